@@ -35,26 +35,78 @@
 
 #include "bt_types.h"
 #include "wiced_bt_cfg.h"
+#include "wiced_bt_dev.h"
 #include "hci_control_api.h"
+#include "handsfree_hci_api.h"
 #include "wiced_bt_hfp_hf_int.h"
 #include "wiced_bt_audio.h"
 #include "wiced_bt_utils.h"
+#include "wiced_transport.h"
+
+/*
+ * Capacity profile. Stack configuration, memory pre-init and application pools are
+ * derived from these values, override them from the makefile (CY_APP_DEFINES) to size
+ * the application for a product. Features that are not enabled are configured with no
+ * links and no buffers.
+ */
+#define HANDSFREE_CAP_HF_CONNECTIONS            WICED_BT_HFP_HF_MAX_CONN        /* Simultaneous AGs */
+#ifndef HANDSFREE_CAP_BR_LINKS
+#define HANDSFREE_CAP_BR_LINKS                  ( HANDSFREE_CAP_HF_CONNECTIONS + 1 )  /* One spare for pairing a new AG */
+#endif
+#ifndef HANDSFREE_CAP_BONDS
+#define HANDSFREE_CAP_BONDS                     10
+#endif
+#ifndef HANDSFREE_CAP_LE_LINKS
+#define HANDSFREE_CAP_LE_LINKS                  1       /* LE is only used for address resolution of bonded devices */
+#endif
+#ifndef HANDSFREE_CAP_LE_ADV_SETS
+#define HANDSFREE_CAP_LE_ADV_SETS               0       /* The application does not advertise */
+#endif
+#ifndef HANDSFREE_CAP_A2DP
+#define HANDSFREE_CAP_A2DP                      0       /* A2DP sink and AVRCP links */
+#endif
+
+#define HANDSFREE_CAP_A2DP_LINKS                ( HANDSFREE_CAP_A2DP ? 1 : 0 )
+#define HANDSFREE_CAP_A2DP_SEPS                 ( HANDSFREE_CAP_A2DP ? 3 : 0 )
+
+#ifndef HANDSFREE_CAP_RX_BUFFERS
+#define HANDSFREE_CAP_RX_BUFFERS                2       /* Host commands that can be queued in the transport */
+#endif
+#define HANDSFREE_CAP_RX_BUFFER_SIZE            TRANS_UART_BUFFER_SIZE
+
+/* Pools created by the application: key info, transport RX, fragment reassembly, NVRAM record slabs */
+#define HANDSFREE_RECORD_SLAB_COUNT             3
+#define HANDSFREE_APP_BUFFER_POOLS              ( 3 + HANDSFREE_RECORD_SLAB_COUNT )
 
 // SDP Record for Hands-Free Unit
 #define HDLR_HANDS_FREE_UNIT                    0x10001
 #define HDLR_HEADSET_UNIT                       0x10002
+#define HDLR_A2DP_SINK                          0x10003
 #define HANDS_FREE_SCN                          0x01
 #define HEADSET_SCN                             0x02
 #define HANDS_FREE_DEVICE_NAME                  "free-hands"
 #define BT_AUDIO_HFP_VOLUME_MIN                 1
 #define BT_AUDIO_HFP_VOLUME_MAX                 15
+#define BT_AUDIO_HFP_VOLUME_DEFAULT             8
 #define TRANS_UART_BUFFER_SIZE                  1024
 #define BT_AUDIO_INVALID_SCO_INDEX              0xFFFF
 #define HANDSFREE_NVRAM_ID                      0x46
 
 #define WICED_HS_EIR_BUF_MAX_SIZE               264
+
+/*
+ * Hot path placement. In XIP builds code runs from flash through the cache; functions
+ * tagged HANDSFREE_HOT are put in HANDSFREE_HOT_SECTION instead, which the linker script
+ * of the target must place in RAM. Set HOT_CODE_SECTION in the makefile to enable, see
+ * host/hot_placement.py to choose functions from a call count profile.
+ */
+#ifdef HANDSFREE_HOT_SECTION
+#define HANDSFREE_HOT                           __attribute__( ( section( HANDSFREE_HOT_SECTION ), noinline ) )
+#else
+#define HANDSFREE_HOT
+#endif
 #define KEY_INFO_POOL_BUFFER_SIZE               145 //Size of the buffer used for holding the peer device key info
-#define KEY_INFO_POOL_BUFFER_COUNT              10  //Correspond's to the number of peer devices
+#define KEY_INFO_POOL_BUFFER_COUNT              HANDSFREE_CAP_BONDS  //Correspond's to the number of peer devices
 
 extern const wiced_bt_cfg_settings_t handsfree_cfg_settings;
 #ifndef BTSTACK_VER
@@ -63,6 +115,64 @@ extern const wiced_bt_cfg_buf_pool_t handsfree_cfg_buf_pools[];
 extern const wiced_bt_audio_config_buffer_t handsfree_audio_buf_config;
 extern uint32_t  hci_control_proc_rx_cmd( uint8_t *p_data, uint32_t length );
 
+/* Host interface transport, see handsfree_transport.c */
+typedef struct
+{
+    wiced_result_t (*init)( const wiced_transport_cfg_t *p_cfg );
+    /* One packet whose payload is p_data followed by p_tail, p_tail may be NULL */
+    wiced_result_t (*send)( uint16_t code, uint8_t *p_data, uint16_t length, const uint8_t *p_tail, uint16_t tail_length );
+    void           (*free_rx_buffer)( uint8_t *p_buf );     /* Release a buffer passed to p_data_handler */
+} handsfree_transport_t;
+
+extern const handsfree_transport_t *p_handsfree_transport;
+
+/* Performance counters, see HANDSFREE_COUNTER_LIST in handsfree_hci_api.h */
+#define HANDSFREE_COUNTER_ENUM( name )          HANDSFREE_COUNTER_##name,
+enum
+{
+    HANDSFREE_COUNTER_LIST( HANDSFREE_COUNTER_ENUM )
+    HANDSFREE_COUNTER_MAX
+};
+
+#define HANDSFREE_COUNT( name )                 ( handsfree_counters[HANDSFREE_COUNTER_##name]++ )
+
+extern void hci_control_counters_handle_get( uint8_t *p_data, uint32_t data_len );
+extern void hci_control_dispatch_cmd( uint16_t opcode, uint8_t *p_data, uint16_t payload_len );
+extern wiced_result_t hci_control_send_data( uint16_t code, uint8_t *p_data, uint16_t length );
+extern wiced_result_t hci_control_transport_send( uint16_t code, uint8_t *p_data, uint16_t length );
+extern void hci_control_send_command_status_evt( uint16_t code, uint8_t status );
+
+/* Host protocol v2 */
+extern uint16_t hci_control_crc16( const uint8_t *p_data, uint32_t length );
+extern void hci_control_v2_reset( void );
+extern wiced_bool_t hci_control_v2_is_enabled( void );
+extern void hci_control_v2_handle_set_protocol( uint8_t *p_data, uint32_t data_len );
+extern void hci_control_v2_handle_frame( uint8_t *p_data, uint32_t data_len );
+extern wiced_result_t hci_control_v2_send( uint16_t code, uint8_t *p_data, uint16_t length, const uint8_t *p_tail, uint16_t tail_length );
+
+/* Fragmented host commands */
+extern void hci_control_frag_init( void );
+extern void hci_control_frag_reset( void );
+extern void hci_control_frag_handle( uint8_t *p_data, uint32_t data_len );
+
+/* Event timestamps */
+extern void hci_control_time_reset( void );
+extern wiced_bool_t hci_control_time_is_enabled( void );
+#define HCI_TIME_TRAILER_LEN                    6       /* timestamp_us(4) seq(2) */
+extern uint16_t hci_control_time_stamp( uint16_t length, uint8_t *p_trailer );
+extern void hci_control_time_handle_set( uint8_t *p_data, uint32_t data_len );
+extern void hci_control_time_handle_sync( uint8_t *p_data, uint32_t data_len );
+
+#if defined(OTA_FW_UPGRADE) && !defined(BTSTACK_VER)
+/* Firmware update over the host transport */
+extern void hci_control_ota_handle_command( uint16_t opcode, uint8_t *p_data, uint32_t data_len );
+#endif
+
+#ifdef HANDSFREE_LATENCY_PROBE
+/* Latency probe on the app voice path */
+extern void hci_control_latency_probe_handle( uint8_t *p_data, uint32_t data_len );
+#endif
+
 extern const uint8_t handsfree_sdp_db[];
 
 #ifndef BTM_SCO_PKT_TYPES_MASK_HV1
@@ -137,6 +247,35 @@ typedef enum
     WICED_BT_HFP_HF_ROAM_IND        =   6,
     WICED_BT_HFP_HF_BATTERY_IND     =   7
 }wiced_bt_hfp_hf_indicator_t;
+#define HANDSFREE_AG_CACHE_VALID                0xA5
+#define HANDSFREE_AG_CACHE_V1_SIZE              8       /* valid .. ag_features */
+
+/*
+ * Per-bond AG capabilities learned during the previous SLC, stored as a typed record of
+ * type HANDSFREE_RECORD_TYPE_AG_CACHE next to the bond record and synced to the host
+ * like it. Fields are only ever appended or take over reserved bytes, the stored length
+ * tells the layout version: caches of HANDSFREE_AG_CACHE_V1_SIZE bytes predate the gains
+ * and read back with mic_volume 0.
+ */
+typedef struct
+{
+    uint8_t                                 valid;              /* HANDSFREE_AG_CACHE_VALID if populated */
+    uint8_t                                 last_codec;         /* Codec selected by the AG on the last +BCS */
+    uint8_t                                 reserved0;          /* Was the HF indicator mask, +BIND comes on every SLC */
+    uint8_t                                 spkr_volume;        /* Last +VGS level, 0 if never set */
+    uint32_t                                ag_features;        /* AG supported features from +BRSF */
+    uint8_t                                 mic_volume;         /* Last +VGM level, 0 if never set */
+    uint8_t                                 reserved[3];
+} handsfree_ag_cache_t;
+
+/* AG cache record, indexed by the nvram_id of the bond */
+typedef struct
+{
+    wiced_bt_device_address_t               bd_addr;            /* A record left by an earlier bond of the id is ignored */
+    uint8_t                                 reserved[2];
+    handsfree_ag_cache_t                    ag_cache;
+} handsfree_ag_cache_record_t;
+
 typedef struct
 {
     wiced_bt_device_address_t               peer_bd_addr;
@@ -151,10 +290,12 @@ typedef struct
     uint16_t                                rfcomm_handle;
     wiced_bool_t                            init_sco_conn;
     wiced_bool_t                            is_sco_connected;
+    wiced_bool_t                            vr_active;          /* Voice recognition session, see handsfree_voice_rec.c */
+    uint8_t                                 vr_at_state;        /* Its AT+BCC, HANDSFREE_VR_AT_* */
+    handsfree_ag_cache_t                    ag_cache;
+    wiced_bool_t                            ag_cache_dirty;
 } bluetooth_hfp_context_t;
 
-extern bluetooth_hfp_context_t handsfree_ctxt_data;
-
 /* data associated with HF_OPEN_EVT */
 typedef struct
 {
@@ -191,7 +332,79 @@ typedef struct
     wiced_timer_t hfp_timer;
 } handsfrees_app_globals;
 
-extern handsfrees_app_globals handsfree_app_states;
+extern void handsfree_set_volume( uint8_t type, uint8_t level );
+
+/* Voice recognition sessions */
+extern wiced_bt_sco_params_t *handsfree_sco_params( void );
+extern uint32_t handsfree_sco_wait_timeout( void );
+/* AT+BCC of a voice recognition session, bluetooth_hfp_context_t vr_at_state */
+#define HANDSFREE_VR_AT_IDLE                    0
+#define HANDSFREE_VR_AT_BVRA                    1       /* AT+BVRA sent, AT+BCC follows its OK */
+#define HANDSFREE_VR_AT_BCC                     2       /* AT+BCC sent, its answer is not for the host */
+
+extern void handsfree_vr_start( uint16_t handle, int value );
+extern void handsfree_vr_stop( uint16_t handle );
+extern void handsfree_vr_end( void );
+extern wiced_bool_t handsfree_vr_at_result( uint16_t handle, wiced_bool_t ok );
+extern wiced_bool_t handsfree_vr_text_handle( uint16_t handle, const char *p_at );
+
+/* Per-call quality record */
+extern void handsfree_call_stats_setup_start( void );
+extern void handsfree_call_stats_params( const wiced_bt_sco_params_t *p_params );
+extern void handsfree_call_stats_sco_up( void );
+extern void handsfree_call_stats_sco_down( uint16_t handle, uint8_t reason );
+extern void handsfree_call_stats_rssi( int8_t rssi );
+extern void handsfree_call_stats_volume_change( void );
+
+#ifdef HANDSFREE_LATENCY_PROBE
+/* Latency probe, see handsfree_latency_probe.c */
+#define HANDSFREE_PROBE_ORDER_MAX               10      /* Longest sequence 2^10 - 1 samples */
+
+extern void handsfree_latency_probe_sco_data( uint16_t sco_channel, uint16_t length, uint8_t *p_data );
+extern void handsfree_latency_probe_sco_down( void );
+#endif
+
+/* Link quality monitor */
+extern void handsfree_link_monitor_start( wiced_bt_device_address_t bd_addr );
+extern void handsfree_link_monitor_stop( void );
+extern void handsfree_link_monitor_sco_lost( uint8_t reason );
+extern void handsfree_link_monitor_adjust( wiced_bt_sco_params_t *p_params );
+extern void hci_control_hf_send_at_cmd( uint16_t handle, char *cmd, uint8_t arg_type, uint8_t arg_format, const char *p_arg, int16_t int_arg );
+
+#if defined(CYW20721B2) || defined(CYW43012C0) || defined(CYW55572A1)
+#include "wiced_audio_manager.h"
+
+/* Audio manager parameter cache, see handsfree_audio.c */
+#ifndef HANDSFREE_AUDIO_SHADOW
+#define HANDSFREE_AUDIO_SHADOW                  1       /* 0 applies every setting as it comes, for comparison */
+#endif
+
+extern void handsfree_audio_stream_reset( void );
+extern wiced_result_t handsfree_audio_set_config( int32_t stream_id, audio_config_t *p_config );
+extern wiced_result_t handsfree_audio_start( int32_t stream_id );
+extern wiced_result_t handsfree_audio_set_gains( int32_t stream_id, int32_t volume, int32_t mic_gain );
+extern void handsfree_audio_update_gains( int32_t stream_id, int32_t volume, int32_t mic_gain );
+
+/* Audio path arbitration between calls and music */
+extern void handsfree_audio_arbiter_call_start( void );
+extern void handsfree_audio_arbiter_call_end( void );
+extern wiced_bool_t handsfree_audio_arbiter_music_start( void );
+extern void handsfree_audio_arbiter_music_stop( void );
+extern void handsfree_call_audio_prewarm( void );
+extern void handsfree_call_audio_release( void );
+extern void handsfree_call_audio_check_idle( void );
+
+#if HANDSFREE_CAP_A2DP && !defined(BTSTACK_VER)
+extern void handsfree_a2dp_sink_init( void );
+extern wiced_bool_t handsfree_a2dp_sink_pause( void );
+extern void handsfree_a2dp_sink_resume( void );
+#endif
+#endif
+
+extern void handsfree_hf_ind_init( void );
+extern void handsfree_hf_ind_reset( uint16_t handle );
+extern void handsfree_hf_ind_bind( uint16_t handle, uint8_t ind_id, uint8_t enabled );
+extern wiced_bool_t handsfree_hf_ind_update( uint16_t handle, uint8_t ind_id, uint16_t value );
 
 /* External Function Definitions */
 extern uint16_t wiced_app_cfg_sdp_record_get_size(void);
@@ -202,3 +415,245 @@ extern int hci_control_alloc_nvram_id( );
 extern int hci_control_write_nvram( int nvram_id, int data_len, void *p_data, wiced_bool_t from_host );
 extern int hci_control_read_nvram( int nvram_id, void *p_data, int data_len );
 extern void hci_control_delete_nvram( int nvram_id ,wiced_bool_t from_host);
+/*
+ * NVRAM records. The high byte of the nvram_id is the record type, bond records
+ * (type 0) keep the historical ids so that stores saved by older firmware stay valid.
+ */
+#define HANDSFREE_RECORD_TYPE_BOND              0x00
+#define HANDSFREE_RECORD_TYPE_AG_CACHE          0x01    /* handsfree_ag_cache_record_t, index is the bond nvram_id */
+#define HANDSFREE_RECORD_TYPE( nvram_id )       ( ( ( nvram_id ) >> 8 ) & 0xff )
+#define HANDSFREE_RECORD_ID( type, index )      ( ( ( type ) << 8 ) | ( index ) )
+#define HANDSFREE_RECORD_MAX_LEN                512
+
+extern void hci_control_nvram_init( void );
+extern void hci_control_nvram_restore( uint8_t *p_data, uint32_t data_len );
+extern int hci_control_record_write( uint8_t type, uint8_t index, const void *p_data, uint16_t data_len );
+extern int hci_control_record_read( uint8_t type, uint8_t index, void *p_data, uint16_t data_len );
+extern void hci_control_record_delete( uint8_t type, uint8_t index );
+extern wiced_bool_t hci_control_read_ag_cache( wiced_bt_device_address_t bd_addr, handsfree_ag_cache_t *p_cache );
+extern wiced_bool_t hci_control_write_ag_cache( wiced_bt_device_address_t bd_addr, const handsfree_ag_cache_t *p_cache );
+
+/*
+ * Module state kept per device in handsfree_instance_t, see the module for the fields.
+ */
+
+/* handsfree_hci_v2.c */
+#define HCI_V2_HDR_LEN                          6       /* seq(1) ack(1) opcode(2) len(2) */
+#define HCI_V2_CRC_LEN                          2
+#define HCI_V2_OVERHEAD                         ( HCI_V2_HDR_LEN + HCI_V2_CRC_LEN )
+
+typedef struct
+{
+    wiced_bool_t         enabled;
+    uint8_t              window;
+    uint8_t              tx_seq;                /* Seq of the next new frame */
+    uint8_t              tx_base;               /* Seq of the oldest unacked frame */
+    uint8_t              rx_expected;           /* Seq expected next from the host */
+    uint8_t              in_flight;
+    uint8_t              queued;
+    uint8_t              retries;
+    wiced_bool_t         ack_pending;
+    wiced_bool_t         fast_resent;           /* Window resent on a duplicate ack, until new data is acked */
+    struct hci_v2_frame *p_unacked;             /* Sent, waiting for ack, ordered by seq */
+    struct hci_v2_frame *p_backlog;             /* Not sent yet, window is full */
+} hci_v2_cb_t;
+
+/* handsfree_hci_frag.c */
+/*
+ * Largest command sent in fragments, an NVRAM_RESTORE of the records of a device. The
+ * general pools end at about a transport buffer, so reassembly has a pool of its own.
+ */
+#define HCI_FRAG_MAX_LEN                        4096
+
+typedef struct
+{
+    wiced_bool_t    active;
+    uint8_t         xfer_id;
+    uint16_t        opcode;
+    uint16_t        total_len;
+    uint16_t        next_offset;
+    uint8_t         unacked;                    /* Fragments received since the last ack */
+    wiced_bool_t    nak_sent;                   /* Suppress repeated naks until the host rewinds */
+    uint8_t        *p_buf;                      /* The reassembly buffer while active */
+} hci_frag_cb_t;
+
+/* handsfree_wiced_hci.c */
+/*
+ * Commands up to this size are copied out of the transport buffer and the buffer is
+ * released before the command is handled, so that the transport can receive the next
+ * command while a slow handler (NVRAM write, audio setup) runs. The largest command
+ * copied is a PUSH_NVRAM_DATA of a typed record in a v2 frame. Bulk data, fragments and
+ * OTA DATA, is handled in place.
+ */
+#define HCI_CONTROL_RX_COPY_MAX                 ( HCI_V2_OVERHEAD + 2 + HANDSFREE_RECORD_MAX_LEN )
+
+/* handsfree_hf_indicator.c */
+typedef struct
+{
+    wiced_bool_t    enabled;        /* Enabled by the AG with +BIND */
+    wiced_bool_t    pending;        /* Update deferred until the report interval expires */
+    uint16_t        value;          /* Latest value from the host */
+    uint16_t        sent_value;     /* Value last reported to the AG */
+} hf_ind_state_t;
+
+typedef struct
+{
+    uint16_t        handle;         /* RFCOMM handle of the link, HF_IND_HANDLE_INVALID if free */
+    wiced_timer_t   timer;          /* Report interval of the link */
+    hf_ind_state_t  ind[HANDSFREE_HF_IND_MAX + 1];
+} hf_ind_link_t;
+
+/* handsfree_call_stats.c */
+typedef struct
+{
+    wiced_bool_t    setup_pending;
+    wiced_bool_t    sco_up;
+    uint64_t        setup_start_us;
+    uint64_t        sco_up_us;
+    uint16_t        setup_ms;
+    uint16_t        packet_types;
+    uint16_t        max_latency;
+    uint8_t         retrans_effort;
+    uint8_t         codec;
+    int8_t          rssi_min;
+    int32_t         rssi_sum;
+    uint8_t         rssi_samples;
+    uint8_t         volume_changes;
+} handsfree_call_stats_t;
+
+/* handsfree_link_monitor.c */
+typedef struct
+{
+    wiced_bool_t                active;
+    wiced_bool_t                poor;
+    wiced_bool_t                have_sample;
+    int16_t                     rssi_avg;           /* Smoothed RSSI << HANDSFREE_LINKQ_RSSI_SHIFT */
+    wiced_bt_device_address_t   bd_addr;
+} handsfree_linkq_cb_t;
+
+#if defined(OTA_FW_UPGRADE) && !defined(BTSTACK_VER)
+/* handsfree_ota.c */
+#define HANDSFREE_OTA_RING_SIZE                 2048    /* Match window, power of 2 and multiple of the page */
+
+typedef struct
+{
+    wiced_bool_t    active;
+    uint8_t         format;
+    uint32_t        image_len;
+    uint32_t        image_crc;
+    uint32_t        next_offset;            /* Next expected stream offset */
+    uint32_t        out_len;                /* Image bytes decoded so far */
+    uint32_t        flushed;                /* Image bytes written to flash */
+    uint32_t        crc;                    /* CRC32 of the flushed bytes */
+    uint8_t         unacked;
+    wiced_bool_t    nak_sent;
+
+    uint8_t         lz_state;
+    uint32_t        lz_literal_len;
+    uint32_t        lz_match_len;
+    uint16_t        lz_match_offset;
+} handsfree_ota_cb_t;
+#endif
+
+#if defined(CYW20721B2) || defined(CYW43012C0) || defined(CYW55572A1)
+/* handsfree_audio.c */
+typedef struct
+{
+    int32_t         stream_id;
+    wiced_bool_t    config_valid;
+    audio_config_t  config;
+    wiced_bool_t    volume_valid;
+    int32_t         volume;
+    wiced_bool_t    mic_gain_valid;
+    int32_t         mic_gain;
+    wiced_bool_t    gains_pending;              /* Gains waiting for handsfree_audio_flush() */
+    wiced_bool_t    flush_scheduled;
+    int32_t         pending_volume;
+    int32_t         pending_mic_gain;
+} handsfree_audio_shadow_t;
+
+typedef enum
+{
+    HANDSFREE_AUDIO_OWNER_NONE,
+    HANDSFREE_AUDIO_OWNER_MUSIC,
+    HANDSFREE_AUDIO_OWNER_CALL,
+} handsfree_audio_owner_t;
+
+#if HANDSFREE_CAP_A2DP && !defined(BTSTACK_VER)
+/* handsfree_a2dp_sink.c */
+typedef struct
+{
+    uint16_t        handle;             /* AVDT handle of the connected source */
+    uint32_t        sample_rate;        /* From the last codec configuration */
+    wiced_bool_t    streaming;
+    int32_t         stream_id;          /* Audio manager stream */
+} handsfree_a2dp_sink_cb_t;
+#endif
+#endif
+
+/*
+ * Per device state. The firmware runs a single instance; a host build running several
+ * devices in one process (host/handsfree_sim.c) selects the instance a thread works on
+ * with handsfree_instance_select() before calling into the application. The module
+ * fields are reached through macros of the same name in each module.
+ */
+typedef struct
+{
+    bluetooth_hfp_context_t                 ctxt_data;
+    handsfrees_app_globals                  app_states;
+    struct hci_control_nvram_chunk          *p_nvram_first;     /* NVRAM records, see handsfree_nvram.c */
+    wiced_bt_buffer_pool_t                  *p_key_info_pool;   /* Bond record buffers */
+    wiced_bt_buffer_pool_t                  *p_record_pools[HANDSFREE_RECORD_SLAB_COUNT];  /* Other typed records */
+    wiced_bt_sco_params_t                   handsfree_esco_params;
+    wiced_bt_sco_params_t                   handsfree_next_sco_params;
+    uint32_t                                handsfree_counters[HANDSFREE_COUNTER_MAX];
+
+    hci_v2_cb_t                             hci_v2_cb;
+    wiced_timer_t                           hci_v2_retransmit_timer;
+    wiced_bool_t                            hci_v2_timer_initialized;
+    hci_frag_cb_t                           hci_frag_cb;
+    wiced_bt_buffer_pool_t                  *hci_frag_pool;     /* One HCI_FRAG_MAX_LEN buffer */
+    wiced_bool_t                            hci_time_enabled;
+    uint16_t                                hci_time_seq;
+#ifndef BTSTACK_VER
+    uint8_t                                 hci_control_rx_copy[HCI_CONTROL_RX_COPY_MAX];
+#endif
+
+    hf_ind_link_t                           hf_ind_link[WICED_BT_HFP_HF_MAX_CONN];
+    handsfree_call_stats_t                  handsfree_call_stats;
+    handsfree_linkq_cb_t                    handsfree_linkq_cb;
+    wiced_timer_t                           handsfree_linkq_timer;
+    wiced_bool_t                            handsfree_linkq_timer_initialized;
+
+#if defined(OTA_FW_UPGRADE) && !defined(BTSTACK_VER)
+    handsfree_ota_cb_t                      handsfree_ota_cb;
+    uint8_t                                 handsfree_ota_ring[HANDSFREE_OTA_RING_SIZE];
+    wiced_timer_t                           handsfree_ota_reset_timer;
+    wiced_bool_t                            handsfree_ota_timer_initialized;
+#endif
+
+#if defined(CYW20721B2) || defined(CYW43012C0) || defined(CYW55572A1)
+    int32_t                                 stream_id;          /* HFP audio manager stream, see handsfree_main.c */
+    audio_config_t                          audio_config;
+    handsfree_audio_shadow_t                handsfree_audio_shadow;
+    handsfree_audio_owner_t                 handsfree_audio_owner;
+    wiced_bool_t                            handsfree_audio_music_interrupted;
+#if HANDSFREE_CAP_A2DP && !defined(BTSTACK_VER)
+    handsfree_a2dp_sink_cb_t                handsfree_a2dp_sink_cb;
+#endif
+#endif
+} handsfree_instance_t;
+
+#ifdef HANDSFREE_HOST_BUILD
+extern _Thread_local handsfree_instance_t *p_handsfree_instance;
+#else
+extern handsfree_instance_t *p_handsfree_instance;
+#endif
+
+#define handsfree_ctxt_data                 ( p_handsfree_instance->ctxt_data )
+#define handsfree_app_states                ( p_handsfree_instance->app_states )
+#define p_key_info_pool                     ( p_handsfree_instance->p_key_info_pool )
+#define handsfree_esco_params               ( p_handsfree_instance->handsfree_esco_params )
+#define handsfree_counters                  ( p_handsfree_instance->handsfree_counters )
+
+extern handsfree_instance_t *handsfree_instance_select( handsfree_instance_t *p_instance );
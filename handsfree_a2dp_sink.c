@@ -0,0 +1,221 @@
+/*
+ * Copyright 2016-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+/** @file
+ *
+ * A2DP sink role running alongside HFP.
+ *
+ * Music plays through an audio manager A2DP stream. The audio arbiter in
+ * handsfree_audio.c gives calls priority: music is suspended on RING or codec
+ * negotiation, and restarted when the call is over. Built when HANDSFREE_CAP_A2DP is
+ * set (make A2DP_SINK=1).
+ */
+
+#include "wiced_bt_trace.h"
+#include "handsfree.h"
+#include "string.h"
+
+#if HANDSFREE_CAP_A2DP && !defined(BTSTACK_VER) && ( defined(CYW20721B2) || defined(CYW43012C0) )
+
+#include "wiced_bt_a2dp_sink.h"
+
+#define HANDSFREE_A2DP_INVALID_HANDLE   0
+
+/* Per device, see handsfree_instance_t */
+#define handsfree_a2dp_sink_cb          ( p_handsfree_instance->handsfree_a2dp_sink_cb )
+
+static wiced_bt_a2dp_codec_info_t handsfree_a2dp_codec_capabilities =
+{
+    .codec_id = WICED_BT_A2DP_CODEC_SBC,
+    .cie =
+    {
+        .sbc =
+        {
+            ( A2D_SBC_IE_SAMP_FREQ_44 | A2D_SBC_IE_SAMP_FREQ_48 ),
+            ( A2D_SBC_IE_CH_MD_MONO | A2D_SBC_IE_CH_MD_STEREO | A2D_SBC_IE_CH_MD_JOINT | A2D_SBC_IE_CH_MD_DUAL ),
+            ( A2D_SBC_IE_BLOCKS_16 | A2D_SBC_IE_BLOCKS_12 | A2D_SBC_IE_BLOCKS_8 | A2D_SBC_IE_BLOCKS_4 ),
+            ( A2D_SBC_IE_SUBBAND_4 | A2D_SBC_IE_SUBBAND_8 ),
+            ( A2D_SBC_IE_ALLOC_MD_L | A2D_SBC_IE_ALLOC_MD_S ),
+            A2D_SBC_IE_MIN_BITPOOL,
+            A2D_SBC_IE_MAX_BITPOOL
+        }
+    }
+};
+
+static wiced_bt_a2dp_config_data_t handsfree_a2dp_config =
+{
+    .feature_mask = 0,
+    .codec_capabilities =
+    {
+        .count = 1,
+        .info  = &handsfree_a2dp_codec_capabilities,
+    },
+    .p_param =
+    {
+        .buf_depth_ms                  = 300,
+        .start_buf_depth               = 50,
+        .target_buf_depth              = 50,
+        .overrun_control               = WICED_BT_A2DP_SINK_OVERRUN_CONTROL_FLUSH_DATA,
+        .adj_ppm_max                   = +300,
+        .adj_ppm_min                   = -300,
+        .adj_ppb_per_msec              = 200,
+        .lvl_correction_threshold_high = +2000,
+        .lvl_correction_threshold_low  = -2000,
+        .adj_proportional_gain         = 20,
+        .adj_integral_gain             = 2,
+    },
+};
+
+static void handsfree_a2dp_sink_audio_start( void )
+{
+    audio_config_t config =
+    {
+        .sr              = handsfree_a2dp_sink_cb.sample_rate,
+        .channels        = 2,
+        .bits_per_sample = DEFAULT_BITSPSAM,
+        .volume          = AM_VOL_LEVEL_HIGH - 2,
+        .mic_gain        = 0,
+        .sink            = AM_HEADPHONES,
+    };
+
+    if ( handsfree_a2dp_sink_cb.stream_id == WICED_AUDIO_MANAGER_STREAM_ID_INVALID )
+        handsfree_a2dp_sink_cb.stream_id = wiced_am_stream_open( A2DP_SINK );
+
+    if ( WICED_SUCCESS != wiced_am_stream_set_param( handsfree_a2dp_sink_cb.stream_id, AM_AUDIO_CONFIG, &config ) )
+        WICED_BT_TRACE( "a2dp sink: set_param failed\n" );
+
+    if ( WICED_SUCCESS != wiced_am_stream_start( handsfree_a2dp_sink_cb.stream_id ) )
+        WICED_BT_TRACE( "a2dp sink: stream start failed\n" );
+
+    handsfree_a2dp_sink_cb.streaming = WICED_TRUE;
+}
+
+static void handsfree_a2dp_sink_audio_stop( void )
+{
+    if ( handsfree_a2dp_sink_cb.stream_id != WICED_AUDIO_MANAGER_STREAM_ID_INVALID )
+    {
+        wiced_am_stream_stop( handsfree_a2dp_sink_cb.stream_id );
+        wiced_am_stream_close( handsfree_a2dp_sink_cb.stream_id );
+        handsfree_a2dp_sink_cb.stream_id = WICED_AUDIO_MANAGER_STREAM_ID_INVALID;
+    }
+    if ( handsfree_a2dp_sink_cb.streaming )
+    {
+        handsfree_a2dp_sink_cb.streaming = WICED_FALSE;
+        handsfree_audio_arbiter_music_stop( );
+    }
+}
+
+static void handsfree_a2dp_sink_control_cback( wiced_bt_a2dp_sink_event_t event, wiced_bt_a2dp_sink_event_data_t *p_data )
+{
+    switch ( event )
+    {
+    case WICED_BT_A2DP_SINK_CONNECT_EVT:
+        if ( p_data->connect.result == WICED_SUCCESS )
+        {
+            handsfree_a2dp_sink_cb.handle = p_data->connect.handle;
+            WICED_BT_TRACE( "a2dp sink: connected %B handle:%d\n", p_data->connect.bd_addr, p_data->connect.handle );
+        }
+        break;
+
+    case WICED_BT_A2DP_SINK_DISCONNECT_EVT:
+        handsfree_a2dp_sink_audio_stop( );
+        handsfree_a2dp_sink_cb.handle = HANDSFREE_A2DP_INVALID_HANDLE;
+        break;
+
+    case WICED_BT_A2DP_SINK_CODEC_CONFIG_EVT:
+        handsfree_a2dp_sink_cb.sample_rate =
+                ( p_data->codec_config.codec.cie.sbc.samp_freq == A2D_SBC_IE_SAMP_FREQ_48 ) ? AM_PLAYBACK_SR_48K : AM_PLAYBACK_SR_44K;
+        break;
+
+    case WICED_BT_A2DP_SINK_START_IND_EVT:
+        /* A call owns the audio path, refuse music until it is over */
+        if ( !handsfree_audio_arbiter_music_start( ) )
+        {
+            WICED_BT_TRACE( "a2dp sink: start refused, call in progress\n" );
+            wiced_bt_a2dp_sink_send_start_response( p_data->start_ind.handle, p_data->start_ind.label, A2D_BUSY );
+            break;
+        }
+        wiced_bt_a2dp_sink_send_start_response( p_data->start_ind.handle, p_data->start_ind.label, A2D_SUCCESS );
+        handsfree_a2dp_sink_audio_start( );
+        break;
+
+    case WICED_BT_A2DP_SINK_START_CFM_EVT:
+        if ( ( p_data->start_cfm.result == WICED_SUCCESS ) && handsfree_audio_arbiter_music_start( ) )
+            handsfree_a2dp_sink_audio_start( );
+        break;
+
+    case WICED_BT_A2DP_SINK_SUSPEND_EVT:
+        handsfree_a2dp_sink_audio_stop( );
+        break;
+
+    default:
+        break;
+    }
+}
+
+void handsfree_a2dp_sink_init( void )
+{
+    wiced_result_t result;
+
+    memset( &handsfree_a2dp_sink_cb, 0, sizeof( handsfree_a2dp_sink_cb ) );
+    handsfree_a2dp_sink_cb.stream_id = WICED_AUDIO_MANAGER_STREAM_ID_INVALID;
+
+    result = wiced_bt_a2dp_sink_init( &handsfree_a2dp_config, handsfree_a2dp_sink_control_cback );
+
+    WICED_BT_TRACE( "a2dp sink init:%d\n", result );
+}
+
+/*
+ * Suspend music for a call. Returns WICED_TRUE if music was playing.
+ */
+wiced_bool_t handsfree_a2dp_sink_pause( void )
+{
+    if ( !handsfree_a2dp_sink_cb.streaming || ( handsfree_a2dp_sink_cb.handle == HANDSFREE_A2DP_INVALID_HANDLE ) )
+        return WICED_FALSE;
+
+    /* Release the codec right away, the call stream is opened next */
+    wiced_bt_a2dp_sink_suspend( handsfree_a2dp_sink_cb.handle );
+    handsfree_a2dp_sink_audio_stop( );
+    return WICED_TRUE;
+}
+
+/*
+ * Restart music interrupted by a call
+ */
+void handsfree_a2dp_sink_resume( void )
+{
+    if ( handsfree_a2dp_sink_cb.handle != HANDSFREE_A2DP_INVALID_HANDLE )
+        wiced_bt_a2dp_sink_start( handsfree_a2dp_sink_cb.handle );
+}
+
+#endif
@@ -0,0 +1,281 @@
+/*
+ * Copyright 2016-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+/** @file
+ *
+ * Audio manager parameter cache.
+ *
+ * Every wiced_am_stream_set_param() turns into register writes to the external codec
+ * over I2C/SPI. The HFP flow sets the same configuration when the codec is negotiated and
+ * again when SCO comes up, and the AG and the host both echo volume changes. The calls
+ * below remember what was last applied to the stream and skip settings that would not
+ * change anything.
+ *
+ * The codec is powered up by wiced_am_stream_start(), gains are written again after it;
+ * closing the stream forgets everything.
+ *
+ * Gain changes during a call are batched: handsfree_audio_update_gains() records the
+ * levels and queues one flush on the application thread, so a burst of changes (a
+ * volume slider on the host, the AG echoing it) reaches the codec as one write of the
+ * final levels. HANDSFREE_AUDIO_SHADOW 0 turns caching and batching off, host/audio_bench
+ * compares both on the codec bus model of the stub.
+ *
+ * The audio arbiter decides who owns the audio path when the A2DP sink is enabled. A call
+ * takes it over from music as soon as it is announced (RING, call setup or codec
+ * negotiation): music is suspended and the HFP stream is opened and configured before
+ * SCO comes up, so that only the stream start remains on the SCO connected path. Music
+ * interrupted by a call is restarted once the call and its audio are gone. A call that
+ * interrupts nothing opens its stream on codec negotiation, as without the arbiter.
+ * host/audio_bench -s measures the switch gaps.
+ */
+
+#include "wiced_bt_trace.h"
+#include "wiced_rtos.h"
+#include "handsfree.h"
+#include "string.h"
+
+#if defined(CYW20721B2) || defined(CYW43012C0) || defined(CYW55572A1)
+
+/* Per device, see handsfree_instance_t */
+#define handsfree_audio_shadow              ( p_handsfree_instance->handsfree_audio_shadow )
+#define handsfree_audio_owner               ( p_handsfree_instance->handsfree_audio_owner )
+#define handsfree_audio_music_interrupted   ( p_handsfree_instance->handsfree_audio_music_interrupted )
+
+/* Settings applied to another stream are of no use */
+static void handsfree_audio_bind( int32_t stream_id )
+{
+    if ( handsfree_audio_shadow.stream_id != stream_id )
+    {
+        handsfree_audio_stream_reset( );
+        handsfree_audio_shadow.stream_id = stream_id;
+    }
+}
+
+/*
+ * Forget the applied settings, called when the stream is closed
+ */
+void handsfree_audio_stream_reset( void )
+{
+    memset( &handsfree_audio_shadow, 0, sizeof( handsfree_audio_shadow ) );
+    handsfree_audio_shadow.stream_id = WICED_AUDIO_MANAGER_STREAM_ID_INVALID;
+}
+
+/*
+ * Apply AM_AUDIO_CONFIG. The configuration carries the gains, so they are considered
+ * applied as well.
+ */
+wiced_result_t handsfree_audio_set_config( int32_t stream_id, audio_config_t *p_config )
+{
+    wiced_result_t result;
+
+    handsfree_audio_bind( stream_id );
+
+    if ( HANDSFREE_AUDIO_SHADOW && handsfree_audio_shadow.config_valid &&
+         ( memcmp( &handsfree_audio_shadow.config, p_config, sizeof( audio_config_t ) ) == 0 ) )
+    {
+        HANDSFREE_COUNT( AUDIO_SUPPRESSED );
+        return WICED_SUCCESS;
+    }
+
+    result = wiced_am_stream_set_param( stream_id, AM_AUDIO_CONFIG, p_config );
+    HANDSFREE_COUNT( AUDIO_APPLIED );
+
+    handsfree_audio_shadow.config_valid = ( result == WICED_SUCCESS );
+    memcpy( &handsfree_audio_shadow.config, p_config, sizeof( audio_config_t ) );
+    handsfree_audio_shadow.volume_valid   = handsfree_audio_shadow.config_valid;
+    handsfree_audio_shadow.volume         = p_config->volume;
+    handsfree_audio_shadow.mic_gain_valid = handsfree_audio_shadow.config_valid;
+    handsfree_audio_shadow.mic_gain       = p_config->mic_gain;
+    return result;
+}
+
+/*
+ * Start the stream, the codec loses its gains when it is powered up
+ */
+wiced_result_t handsfree_audio_start( int32_t stream_id )
+{
+    handsfree_audio_bind( stream_id );
+    handsfree_audio_shadow.volume_valid   = WICED_FALSE;
+    handsfree_audio_shadow.mic_gain_valid = WICED_FALSE;
+
+    return wiced_am_stream_start( stream_id );
+}
+
+/*
+ * Apply the speaker volume and the microphone gain, only the ones that changed
+ */
+wiced_result_t handsfree_audio_set_gains( int32_t stream_id, int32_t volume, int32_t mic_gain )
+{
+    wiced_result_t result = WICED_SUCCESS;
+
+    handsfree_audio_bind( stream_id );
+    handsfree_audio_shadow.gains_pending = WICED_FALSE;
+
+    if ( HANDSFREE_AUDIO_SHADOW && handsfree_audio_shadow.volume_valid && ( handsfree_audio_shadow.volume == volume ) )
+    {
+        HANDSFREE_COUNT( AUDIO_SUPPRESSED );
+    }
+    else
+    {
+        handsfree_audio_shadow.volume = volume;
+        result = wiced_am_stream_set_param( stream_id, AM_SPEAKER_VOL_LEVEL, &handsfree_audio_shadow.volume );
+        handsfree_audio_shadow.volume_valid = ( result == WICED_SUCCESS );
+        HANDSFREE_COUNT( AUDIO_APPLIED );
+    }
+
+    if ( HANDSFREE_AUDIO_SHADOW && handsfree_audio_shadow.mic_gain_valid && ( handsfree_audio_shadow.mic_gain == mic_gain ) )
+    {
+        HANDSFREE_COUNT( AUDIO_SUPPRESSED );
+    }
+    else
+    {
+        handsfree_audio_shadow.mic_gain = mic_gain;
+        if ( wiced_am_stream_set_param( stream_id, AM_MIC_GAIN_LEVEL, &handsfree_audio_shadow.mic_gain ) == WICED_SUCCESS )
+        {
+            handsfree_audio_shadow.mic_gain_valid = WICED_TRUE;
+        }
+        else
+        {
+            handsfree_audio_shadow.mic_gain_valid = WICED_FALSE;
+            result = WICED_ERROR;
+        }
+        HANDSFREE_COUNT( AUDIO_APPLIED );
+    }
+
+    /* Keep the cached configuration in line, it is compared on the next AM_AUDIO_CONFIG */
+    handsfree_audio_shadow.config.volume   = volume;
+    handsfree_audio_shadow.config.mic_gain = mic_gain;
+    return result;
+}
+
+/* Runs on the application thread after the events queued with the first change */
+static int handsfree_audio_flush( void *p_data )
+{
+    handsfree_audio_shadow.flush_scheduled = WICED_FALSE;
+
+    /* Dropped if the stream was closed, or set_gains() applied newer levels meanwhile */
+    if ( handsfree_audio_shadow.gains_pending &&
+         ( handsfree_audio_shadow.stream_id != WICED_AUDIO_MANAGER_STREAM_ID_INVALID ) )
+    {
+        if ( WICED_SUCCESS != handsfree_audio_set_gains( handsfree_audio_shadow.stream_id, handsfree_audio_shadow.pending_volume,
+                                                         handsfree_audio_shadow.pending_mic_gain ) )
+            WICED_BT_TRACE( "wiced_am_set_param failed\n" );
+    }
+    return 0;
+}
+
+/*
+ * Apply new gains to a running stream with the next flush, changes made before it runs
+ * are merged
+ */
+void handsfree_audio_update_gains( int32_t stream_id, int32_t volume, int32_t mic_gain )
+{
+    if ( !HANDSFREE_AUDIO_SHADOW )
+    {
+        handsfree_audio_set_gains( stream_id, volume, mic_gain );
+        return;
+    }
+
+    handsfree_audio_bind( stream_id );
+    handsfree_audio_shadow.pending_volume   = volume;
+    handsfree_audio_shadow.pending_mic_gain = mic_gain;
+    handsfree_audio_shadow.gains_pending    = WICED_TRUE;
+
+    if ( !handsfree_audio_shadow.flush_scheduled &&
+         ( wiced_app_event_serialize( handsfree_audio_flush, NULL ) == WICED_SUCCESS ) )
+        handsfree_audio_shadow.flush_scheduled = WICED_TRUE;
+    else if ( !handsfree_audio_shadow.flush_scheduled )
+        handsfree_audio_flush( NULL );
+}
+
+/*
+ * A call is coming up, take the audio path over and prepare the call stream
+ */
+void handsfree_audio_arbiter_call_start( void )
+{
+    if ( handsfree_audio_owner == HANDSFREE_AUDIO_OWNER_CALL )
+        return;
+
+#if HANDSFREE_CAP_A2DP && !defined(BTSTACK_VER)
+    if ( handsfree_audio_owner == HANDSFREE_AUDIO_OWNER_MUSIC )
+        handsfree_audio_music_interrupted = handsfree_a2dp_sink_pause( );
+#endif
+
+    WICED_BT_TRACE( "audio arbiter: call%s\n", handsfree_audio_music_interrupted ? ", music paused" : "" );
+    handsfree_audio_owner = HANDSFREE_AUDIO_OWNER_CALL;
+
+    /* Without music to take over from, the stream is opened on codec negotiation as usual */
+    if ( handsfree_audio_music_interrupted )
+        handsfree_call_audio_prewarm( );
+}
+
+/*
+ * No call and no call audio left, give the audio path back
+ */
+void handsfree_audio_arbiter_call_end( void )
+{
+    if ( handsfree_audio_owner != HANDSFREE_AUDIO_OWNER_CALL )
+        return;
+
+    handsfree_audio_owner = HANDSFREE_AUDIO_OWNER_NONE;
+    handsfree_call_audio_release( );
+
+    if ( handsfree_audio_music_interrupted )
+    {
+        WICED_BT_TRACE( "audio arbiter: resume music\n" );
+        handsfree_audio_music_interrupted = WICED_FALSE;
+#if HANDSFREE_CAP_A2DP && !defined(BTSTACK_VER)
+        handsfree_a2dp_sink_resume( );
+#endif
+    }
+}
+
+/*
+ * Music wants to play, returns WICED_FALSE while a call owns the audio path
+ */
+wiced_bool_t handsfree_audio_arbiter_music_start( void )
+{
+    if ( handsfree_audio_owner == HANDSFREE_AUDIO_OWNER_CALL )
+        return WICED_FALSE;
+
+    handsfree_audio_owner = HANDSFREE_AUDIO_OWNER_MUSIC;
+    return WICED_TRUE;
+}
+
+void handsfree_audio_arbiter_music_stop( void )
+{
+    if ( handsfree_audio_owner == HANDSFREE_AUDIO_OWNER_MUSIC )
+        handsfree_audio_owner = HANDSFREE_AUDIO_OWNER_NONE;
+}
+
+#endif
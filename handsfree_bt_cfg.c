@@ -49,6 +49,8 @@
  * wiced_bt core stack configuration
  ****************************************************************************/
 
+#define HANDSFREE_CFG_BUF_POOL_COUNT    4   /* Entries in handsfree_cfg_buf_pools */
+
 uint8_t uuid_list[] =
 {
     0x08, 0x11, /* Headset */
@@ -133,24 +135,24 @@ const wiced_bt_cfg_l2cap_application_t wiced_bt_cfg_l2cap_app = /* Application m
 /* BR Setting */
 const wiced_bt_cfg_br_t wiced_bt_cfg_br =
 {
-    .br_max_simultaneous_links = 3,
+    .br_max_simultaneous_links = HANDSFREE_CAP_BR_LINKS,
     .br_max_rx_pdu_size = 1024,
     .device_class = {0x24, 0x04, 0x18},                     /**< Local device class */
 
     .rfcomm_cfg = /* RFCOMM configuration */
     {
-        .max_links = WICED_BT_HFP_HF_MAX_CONN, /**< Maximum number of simultaneous connected remote devices. Should be less than or equal to l2cap_application_max_links */
-        .max_ports = WICED_BT_HFP_HF_MAX_CONN, /**< Maximum number of simultaneous RFCOMM ports */
+        .max_links = HANDSFREE_CAP_HF_CONNECTIONS, /**< Maximum number of simultaneous connected remote devices. Should be less than or equal to l2cap_application_max_links */
+        .max_ports = HANDSFREE_CAP_HF_CONNECTIONS, /**< Maximum number of simultaneous RFCOMM ports */
     },
     .avdt_cfg = /* Audio/Video Distribution configuration */
     {
-        .max_links = 1, /**< Maximum simultaneous audio/video links */
-        .max_seps = 3,  /**< Maximum number of stream end points */
+        .max_links = HANDSFREE_CAP_A2DP_LINKS, /**< Maximum simultaneous audio/video links */
+        .max_seps = HANDSFREE_CAP_A2DP_SEPS,   /**< Maximum number of stream end points */
     },
 
     .avrc_cfg = /* Audio/Video Remote Control configuration */
     {
-        .max_links = 1, /**< Maximum simultaneous remote control links */
+        .max_links = HANDSFREE_CAP_A2DP_LINKS, /**< Maximum simultaneous remote control links */
     },
 };
 
@@ -167,7 +169,7 @@ const wiced_bt_cfg_isoc_t wiced_bt_cfg_isoc =
 /* LE Setting */
 const wiced_bt_cfg_ble_t wiced_bt_cfg_ble =
 {
-    .ble_max_simultaneous_links = 1,
+    .ble_max_simultaneous_links = HANDSFREE_CAP_LE_LINKS,
     .ble_max_rx_pdu_size = 365,
     .appearance = APPEARANCE_GENERIC_TAG,    /**< GATT appearance (see gatt_appearance_e) */
     .rpa_refresh_timeout = WICED_BT_CFG_DEFAULT_RANDOM_ADDRESS_NEVER_CHANGE,   /**< Interval of  random address refreshing - secs */
@@ -204,7 +206,7 @@ const wiced_bt_cfg_settings_t handsfree_cfg_settings =
     .device_class                        = {0x24, 0x04, 0x18},                                         /**< Local device class */
     .security_requirement_mask           = (  BTM_SEC_IN_AUTHENTICATE | BTM_SEC_OUT_AUTHENTICATE | BTM_SEC_ENCRYPT ), /**< Security requirements mask (BTM_SEC_NONE, or combinination of BTM_SEC_IN_AUTHENTICATE, BTM_SEC_OUT_AUTHENTICATE, BTM_SEC_ENCRYPT (see #wiced_bt_sec_level_e)) */
 
-    .max_simultaneous_links              = 3,                                                          /**< Maximum number simultaneous links to different devices */
+    .max_simultaneous_links              = HANDSFREE_CAP_BR_LINKS,                                     /**< Maximum number simultaneous links to different devices */
 
     .br_edr_scan_cfg =                                              /* BR/EDR scan config */
     {
@@ -279,8 +281,8 @@ const wiced_bt_cfg_settings_t handsfree_cfg_settings =
     .gatt_cfg =                                                     /* GATT configuration */
     {
         .appearance                     = APPEARANCE_GENERIC_TAG,                                      /**< GATT appearance (see gatt_appearance_e) */
-        .client_max_links               = 3,                                                           /**< Client config: maximum number of servers that local client can connect to  */
-        .server_max_links               = 3,                                                           /**< Server config: maximum number of remote clients connections allowed by the local */
+        .client_max_links               = HANDSFREE_CAP_LE_LINKS,                                      /**< Client config: maximum number of servers that local client can connect to  */
+        .server_max_links               = HANDSFREE_CAP_LE_LINKS,                                      /**< Server config: maximum number of remote clients connections allowed by the local */
         .max_attr_len                   = 360,                                                         /**< Maximum attribute length; gki_cfg must have a corresponding buffer pool that can hold this length */
 #if !defined(CYW20706A2)
         .max_mtu_size                   = 365                                                          /**< Maximum MTU size for GATT connections, should be between 23 and (max_attr_len + 5) */
@@ -289,13 +291,13 @@ const wiced_bt_cfg_settings_t handsfree_cfg_settings =
 
     .rfcomm_cfg =                                                   /* RFCOMM configuration */
     {
-        .max_links                      = 2,                                                           /**< Maximum number of simultaneous connected remote devices*/
-        .max_ports                      = 2                                                            /**< Maximum number of simultaneous RFCOMM ports */
+        .max_links                      = HANDSFREE_CAP_HF_CONNECTIONS,                                /**< Maximum number of simultaneous connected remote devices*/
+        .max_ports                      = HANDSFREE_CAP_HF_CONNECTIONS                                 /**< Maximum number of simultaneous RFCOMM ports */
     },
 
     .l2cap_application =                                            /* Application managed l2cap protocol configuration */
     {
-        .max_links                      = 2,                                                           /**< Maximum number of application-managed l2cap links (BR/EDR and LE) */
+        .max_links                      = HANDSFREE_CAP_HF_CONNECTIONS,                                /**< Maximum number of application-managed l2cap links (BR/EDR and LE) */
 
         /* BR EDR l2cap configuration */
         .max_psm                        = 7,                                                           /**< Maximum number of application-managed BR/EDR PSMs */
@@ -313,16 +315,16 @@ const wiced_bt_cfg_settings_t handsfree_cfg_settings =
     .avdt_cfg =
     /* Audio/Video Distribution configuration */
     {
-        .max_links                      = 1,                                                           /**< Maximum simultaneous audio/video links */
+        .max_links                      = HANDSFREE_CAP_A2DP_LINKS,                                    /**< Maximum simultaneous audio/video links */
 #if !defined(CYW20706A2)
-        .max_seps                       = 3                                                            /**< Maximum number of stream end points */
+        .max_seps                       = HANDSFREE_CAP_A2DP_SEPS                                      /**< Maximum number of stream end points */
 #endif
     },
 
     .avrc_cfg =                                                     /* Audio/Video Remote Control configuration */
     {
         .roles                          = 1,                                                           /**< Mask of local roles supported (AVRC_CONN_INITIATOR|AVRC_CONN_ACCEPTOR) */
-        .max_links                      = 1                                                            /**< Maximum simultaneous remote control links */
+        .max_links                      = HANDSFREE_CAP_A2DP_LINKS                                     /**< Maximum simultaneous remote control links */
     },
 
     /* LE Address Resolution DB size  */
@@ -333,7 +335,7 @@ const wiced_bt_cfg_settings_t handsfree_cfg_settings =
     .max_pwr_db_val                     = 12                                                           /**< Max. power level of the device */
 #else
     /* Maximum number of buffer pools */
-    .max_number_of_buffer_pools         = 6,                                                           /**< Maximum number of buffer pools in p_btm_cfg_buf_pools and by wiced_create_pool */
+    .max_number_of_buffer_pools         = HANDSFREE_CFG_BUF_POOL_COUNT + HANDSFREE_APP_BUFFER_POOLS,   /**< Maximum number of buffer pools in p_btm_cfg_buf_pools and by wiced_create_pool */
 
     /* Interval of  random address refreshing */
     .rpa_refresh_timeout                = WICED_BT_CFG_DEFAULT_RANDOM_ADDRESS_NEVER_CHANGE,            /**< Interval of  random address refreshing - secs */
@@ -357,6 +359,9 @@ const uint8_t handsfree_sdp_db[] =
     SDP_ATTR_SEQUENCE_1(75 + 2                                          // HFP
 #ifdef  WICED_ENABLE_BT_HSP_PROFILE
               + 75 + 2                                                      // HSP
+#endif
+#if HANDSFREE_CAP_A2DP
+              + 77 + 2                                                      // A2DP sink
 #endif
              ),
 
@@ -391,6 +396,28 @@ const uint8_t handsfree_sdp_db[] =
             'W', 'I', 'C', 'E', 'D', ' ', 'H', 'S', ' ', 'D', 'E', 'V', 'I', 'C', 'E',
         SDP_ATTR_UINT2(ATTR_ID_SUPPORTED_FEATURES, 0x0016),
 #endif
+
+#if HANDSFREE_CAP_A2DP
+    // SDP Record for A2DP Sink
+    SDP_ATTR_SEQUENCE_1(77),
+        SDP_ATTR_RECORD_HANDLE(HDLR_A2DP_SINK),
+        SDP_ATTR_ID(ATTR_ID_SERVICE_CLASS_ID_LIST), SDP_ATTR_SEQUENCE_1(3),
+            SDP_ATTR_UUID16(UUID_SERVCLASS_AUDIO_SINK),
+        SDP_ATTR_ID(ATTR_ID_PROTOCOL_DESC_LIST), SDP_ATTR_SEQUENCE_1(16),
+            SDP_ATTR_SEQUENCE_1(6),
+                SDP_ATTR_UUID16(UUID_PROTOCOL_L2CAP),
+                SDP_ATTR_VALUE_UINT2(BT_PSM_AVDTP),
+            SDP_ATTR_SEQUENCE_1(6),
+                SDP_ATTR_UUID16(UUID_PROTOCOL_AVDTP),
+                SDP_ATTR_VALUE_UINT2(0x0103),
+        SDP_ATTR_ID(ATTR_ID_BT_PROFILE_DESC_LIST), SDP_ATTR_SEQUENCE_1(8),
+            SDP_ATTR_SEQUENCE_1(6),
+                SDP_ATTR_UUID16(UUID_SERVCLASS_ADV_AUDIO_DISTRIBUTION),
+                SDP_ATTR_VALUE_UINT2(0x0103),
+        SDP_ATTR_UINT2(ATTR_ID_SUPPORTED_FEATURES, 0x0001),                 // Headphone
+        SDP_ATTR_SERVICE_NAME(16),
+            'W', 'I', 'C', 'E', 'D', ' ', 'A', 'u', 'd', 'i', 'o', ' ', 'S', 'i', 'n', 'k',
+#endif
 };
 
 #ifndef BTSTACK_VER
@@ -409,13 +436,17 @@ const wiced_bt_cfg_buf_pool_t handsfree_cfg_buf_pools[] =
     { 64,      12  },      /* Small Buffer Pool */
     { 272,      6  },      /* Medium Buffer Pool (used for HCI & RFCOMM control messages, min recommended size is 360) */
     { 1056,     6  },      /* Large Buffer Pool  (used for HCI ACL messages) */
-    { 1056,     1  },      /* Extra Large Buffer Pool - Used for avdt media packets and miscellaneous (if not needed, set buf_count to 0) */
+    { 1056,     HANDSFREE_CAP_A2DP_LINKS },  /* Extra Large Buffer Pool - Used for avdt media packets and miscellaneous (if not needed, set buf_count to 0) */
 };
 #endif
 
 /**  Audio buffer configuration */
 const wiced_bt_audio_config_buffer_t handsfree_audio_buf_config = {
+#if HANDSFREE_CAP_A2DP
+    .role                       =   WICED_AUDIO_SINK_ROLE | WICED_HF_ROLE,
+#else
     .role                       =   WICED_HF_ROLE,
+#endif
     .audio_tx_buffer_size       =   0,
 #if defined(CYW20719B2) || defined(CYW20721B2)
     .audio_codec_buffer_size    =   0x4000,
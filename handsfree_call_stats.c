@@ -0,0 +1,168 @@
+/*
+ * Copyright 2016-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+/** @file
+ *
+ * Per-call quality record.
+ *
+ * The record opens when call audio set up starts, at codec negotiation or the AG's SCO
+ * request, whichever comes first. It follows the SCO link and goes to the host as one
+ * HCI_CONTROL_HF_EVENT_CALL_STATS when the link closes:
+ *
+ *   handle(2) codec(1) packet_types(2) max_latency(2) retrans_effort(1) setup_ms(2)
+ *   duration_ms(4) rssi_min(1) rssi_avg(1) rssi_samples(1) volume_changes(1) reason(1)
+ *
+ * The eSCO fields are the parameters offered for the link. RSSI comes from the link
+ * quality monitor samples taken while SCO was up, rssi_samples 0 means the call was too
+ * short for one. setup_ms is 0xFFFF when SCO came up without a set up phase seen by the
+ * app, reason is the HCI disconnect reason of the SCO link.
+ *
+ * The record has no count of lost or concealed frames. With the PCM and I2S voice paths
+ * of handsfree_sco_path the controller checks the received packets, conceals the lost
+ * ones and clocks the samples to the codec itself; the stack reports neither to the
+ * application. The disconnect reason and the RSSI are the quality signals it does see.
+ */
+
+#include "wiced_bt_trace.h"
+#include "wiced_timer.h"
+#include "handsfree.h"
+#include "string.h"
+
+#define HANDSFREE_CALL_STATS_LEN        19
+
+/* Per device, see handsfree_instance_t */
+#define handsfree_call_stats            ( p_handsfree_instance->handsfree_call_stats )
+
+/*
+ * Call audio set up started, repeated calls keep the first start
+ */
+void handsfree_call_stats_setup_start( void )
+{
+    if ( handsfree_call_stats.setup_pending || handsfree_call_stats.sco_up )
+        return;
+
+    handsfree_call_stats.setup_pending  = WICED_TRUE;
+    handsfree_call_stats.setup_start_us = clock_SystemTimeMicroseconds64( );
+}
+
+/*
+ * Parameters about to be offered for the SCO link
+ */
+void handsfree_call_stats_params( const wiced_bt_sco_params_t *p_params )
+{
+    if ( handsfree_call_stats.sco_up )
+        return;
+
+    handsfree_call_stats.packet_types   = p_params->packet_types;
+    handsfree_call_stats.max_latency    = p_params->max_latency;
+    handsfree_call_stats.retrans_effort = p_params->retrans_effort;
+    handsfree_call_stats.codec          = p_params->use_wbs ? WICED_BT_HFP_HF_MSBC_CODEC : WICED_BT_HFP_HF_CVSD_CODEC;
+}
+
+void handsfree_call_stats_sco_up( void )
+{
+    uint64_t now = clock_SystemTimeMicroseconds64( );
+    uint64_t setup_ms;
+
+    handsfree_call_stats.setup_ms = 0xFFFF;
+    if ( handsfree_call_stats.setup_pending )
+    {
+        setup_ms = ( now - handsfree_call_stats.setup_start_us ) / 1000;
+        handsfree_call_stats.setup_ms = ( setup_ms < 0xFFFF ) ? (uint16_t)setup_ms : 0xFFFE;
+    }
+    handsfree_call_stats.setup_pending  = WICED_FALSE;
+    handsfree_call_stats.sco_up         = WICED_TRUE;
+    handsfree_call_stats.sco_up_us      = now;
+    handsfree_call_stats.rssi_min       = 0;
+    handsfree_call_stats.rssi_sum       = 0;
+    handsfree_call_stats.rssi_samples   = 0;
+    handsfree_call_stats.volume_changes = 0;
+}
+
+void handsfree_call_stats_rssi( int8_t rssi )
+{
+    if ( !handsfree_call_stats.sco_up || ( handsfree_call_stats.rssi_samples == 0xFF ) )
+        return;
+
+    if ( ( handsfree_call_stats.rssi_samples == 0 ) || ( rssi < handsfree_call_stats.rssi_min ) )
+        handsfree_call_stats.rssi_min = rssi;
+    handsfree_call_stats.rssi_sum += rssi;
+    handsfree_call_stats.rssi_samples++;
+}
+
+void handsfree_call_stats_volume_change( void )
+{
+    if ( handsfree_call_stats.sco_up && ( handsfree_call_stats.volume_changes < 0xFF ) )
+        handsfree_call_stats.volume_changes++;
+}
+
+/*
+ * SCO closed, send the record of the call
+ */
+void handsfree_call_stats_sco_down( uint16_t handle, uint8_t reason )
+{
+    uint8_t   tx_buf[HANDSFREE_CALL_STATS_LEN];
+    uint8_t  *p = tx_buf;
+    uint64_t  duration_ms;
+    int8_t    rssi_avg = 0;
+
+    if ( !handsfree_call_stats.sco_up )
+    {
+        handsfree_call_stats.setup_pending = WICED_FALSE;
+        return;
+    }
+    handsfree_call_stats.sco_up = WICED_FALSE;
+
+    duration_ms = ( clock_SystemTimeMicroseconds64( ) - handsfree_call_stats.sco_up_us ) / 1000;
+    if ( duration_ms > 0xFFFFFFFF )
+        duration_ms = 0xFFFFFFFF;
+    if ( handsfree_call_stats.rssi_samples )
+        rssi_avg = (int8_t)( handsfree_call_stats.rssi_sum / handsfree_call_stats.rssi_samples );
+
+    UINT16_TO_STREAM( p, handle );
+    UINT8_TO_STREAM( p, handsfree_call_stats.codec );
+    UINT16_TO_STREAM( p, handsfree_call_stats.packet_types );
+    UINT16_TO_STREAM( p, handsfree_call_stats.max_latency );
+    UINT8_TO_STREAM( p, handsfree_call_stats.retrans_effort );
+    UINT16_TO_STREAM( p, handsfree_call_stats.setup_ms );
+    UINT32_TO_STREAM( p, (uint32_t)duration_ms );
+    UINT8_TO_STREAM( p, (uint8_t)handsfree_call_stats.rssi_min );
+    UINT8_TO_STREAM( p, (uint8_t)rssi_avg );
+    UINT8_TO_STREAM( p, handsfree_call_stats.rssi_samples );
+    UINT8_TO_STREAM( p, handsfree_call_stats.volume_changes );
+    UINT8_TO_STREAM( p, reason );
+
+    WICED_BT_TRACE( "call stats: codec %d setup %d ms, %d ms, rssi %d/%d, reason 0x%02x\n", handsfree_call_stats.codec,
+            handsfree_call_stats.setup_ms, (uint32_t)duration_ms, handsfree_call_stats.rssi_min, rssi_avg, reason );
+    hci_control_send_data( HCI_CONTROL_HF_EVENT_CALL_STATS, tx_buf, (uint32_t)( p - tx_buf ) );
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright 2016-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+/** @file
+ *
+ * Performance counters.
+ *
+ * Counters are plain uint32_t slots in handsfree_instance_t indexed by HANDSFREE_COUNTER_LIST,
+ * so counting is a single increment through the selected instance. Code that runs without
+ * the instance selected (host transport reader threads) hands the count to the thread that
+ * owns it. HCI_CONTROL_MISC_COMMAND_GET_COUNTERS returns all
+ * of them in one HCI_CONTROL_MISC_EVENT_COUNTERS frame, optionally clearing them, so a
+ * monitor can poll health with one round trip. Counters wrap, the host works on deltas.
+ */
+
+#include "wiced_bt_trace.h"
+#include "handsfree.h"
+#include "string.h"
+
+/* The frame must fit a transport buffer */
+typedef char handsfree_counters_size_check[ ( 1 + 4 * HANDSFREE_COUNTER_MAX <= TRANS_UART_BUFFER_SIZE ) ? 1 : -1 ];
+
+/*
+ * Send all counters, clear them afterwards if the host asks to
+ */
+void hci_control_counters_handle_get( uint8_t *p_data, uint32_t data_len )
+{
+    uint8_t   tx_buf[1 + 4 * HANDSFREE_COUNTER_MAX];
+    uint8_t  *p = tx_buf;
+    int       i;
+
+    *p++ = HANDSFREE_COUNTER_MAX;
+    for ( i = 0; i < HANDSFREE_COUNTER_MAX; i++ )
+    {
+        UINT32_TO_STREAM( p, handsfree_counters[i] );
+    }
+    hci_control_send_data( HCI_CONTROL_MISC_EVENT_COUNTERS, tx_buf, sizeof( tx_buf ) );
+
+    if ( ( data_len >= 1 ) && ( p_data[0] != 0 ) )
+    {
+        memset( handsfree_counters, 0, sizeof( handsfree_counters ) );
+    }
+}
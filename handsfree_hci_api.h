@@ -0,0 +1,145 @@
+/*
+ * Copyright 2016-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+/** @file
+ *
+ * Handsfree application specific extensions of the WICED HCI host protocol.
+ *
+ * Opcodes defined here complement hci_control_api.h. This header only depends on
+ * hci_control_api.h so that host software can share it with the firmware.
+ */
+
+#pragma once
+
+#include "hci_control_api.h"
+
+/* Application specific MISC group commands and events */
+#define HCI_CONTROL_MISC_COMMAND_SET_PROTOCOL   ( ( HCI_CONTROL_GROUP_MISC << 8 ) | 0x40 )  /* version(1) window(1) */
+#define HCI_CONTROL_MISC_COMMAND_V2_FRAME       ( ( HCI_CONTROL_GROUP_MISC << 8 ) | 0x41 )  /* Protocol v2 frame, see handsfree_hci_v2.c */
+#define HCI_CONTROL_MISC_EVENT_V2_FRAME         ( ( HCI_CONTROL_GROUP_MISC << 8 ) | 0x41 )
+#define HCI_CONTROL_MISC_COMMAND_FRAGMENT       ( ( HCI_CONTROL_GROUP_MISC << 8 ) | 0x42 )  /* xfer_id(1) opcode(2) total_len(2) offset(2) data */
+#define HCI_CONTROL_MISC_EVENT_FRAGMENT_ACK     ( ( HCI_CONTROL_GROUP_MISC << 8 ) | 0x42 )  /* xfer_id(1) next_offset(2) status(1) */
+
+/* HCI_CONTROL_MISC_EVENT_FRAGMENT_ACK status */
+#define HCI_CONTROL_FRAG_STATUS_SUCCESS         0   /* Window acknowledged, keep sending */
+#define HCI_CONTROL_FRAG_STATUS_COMPLETE        1   /* Command reassembled and executed */
+#define HCI_CONTROL_FRAG_STATUS_OUT_OF_ORDER    2   /* Resend from next_offset */
+#define HCI_CONTROL_FRAG_STATUS_TOO_LARGE       3   /* total_len exceeds HCI_FRAG_MAX_LEN */
+#define HCI_CONTROL_FRAG_STATUS_UNKNOWN_XFER    4   /* No transfer in progress with this xfer_id */
+#define HCI_CONTROL_FRAG_STATUS_NO_RESOURCES    5   /* No buffer for the transfer, retry later */
+
+#define HCI_CONTROL_MISC_COMMAND_OTA_START      ( ( HCI_CONTROL_GROUP_MISC << 8 ) | 0x43 )  /* format(1) image_len(4) image_crc32(4) */
+#define HCI_CONTROL_MISC_COMMAND_OTA_DATA       ( ( HCI_CONTROL_GROUP_MISC << 8 ) | 0x44 )  /* offset(4) data, see handsfree_ota.c */
+#define HCI_CONTROL_MISC_COMMAND_OTA_FINISH     ( ( HCI_CONTROL_GROUP_MISC << 8 ) | 0x45 )
+#define HCI_CONTROL_MISC_COMMAND_OTA_ABORT      ( ( HCI_CONTROL_GROUP_MISC << 8 ) | 0x46 )
+#define HCI_CONTROL_MISC_EVENT_OTA_STATUS       ( ( HCI_CONTROL_GROUP_MISC << 8 ) | 0x43 )  /* next_offset(4) status(1) */
+#define HCI_CONTROL_MISC_COMMAND_SET_TIMESTAMPS ( ( HCI_CONTROL_GROUP_MISC << 8 ) | 0x47 )  /* enable(1), events end with timestamp_us(4) seq(2) */
+#define HCI_CONTROL_MISC_COMMAND_TIME_SYNC      ( ( HCI_CONTROL_GROUP_MISC << 8 ) | 0x48 )  /* host_time(8) */
+#define HCI_CONTROL_MISC_EVENT_TIME_SYNC        ( ( HCI_CONTROL_GROUP_MISC << 8 ) | 0x48 )  /* host_time(8) device_time_us(8), see handsfree_hci_time.c */
+#define HCI_CONTROL_MISC_COMMAND_GET_COUNTERS   ( ( HCI_CONTROL_GROUP_MISC << 8 ) | 0x49 )  /* clear(1), optional */
+#define HCI_CONTROL_MISC_EVENT_COUNTERS         ( ( HCI_CONTROL_GROUP_MISC << 8 ) | 0x49 )  /* count(1) value(4) * count, in HANDSFREE_COUNTER_LIST order */
+#define HCI_CONTROL_MISC_COMMAND_LATENCY_PROBE  ( ( HCI_CONTROL_GROUP_MISC << 8 ) | 0x4A )  /* order(1), optional, LATENCY_PROBE=1 builds only */
+#define HCI_CONTROL_MISC_EVENT_LATENCY_PROBE    ( ( HCI_CONTROL_GROUP_MISC << 8 ) | 0x4A )  /* status(1) sample_rate(2) delay_samples(2) delay_us(4) level(1), see handsfree_latency_probe.c */
+#define HCI_CONTROL_MISC_COMMAND_NVRAM_RESTORE  ( ( HCI_CONTROL_GROUP_MISC << 8 ) | 0x4B )  /* ( nvram_id(2) length(2) data ) * n, see handsfree_nvram.c */
+#define HCI_CONTROL_MISC_EVENT_NVRAM_RESTORE    ( ( HCI_CONTROL_GROUP_MISC << 8 ) | 0x4B )  /* restored(1) status(1) */
+
+/* HCI_CONTROL_MISC_COMMAND_OTA_START format */
+#define HCI_CONTROL_OTA_FORMAT_RAW              0   /* Plain image */
+#define HCI_CONTROL_OTA_FORMAT_LZ               1   /* Image compressed with host/ota_pack.py */
+
+/* HCI_CONTROL_MISC_EVENT_OTA_STATUS status */
+#define HCI_CONTROL_OTA_STATUS_SUCCESS          0   /* Window acknowledged, keep sending */
+#define HCI_CONTROL_OTA_STATUS_COMPLETE         1   /* Image verified, the device reboots into it */
+#define HCI_CONTROL_OTA_STATUS_OUT_OF_ORDER     2   /* Resend from next_offset */
+#define HCI_CONTROL_OTA_STATUS_NOT_STARTED      3   /* No update in progress */
+#define HCI_CONTROL_OTA_STATUS_BAD_ARGS         4   /* Unknown format or empty image */
+#define HCI_CONTROL_OTA_STATUS_BAD_IMAGE        5   /* Corrupt stream, length or CRC mismatch, update abandoned */
+#define HCI_CONTROL_OTA_STATUS_WRITE_FAILED     6   /* Flash write or verify failed, update abandoned */
+
+/* HCI_CONTROL_MISC_EVENT_NVRAM_RESTORE status, restored counts the records stored before it */
+#define HCI_CONTROL_RESTORE_STATUS_SUCCESS      0   /* All records stored */
+#define HCI_CONTROL_RESTORE_STATUS_MALFORMED    1   /* A record runs past the end of the command */
+#define HCI_CONTROL_RESTORE_STATUS_NOT_STORED   2   /* Bad record length or no buffer for the record */
+
+/* HCI_CONTROL_MISC_EVENT_LATENCY_PROBE status */
+#define HCI_CONTROL_PROBE_STATUS_SUCCESS        0   /* Delay measured */
+#define HCI_CONTROL_PROBE_STATUS_BUSY           1   /* A probe is running */
+#define HCI_CONTROL_PROBE_STATUS_NO_AUDIO       2   /* No SCO link */
+#define HCI_CONTROL_PROBE_STATUS_BAD_ARGS       3   /* Order out of range */
+#define HCI_CONTROL_PROBE_STATUS_ABORTED        4   /* SCO closed before the capture was complete */
+#define HCI_CONTROL_PROBE_STATUS_NOT_FOUND      5   /* No echo of the sequence within the lag range */
+
+/*
+ * Performance counters reported by HCI_CONTROL_MISC_EVENT_COUNTERS. New counters are
+ * only ever appended, so hosts built against an older list read a prefix of the frame.
+ */
+#define HANDSFREE_COUNTER_LIST( X ) \
+    X( RX_PACKETS )             /* Host packets received */ \
+    X( RX_EARLY_RELEASE )       /* Copied out, transport buffer released before handling */ \
+    X( RX_IN_PLACE )            /* Handled inside the transport buffer */ \
+    X( RX_MALFORMED )           /* Shorter than the header or than the declared length */ \
+    X( RX_OVERFLOW )            /* Dropped by the transport, no buffer or too long */ \
+    X( CMD_DEVICE )             /* Commands received per group */ \
+    X( CMD_HF ) \
+    X( CMD_MISC ) \
+    X( CMD_UNKNOWN ) \
+    X( EVT_SENT )               /* Events handed to the transport */ \
+    X( EVT_SEND_FAILED ) \
+    X( SCO_CONNECT ) \
+    X( SCO_FALLBACK )           /* AG did not open audio in time, the HF initiated it */ \
+    X( CODEC_CVSD )             /* Codec selections by the AG */ \
+    X( CODEC_MSBC ) \
+    X( NVRAM_WRITE ) \
+    X( NVRAM_LOOKUP ) \
+    X( POOL_ALLOC_FAILED )      /* wiced_bt_get_buffer* returned NULL */ \
+    X( LINK_LOSS )              /* SCO dropped on supervision timeout */ \
+    X( AUDIO_APPLIED )          /* Audio manager settings written to the codec */ \
+    X( AUDIO_SUPPRESSED )       /* Audio manager settings skipped, already in effect */ \
+    X( LINKQ_DEGRADE )          /* Link quality monitor switched to robust SCO parameters */ \
+    X( LINKQ_RECOVER )          /* and back */
+
+/* Application specific HF group commands */
+#define HCI_CONTROL_HF_COMMAND_SET_HF_INDICATOR ( ( HCI_CONTROL_GROUP_HF << 8 ) | 0x60 )    /* Binary HF indicator value: handle(2) ind_id(1) value(2) */
+
+/* Application specific HF group events */
+#define HCI_CONTROL_HF_EVENT_VR_TEXT            ( ( HCI_CONTROL_GROUP_HF << 8 ) | 0x60 )    /* handle(2) text_id(2) text_type(1) text_op(1) total_len(2) offset(2) text */
+
+#define HCI_CONTROL_HF_EVENT_CALL_STATS         ( ( HCI_CONTROL_GROUP_HF << 8 ) | 0x61 )    /* Per-call quality record, see handsfree_call_stats.c */
+
+/* Longest text carried by one HCI_CONTROL_HF_EVENT_VR_TEXT, longer texts come in several events */
+#define HCI_CONTROL_HF_VR_TEXT_CHUNK            200
+
+/* HF indicator assigned numbers (HFP 1.7, +BIND) */
+#define HANDSFREE_HF_IND_ENHANCED_SAFETY        1
+#define HANDSFREE_HF_IND_BATTERY_LEVEL          2
+#define HANDSFREE_HF_IND_MAX                    HANDSFREE_HF_IND_BATTERY_LEVEL
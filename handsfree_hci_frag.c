@@ -0,0 +1,202 @@
+/*
+ * Copyright 2016-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+/** @file
+ *
+ * Reassembly of host commands larger than a transport buffer.
+ *
+ * The host splits a command that does not fit in TRANS_UART_BUFFER_SIZE, such as an
+ * HCI_CONTROL_MISC_COMMAND_NVRAM_RESTORE of all records of a device, into
+ * HCI_CONTROL_MISC_COMMAND_FRAGMENT packets:
+ *
+ *     xfer_id(1) opcode(2) total_len(2) offset(2) data
+ *
+ * Commands of up to HCI_FRAG_MAX_LEN bytes are reassembled in the single buffer of a pool
+ * created at startup, larger ones are rejected with HCI_CONTROL_FRAG_STATUS_TOO_LARGE.
+ * The fragment at offset 0 takes the buffer, or gets HCI_CONTROL_FRAG_STATUS_NO_RESOURCES
+ * if there is none, and fragments are copied into it as they arrive, so the RX pool is
+ * released after every fragment. Once total_len bytes are in, the command is dispatched
+ * as if it had been received in one packet and the buffer goes back to the pool. The
+ * device answers with
+ * HCI_CONTROL_MISC_EVENT_FRAGMENT_ACK
+ *
+ *     xfer_id(1) next_offset(2) status(1)
+ *
+ * every HCI_FRAG_ACK_INTERVAL fragments, on completion and on error. The host may keep
+ * sending while acks are outstanding and only has to rewind to next_offset when a
+ * HCI_CONTROL_FRAG_STATUS_OUT_OF_ORDER ack comes back.
+ */
+
+#include "wiced_memory.h"
+#include "wiced_bt_trace.h"
+#include "handsfree.h"
+#include "string.h"
+
+#define HCI_FRAG_HDR_LEN                7
+#define HCI_FRAG_ACK_INTERVAL           4       // Fragments per window ack
+
+/* Per device, see handsfree_instance_t */
+#define hci_frag_cb                     ( p_handsfree_instance->hci_frag_cb )
+#define hci_frag_pool                   ( p_handsfree_instance->hci_frag_pool )
+
+static void hci_frag_send_ack( uint8_t xfer_id, uint16_t next_offset, uint8_t status )
+{
+    uint8_t  tx_buf[4];
+
+    tx_buf[0] = xfer_id;
+    tx_buf[1] = next_offset & 0xff;
+    tx_buf[2] = next_offset >> 8;
+    tx_buf[3] = status;
+    hci_control_send_data( HCI_CONTROL_MISC_EVENT_FRAGMENT_ACK, tx_buf, sizeof( tx_buf ) );
+
+    hci_frag_cb.unacked = 0;
+}
+
+static void hci_frag_release( void )
+{
+    if ( hci_frag_cb.p_buf != NULL )
+        wiced_bt_free_buffer( hci_frag_cb.p_buf );
+    hci_frag_cb.p_buf  = NULL;
+    hci_frag_cb.active = WICED_FALSE;
+}
+
+/*
+ * Create the reassembly pool, called once the stack is up
+ */
+void hci_control_frag_init( void )
+{
+#if BTSTACK_VER >= 0x03000001
+    hci_frag_pool = wiced_bt_create_pool( "frag", HCI_FRAG_MAX_LEN, 1, NULL );
+#else
+    hci_frag_pool = wiced_bt_create_pool( HCI_FRAG_MAX_LEN, 1 );
+#endif
+    WICED_BT_TRACE( "frag pool %x\n", hci_frag_pool );
+}
+
+/*
+ * Drop any partially received command, called when the device (re)starts
+ */
+void hci_control_frag_reset( void )
+{
+    hci_frag_release( );
+    memset( &hci_frag_cb, 0, sizeof( hci_frag_cb ) );
+}
+
+/*
+ * Handle one HCI_CONTROL_MISC_COMMAND_FRAGMENT packet
+ */
+void hci_control_frag_handle( uint8_t *p_data, uint32_t data_len )
+{
+    uint8_t   xfer_id;
+    uint16_t  opcode, total_len, offset, len;
+
+    if ( data_len < HCI_FRAG_HDR_LEN )
+        return;
+
+    xfer_id   = p_data[0];
+    opcode    = p_data[1] | ( p_data[2] << 8 );
+    total_len = p_data[3] | ( p_data[4] << 8 );
+    offset    = p_data[5] | ( p_data[6] << 8 );
+    len       = data_len - HCI_FRAG_HDR_LEN;
+    p_data   += HCI_FRAG_HDR_LEN;
+
+    /* Offset 0 starts a new transfer, abandoning any incomplete one */
+    if ( offset == 0 )
+    {
+        if ( hci_frag_cb.active && ( hci_frag_cb.xfer_id != xfer_id ) )
+            WICED_BT_TRACE( "frag: xfer %d abandoned at %d\n", hci_frag_cb.xfer_id, hci_frag_cb.next_offset );
+        hci_frag_release( );
+
+        if ( ( total_len == 0 ) || ( total_len > HCI_FRAG_MAX_LEN ) || ( opcode == HCI_CONTROL_MISC_COMMAND_FRAGMENT ) )
+        {
+            WICED_BT_TRACE( "frag: reject xfer %d opcode %04x len %d\n", xfer_id, opcode, total_len );
+            hci_frag_send_ack( xfer_id, 0, HCI_CONTROL_FRAG_STATUS_TOO_LARGE );
+            return;
+        }
+        if ( ( hci_frag_cb.p_buf = (uint8_t *)wiced_bt_get_buffer_from_pool( hci_frag_pool ) ) == NULL )
+        {
+            HANDSFREE_COUNT( POOL_ALLOC_FAILED );
+            hci_frag_send_ack( xfer_id, 0, HCI_CONTROL_FRAG_STATUS_NO_RESOURCES );
+            return;
+        }
+
+        hci_frag_cb.active      = WICED_TRUE;
+        hci_frag_cb.xfer_id     = xfer_id;
+        hci_frag_cb.opcode      = opcode;
+        hci_frag_cb.total_len   = total_len;
+        hci_frag_cb.next_offset = 0;
+        hci_frag_cb.unacked     = 0;
+        hci_frag_cb.nak_sent    = WICED_FALSE;
+    }
+
+    if ( !hci_frag_cb.active || ( hci_frag_cb.xfer_id != xfer_id ) )
+    {
+        hci_frag_send_ack( xfer_id, 0, HCI_CONTROL_FRAG_STATUS_UNKNOWN_XFER );
+        return;
+    }
+
+    /* Fragments must be contiguous, the host rewinds to next_offset on a nak */
+    if ( offset != hci_frag_cb.next_offset )
+    {
+        if ( !hci_frag_cb.nak_sent )
+        {
+            hci_frag_send_ack( xfer_id, hci_frag_cb.next_offset, HCI_CONTROL_FRAG_STATUS_OUT_OF_ORDER );
+            hci_frag_cb.nak_sent = WICED_TRUE;
+        }
+        return;
+    }
+    hci_frag_cb.nak_sent = WICED_FALSE;
+
+    if ( ( opcode != hci_frag_cb.opcode ) || ( total_len != hci_frag_cb.total_len ) ||
+         ( len > hci_frag_cb.total_len - offset ) )
+    {
+        WICED_BT_TRACE( "frag: xfer %d inconsistent fragment at %d\n", xfer_id, offset );
+        hci_frag_send_ack( xfer_id, hci_frag_cb.next_offset, HCI_CONTROL_FRAG_STATUS_OUT_OF_ORDER );
+        return;
+    }
+
+    memcpy( &hci_frag_cb.p_buf[offset], p_data, len );
+    hci_frag_cb.next_offset += len;
+
+    if ( hci_frag_cb.next_offset == hci_frag_cb.total_len )
+    {
+        hci_frag_cb.active = WICED_FALSE;
+        hci_frag_send_ack( xfer_id, hci_frag_cb.next_offset, HCI_CONTROL_FRAG_STATUS_COMPLETE );
+        hci_control_dispatch_cmd( hci_frag_cb.opcode, hci_frag_cb.p_buf, hci_frag_cb.total_len );
+        hci_frag_release( );
+    }
+    else if ( ++hci_frag_cb.unacked >= HCI_FRAG_ACK_INTERVAL )
+    {
+        hci_frag_send_ack( xfer_id, hci_frag_cb.next_offset, HCI_CONTROL_FRAG_STATUS_SUCCESS );
+    }
+}
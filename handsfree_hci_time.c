@@ -0,0 +1,141 @@
+/*
+ * Copyright 2016-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+/** @file
+ *
+ * Device timestamps on host events.
+ *
+ * HCI_CONTROL_MISC_COMMAND_SET_TIMESTAMPS enable(1) turns on a trailer appended to the
+ * payload of every event sent with hci_control_send_data:
+ *
+ *     payload  timestamp_us(4)  seq(2)
+ *
+ * timestamp_us is the low 32 bits of the device microsecond clock when the event was
+ * handed to the transport, seq counts stamped events so the host can spot dropped ones.
+ * The trailer is added after the event is built, so the payload layout of each event is
+ * unchanged and the host strips the last 6 bytes. It is handed to the transport as a
+ * second piece of the payload, the event itself is not copied to make room for it.
+ *
+ * HCI_CONTROL_MISC_COMMAND_TIME_SYNC host_time(8) is answered with
+ * HCI_CONTROL_MISC_EVENT_TIME_SYNC host_time(8) device_time_us(8). The host takes its
+ * own time t2 when the answer arrives and adds
+ * offset = ( host_time + t2 ) / 2 - device_time_us to device times, keeping the offset of
+ * the exchange with the smallest t2 - host_time. The full 64 bit device time also lets
+ * the host unwrap timestamp_us.
+ *
+ * Stamping is off after every device started event, hosts that do not know about it
+ * are not affected.
+ */
+
+#include "wiced_bt_trace.h"
+#include "wiced_timer.h"
+#include "handsfree.h"
+#include "string.h"
+
+/* Per device, see handsfree_instance_t */
+#define hci_time_enabled            ( p_handsfree_instance->hci_time_enabled )
+#define hci_time_seq                ( p_handsfree_instance->hci_time_seq )
+
+/*
+ * Stop stamping, called when the device (re)starts
+ */
+void hci_control_time_reset( void )
+{
+    hci_time_enabled = WICED_FALSE;
+    hci_time_seq     = 0;
+}
+
+wiced_bool_t hci_control_time_is_enabled( void )
+{
+    return hci_time_enabled;
+}
+
+/*
+ * Fill in the trailer for an event of length bytes. Returns the trailer length, 0 when
+ * the stamped event, with its v2 framing when that is on, would not fit in a transport
+ * buffer.
+ */
+HANDSFREE_HOT uint16_t hci_control_time_stamp( uint16_t length, uint8_t *p_trailer )
+{
+    uint32_t  now = (uint32_t)clock_SystemTimeMicroseconds64( );
+    uint8_t  *p   = p_trailer;
+    uint16_t  max = TRANS_UART_BUFFER_SIZE - HCI_TIME_TRAILER_LEN;
+
+    if ( hci_control_v2_is_enabled( ) )
+        max -= HCI_V2_OVERHEAD;
+
+    if ( length > max )
+    {
+        WICED_BT_TRACE( "time: event of %d bytes too long to stamp\n", length );
+        return 0;
+    }
+
+    UINT32_TO_STREAM( p, now );
+    UINT16_TO_STREAM( p, hci_time_seq );
+    hci_time_seq++;
+    return HCI_TIME_TRAILER_LEN;
+}
+
+void hci_control_time_handle_set( uint8_t *p_data, uint32_t data_len )
+{
+    if ( data_len < 1 )
+    {
+        hci_control_send_command_status_evt( HCI_CONTROL_EVENT_COMMAND_STATUS, HCI_CONTROL_STATUS_INVALID_ARGS );
+        return;
+    }
+
+    /* Status goes out in the old mode so the host knows where the change happens */
+    hci_control_send_command_status_evt( HCI_CONTROL_EVENT_COMMAND_STATUS, HCI_CONTROL_STATUS_SUCCESS );
+
+    hci_time_enabled = ( p_data[0] != 0 );
+    hci_time_seq     = 0;
+    WICED_BT_TRACE( "event timestamps %s\n", hci_time_enabled ? "on" : "off" );
+}
+
+void hci_control_time_handle_sync( uint8_t *p_data, uint32_t data_len )
+{
+    uint64_t  now = clock_SystemTimeMicroseconds64( );
+    uint8_t   tx_buf[16];
+    uint8_t  *p = &tx_buf[8];
+
+    if ( data_len < 8 )
+    {
+        hci_control_send_command_status_evt( HCI_CONTROL_EVENT_COMMAND_STATUS, HCI_CONTROL_STATUS_INVALID_ARGS );
+        return;
+    }
+
+    memcpy( tx_buf, p_data, 8 );
+    UINT32_TO_STREAM( p, (uint32_t)now );
+    UINT32_TO_STREAM( p, (uint32_t)( now >> 32 ) );
+    hci_control_send_data( HCI_CONTROL_MISC_EVENT_TIME_SYNC, tx_buf, sizeof( tx_buf ) );
+}
@@ -0,0 +1,424 @@
+/*
+ * Copyright 2016-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+/** @file
+ *
+ * Reliable framing (protocol v2) for the WICED HCI host interface.
+ *
+ * Protocol v2 is opt-in. The host enables it with HCI_CONTROL_MISC_COMMAND_SET_PROTOCOL
+ * and from then on every command and event is carried inside a V2 frame:
+ *
+ *     seq(1) ack(1) opcode(2) length(2) payload(length) crc16(2)
+ *
+ * - seq is the sequence number of the frame, incremented per data frame.
+ * - ack is the next sequence number expected from the peer (cumulative ack).
+ * - opcode 0 with an empty payload is an ack-only frame, it does not consume a seq.
+ * - crc16 is CRC-16/CCITT-FALSE over all preceding bytes of the frame.
+ *
+ * Both directions use Go-Back-N: up to window frames may be outstanding, frames with a
+ * bad CRC or out of order are dropped and answered with an ack for the last in-order
+ * frame, and unacknowledged frames are resent when the retransmit timer expires. An
+ * ack-only frame from the host that acknowledges nothing new means it dropped one of ours,
+ * the device then resends its window at once rather than waiting for the timer.
+ * Plain v1 packets are still accepted while v2 is active so that the host can recover.
+ */
+
+#include "wiced_bt_trace.h"
+#include "wiced_memory.h"
+#include "wiced_timer.h"
+#include "wiced_transport.h"
+#include "handsfree.h"
+#include "string.h"
+
+#define HCI_V2_MAX_WINDOW               8
+#define HCI_V2_MAX_QUEUED               16      // Frames waiting for the window to open
+#define HCI_V2_RX_RESERVE               2       // Backlog room a command needs to be accepted
+#define HCI_V2_RETRANSMIT_TIMEOUT       200     // msec
+#define HCI_V2_MAX_RETRIES              10      // Fall back to v1 if the host stops acking
+
+typedef struct hci_v2_frame
+{
+    struct hci_v2_frame *p_next;
+    uint16_t             len;                   // Length of the frame on the wire
+    uint8_t              data[1];
+} hci_v2_frame_t;
+
+/* Per device, see handsfree_instance_t */
+#define hci_v2_cb                       ( p_handsfree_instance->hci_v2_cb )
+#define hci_v2_retransmit_timer         ( p_handsfree_instance->hci_v2_retransmit_timer )
+#define hci_v2_timer_initialized        ( p_handsfree_instance->hci_v2_timer_initialized )
+
+static const uint16_t crc16_nibble_table[16] =
+{
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+};
+
+/*
+ * CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF), nibble table driven
+ */
+uint16_t hci_control_crc16( const uint8_t *p_data, uint32_t length )
+{
+    uint16_t crc = 0xFFFF;
+
+    while ( length-- )
+    {
+        crc = ( crc << 4 ) ^ crc16_nibble_table[( crc >> 12 ) ^ ( *p_data >> 4 )];
+        crc = ( crc << 4 ) ^ crc16_nibble_table[( crc >> 12 ) ^ ( *p_data++ & 0x0F )];
+    }
+    return crc;
+}
+
+/*
+ * Refresh the ack field and the CRC of a frame before it goes on the wire
+ */
+static void hci_v2_seal( uint8_t *p_frame, uint16_t len )
+{
+    uint16_t crc;
+
+    p_frame[1] = hci_v2_cb.rx_expected;
+    crc = hci_control_crc16( p_frame, len - HCI_V2_CRC_LEN );
+    p_frame[len - 2] = crc & 0xff;
+    p_frame[len - 1] = crc >> 8;
+}
+
+static void hci_v2_transmit( hci_v2_frame_t *p_frame )
+{
+    hci_v2_seal( p_frame->data, p_frame->len );
+    hci_control_transport_send( HCI_CONTROL_MISC_EVENT_V2_FRAME, p_frame->data, p_frame->len );
+
+    /* Every data frame carries the cumulative ack */
+    hci_v2_cb.ack_pending = WICED_FALSE;
+}
+
+static void hci_v2_send_ack( void )
+{
+    uint8_t frame[HCI_V2_OVERHEAD];
+
+    memset( frame, 0, sizeof( frame ) );
+    frame[0] = hci_v2_cb.tx_seq;
+    hci_v2_seal( frame, sizeof( frame ) );
+    hci_control_transport_send( HCI_CONTROL_MISC_EVENT_V2_FRAME, frame, sizeof( frame ) );
+
+    hci_v2_cb.ack_pending = WICED_FALSE;
+}
+
+/*
+ * Move frames from the backlog into the window
+ */
+static void hci_v2_pump( void )
+{
+    hci_v2_frame_t *p_frame;
+    hci_v2_frame_t **pp_tail = &hci_v2_cb.p_unacked;
+
+    while ( *pp_tail != NULL )
+        pp_tail = &( *pp_tail )->p_next;
+
+    while ( ( hci_v2_cb.p_backlog != NULL ) && ( hci_v2_cb.in_flight < hci_v2_cb.window ) )
+    {
+        p_frame = hci_v2_cb.p_backlog;
+        hci_v2_cb.p_backlog = p_frame->p_next;
+        hci_v2_cb.queued--;
+
+        p_frame->p_next = NULL;
+        *pp_tail = p_frame;
+        pp_tail = &p_frame->p_next;
+        hci_v2_cb.in_flight++;
+
+        hci_v2_transmit( p_frame );
+    }
+
+    if ( hci_v2_cb.in_flight && !wiced_is_timer_in_use( &hci_v2_retransmit_timer ) )
+    {
+        wiced_start_timer( &hci_v2_retransmit_timer, HCI_V2_RETRANSMIT_TIMEOUT );
+    }
+}
+
+static void hci_v2_free_list( hci_v2_frame_t *p_frame )
+{
+    hci_v2_frame_t *p_next;
+
+    for ( ; p_frame != NULL; p_frame = p_next )
+    {
+        p_next = p_frame->p_next;
+        wiced_bt_free_buffer( p_frame );
+    }
+}
+
+/*
+ * Release the frames acknowledged by the host
+ */
+static void hci_v2_process_ack( uint8_t ack )
+{
+    uint8_t         acked = (uint8_t)( ack - hci_v2_cb.tx_base );
+    hci_v2_frame_t *p_frame;
+
+    /* Stale or bogus ack */
+    if ( ( acked == 0 ) || ( acked > hci_v2_cb.in_flight ) )
+        return;
+
+    while ( acked-- )
+    {
+        p_frame = hci_v2_cb.p_unacked;
+        hci_v2_cb.p_unacked = p_frame->p_next;
+        wiced_bt_free_buffer( p_frame );
+        hci_v2_cb.in_flight--;
+        hci_v2_cb.tx_base++;
+    }
+    hci_v2_cb.retries     = 0;
+    hci_v2_cb.fast_resent = WICED_FALSE;
+
+    if ( wiced_is_timer_in_use( &hci_v2_retransmit_timer ) )
+    {
+        wiced_stop_timer( &hci_v2_retransmit_timer );
+    }
+    hci_v2_pump( );
+}
+
+/*
+ * The host acked nothing new, resend the window once instead of waiting for the timer
+ */
+static void hci_v2_fast_retransmit( void )
+{
+    hci_v2_frame_t *p_frame;
+
+    if ( ( hci_v2_cb.in_flight == 0 ) || hci_v2_cb.fast_resent )
+        return;
+
+    hci_v2_cb.fast_resent = WICED_TRUE;
+    for ( p_frame = hci_v2_cb.p_unacked; p_frame != NULL; p_frame = p_frame->p_next )
+    {
+        hci_v2_transmit( p_frame );
+    }
+    wiced_stop_timer( &hci_v2_retransmit_timer );
+    wiced_start_timer( &hci_v2_retransmit_timer, HCI_V2_RETRANSMIT_TIMEOUT );
+}
+
+static void hci_v2_retransmit_timeout( TIMER_PARAM_TYPE param )
+{
+    hci_v2_frame_t *p_frame;
+
+    if ( !hci_v2_cb.enabled || ( hci_v2_cb.in_flight == 0 ) )
+        return;
+
+    if ( ++hci_v2_cb.retries > HCI_V2_MAX_RETRIES )
+    {
+        WICED_BT_TRACE( "v2: host not responding, back to v1\n" );
+        hci_control_v2_reset( );
+        return;
+    }
+
+    /* Go-Back-N, resend everything outstanding */
+    for ( p_frame = hci_v2_cb.p_unacked; p_frame != NULL; p_frame = p_frame->p_next )
+    {
+        hci_v2_transmit( p_frame );
+    }
+    wiced_start_timer( &hci_v2_retransmit_timer, HCI_V2_RETRANSMIT_TIMEOUT );
+}
+
+/*
+ * Drop all v2 state and return to plain v1 packets
+ */
+void hci_control_v2_reset( void )
+{
+    if ( hci_v2_timer_initialized && wiced_is_timer_in_use( &hci_v2_retransmit_timer ) )
+    {
+        wiced_stop_timer( &hci_v2_retransmit_timer );
+    }
+    hci_v2_free_list( hci_v2_cb.p_unacked );
+    hci_v2_free_list( hci_v2_cb.p_backlog );
+
+    memset( &hci_v2_cb, 0, sizeof( hci_v2_cb ) );
+}
+
+/*
+ * Handle HCI_CONTROL_MISC_COMMAND_SET_PROTOCOL: version(1) window(1)
+ */
+void hci_control_v2_handle_set_protocol( uint8_t *p_data, uint32_t data_len )
+{
+    uint8_t version = ( data_len >= 1 ) ? p_data[0] : 0;
+    uint8_t window  = ( data_len >= 2 ) ? p_data[1] : HCI_V2_MAX_WINDOW;
+
+    if ( ( version != 1 ) && ( version != 2 ) )
+    {
+        hci_control_send_command_status_evt( HCI_CONTROL_EVENT_COMMAND_STATUS, HCI_CONTROL_STATUS_INVALID_ARGS );
+        return;
+    }
+
+    /* Status always goes out in v1, sequence numbers restart at 0 */
+    hci_control_v2_reset( );
+    hci_control_send_command_status_evt( HCI_CONTROL_EVENT_COMMAND_STATUS, HCI_CONTROL_STATUS_SUCCESS );
+
+    if ( version == 2 )
+    {
+        hci_v2_cb.window  = ( window == 0 ) ? 1 : ( ( window > HCI_V2_MAX_WINDOW ) ? HCI_V2_MAX_WINDOW : window );
+        hci_v2_cb.enabled = WICED_TRUE;
+
+        if ( !hci_v2_timer_initialized )
+        {
+            wiced_init_timer( &hci_v2_retransmit_timer, hci_v2_retransmit_timeout, 0, WICED_MILLI_SECONDS_TIMER );
+            hci_v2_timer_initialized = WICED_TRUE;
+        }
+    }
+    WICED_BT_TRACE( "host protocol v%d window:%d\n", version, hci_v2_cb.window );
+}
+
+wiced_bool_t hci_control_v2_is_enabled( void )
+{
+    return hci_v2_cb.enabled;
+}
+
+/*
+ * Queue an event for reliable delivery to the host, p_tail (may be NULL) follows the payload
+ */
+wiced_result_t hci_control_v2_send( uint16_t code, uint8_t *p_data, uint16_t length, const uint8_t *p_tail, uint16_t tail_length )
+{
+    hci_v2_frame_t  *p_frame;
+    hci_v2_frame_t **pp_tail;
+    uint8_t         *p;
+
+    if ( hci_v2_cb.queued >= HCI_V2_MAX_QUEUED )
+    {
+        WICED_BT_TRACE( "v2: tx queue full, event 0x%04x dropped\n", code );
+        return WICED_BT_NO_RESOURCES;
+    }
+
+    if ( ( p_frame = (hci_v2_frame_t *)wiced_bt_get_buffer( sizeof( hci_v2_frame_t ) + HCI_V2_OVERHEAD + length + tail_length ) ) == NULL )
+    {
+        HANDSFREE_COUNT( POOL_ALLOC_FAILED );
+        WICED_BT_TRACE( "v2: no buffer for event 0x%04x\n", code );
+        return WICED_BT_NO_RESOURCES;
+    }
+
+    p_frame->p_next = NULL;
+    p_frame->len    = HCI_V2_OVERHEAD + length + tail_length;
+
+    p = p_frame->data;
+    *p++ = hci_v2_cb.tx_seq++;
+    *p++ = 0;                               // ack, filled in on transmit
+    UINT16_TO_STREAM( p, code );
+    UINT16_TO_STREAM( p, length + tail_length );
+    if ( length )
+        memcpy( p, p_data, length );
+    if ( tail_length )
+        memcpy( p + length, p_tail, tail_length );
+
+    for ( pp_tail = &hci_v2_cb.p_backlog; *pp_tail != NULL; pp_tail = &( *pp_tail )->p_next )
+        ;
+    *pp_tail = p_frame;
+    hci_v2_cb.queued++;
+
+    hci_v2_pump( );
+    return WICED_BT_SUCCESS;
+}
+
+/*
+ * Handle a V2 frame received from the host
+ */
+void hci_control_v2_handle_frame( uint8_t *p_data, uint32_t data_len )
+{
+    uint8_t  seq;
+    uint16_t opcode, length, crc;
+    uint8_t *p = p_data;
+
+    if ( !hci_v2_cb.enabled )
+    {
+        hci_control_send_command_status_evt( HCI_CONTROL_EVENT_COMMAND_STATUS, HCI_CONTROL_STATUS_FAILED );
+        return;
+    }
+
+    if ( data_len < HCI_V2_OVERHEAD )
+        return;
+
+    STREAM_TO_UINT8( seq, p );
+    p++;                                    // ack, processed once the CRC is verified
+    STREAM_TO_UINT16( opcode, p );
+    STREAM_TO_UINT16( length, p );
+
+    crc = p_data[data_len - 2] | ( p_data[data_len - 1] << 8 );
+    if ( ( length + HCI_V2_OVERHEAD != data_len ) || ( hci_control_crc16( p_data, data_len - HCI_V2_CRC_LEN ) != crc ) )
+    {
+        WICED_BT_TRACE( "v2: corrupted frame\n" );
+        /* Duplicate ack lets the host resend before its timer expires */
+        hci_v2_send_ack( );
+        return;
+    }
+
+    /* Ack only frame */
+    if ( opcode == 0 )
+    {
+        if ( p_data[1] == hci_v2_cb.tx_base )
+            hci_v2_fast_retransmit( );
+        else
+            hci_v2_process_ack( p_data[1] );
+        return;
+    }
+
+    hci_v2_process_ack( p_data[1] );
+
+    if ( seq != hci_v2_cb.rx_expected )
+    {
+        /* Duplicate or out of order, the host goes back to rx_expected */
+        hci_v2_send_ack( );
+        return;
+    }
+
+    /*
+     * A stalled window fills the backlog while the host keeps sending. Leave the command
+     * unacked so that it is resent once there is room for its events, dropping the
+     * events instead would lose them for good.
+     */
+    if ( hci_v2_cb.queued + HCI_V2_RX_RESERVE > HCI_V2_MAX_QUEUED )
+    {
+        hci_v2_send_ack( );
+        return;
+    }
+
+    hci_v2_cb.rx_expected++;
+    hci_v2_cb.ack_pending = WICED_TRUE;
+
+    if ( ( opcode == HCI_CONTROL_MISC_COMMAND_V2_FRAME ) || ( opcode == HCI_CONTROL_MISC_COMMAND_SET_PROTOCOL ) )
+    {
+        hci_control_send_command_status_evt( HCI_CONTROL_EVENT_COMMAND_STATUS, HCI_CONTROL_STATUS_INVALID_ARGS );
+    }
+    else
+    {
+        hci_control_dispatch_cmd( opcode, p, length );
+    }
+
+    /* No event carried the ack, send it on its own */
+    if ( hci_v2_cb.enabled && hci_v2_cb.ack_pending )
+    {
+        hci_v2_send_ack( );
+    }
+}
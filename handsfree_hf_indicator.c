@@ -0,0 +1,287 @@
+/*
+ * Copyright 2016-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+/** @file
+ *
+ * HF indicator (+BIEV) reporting engine.
+ *
+ * The host pushes binary indicator values with HCI_CONTROL_HF_COMMAND_SET_HF_INDICATOR
+ * as often as it likes. The engine tracks which HF indicators the AG enabled with +BIND
+ * and decides when an update is worth an AT+BIEV on the air:
+ *  - Enhanced safety is reported on every change.
+ *  - Battery level is reported when it moved by at least HF_IND_BATTERY_STEP percent or
+ *    crossed one of the low battery thresholds, and at most once per
+ *    HF_IND_BATTERY_MIN_INTERVAL. Changes arriving within the interval are coalesced
+ *    and only the latest level is sent when the interval expires.
+ *
+ * State is kept per service level connection, keyed by the RFCOMM handle the host uses
+ * in the command. Each link has its own values, +BIND state and report interval timer.
+ */
+
+#include "wiced_bt_trace.h"
+#include "wiced_timer.h"
+#include "handsfree.h"
+#include "string.h"
+
+#define HF_IND_VALUE_INVALID                0xFFFF
+#define HF_IND_HANDLE_INVALID               0
+
+#define HF_IND_BATTERY_MIN_INTERVAL         10000   // Minimum time between two battery reports (msec)
+#define HF_IND_BATTERY_STEP                 10      // Battery change (percent) worth reporting
+
+typedef struct
+{
+    uint16_t    max_value;
+    uint16_t    step;
+    uint32_t    min_interval;
+} hf_ind_policy_t;
+
+static const hf_ind_policy_t hf_ind_policy[HANDSFREE_HF_IND_MAX + 1] =
+{
+    [HANDSFREE_HF_IND_ENHANCED_SAFETY] = { 1,   1,                   0                           },
+    [HANDSFREE_HF_IND_BATTERY_LEVEL]   = { 100, HF_IND_BATTERY_STEP, HF_IND_BATTERY_MIN_INTERVAL },
+};
+
+static const uint8_t hf_ind_battery_thresholds[] = { 20, 10, 5 };
+
+/* Per device, see handsfree_instance_t */
+#define hf_ind_link             ( p_handsfree_instance->hf_ind_link )
+
+static void hf_ind_timer_expiry_handler( TIMER_PARAM_TYPE param );
+
+/*
+ * Find the state of a link, optionally taking a free entry for a new handle
+ */
+static hf_ind_link_t *hf_ind_link_get( uint16_t handle, wiced_bool_t alloc )
+{
+    hf_ind_link_t *p_free = NULL;
+    uint8_t        ind_id;
+    int            i;
+
+    if ( handle == HF_IND_HANDLE_INVALID )
+        return NULL;
+
+    for ( i = 0; i < WICED_BT_HFP_HF_MAX_CONN; i++ )
+    {
+        if ( hf_ind_link[i].handle == handle )
+            return &hf_ind_link[i];
+        if ( ( p_free == NULL ) && ( hf_ind_link[i].handle == HF_IND_HANDLE_INVALID ) )
+            p_free = &hf_ind_link[i];
+    }
+
+    if ( !alloc || ( p_free == NULL ) )
+        return NULL;
+
+    /* Values from the host are unknown until pushed for this link */
+    p_free->handle = handle;
+    for ( ind_id = 0; ind_id <= HANDSFREE_HF_IND_MAX; ind_id++ )
+    {
+        p_free->ind[ind_id].enabled    = WICED_FALSE;
+        p_free->ind[ind_id].pending    = WICED_FALSE;
+        p_free->ind[ind_id].value      = HF_IND_VALUE_INVALID;
+        p_free->ind[ind_id].sent_value = HF_IND_VALUE_INVALID;
+    }
+    return p_free;
+}
+
+/*
+ * Send AT+BIEV=<ind_id>,<value> for the indicator and restart its report interval
+ */
+static void hf_ind_send( hf_ind_link_t *p_link, uint8_t ind_id )
+{
+    hf_ind_state_t *p_ind = &p_link->ind[ind_id];
+    char            arg[12];
+    int             len;
+
+    len = utl_itoa( ind_id, arg );
+    arg[len++] = ',';
+    len += utl_itoa( p_ind->value, &arg[len] );
+    arg[len] = '\0';
+
+    WICED_BT_TRACE( "[%u]BIEV %s\n", p_link->handle, arg );
+    hci_control_hf_send_at_cmd( p_link->handle, "+BIEV",
+            WICED_BT_HFP_HF_AT_SET, WICED_BT_HFP_HF_AT_FMT_STR, arg, 0 );
+
+    p_ind->sent_value = p_ind->value;
+    p_ind->pending    = WICED_FALSE;
+
+    if ( hf_ind_policy[ind_id].min_interval )
+    {
+        wiced_start_timer( &p_link->timer, hf_ind_policy[ind_id].min_interval );
+    }
+}
+
+/*
+ * Check if the battery level crossed one of the low battery thresholds since the last report
+ */
+static wiced_bool_t hf_ind_battery_threshold_crossed( uint16_t old_value, uint16_t new_value )
+{
+    int i;
+
+    for ( i = 0; i < sizeof( hf_ind_battery_thresholds ); i++ )
+    {
+        if ( ( old_value > hf_ind_battery_thresholds[i] ) != ( new_value > hf_ind_battery_thresholds[i] ) )
+            return WICED_TRUE;
+    }
+    return WICED_FALSE;
+}
+
+/*
+ * Decide if the current value of the indicator has to be reported now, later or not at all
+ */
+static void hf_ind_evaluate( hf_ind_link_t *p_link, uint8_t ind_id )
+{
+    hf_ind_state_t *p_ind = &p_link->ind[ind_id];
+    uint16_t        delta;
+
+    if ( !p_ind->enabled || ( p_ind->value == HF_IND_VALUE_INVALID ) || ( p_ind->value == p_ind->sent_value ) )
+    {
+        p_ind->pending = WICED_FALSE;
+        return;
+    }
+
+    if ( p_ind->sent_value != HF_IND_VALUE_INVALID )
+    {
+        delta = ( p_ind->value > p_ind->sent_value ) ? ( p_ind->value - p_ind->sent_value ) : ( p_ind->sent_value - p_ind->value );
+
+        if ( ( ind_id == HANDSFREE_HF_IND_BATTERY_LEVEL ) && hf_ind_battery_threshold_crossed( p_ind->sent_value, p_ind->value ) )
+        {
+            /* Low battery is reported right away */
+            wiced_stop_timer( &p_link->timer );
+        }
+        else if ( delta < hf_ind_policy[ind_id].step )
+        {
+            /* Back within a step of the value the AG has, a deferred report is not needed */
+            p_ind->pending = WICED_FALSE;
+            return;
+        }
+        else if ( hf_ind_policy[ind_id].min_interval && wiced_is_timer_in_use( &p_link->timer ) )
+        {
+            p_ind->pending = WICED_TRUE;
+            return;
+        }
+    }
+
+    hf_ind_send( p_link, ind_id );
+}
+
+static void hf_ind_timer_expiry_handler( TIMER_PARAM_TYPE param )
+{
+    hf_ind_link_t *p_link = &hf_ind_link[(uint32_t)param];
+    uint8_t        ind_id;
+
+    if ( p_link->handle == HF_IND_HANDLE_INVALID )
+        return;
+
+    for ( ind_id = 1; ind_id <= HANDSFREE_HF_IND_MAX; ind_id++ )
+    {
+        if ( p_link->ind[ind_id].pending )
+        {
+            hf_ind_evaluate( p_link, ind_id );
+        }
+    }
+}
+
+/*
+ * Initialize the HF indicator engine, no link has state yet
+ */
+void handsfree_hf_ind_init( void )
+{
+    uint32_t i;
+
+    for ( i = 0; i < WICED_BT_HFP_HF_MAX_CONN; i++ )
+    {
+        hf_ind_link[i].handle = HF_IND_HANDLE_INVALID;
+        wiced_init_timer( &hf_ind_link[i].timer, hf_ind_timer_expiry_handler, (TIMER_PARAM_TYPE)i, WICED_MILLI_SECONDS_TIMER );
+    }
+}
+
+/*
+ * The service level connection went down, drop the state of the link. The host pushes
+ * the values again for the next connection.
+ */
+void handsfree_hf_ind_reset( uint16_t handle )
+{
+    hf_ind_link_t *p_link = hf_ind_link_get( handle, WICED_FALSE );
+
+    if ( p_link == NULL )
+        return;
+
+    if ( wiced_is_timer_in_use( &p_link->timer ) )
+    {
+        wiced_stop_timer( &p_link->timer );
+    }
+    p_link->handle = HF_IND_HANDLE_INVALID;
+}
+
+/*
+ * AG enabled or disabled an HF indicator with +BIND. The current value is reported
+ * as soon as the indicator gets enabled.
+ */
+void handsfree_hf_ind_bind( uint16_t handle, uint8_t ind_id, uint8_t enabled )
+{
+    hf_ind_link_t *p_link;
+
+    if ( ( ind_id == 0 ) || ( ind_id > HANDSFREE_HF_IND_MAX ) )
+        return;
+
+    if ( ( p_link = hf_ind_link_get( handle, WICED_TRUE ) ) == NULL )
+        return;
+
+    p_link->ind[ind_id].enabled = enabled ? WICED_TRUE : WICED_FALSE;
+
+    if ( enabled )
+    {
+        p_link->ind[ind_id].sent_value = HF_IND_VALUE_INVALID;
+        hf_ind_evaluate( p_link, ind_id );
+    }
+}
+
+/*
+ * New indicator value from the host for the link
+ */
+wiced_bool_t handsfree_hf_ind_update( uint16_t handle, uint8_t ind_id, uint16_t value )
+{
+    hf_ind_link_t *p_link;
+
+    if ( ( ind_id == 0 ) || ( ind_id > HANDSFREE_HF_IND_MAX ) || ( value > hf_ind_policy[ind_id].max_value ) )
+        return WICED_FALSE;
+
+    if ( ( p_link = hf_ind_link_get( handle, WICED_TRUE ) ) == NULL )
+        return WICED_FALSE;
+
+    p_link->ind[ind_id].value = value;
+    hf_ind_evaluate( p_link, ind_id );
+
+    return WICED_TRUE;
+}
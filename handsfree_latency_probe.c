@@ -0,0 +1,316 @@
+/*
+ * Copyright 2016-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+
+/** @file
+ *
+ * End-to-end latency probe on the app voice path.
+ *
+ * Built with LATENCY_PROBE=1, which routes SCO through the application
+ * (WICED_BT_SCO_OVER_APP_CB) in place of the PCM and I2S paths. This is a measurement
+ * firmware: the received samples go to the probe and not to the codec, the uplink
+ * carries the probe signal or silence. What it measures is therefore the SCO link alone,
+ * the air both ways, the AG and the SCO packet clocking. The codec side of a normal
+ * build, the PCM/I2S interface, the codec and its DSP, is not on this path; measure
+ * mouth-to-ear on the normal firmware with host/latency_probe.py.
+ *
+ * HCI_CONTROL_MISC_COMMAND_LATENCY_PROBE, during a call with the AG looping its
+ * downlink back (an AG in echo test mode, or a test set), sends a maximum length
+ * sequence of 2^order - 1 samples on the uplink. Every received packet clocks one
+ * uplink packet of the same size, so the uplink runs on the SCO clock. The received
+ * samples are captured from the packet the first sequence sample went out with, for
+ * the sequence length plus HANDSFREE_PROBE_MAX_LAG. Once the capture is complete the
+ * cross-correlation with the sequence is computed in the application thread and the
+ * lag of its peak is reported in HCI_CONTROL_MISC_EVENT_LATENCY_PROBE:
+ *
+ *   status(1) sample_rate(2) delay_samples(2) delay_us(4) level(1)
+ *
+ * delay_samples is the round trip from the uplink packet to the downlink packet the
+ * sequence came back in: the air on both ways, the AG and the SCO packet clocking.
+ * level is the echo level in percent of the sent one; without a peak of
+ * HANDSFREE_PROBE_MIN_LEVEL the status is HCI_CONTROL_PROBE_STATUS_NOT_FOUND.
+ * host/probe_bench.c runs the probe against the stub SCO layer with a stand-in AG of
+ * known delay.
+ *
+ * The capture takes 8 KB, so there is one probe and not one per device. The instance that
+ * starts it owns it until the result is out; a command from any other instance gets
+ * HCI_CONTROL_PROBE_STATUS_BUSY and the SCO links of the others carry silence meanwhile.
+ */
+
+#ifdef HANDSFREE_LATENCY_PROBE
+
+#include "wiced_bt_trace.h"
+#include "handsfree.h"
+#include "string.h"
+
+#define HANDSFREE_PROBE_ORDER_MIN       7
+#define HANDSFREE_PROBE_LEVEL           8192    // Sequence amplitude, -12 dBFS
+#define HANDSFREE_PROBE_MIN_LEVEL       10      // Percent
+#define HANDSFREE_PROBE_BLOCK           120     // Samples sent uplink per output call
+
+#define HANDSFREE_PROBE_IDLE            0
+#define HANDSFREE_PROBE_RUNNING         1
+#define HANDSFREE_PROBE_CORRELATING     2
+
+#define HANDSFREE_PROBE_MAX_LAG         3072    // Samples, 192 ms at 16 kHz
+#define HANDSFREE_PROBE_CAPTURE_LEN     ( ( 1 << HANDSFREE_PROBE_ORDER_MAX ) - 1 + HANDSFREE_PROBE_MAX_LAG )
+
+#define HANDSFREE_PROBE_EVENT_LEN       10
+
+typedef struct
+{
+    handsfree_instance_t *p_owner;              /* Instance running the probe, NULL when idle */
+    uint8_t         state;
+    uint16_t        length;                     /* Samples of the sequence */
+    uint16_t        sample_rate;
+    uint16_t        sent;                       /* Sequence samples sent uplink */
+    uint16_t        captured;                   /* Downlink samples captured since the first one was sent */
+    uint8_t         mls[( 1 << HANDSFREE_PROBE_ORDER_MAX ) / 8];
+    int16_t         capture[HANDSFREE_PROBE_CAPTURE_LEN];
+} handsfree_probe_cb_t;
+
+static handsfree_probe_cb_t handsfree_probe_cb;
+
+/*
+ * handsfree_sim runs its devices on several threads, the owner is taken and given back
+ * atomically there. The firmware has one instance.
+ */
+#ifdef HANDSFREE_HOST_BUILD
+#define HANDSFREE_PROBE_OWNER( )        __atomic_load_n( &handsfree_probe_cb.p_owner, __ATOMIC_ACQUIRE )
+#define HANDSFREE_PROBE_RELEASE( )      __atomic_store_n( &handsfree_probe_cb.p_owner, NULL, __ATOMIC_RELEASE )
+#else
+#define HANDSFREE_PROBE_OWNER( )        ( handsfree_probe_cb.p_owner )
+#define HANDSFREE_PROBE_RELEASE( )      ( handsfree_probe_cb.p_owner = NULL )
+#endif
+
+/* Galois LFSR feedback of a maximum length sequence for each order from HANDSFREE_PROBE_ORDER_MIN */
+static const uint16_t handsfree_probe_lfsr_mask[] = { 0x60, 0xB8, 0x110, 0x240 };
+
+typedef char handsfree_probe_mask_check[ ( HANDSFREE_PROBE_ORDER_MIN + sizeof( handsfree_probe_lfsr_mask ) / sizeof( uint16_t ) - 1 ==
+                                           HANDSFREE_PROBE_ORDER_MAX ) ? 1 : -1 ];
+
+static void handsfree_latency_probe_report( uint8_t status, uint16_t sample_rate, uint32_t delay_samples, uint8_t level )
+{
+    uint8_t   tx_buf[HANDSFREE_PROBE_EVENT_LEN];
+    uint8_t  *p        = tx_buf;
+    uint32_t  delay_us = 0;
+
+    if ( sample_rate )
+        delay_us = (uint32_t)( (uint64_t)delay_samples * 1000000 / sample_rate );
+
+    UINT8_TO_STREAM( p, status );
+    UINT16_TO_STREAM( p, sample_rate );
+    UINT16_TO_STREAM( p, delay_samples );
+    UINT32_TO_STREAM( p, delay_us );
+    UINT8_TO_STREAM( p, level );
+
+    WICED_BT_TRACE( "latency probe: status %d, %d samples, %d us, level %d%%\n", status, delay_samples, delay_us, level );
+    hci_control_send_data( HCI_CONTROL_MISC_EVENT_LATENCY_PROBE, tx_buf, sizeof( tx_buf ) );
+}
+
+/*
+ * Capture complete, find the lag of the echo. Serialized by the owner's SCO data path, so
+ * it runs with the owner selected.
+ */
+static int handsfree_latency_probe_correlate( void *p_data )
+{
+    const int16_t  *p_capture = handsfree_probe_cb.capture;
+    int32_t         acc, best = 0;
+    uint32_t        lag, i, best_lag = 0, level;
+    uint16_t        sample_rate;
+
+    if ( ( HANDSFREE_PROBE_OWNER( ) != p_handsfree_instance ) || ( handsfree_probe_cb.state != HANDSFREE_PROBE_CORRELATING ) )
+        return 0;
+
+    for ( lag = 0; lag <= HANDSFREE_PROBE_MAX_LAG; lag++ )
+    {
+        acc = 0;
+        for ( i = 0; i < handsfree_probe_cb.length; i++ )
+        {
+            if ( handsfree_probe_cb.mls[i >> 3] & ( 1 << ( i & 7 ) ) )
+                acc += p_capture[lag + i];
+            else
+                acc -= p_capture[lag + i];
+        }
+        if ( acc > best )
+        {
+            best     = acc;
+            best_lag = lag;
+        }
+    }
+
+    level = (uint32_t)( (int64_t)best * 100 / ( (int32_t)HANDSFREE_PROBE_LEVEL * handsfree_probe_cb.length ) );
+    if ( level > 0xFF )
+        level = 0xFF;
+    sample_rate = handsfree_probe_cb.sample_rate;
+    handsfree_probe_cb.state = HANDSFREE_PROBE_IDLE;
+    HANDSFREE_PROBE_RELEASE( );
+
+    if ( level < HANDSFREE_PROBE_MIN_LEVEL )
+        handsfree_latency_probe_report( HCI_CONTROL_PROBE_STATUS_NOT_FOUND, sample_rate, 0, (uint8_t)level );
+    else
+        handsfree_latency_probe_report( HCI_CONTROL_PROBE_STATUS_SUCCESS, sample_rate, best_lag, (uint8_t)level );
+    return 0;
+}
+
+/*
+ * SCO data of the app voice path, one received packet. Only the owner of a running probe
+ * captures and sends the sequence, every other link answers with silence.
+ */
+void handsfree_latency_probe_sco_data( uint16_t sco_channel, uint16_t length, uint8_t *p_data )
+{
+    int16_t      uplink[HANDSFREE_PROBE_BLOCK];
+    uint32_t     count = length / 2;
+    uint32_t     n, i, take;
+    wiced_bool_t running;
+
+    while ( count )
+    {
+        n = ( count < HANDSFREE_PROBE_BLOCK ) ? count : HANDSFREE_PROBE_BLOCK;
+        running = ( HANDSFREE_PROBE_OWNER( ) == p_handsfree_instance ) && ( handsfree_probe_cb.state == HANDSFREE_PROBE_RUNNING );
+
+        if ( running )
+        {
+            take = handsfree_probe_cb.length + HANDSFREE_PROBE_MAX_LAG - handsfree_probe_cb.captured;
+            if ( take > n )
+                take = n;
+            memcpy( &handsfree_probe_cb.capture[handsfree_probe_cb.captured], p_data, take * sizeof( int16_t ) );
+            handsfree_probe_cb.captured += take;
+        }
+
+        for ( i = 0; i < n; i++ )
+        {
+            if ( !running || ( handsfree_probe_cb.sent >= handsfree_probe_cb.length ) )
+                uplink[i] = 0;
+            else if ( handsfree_probe_cb.mls[handsfree_probe_cb.sent >> 3] & ( 1 << ( handsfree_probe_cb.sent & 7 ) ) )
+                uplink[i] = HANDSFREE_PROBE_LEVEL;
+            else
+                uplink[i] = -HANDSFREE_PROBE_LEVEL;
+            if ( running )
+                handsfree_probe_cb.sent++;
+        }
+        wiced_bt_sco_output_stream( handsfree_ctxt_data.sco_index, (uint8_t *)uplink, (uint16_t)( n * sizeof( int16_t ) ) );
+
+        /* The correlation takes tens of ms, not in the SCO data path */
+        if ( running && ( handsfree_probe_cb.captured == handsfree_probe_cb.length + HANDSFREE_PROBE_MAX_LAG ) )
+        {
+            handsfree_probe_cb.state = HANDSFREE_PROBE_CORRELATING;
+            wiced_app_event_serialize( handsfree_latency_probe_correlate, NULL );
+        }
+
+        p_data += n * sizeof( int16_t );
+        count  -= n;
+    }
+}
+
+/*
+ * SCO closed, a probe of this instance waiting for its echo is lost
+ */
+void handsfree_latency_probe_sco_down( void )
+{
+    uint16_t sample_rate;
+
+    if ( ( HANDSFREE_PROBE_OWNER( ) == p_handsfree_instance ) && ( handsfree_probe_cb.state == HANDSFREE_PROBE_RUNNING ) )
+    {
+        sample_rate = handsfree_probe_cb.sample_rate;
+        handsfree_probe_cb.state = HANDSFREE_PROBE_IDLE;
+        HANDSFREE_PROBE_RELEASE( );
+        handsfree_latency_probe_report( HCI_CONTROL_PROBE_STATUS_ABORTED, sample_rate, 0, 0 );
+    }
+}
+
+static wiced_bool_t handsfree_latency_probe_claim( void )
+{
+#ifdef HANDSFREE_HOST_BUILD
+    handsfree_instance_t *p_free = NULL;
+
+    return __atomic_compare_exchange_n( &handsfree_probe_cb.p_owner, &p_free, p_handsfree_instance, 0,
+                                        __ATOMIC_ACQUIRE, __ATOMIC_RELAXED ) ? WICED_TRUE : WICED_FALSE;
+#else
+    if ( handsfree_probe_cb.p_owner != NULL )
+        return WICED_FALSE;
+    handsfree_probe_cb.p_owner = p_handsfree_instance;
+    return WICED_TRUE;
+#endif
+}
+
+/*
+ * HCI_CONTROL_MISC_COMMAND_LATENCY_PROBE: order(1), optional
+ */
+void hci_control_latency_probe_handle( uint8_t *p_data, uint32_t data_len )
+{
+    uint8_t     order = ( data_len >= 1 ) ? p_data[0] : HANDSFREE_PROBE_ORDER_MAX;
+    uint16_t    sample_rate = ( handsfree_esco_params.use_wbs == WICED_TRUE ) ? 16000 : 8000;
+    uint16_t    lfsr = 1, mask;
+    uint32_t    i;
+
+    if ( ( order < HANDSFREE_PROBE_ORDER_MIN ) || ( order > HANDSFREE_PROBE_ORDER_MAX ) )
+    {
+        handsfree_latency_probe_report( HCI_CONTROL_PROBE_STATUS_BAD_ARGS, sample_rate, 0, 0 );
+        return;
+    }
+    if ( !handsfree_ctxt_data.is_sco_connected )
+    {
+        handsfree_latency_probe_report( HCI_CONTROL_PROBE_STATUS_NO_AUDIO, sample_rate, 0, 0 );
+        return;
+    }
+    if ( !handsfree_latency_probe_claim( ) )
+    {
+        handsfree_latency_probe_report( HCI_CONTROL_PROBE_STATUS_BUSY, sample_rate, 0, 0 );
+        return;
+    }
+
+    handsfree_probe_cb.sample_rate = sample_rate;
+    handsfree_probe_cb.length = (uint16_t)( ( 1 << order ) - 1 );
+    mask = handsfree_probe_lfsr_mask[order - HANDSFREE_PROBE_ORDER_MIN];
+    memset( handsfree_probe_cb.mls, 0, sizeof( handsfree_probe_cb.mls ) );
+    for ( i = 0; i < handsfree_probe_cb.length; i++ )
+    {
+        if ( lfsr & 1 )
+        {
+            handsfree_probe_cb.mls[i >> 3] |= (uint8_t)( 1 << ( i & 7 ) );
+            lfsr = ( lfsr >> 1 ) ^ mask;
+        }
+        else
+        {
+            lfsr >>= 1;
+        }
+    }
+
+    /* Starts with the next received packet */
+    handsfree_probe_cb.sent     = 0;
+    handsfree_probe_cb.captured = 0;
+    handsfree_probe_cb.state    = HANDSFREE_PROBE_RUNNING;
+}
+
+#endif /* HANDSFREE_LATENCY_PROBE */
@@ -0,0 +1,173 @@
+/*
+ * Copyright 2016-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+/** @file
+ *
+ * Link quality monitor.
+ *
+ * While an AG is connected its RSSI is sampled every HANDSFREE_LINKQ_SAMPLE_INTERVAL and
+ * smoothed. The smoothed value moves the link between two states, with a hysteresis
+ * band so that a link at the edge does not flip on every sample:
+ *  - Good: the configured parameters, EDR 2-EV3 packets are allowed.
+ *  - Poor: entered below HANDSFREE_LINKQ_POOR_RSSI, or at once when SCO is lost to a
+ *    supervision timeout. Only basic rate EV3 packets, whose modulation holds up better
+ *    in noise, with quality optimized retransmissions. Left above
+ *    HANDSFREE_LINKQ_GOOD_RSSI.
+ *
+ * The parameters apply to the next SCO link, handsfree_sco_params() runs its choice
+ * through handsfree_link_monitor_adjust().
+ *
+ * RSSI and the reason SCO went down are all the monitor has to go on:
+ *  - The stack offers no link quality or per packet statistics of a SCO link. The
+ *    controller checks the CRC of eSCO packets, conceals what is lost and hands on
+ *    samples on the PCM or I2S voice path, so lost packets never reach the application.
+ *  - It offers no way to change the parameters of a live eSCO link either. Dropping and
+ *    reopening SCO in the middle of a call to apply them would cost more audio than a
+ *    poor link does, so the choice waits for the next SCO setup.
+ */
+
+#include "wiced_bt_trace.h"
+#include "wiced_timer.h"
+#include "handsfree.h"
+#include "string.h"
+
+#define HANDSFREE_LINKQ_SAMPLE_INTERVAL     2000    // ms between RSSI samples
+#define HANDSFREE_LINKQ_POOR_RSSI           ( -80 ) // dBm, smoothed RSSI to enter the poor state
+#define HANDSFREE_LINKQ_GOOD_RSSI           ( -70 ) // dBm, smoothed RSSI to leave it
+#define HANDSFREE_LINKQ_RSSI_SHIFT          2       // Smoothing, each sample weighs 1/4
+
+#define HANDSFREE_LINKQ_EDR_PKT_TYPES       ( BTM_SCO_PKT_TYPES_MASK_NO_2_EV3 | BTM_SCO_PKT_TYPES_MASK_NO_3_EV3 | \
+                                              BTM_SCO_PKT_TYPES_MASK_NO_2_EV5 | BTM_SCO_PKT_TYPES_MASK_NO_3_EV5 )
+
+/* Per device, see handsfree_instance_t */
+#define handsfree_linkq_cb                  ( p_handsfree_instance->handsfree_linkq_cb )
+#define handsfree_linkq_timer               ( p_handsfree_instance->handsfree_linkq_timer )
+#define handsfree_linkq_timer_initialized   ( p_handsfree_instance->handsfree_linkq_timer_initialized )
+
+static void handsfree_linkq_set_poor( wiced_bool_t poor )
+{
+    if ( handsfree_linkq_cb.poor == poor )
+        return;
+
+    handsfree_linkq_cb.poor = poor;
+    if ( poor )
+        HANDSFREE_COUNT( LINKQ_DEGRADE );
+    else
+        HANDSFREE_COUNT( LINKQ_RECOVER );
+    WICED_BT_TRACE( "linkq: %s, rssi %d\n", poor ? "poor" : "good", handsfree_linkq_cb.rssi_avg >> HANDSFREE_LINKQ_RSSI_SHIFT );
+}
+
+static void handsfree_linkq_rssi_cback( void *p_data )
+{
+    wiced_bt_dev_rssi_result_t *p_result = (wiced_bt_dev_rssi_result_t *)p_data;
+    int16_t                     rssi;
+
+    if ( !handsfree_linkq_cb.active || ( p_result == NULL ) || ( p_result->hci_status != HCI_SUCCESS ) )
+        return;
+
+    rssi = p_result->rssi;
+    handsfree_call_stats_rssi( p_result->rssi );
+    if ( !handsfree_linkq_cb.have_sample )
+    {
+        handsfree_linkq_cb.rssi_avg    = rssi << HANDSFREE_LINKQ_RSSI_SHIFT;
+        handsfree_linkq_cb.have_sample = WICED_TRUE;
+    }
+    else
+    {
+        handsfree_linkq_cb.rssi_avg += rssi - ( handsfree_linkq_cb.rssi_avg >> HANDSFREE_LINKQ_RSSI_SHIFT );
+    }
+
+    rssi = handsfree_linkq_cb.rssi_avg >> HANDSFREE_LINKQ_RSSI_SHIFT;
+    if ( !handsfree_linkq_cb.poor && ( rssi < HANDSFREE_LINKQ_POOR_RSSI ) )
+        handsfree_linkq_set_poor( WICED_TRUE );
+    else if ( handsfree_linkq_cb.poor && ( rssi > HANDSFREE_LINKQ_GOOD_RSSI ) )
+        handsfree_linkq_set_poor( WICED_FALSE );
+}
+
+static void handsfree_linkq_timeout( TIMER_PARAM_TYPE param )
+{
+    if ( !handsfree_linkq_cb.active )
+        return;
+
+    wiced_bt_dev_read_rssi( handsfree_linkq_cb.bd_addr, BT_TRANSPORT_BR_EDR, handsfree_linkq_rssi_cback );
+    wiced_start_timer( &handsfree_linkq_timer, HANDSFREE_LINKQ_SAMPLE_INTERVAL );
+}
+
+/*
+ * Start sampling the link to a newly connected AG. The state of the previous AG is kept
+ * if it is the same device.
+ */
+void handsfree_link_monitor_start( wiced_bt_device_address_t bd_addr )
+{
+    if ( !handsfree_linkq_timer_initialized )
+    {
+        wiced_init_timer( &handsfree_linkq_timer, handsfree_linkq_timeout, 0, WICED_MILLI_SECONDS_TIMER );
+        handsfree_linkq_timer_initialized = WICED_TRUE;
+    }
+
+    if ( memcmp( handsfree_linkq_cb.bd_addr, bd_addr, sizeof( wiced_bt_device_address_t ) ) != 0 )
+    {
+        memset( &handsfree_linkq_cb, 0, sizeof( handsfree_linkq_cb ) );
+        memcpy( handsfree_linkq_cb.bd_addr, bd_addr, sizeof( wiced_bt_device_address_t ) );
+    }
+    handsfree_linkq_cb.active = WICED_TRUE;
+    wiced_start_timer( &handsfree_linkq_timer, HANDSFREE_LINKQ_SAMPLE_INTERVAL );
+}
+
+void handsfree_link_monitor_stop( void )
+{
+    handsfree_linkq_cb.active = WICED_FALSE;
+    if ( handsfree_linkq_timer_initialized && wiced_is_timer_in_use( &handsfree_linkq_timer ) )
+        wiced_stop_timer( &handsfree_linkq_timer );
+}
+
+/*
+ * SCO went down on its own, a supervision timeout means the link could not carry it
+ */
+void handsfree_link_monitor_sco_lost( uint8_t reason )
+{
+    if ( handsfree_linkq_cb.active && ( reason == HCI_ERR_CONNECTION_TOUT ) )
+        handsfree_linkq_set_poor( WICED_TRUE );
+}
+
+/*
+ * Apply the packet types and retransmission effort of the current link state
+ */
+void handsfree_link_monitor_adjust( wiced_bt_sco_params_t *p_params )
+{
+    if ( handsfree_linkq_cb.poor )
+    {
+        p_params->packet_types   |= HANDSFREE_LINKQ_EDR_PKT_TYPES;
+        p_params->retrans_effort  = BTM_ESCO_RETRANS_QUALITY;
+    }
+}
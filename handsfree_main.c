@@ -140,13 +140,13 @@ WICED_CONFIG_DYNAMIC_MEMORY_t gen_pool_config =
 
 WICED_MEM_PRE_INIT_CONTROL g_mem_pre_init =
 {
-    .max_ble_connections = 4,
-    .max_peripheral_piconet = 2,
-    .max_resolving_list = 16,
+    .max_ble_connections = HANDSFREE_CAP_LE_LINKS,
+    .max_peripheral_piconet = HANDSFREE_CAP_HF_CONNECTIONS,     /* Peripheral in each AG piconet */
+    .max_resolving_list = HANDSFREE_CAP_LE_LINKS ? HANDSFREE_CAP_BONDS : 0,
     .onfound_list_len = 0,
-    .max_multi_adv_instances = 8,
+    .max_multi_adv_instances = HANDSFREE_CAP_LE_ADV_SETS,
     .adv_filter_size = 0,
-    .max_bt_connections = 5,
+    .max_bt_connections = HANDSFREE_CAP_BR_LINKS,
     .disable_coex_fix = 1,
     .p_ACL_pool_config = &ACL_pool_config,
     .p_LE_pool_config = &LE_pool_config,
@@ -155,8 +155,11 @@ WICED_MEM_PRE_INIT_CONTROL g_mem_pre_init =
 #endif
 
 #if defined(CYW20721B2) || defined(CYW43012C0) || defined(CYW55572A1)
-static int32_t stream_id = WICED_AUDIO_MANAGER_STREAM_ID_INVALID;
-static audio_config_t audio_config =
+/* Per device, see handsfree_instance_t */
+#define stream_id                       ( p_handsfree_instance->stream_id )
+#define audio_config                    ( p_handsfree_instance->audio_config )
+
+static const audio_config_t audio_config_default =
     {
 #if (WICED_BT_HFP_HF_WBS_INCLUDED == TRUE)
         .sr = AM_PLAYBACK_SR_16K,
@@ -169,6 +172,22 @@ static audio_config_t audio_config =
        .mic_gain = AM_VOL_LEVEL_HIGH-2,
        .sink = AM_HEADPHONES,
     };
+
+static int32_t handsfree_utils_hfp_volume_to_am_volume(int32_t vol)
+{
+    uint32_t remainder;
+    int32_t am_level;
+
+    am_level    = (vol * AM_VOL_LEVEL_HIGH) / HFP_VOLUME_HIGH;
+    remainder   = (vol * AM_VOL_LEVEL_HIGH) % HFP_VOLUME_HIGH;
+
+    if (remainder >= AM_VOL_LEVEL_HIGH)
+    {
+        am_level++;
+    }
+
+    return am_level;
+}
 #endif
 static void hci_control_transport_status( wiced_transport_type_t type );
 static void hfp_timer_expiry_handler( TIMER_PARAM_TYPE param );
@@ -194,8 +213,8 @@ const wiced_transport_cfg_t  transport_cfg =
 #else
     .rx_buff_pool_cfg =
     {
-        .buffer_size  = TRANS_UART_BUFFER_SIZE,
-        .buffer_count = 2
+        .buffer_size  = HANDSFREE_CAP_RX_BUFFER_SIZE,
+        .buffer_count = HANDSFREE_CAP_RX_BUFFERS
     },
 #endif
     .p_status_handler    = hci_control_transport_status,
@@ -208,7 +227,7 @@ const wiced_transport_cfg_t  transport_cfg =
 wiced_bt_heap_t *p_default_heap = NULL;
 #endif
 
-wiced_bt_sco_params_t handsfree_esco_params =
+static const wiced_bt_sco_params_t handsfree_esco_params_default =
 {
 #if (WICED_BT_HFP_HF_WBS_INCLUDED == TRUE)
         0x000D,             /* Latency: 13 ms ( HS/HF can use EV3, 2-EV3, 3-EV3 ) ( T2 ) */
@@ -234,12 +253,200 @@ wiced_bt_sco_params_t headset_sco_params =
 };
 #endif
 
-bluetooth_hfp_context_t handsfree_ctxt_data;
-handsfrees_app_globals handsfree_app_states;
+static handsfree_instance_t handsfree_default_instance;
+#ifdef HANDSFREE_HOST_BUILD
+_Thread_local handsfree_instance_t *p_handsfree_instance = &handsfree_default_instance;
+#else
+handsfree_instance_t *p_handsfree_instance = &handsfree_default_instance;
+#endif
+
+/*
+ * Make p_instance the state the application works on and return the previous one.
+ * NULL selects the default instance.
+ */
+handsfree_instance_t *handsfree_instance_select( handsfree_instance_t *p_instance )
+{
+    handsfree_instance_t *p_prev = p_handsfree_instance;
+
+    p_handsfree_instance = ( p_instance != NULL ) ? p_instance : &handsfree_default_instance;
+    return p_prev;
+}
+
+/*
+ * Power on state of the selected instance, done first thing by application_start(). Only
+ * the fields that do not start at zero are listed here.
+ */
+static void handsfree_instance_init( void )
+{
+    memset( p_handsfree_instance, 0, sizeof( handsfree_instance_t ) );
+
+    handsfree_esco_params = handsfree_esco_params_default;
+#if defined(CYW20721B2) || defined(CYW43012C0) || defined(CYW55572A1)
+    stream_id    = WICED_AUDIO_MANAGER_STREAM_ID_INVALID;
+    audio_config = audio_config_default;
+    handsfree_audio_stream_reset( );
+#endif
+}
+
+/*
+ * Load the capabilities cached for a bonded AG and pre-arm the SCO and audio configuration
+ * so that an audio connection can be set up before the SLC negotiation has completed.
+ */
+static void handsfree_ag_cache_load( wiced_bt_device_address_t bd_addr )
+{
+    handsfree_ag_cache_t *p_cache = &handsfree_ctxt_data.ag_cache;
+
+    handsfree_ctxt_data.ag_cache_dirty = WICED_FALSE;
+
+    handsfree_ctxt_data.spkr_volume = BT_AUDIO_HFP_VOLUME_DEFAULT;
+    handsfree_ctxt_data.mic_volume  = BT_AUDIO_HFP_VOLUME_DEFAULT;
+
+    if ( !hci_control_read_ag_cache( bd_addr, p_cache ) )
+    {
+        memset( p_cache, 0, sizeof( handsfree_ag_cache_t ) );
+        return;
+    }
+
+    /* Restore the gains the user last chose on this AG */
+    if ( p_cache->spkr_volume )
+        handsfree_ctxt_data.spkr_volume = p_cache->spkr_volume;
+    if ( p_cache->mic_volume )
+        handsfree_ctxt_data.mic_volume = p_cache->mic_volume;
+
+    WICED_BT_TRACE( "AG cache hit %B features:0x%x codec:%d\n", bd_addr, p_cache->ag_features, p_cache->last_codec );
+
+    if ( p_cache->ag_features & WICED_BT_HFP_AG_FEATURE_INBAND_RING_TONE_CAPABILITY )
+        handsfree_ctxt_data.inband_ring_status = WICED_BT_HFP_HF_INBAND_RING_ENABLED;
+    else
+        handsfree_ctxt_data.inband_ring_status = WICED_BT_HFP_HF_INBAND_RING_DISABLED;
+
+#if (WICED_BT_HFP_HF_WBS_INCLUDED == TRUE)
+    handsfree_esco_params.use_wbs = ( p_cache->last_codec == WICED_BT_HFP_HF_MSBC_CODEC ) ? WICED_TRUE : WICED_FALSE;
+#endif
+#if defined(CYW20721B2) || defined(CYW43012C0) || defined(CYW55572A1)
+    audio_config.sr = ( handsfree_esco_params.use_wbs == WICED_TRUE ) ? AM_PLAYBACK_SR_16K : AM_PLAYBACK_SR_8K;
+#endif
+}
+
+/*
+ * Record a new speaker or microphone gain (HFP level 0..15) for the connected AG and
+ * apply it to the running audio stream.
+ */
+void handsfree_set_volume( uint8_t type, uint8_t level )
+{
+    uint8_t *p_level;
+    uint8_t *p_cached;
+
+    if ( level > BT_AUDIO_HFP_VOLUME_MAX )
+        level = BT_AUDIO_HFP_VOLUME_MAX;
+
+    if ( type == WICED_BT_HFP_HF_SPEAKER )
+    {
+        p_level  = &handsfree_ctxt_data.spkr_volume;
+        p_cached = &handsfree_ctxt_data.ag_cache.spkr_volume;
+    }
+    else
+    {
+        p_level  = &handsfree_ctxt_data.mic_volume;
+        p_cached = &handsfree_ctxt_data.ag_cache.mic_volume;
+    }
+
+    if ( *p_level != level )
+        handsfree_call_stats_volume_change( );
+    *p_level = level;
+    if ( ( handsfree_ctxt_data.ag_cache.valid == HANDSFREE_AG_CACHE_VALID ) && ( *p_cached != level ) )
+    {
+        *p_cached = level;
+        handsfree_ctxt_data.ag_cache_dirty = WICED_TRUE;
+    }
+
+#if defined(CYW20721B2) || defined(CYW43012C0) || defined(CYW55572A1)
+    if ( type == WICED_BT_HFP_HF_SPEAKER )
+        audio_config.volume = handsfree_utils_hfp_volume_to_am_volume( level );
+    else
+        audio_config.mic_gain = handsfree_utils_hfp_volume_to_am_volume( level );
+
+    if ( ( stream_id != WICED_AUDIO_MANAGER_STREAM_ID_INVALID ) && handsfree_ctxt_data.is_sco_connected )
+    {
+        handsfree_audio_update_gains( stream_id, audio_config.volume, audio_config.mic_gain );
+    }
+#endif
+}
+
+#if defined(CYW20721B2) || defined(CYW43012C0) || defined(CYW55572A1)
+/*
+ * Open the HFP audio stream and apply its configuration ahead of SCO, so that only the
+ * stream start is left when SCO connects. Called by the audio arbiter.
+ */
+void handsfree_call_audio_prewarm( void )
+{
+    if ( stream_id == WICED_AUDIO_MANAGER_STREAM_ID_INVALID )
+        stream_id = wiced_am_stream_open( HFP );
+
+    audio_config.volume   = handsfree_utils_hfp_volume_to_am_volume( handsfree_ctxt_data.spkr_volume );
+    audio_config.mic_gain = handsfree_utils_hfp_volume_to_am_volume( handsfree_ctxt_data.mic_volume );
+    if ( WICED_SUCCESS != handsfree_audio_set_config( stream_id, &audio_config ) )
+        WICED_BT_TRACE( "wiced_am_set_param failed\n" );
+}
+
+/*
+ * Close a stream opened for a call that ended without audio
+ */
+void handsfree_call_audio_release( void )
+{
+    if ( ( stream_id != WICED_AUDIO_MANAGER_STREAM_ID_INVALID ) && !handsfree_ctxt_data.is_sco_connected )
+    {
+        wiced_am_stream_close( stream_id );
+        stream_id = WICED_AUDIO_MANAGER_STREAM_ID_INVALID;
+        handsfree_audio_stream_reset( );
+    }
+}
+
+/*
+ * Hand the audio path back once there is neither a call, a voice recognition session
+ * nor call audio
+ */
+void handsfree_call_audio_check_idle( void )
+{
+    if ( !handsfree_ctxt_data.call_active && !handsfree_ctxt_data.is_sco_connected && !handsfree_ctxt_data.vr_active &&
+         ( handsfree_ctxt_data.call_setup == WICED_BT_HFP_HF_CALLSETUP_STATE_IDLE ) )
+    {
+        handsfree_audio_arbiter_call_end( );
+    }
+}
+#endif
+
+/*
+ * Write the AG cache record back if it changed during this connection
+ */
+static void handsfree_ag_cache_flush( wiced_bt_device_address_t bd_addr )
+{
+    if ( handsfree_ctxt_data.ag_cache_dirty )
+    {
+        hci_control_write_ag_cache( bd_addr, &handsfree_ctxt_data.ag_cache );
+        handsfree_ctxt_data.ag_cache_dirty = WICED_FALSE;
+    }
+}
+
+/*
+ * Serialize an HF event to the host. The layouts are the wire contract parsed by the
+ * host (see host/handsfree_client.hpp decode_event), all fields little endian:
+ *
+ *   OPEN            handle(2) bd_addr(6, LSB first) status(1)
+ *   CLOSE           handle(2)
+ *   AUDIO_OPEN      handle(2)
+ *   AUDIO_CLOSE     handle(2)
+ *   CONNECTED       handle(2) peer_features(4)
+ *   PROFILE_TYPE    handle(2) profile(1)
+ *   AT_EVENT_*      handle(2) num(2) string(NUL terminated, empty if no data)
+ *
+ * host/hf_event_test checks every event against the frames in host/golden/hf_events.
+ */
+#define HCI_CONTROL_HF_EVENT_MAX_LEN    ( 2 + 2 + WICED_BT_HFP_HF_MAX_AT_CMD_LEN + 1 )
 
-void hci_control_send_hf_event(uint16_t evt, uint16_t handle, hci_control_hf_event_t *p_data)
+HANDSFREE_HOT void hci_control_send_hf_event(uint16_t evt, uint16_t handle, hci_control_hf_event_t *p_data)
 {
-    uint8_t   tx_buf[300];
+    uint8_t   tx_buf[HCI_CONTROL_HF_EVENT_MAX_LEN];
     uint8_t  *p = tx_buf;
     int       i;
 
@@ -288,7 +495,7 @@ void hci_control_send_hf_event(uint16_t evt, uint16_t handle, hci_control_hf_eve
             }
             break;
     }
-    wiced_transport_send_data(evt, tx_buf, (int)(p - tx_buf));
+    hci_control_send_data(evt, tx_buf, (int)(p - tx_buf));
 }
 
 static void handsfree_connection_event_handler(wiced_bt_hfp_hf_event_data_t* p_data)
@@ -302,6 +509,7 @@ static void handsfree_connection_event_handler(wiced_bt_hfp_hf_event_data_t* p_d
         memcpy(open.bd_addr,p_data->conn_data.remote_address,BD_ADDR_LEN);
         open.status = WICED_BT_SUCCESS;
         handsfree_ctxt_data.rfcomm_handle = p_scb->rfcomm_handle;
+        handsfree_ag_cache_load( p_data->conn_data.remote_address );
         hci_control_send_hf_event( HCI_CONTROL_HF_EVENT_OPEN, p_scb->rfcomm_handle, (hci_control_hf_event_t *) &open);
 
         if( p_data->conn_data.connected_profile == WICED_BT_HFP_PROFILE )
@@ -318,15 +526,26 @@ static void handsfree_connection_event_handler(wiced_bt_hfp_hf_event_data_t* p_d
 
         status = wiced_bt_sco_create_as_acceptor(&handsfree_ctxt_data.sco_index);
         WICED_BT_TRACE("%s: status [%d] SCO INDEX [%d] \n", __func__, status, handsfree_ctxt_data.sco_index);
+        handsfree_link_monitor_start( p_data->conn_data.remote_address );
     }
     else if(p_data->conn_data.conn_state == WICED_BT_HFP_HF_STATE_SLC_CONNECTED)
     {
         WICED_BT_TRACE("%s: Peer BD Addr [%B]\n", __func__,p_data->conn_data.remote_address);
 
         memcpy( handsfree_ctxt_data.peer_bd_addr, p_data->conn_data.remote_address, sizeof(wiced_bt_device_address_t));
+        handsfree_ag_cache_flush( p_data->conn_data.remote_address );
+
+        /* The profile reported the default gains during SLC setup, correct them for this AG */
+        if ( handsfree_ctxt_data.spkr_volume != BT_AUDIO_HFP_VOLUME_DEFAULT )
+            wiced_bt_hfp_hf_notify_volume( handsfree_ctxt_data.rfcomm_handle, WICED_BT_HFP_HF_SPEAKER, handsfree_ctxt_data.spkr_volume );
+        if ( handsfree_ctxt_data.mic_volume != BT_AUDIO_HFP_VOLUME_DEFAULT )
+            wiced_bt_hfp_hf_notify_volume( handsfree_ctxt_data.rfcomm_handle, WICED_BT_HFP_HF_MIC, handsfree_ctxt_data.mic_volume );
     }
     else if(p_data->conn_data.conn_state == WICED_BT_HFP_HF_STATE_DISCONNECTED)
     {
+        handsfree_ag_cache_flush( p_data->conn_data.remote_address );
+        handsfree_hf_ind_reset( handsfree_ctxt_data.rfcomm_handle );
+        handsfree_link_monitor_stop( );
         memset(handsfree_ctxt_data.peer_bd_addr, 0, sizeof(wiced_bt_device_address_t));
         if(handsfree_ctxt_data.sco_index != BT_AUDIO_INVALID_SCO_INDEX)
         {
@@ -335,6 +554,11 @@ static void handsfree_connection_event_handler(wiced_bt_hfp_hf_event_data_t* p_d
             WICED_BT_TRACE("%s: remove sco status [%d] \n", __func__, status);
         }
         hci_control_send_hf_event( HCI_CONTROL_HF_EVENT_CLOSE, handsfree_ctxt_data.rfcomm_handle, NULL);
+        handsfree_vr_end( );
+#if defined(CYW20721B2) || defined(CYW43012C0) || defined(CYW55572A1)
+        /* No more call indications will come from this AG */
+        handsfree_audio_arbiter_call_end( );
+#endif
     }
     UNUSED_VARIABLE(status);
 }
@@ -385,6 +609,13 @@ static void handsfree_call_setup_event_handler(wiced_bt_hfp_hf_call_data_t* call
     handsfree_ctxt_data.call_active = call_data->active_call_present;
     handsfree_ctxt_data.call_setup  = call_data->setup_state;
     handsfree_ctxt_data.call_held   = call_data->held_call_present;
+
+#if defined(CYW20721B2) || defined(CYW43012C0) || defined(CYW55572A1)
+    if ( call_data->active_call_present || ( call_data->setup_state != WICED_BT_HFP_HF_CALLSETUP_STATE_IDLE ) )
+        handsfree_audio_arbiter_call_start( );
+    else
+        handsfree_call_audio_check_idle( );
+#endif
 }
 
 static void handsfree_send_ciev_cmd (uint16_t handle, uint8_t ind_id,uint8_t ind_val,hci_control_hf_value_t *p_val)
@@ -424,7 +655,7 @@ static void handsfree_send_clcc_evt (uint16_t handle, wiced_bt_hfp_hf_active_cal
     hci_control_send_hf_event( HCI_CONTROL_HF_AT_EVENT_BASE + HCI_CONTROL_HF_AT_EVENT_CLCC, p_scb->rfcomm_handle, (hci_control_hf_event_t *)p_val );
 }
 
-static void handsfree_event_callback( wiced_bt_hfp_hf_event_t event, wiced_bt_hfp_hf_event_data_t* p_data)
+static HANDSFREE_HOT void handsfree_event_callback( wiced_bt_hfp_hf_event_t event, wiced_bt_hfp_hf_event_data_t* p_data)
 {
     hci_control_hf_event_t     p_val;
     int res = 0;
@@ -441,6 +672,19 @@ static void handsfree_event_callback( wiced_bt_hfp_hf_event_t event, wiced_bt_hf
             res = HCI_CONTROL_HF_EVENT_CONNECTED;
             p_val.conn.peer_features = p_data->ag_feature_flags;
 
+            /* The cache only pre-arms the setup, record the feature set if it changed */
+            if ( handsfree_ctxt_data.ag_cache.valid != HANDSFREE_AG_CACHE_VALID )
+            {
+                handsfree_ctxt_data.ag_cache.valid      = HANDSFREE_AG_CACHE_VALID;
+                handsfree_ctxt_data.ag_cache.last_codec = WICED_BT_HFP_HF_CVSD_CODEC;
+                handsfree_ctxt_data.ag_cache_dirty      = WICED_TRUE;
+            }
+            if ( handsfree_ctxt_data.ag_cache.ag_features != p_data->ag_feature_flags )
+            {
+                handsfree_ctxt_data.ag_cache.ag_features = p_data->ag_feature_flags;
+                handsfree_ctxt_data.ag_cache_dirty       = WICED_TRUE;
+            }
+
             if(p_data->ag_feature_flags & WICED_BT_HFP_AG_FEATURE_INBAND_RING_TONE_CAPABILITY)
             {
                 handsfree_ctxt_data.inband_ring_status = WICED_BT_HFP_HF_INBAND_RING_ENABLED;
@@ -498,6 +742,9 @@ static void handsfree_event_callback( wiced_bt_hfp_hf_event_t event, wiced_bt_hf
 
         case WICED_BT_HFP_HF_RING_EVT:
             WICED_BT_TRACE("%s: RING \n", __func__);
+#if defined(CYW20721B2) || defined(CYW43012C0) || defined(CYW55572A1)
+            handsfree_audio_arbiter_call_start( );
+#endif
             res = HCI_CONTROL_HF_AT_EVENT_BASE + HCI_CONTROL_HF_AT_EVENT_RING;
             break;
 
@@ -507,16 +754,22 @@ static void handsfree_event_callback( wiced_bt_hfp_hf_event_t event, wiced_bt_hf
 
         case WICED_BT_HFP_HF_OK_EVT:
             WICED_BT_TRACE("%s: OK \n", __func__);
+            if ( handsfree_vr_at_result( p_data->handle, WICED_TRUE ) )
+                break;
             res = HCI_CONTROL_HF_AT_EVENT_BASE + HCI_CONTROL_HF_AT_EVENT_OK;
             break;
 
         case WICED_BT_HFP_HF_ERROR_EVT:
             WICED_BT_TRACE("%s: Error \n", __func__);
+            if ( handsfree_vr_at_result( p_data->handle, WICED_FALSE ) )
+                break;
             res = HCI_CONTROL_HF_AT_EVENT_BASE + HCI_CONTROL_HF_AT_EVENT_ERROR;
             break;
 
         case WICED_BT_HFP_HF_CME_ERROR_EVT:
             WICED_BT_TRACE("%s: CME Error \n", __func__);
+            if ( handsfree_vr_at_result( p_data->handle, WICED_FALSE ) )
+                break;
             p_val.val.num = p_data->error_code;
             res = HCI_CONTROL_HF_AT_EVENT_BASE + HCI_CONTROL_HF_AT_EVENT_CMEE;
             break;
@@ -546,21 +799,34 @@ static void handsfree_event_callback( wiced_bt_hfp_hf_event_t event, wiced_bt_hf
                 res = HCI_CONTROL_HF_AT_EVENT_BASE + HCI_CONTROL_HF_AT_EVENT_VGS;
             }
             p_val.val.num = p_data->volume.level;
+            handsfree_set_volume( p_data->volume.type, p_data->volume.level );
             break;
 
         case WICED_BT_HFP_HFP_CODEC_SET_EVT:
             res = HCI_CONTROL_HF_AT_EVENT_BASE + HCI_CONTROL_HF_AT_EVENT_BCS;
+            handsfree_call_stats_setup_start( );
             if ( p_data->selected_codec == WICED_BT_HFP_HF_MSBC_CODEC )
+            {
                 handsfree_esco_params.use_wbs = WICED_TRUE;
+                HANDSFREE_COUNT( CODEC_MSBC );
+            }
             else
+            {
                 handsfree_esco_params.use_wbs = WICED_FALSE;
+                HANDSFREE_COUNT( CODEC_CVSD );
+            }
             p_val.val.num = p_data->selected_codec;
 
+            if ( handsfree_ctxt_data.ag_cache.last_codec != p_data->selected_codec )
+            {
+                handsfree_ctxt_data.ag_cache.last_codec = p_data->selected_codec;
+                handsfree_ctxt_data.ag_cache_dirty      = WICED_TRUE;
+            }
 
             if (handsfree_ctxt_data.init_sco_conn == WICED_TRUE)
             {
                 /* timer started here to check if the sco has been created as an acceptor*/
-                wiced_start_timer(&handsfree_app_states.hfp_timer,SCO_CONNECTION_WAIT_TIMEOUT);
+                wiced_start_timer(&handsfree_app_states.hfp_timer,handsfree_sco_wait_timeout());
 
                 handsfree_ctxt_data.init_sco_conn = WICED_FALSE;
             }
@@ -577,13 +843,16 @@ static void handsfree_event_callback( wiced_bt_hfp_hf_event_t event, wiced_bt_hf
 
             audio_config.channels =  1;
             audio_config.bits_per_sample = DEFAULT_BITSPSAM;
-            audio_config.volume = AM_VOL_LEVEL_HIGH-2;
+            audio_config.volume = handsfree_utils_hfp_volume_to_am_volume(handsfree_ctxt_data.spkr_volume);
+            audio_config.mic_gain = handsfree_utils_hfp_volume_to_am_volume(handsfree_ctxt_data.mic_volume);
+            /* Call audio is about to start, suspends music */
+            handsfree_audio_arbiter_call_start( );
             if (stream_id == WICED_AUDIO_MANAGER_STREAM_ID_INVALID)
             {
                 stream_id = wiced_am_stream_open(HFP);
             }
 
-            if( WICED_SUCCESS != wiced_am_stream_set_param(stream_id,AM_AUDIO_CONFIG, &audio_config))
+            if( WICED_SUCCESS != handsfree_audio_set_config(stream_id, &audio_config))
                 WICED_BT_TRACE("wiced_am_set_param failed\n");
 #endif
             break;
@@ -602,6 +871,30 @@ static void handsfree_event_callback( wiced_bt_hfp_hf_event_t event, wiced_bt_hf
             p_val.val.str[0] = p_data->bind_data.ind_id + '0';
             p_val.val.str[1] = ',';
             p_val.val.str[2] = p_data->bind_data.ind_value + '0';
+            {
+                wiced_bt_hfp_hf_scb_t *p_scb = wiced_bt_hfp_hf_get_scb_by_handle( p_data->handle );
+
+                if ( p_scb != NULL )
+                    handsfree_hf_ind_bind( p_scb->rfcomm_handle, p_data->bind_data.ind_id, p_data->bind_data.ind_value );
+            }
+            break;
+
+        case WICED_BT_HFP_HF_BVRA_EVT:
+            res = HCI_CONTROL_HF_AT_EVENT_BASE + HCI_CONTROL_HF_AT_EVENT_BVRA;
+            p_val.val.num = p_data->voice_recognition;
+            if ( p_data->voice_recognition == 0 )
+                handsfree_vr_end( );
+            break;
+
+        case WICED_BT_HFP_HF_UNKNOWN_AT_CMD_EVT:
+            /* HFP 1.8 +BVRA with text is not parsed by the profile, texts can be long */
+            if ( p_data->unknown_at_data != NULL )
+            {
+                wiced_bt_hfp_hf_scb_t *p_scb = wiced_bt_hfp_hf_get_scb_by_handle( p_data->handle );
+
+                if ( p_scb != NULL )
+                    handsfree_vr_text_handle( p_scb->rfcomm_handle, p_data->unknown_at_data );
+            }
             break;
 
         default:
@@ -620,13 +913,25 @@ void handsfree_init_context_data(void)
     handsfree_ctxt_data.call_held           = 0;
     handsfree_ctxt_data.call_setup          = WICED_BT_HFP_HF_CALLSETUP_STATE_IDLE;
     handsfree_ctxt_data.connection_status   = WICED_BT_HFP_HF_STATE_DISCONNECTED;
-    handsfree_ctxt_data.spkr_volume         = 8;
-    handsfree_ctxt_data.mic_volume          = 8;
+    handsfree_ctxt_data.spkr_volume         = BT_AUDIO_HFP_VOLUME_DEFAULT;
+    handsfree_ctxt_data.mic_volume          = BT_AUDIO_HFP_VOLUME_DEFAULT;
     handsfree_ctxt_data.sco_index           = BT_AUDIO_INVALID_SCO_INDEX;
     handsfree_ctxt_data.init_sco_conn       = WICED_FALSE;
+    handsfree_ctxt_data.vr_active           = WICED_FALSE;
+    handsfree_ctxt_data.vr_at_state         = HANDSFREE_VR_AT_IDLE;
+    handsfree_ctxt_data.ag_cache_dirty      = WICED_FALSE;
+    memset( &handsfree_ctxt_data.ag_cache, 0, sizeof( handsfree_ag_cache_t ) );
 }
 
 wiced_bt_voice_path_setup_t handsfree_sco_path = {
+#if defined(HANDSFREE_LATENCY_PROBE)
+    /*
+     * SCO data through the latency probe in place of the codec, see
+     * handsfree_latency_probe.c. It measures the SCO link only, not the PCM/I2S path below.
+     */
+    .path = WICED_BT_SCO_OVER_APP_CB,
+    .p_sco_data_cb = handsfree_latency_probe_sco_data
+#else
 #ifdef CYW20706A2
     .path = WICED_BT_SCO_OVER_I2SPCM,
 #else
@@ -635,6 +940,7 @@ wiced_bt_voice_path_setup_t handsfree_sco_path = {
 #if defined(CYW20721B2) || defined (CYW43012C0) || defined(CYW55572A1)
     .p_sco_data_cb = NULL
 #endif
+#endif
 };
 
 void handsfree_hfp_init(void)
@@ -681,6 +987,7 @@ void handsfree_write_eir()
 
     if ( !pBuf )
     {
+        HANDSFREE_COUNT( POOL_ALLOC_FAILED );
         return;
     }
     p = pBuf;
@@ -713,7 +1020,6 @@ void handsfree_write_eir()
     return;
 }
 
-extern wiced_bt_buffer_pool_t* p_key_info_pool;//Pool for storing the  key info
 extern void hci_control_hci_trace_cback( wiced_bt_hci_trace_type_t type, uint16_t length, uint8_t* p_data );
 
 void handsfree_post_bt_init(wiced_bt_management_evt_data_t *p_event_data)
@@ -726,6 +1032,7 @@ void handsfree_post_bt_init(wiced_bt_management_evt_data_t *p_event_data)
         handsfree_app_states.pairing_allowed = WICED_FALSE;
         wiced_init_timer( &handsfree_app_states.hfp_timer, hfp_timer_expiry_handler, 0,
                         WICED_MILLI_SECONDS_TIMER );
+        handsfree_hf_ind_init( );
 
         /* Set-up EIR data */
         handsfree_write_eir();
@@ -733,6 +1040,9 @@ void handsfree_post_bt_init(wiced_bt_management_evt_data_t *p_event_data)
         wiced_bt_sdp_db_init((uint8_t *)handsfree_sdp_db, wiced_app_cfg_sdp_record_get_size());
 
         handsfree_hfp_init();
+#if HANDSFREE_CAP_A2DP && !defined(BTSTACK_VER) && ( defined(CYW20721B2) || defined(CYW43012C0) )
+        handsfree_a2dp_sink_init();
+#endif
     }
     else
     {
@@ -741,28 +1051,10 @@ void handsfree_post_bt_init(wiced_bt_management_evt_data_t *p_event_data)
     }
 }
 
-#if defined(CYW20721B2) || defined(CYW43012C0) || defined(CYW55572A1)
-static int32_t handsfree_utils_hfp_volume_to_am_volume(int32_t vol)
-{
-    uint32_t remainder;
-    int32_t am_level;
-
-    am_level    = (vol * AM_VOL_LEVEL_HIGH) / HFP_VOLUME_HIGH;
-    remainder   = (vol * AM_VOL_LEVEL_HIGH) % HFP_VOLUME_HIGH;
-
-    if (remainder >= AM_VOL_LEVEL_HIGH)
-    {
-        am_level++;
-    }
-
-    return am_level;
-}
-#endif
-
 /*
  * Process SCO management callback
  */
-void hf_sco_management_callback( wiced_bt_management_evt_t event, wiced_bt_management_evt_data_t *p_event_data )
+HANDSFREE_HOT void hf_sco_management_callback( wiced_bt_management_evt_t event, wiced_bt_management_evt_data_t *p_event_data )
 {
     wiced_bt_hfp_hf_scb_t *p_scb = wiced_bt_hfp_hf_get_scb_by_bd_addr (handsfree_ctxt_data.peer_bd_addr);
     int status;
@@ -790,41 +1082,54 @@ void hf_sco_management_callback( wiced_bt_management_evt_t event, wiced_bt_manag
                 audio_config.sr = AM_PLAYBACK_SR_8K;
             }
 
-            audio_config.volume = handsfree_utils_hfp_volume_to_am_volume(AM_VOL_LEVEL_HIGH - 2);
-            audio_config.mic_gain = handsfree_utils_hfp_volume_to_am_volume(AM_VOL_LEVEL_HIGH - 2);
+            /* Gains of this AG, restored from the AG cache record or set during the connection */
+            audio_config.volume = handsfree_utils_hfp_volume_to_am_volume(handsfree_ctxt_data.spkr_volume);
+            audio_config.mic_gain = handsfree_utils_hfp_volume_to_am_volume(handsfree_ctxt_data.mic_volume);
 
-            if( WICED_SUCCESS != wiced_am_stream_set_param(stream_id, AM_AUDIO_CONFIG, &audio_config))
+            /* Skipped if the configuration applied at codec negotiation is still current */
+            if( WICED_SUCCESS != handsfree_audio_set_config(stream_id, &audio_config))
                 WICED_BT_TRACE("wiced_am_set_param failed\n");
 
-            if( WICED_SUCCESS != wiced_am_stream_start(stream_id))
+            if( WICED_SUCCESS != handsfree_audio_start(stream_id))
                 WICED_BT_TRACE("wiced_am_stream_start failed stream_id : %d \n", stream_id);
 
             /* Set speaker volume and MIC gain to make the volume consistency between call
              * sessions. */
-            if (WICED_SUCCESS != wiced_am_stream_set_param(stream_id, AM_SPEAKER_VOL_LEVEL, (void *) &audio_config.volume))
-                WICED_BT_TRACE("wiced_am_set_param failed\n");
-
-            if (WICED_SUCCESS != wiced_am_stream_set_param(stream_id, AM_MIC_GAIN_LEVEL, (void *) &audio_config.mic_gain))
+            if (WICED_SUCCESS != handsfree_audio_set_gains(stream_id, audio_config.volume, audio_config.mic_gain))
                 WICED_BT_TRACE("wiced_am_set_param failed\n");
 #endif
 
             hci_control_send_hf_event( HCI_CONTROL_HF_EVENT_AUDIO_OPEN, p_scb->rfcomm_handle, NULL );
             WICED_BT_TRACE("%s: SCO Audio connected, sco_index = %d [in context sco index=%d]\n", __func__, p_event_data->sco_connected.sco_index, handsfree_ctxt_data.sco_index);
             handsfree_ctxt_data.is_sco_connected = WICED_TRUE;
+            HANDSFREE_COUNT( SCO_CONNECT );
+            handsfree_call_stats_sco_up( );
 
             break;
 
         case BTM_SCO_DISCONNECTED_EVT:          /**< SCO disconnected event. Event data: #wiced_bt_sco_disconnected_t */
             hci_control_send_hf_event( HCI_CONTROL_HF_EVENT_AUDIO_CLOSE, p_scb->rfcomm_handle, NULL );
             WICED_BT_TRACE("%s: SCO disconnection change event handler\n", __func__);
+            if ( p_event_data->sco_disconnected.reason == HCI_ERR_CONNECTION_TOUT )
+                HANDSFREE_COUNT( LINK_LOSS );
+            handsfree_link_monitor_sco_lost( p_event_data->sco_disconnected.reason );
+            handsfree_call_stats_sco_down( p_scb->rfcomm_handle, p_event_data->sco_disconnected.reason );
+#ifdef HANDSFREE_LATENCY_PROBE
+            handsfree_latency_probe_sco_down( );
+#endif
 
             status = wiced_bt_sco_create_as_acceptor(&handsfree_ctxt_data.sco_index);
             WICED_BT_TRACE("%s: status [%d] SCO INDEX [%d] \n", __func__, status, handsfree_ctxt_data.sco_index);
             handsfree_ctxt_data.is_sco_connected = WICED_FALSE;
+            handsfree_vr_end( );
+#if defined(CYW20721B2) || defined(CYW43012C0) || defined(CYW55572A1)
+            handsfree_call_audio_check_idle( );
+#endif
             break;
 
         case BTM_SCO_CONNECTION_REQUEST_EVT:    /**< SCO connection request event. Event data: #wiced_bt_sco_connection_request_t */
             WICED_BT_TRACE("%s: SCO connection request event handler \n", __func__);
+            handsfree_call_stats_setup_start( );
 
             if( wiced_is_timer_in_use(&handsfree_app_states.hfp_timer) )
             {
@@ -833,7 +1138,7 @@ void hf_sco_management_callback( wiced_bt_management_evt_t event, wiced_bt_manag
 
             if(handsfree_app_states.connect.profile_selected == WICED_BT_HFP_PROFILE)
             {
-                wiced_bt_sco_accept_connection(p_event_data->sco_connection_request.sco_index, HCI_SUCCESS, (wiced_bt_sco_params_t *) &handsfree_esco_params);
+                wiced_bt_sco_accept_connection(p_event_data->sco_connection_request.sco_index, HCI_SUCCESS, handsfree_sco_params());
             }
 #ifdef WICED_ENABLE_BT_HSP_PROFILE
             else
@@ -853,10 +1158,11 @@ void hf_sco_management_callback( wiced_bt_management_evt_t event, wiced_bt_manag
 static void hfp_timer_expiry_handler( TIMER_PARAM_TYPE param )
 {
     /* if sco is not created as an acceptor then remove the sco and create it as initiator. */
-    if( handsfree_ctxt_data.call_active && !handsfree_ctxt_data.is_sco_connected )
+    if( ( handsfree_ctxt_data.call_active || handsfree_ctxt_data.vr_active ) && !handsfree_ctxt_data.is_sco_connected )
     {
+        HANDSFREE_COUNT( SCO_FALLBACK );
         wiced_bt_sco_remove( handsfree_ctxt_data.sco_index );
-        wiced_bt_sco_create_as_initiator( handsfree_ctxt_data.peer_bd_addr, &handsfree_ctxt_data.sco_index, (wiced_bt_sco_params_t *) &handsfree_esco_params );
+        wiced_bt_sco_create_as_initiator( handsfree_ctxt_data.peer_bd_addr, &handsfree_ctxt_data.sco_index, handsfree_sco_params() );
     }
 }
 
@@ -918,6 +1224,8 @@ wiced_result_t handsfree_management_callback(wiced_bt_management_evt_t event, wi
             p_key_info_pool = wiced_bt_create_pool( KEY_INFO_POOL_BUFFER_SIZE, KEY_INFO_POOL_BUFFER_COUNT );
 #endif
             WICED_BT_TRACE( "wiced_bt_create_pool %x\n", p_key_info_pool );
+            hci_control_nvram_init( );
+            hci_control_frag_init( );
 
             wiced_bt_dev_register_hci_trace( hci_control_hci_trace_cback );
 
@@ -975,6 +1283,7 @@ wiced_result_t handsfree_management_callback(wiced_bt_management_evt_t event, wi
                     WICED_BT_TRACE("wiced_am_stream_close failed stream_id : %d \n", stream_id);
 
                 stream_id = WICED_AUDIO_MANAGER_STREAM_ID_INVALID;
+                handsfree_audio_stream_reset( );
             }
 #endif
             hf_sco_management_callback(event, p_event_data);
@@ -1101,8 +1410,10 @@ static void hci_control_transport_status( wiced_transport_type_t type )
  */
 APPLICATION_START()
 {
+    handsfree_instance_init( );
+
 #if defined WICED_BT_TRACE_ENABLE || defined HCI_TRACE_OVER_TRANSPORT
-    wiced_transport_init( &transport_cfg );
+    p_handsfree_transport->init( &transport_cfg );
 
     // Set the debug uart as WICED_ROUTE_DEBUG_NONE to get rid of prints
     // wiced_set_debug_uart(WICED_ROUTE_DEBUG_NONE);
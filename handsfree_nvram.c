@@ -37,21 +37,148 @@
 #include "wiced_bt_trace.h"
 #include "handsfree.h"
 #include "string.h"
+#include "stddef.h"
 #include "wiced_transport.h"
 
 #define HCI_CONTROL_FIRST_VALID_NVRAM_ID        0x10
 #define HCI_CONTROL_INVALID_NVRAM_ID            0x00
 
-typedef struct
+/*
+ * nvram_id is placed right before data so that the two form the payload of
+ * HCI_CONTROL_EVENT_NVRAM_DATA (little endian id followed by data) and a chunk can be
+ * handed to the transport without being copied.
+ */
+typedef struct hci_control_nvram_chunk
 {
     void    *p_next;
+    uint16_t chunk_len;
     uint16_t nvram_id;
-    uint8_t  chunk_len;
     uint8_t  data[1];
 } hci_control_nvram_chunk_t;
 
-hci_control_nvram_chunk_t *p_nvram_first = NULL;
-wiced_bt_buffer_pool_t* p_key_info_pool;//Pool for storing the  key info
+/* Fails to compile if padding separates nvram_id from data */
+typedef char hci_control_nvram_chunk_layout_check[ ( offsetof( hci_control_nvram_chunk_t, data ) ==
+                                                     offsetof( hci_control_nvram_chunk_t, nvram_id ) + sizeof( uint16_t ) ) ? 1 : -1 ];
+
+/* The first AG cache layout ended with ag_features, later fields must lie behind it */
+typedef char handsfree_ag_cache_layout_check[ ( offsetof( handsfree_ag_cache_t, mic_volume ) ==
+                                                HANDSFREE_AG_CACHE_V1_SIZE ) ? 1 : -1 ];
+
+/* An AG cache record of every bond fits the smallest slab */
+typedef char handsfree_ag_cache_record_check[ ( sizeof( handsfree_ag_cache_record_t ) <= 32 ) ? 1 : -1 ];
+
+/*
+ * Typed records other than bonds are allocated from slabs of increasing size. A record
+ * takes a buffer from the smallest slab it fits in, or from a larger one when that slab
+ * is exhausted. Sizes and counts are the record payloads expected per bonded AG. Each
+ * instance creates its own pool per slab, kept in p_record_pools.
+ */
+typedef struct
+{
+    uint16_t                 record_size;       /* Largest payload held by a buffer */
+    uint8_t                  count;
+} hci_control_record_slab_t;
+
+static const hci_control_record_slab_t hci_control_record_slabs[] =
+{
+    { 32,                        HANDSFREE_CAP_BONDS + 4 },     /* AG caches of the bonds, counters, preferences */
+    { 128,                       6 },                           /* Per AG metadata */
+    { HANDSFREE_RECORD_MAX_LEN,  2 },                           /* Contact indices, configuration blobs */
+};
+
+#define HCI_CONTROL_RECORD_SLAB_COUNT   ( sizeof( hci_control_record_slabs ) / sizeof( hci_control_record_slabs[0] ) )
+
+/* The stack configuration reserves HANDSFREE_RECORD_SLAB_COUNT pools for the slabs */
+typedef char hci_control_record_slab_count_check[ ( HCI_CONTROL_RECORD_SLAB_COUNT == HANDSFREE_RECORD_SLAB_COUNT ) ? 1 : -1 ];
+
+/* Chunk list and record pools of the selected instance */
+#define p_nvram_first                   ( p_handsfree_instance->p_nvram_first )
+#define p_record_pools                  ( p_handsfree_instance->p_record_pools )
+
+
+/*
+ * Create the record slabs of the selected instance, called once the stack is up
+ */
+void hci_control_nvram_init( void )
+{
+    uint32_t    buf_size;
+    int         i;
+
+    for ( i = 0; i < HCI_CONTROL_RECORD_SLAB_COUNT; i++ )
+    {
+        buf_size = offsetof( hci_control_nvram_chunk_t, data ) + hci_control_record_slabs[i].record_size;
+#if BTSTACK_VER >= 0x03000001
+        p_record_pools[i] = wiced_bt_create_pool( "record", buf_size, hci_control_record_slabs[i].count, NULL );
+#else
+        p_record_pools[i] = wiced_bt_create_pool( buf_size, hci_control_record_slabs[i].count );
+#endif
+        WICED_BT_TRACE( "record slab %d x %d: %x\n", hci_control_record_slabs[i].record_size,
+                        hci_control_record_slabs[i].count, p_record_pools[i] );
+    }
+}
+
+/*
+ * Bond records come from the key info pool, which also limits the number of bonded
+ * devices. Other records come from the record slabs.
+ */
+static hci_control_nvram_chunk_t *hci_control_nvram_alloc( int nvram_id, int data_len )
+{
+    hci_control_nvram_chunk_t *p1 = NULL;
+    int                        i;
+
+    if ( HANDSFREE_RECORD_TYPE( nvram_id ) == HANDSFREE_RECORD_TYPE_BOND )
+        return ( hci_control_nvram_chunk_t * )wiced_bt_get_buffer_from_pool( p_key_info_pool );
+
+    for ( i = 0; i < HCI_CONTROL_RECORD_SLAB_COUNT; i++ )
+    {
+        if ( ( hci_control_record_slabs[i].record_size >= data_len ) && ( p_record_pools[i] != NULL ) &&
+             ( ( p1 = ( hci_control_nvram_chunk_t * )wiced_bt_get_buffer_from_pool( p_record_pools[i] ) ) != NULL ) )
+        {
+            break;
+        }
+    }
+    return p1;
+}
+
+/*
+ * The AG cache goes with its bond when the host deletes the bond. A bond record that is
+ * only being rewritten keeps it.
+ */
+static void hci_control_delete_ag_cache( int nvram_id, wiced_bool_t from_host )
+{
+    if ( from_host && ( HANDSFREE_RECORD_TYPE( nvram_id ) == HANDSFREE_RECORD_TYPE_BOND ) )
+        hci_control_record_delete( HANDSFREE_RECORD_TYPE_AG_CACHE, nvram_id );
+}
+
+/*
+ * Bond records of earlier firmware carry the AG cache behind the link keys. Keep the keys
+ * alone and hand them back to the host, which replaces its long record, and move the
+ * cache to its own record unless one is stored already, which is the newer of the two.
+ */
+static int hci_control_migrate_bond( int nvram_id, int data_len, uint8_t *p_data )
+{
+    handsfree_ag_cache_record_t record;
+    int                         cache_len = data_len - sizeof( wiced_bt_device_link_keys_t );
+
+    if ( hci_control_write_nvram( nvram_id, sizeof( wiced_bt_device_link_keys_t ), p_data, WICED_FALSE ) !=
+         sizeof( wiced_bt_device_link_keys_t ) )
+    {
+        return ( 0 );
+    }
+
+    if ( ( cache_len >= HANDSFREE_AG_CACHE_V1_SIZE ) &&
+         ( hci_control_record_read( HANDSFREE_RECORD_TYPE_AG_CACHE, nvram_id, &record, sizeof( record ) ) == 0 ) )
+    {
+        if ( cache_len > sizeof( handsfree_ag_cache_t ) )
+            cache_len = sizeof( handsfree_ag_cache_t );
+        memset( &record, 0, sizeof( record ) );
+        memcpy( record.bd_addr, p_data, BD_ADDR_LEN );
+        memcpy( &record.ag_cache, &p_data[sizeof( wiced_bt_device_link_keys_t )], cache_len );
+        hci_control_record_write( HANDSFREE_RECORD_TYPE_AG_CACHE, nvram_id, &record,
+                                  offsetof( handsfree_ag_cache_record_t, ag_cache ) + cache_len );
+    }
+    return ( data_len );
+}
 
 /*
  * Delete NVRAM function is called when host deletes NVRAM chunk from the persistent storage.
@@ -68,7 +195,8 @@ void hci_control_delete_nvram( int nvram_id ,wiced_bool_t from_host)
     {
         p1 = p_nvram_first;
 
-        if ( from_host && ( wiced_bt_dev_delete_bonded_device (p1->data) == WICED_ERROR ) )
+        if ( from_host && ( HANDSFREE_RECORD_TYPE( nvram_id ) == HANDSFREE_RECORD_TYPE_BOND ) &&
+             ( wiced_bt_dev_delete_bonded_device (p1->data) == WICED_ERROR ) )
         {
             WICED_BT_TRACE("ERROR: while Unbonding device \n");
         }
@@ -76,6 +204,7 @@ void hci_control_delete_nvram( int nvram_id ,wiced_bool_t from_host)
         {
             p_nvram_first = (hci_control_nvram_chunk_t *)p_nvram_first->p_next;
             wiced_bt_free_buffer( p1 );
+            hci_control_delete_ag_cache( nvram_id, from_host );
         }
         return;
     }
@@ -86,7 +215,8 @@ void hci_control_delete_nvram( int nvram_id ,wiced_bool_t from_host)
         p2 = (hci_control_nvram_chunk_t *)p1->p_next;
         if ( ( p2 != NULL ) && ( p2->nvram_id == nvram_id ) )
         {
-            if ( from_host && ( wiced_bt_dev_delete_bonded_device (p2->data) == WICED_ERROR ) )
+            if ( from_host && ( HANDSFREE_RECORD_TYPE( nvram_id ) == HANDSFREE_RECORD_TYPE_BOND ) &&
+                 ( wiced_bt_dev_delete_bonded_device (p2->data) == WICED_ERROR ) )
             {
                 WICED_BT_TRACE("ERROR: while Unbonding device \n");
             }
@@ -94,6 +224,7 @@ void hci_control_delete_nvram( int nvram_id ,wiced_bool_t from_host)
             {
                 p1->p_next = p2->p_next;
                 wiced_bt_free_buffer( p2 );
+                hci_control_delete_ag_cache( nvram_id, from_host );
             }
             return;
         }
@@ -109,23 +240,35 @@ void hci_control_delete_nvram( int nvram_id ,wiced_bool_t from_host)
  */
 int hci_control_write_nvram( int nvram_id, int data_len, void *p_data, wiced_bool_t from_host )
 {
-    uint8_t                    tx_buf[257];
-    uint8_t                   *p = tx_buf;
     hci_control_nvram_chunk_t *p1;
     wiced_result_t            result;
 
+    if ( ( data_len <= 0 ) || ( data_len > HANDSFREE_RECORD_MAX_LEN ) )
+    {
+        WICED_BT_TRACE( "Bad record length:%d\n", data_len );
+        return ( 0 );
+    }
+
+    if ( ( HANDSFREE_RECORD_TYPE( nvram_id ) == HANDSFREE_RECORD_TYPE_BOND ) &&
+         ( data_len > sizeof( wiced_bt_device_link_keys_t ) ) )
+    {
+        return hci_control_migrate_bond( nvram_id, data_len, p_data );
+    }
+
     /* first check if this ID is being reused and release the memory chunk */
     hci_control_delete_nvram( nvram_id ,WICED_FALSE);
 
-    if ( ( p1 = ( hci_control_nvram_chunk_t * )wiced_bt_get_buffer_from_pool( p_key_info_pool ) ) == NULL )
+    HANDSFREE_COUNT( NVRAM_WRITE );
+    if ( ( p1 = hci_control_nvram_alloc( nvram_id, data_len ) ) == NULL )
     {
+        HANDSFREE_COUNT( POOL_ALLOC_FAILED );
         WICED_BT_TRACE( "Failed to alloc:%d\n", data_len );
         return ( 0 );
     }
-    if ( wiced_bt_get_buffer_size( p1 ) < ( sizeof( hci_control_nvram_chunk_t ) + data_len - 1 ) )
+    if ( wiced_bt_get_buffer_size( p1 ) < ( offsetof( hci_control_nvram_chunk_t, data ) + data_len ) )
     {
         WICED_BT_TRACE( "Insufficient buffer size, Buff Size %d, Len %d  \n",
-                        wiced_bt_get_buffer_size( p1 ), ( sizeof( hci_control_nvram_chunk_t ) + data_len - 1 ) );
+                        wiced_bt_get_buffer_size( p1 ), ( offsetof( hci_control_nvram_chunk_t, data ) + data_len ) );
         wiced_bt_free_buffer( p1 );
         return ( 0 );
     }
@@ -136,6 +279,7 @@ int hci_control_write_nvram( int nvram_id, int data_len, void *p_data, wiced_boo
 
     p_nvram_first = p1;
 
+    if ( HANDSFREE_RECORD_TYPE( nvram_id ) == HANDSFREE_RECORD_TYPE_BOND )
     {
         wiced_bt_device_link_keys_t * p_keys = ( wiced_bt_device_link_keys_t *) p_data;
 #ifdef CYW20706A2
@@ -144,33 +288,76 @@ int hci_control_write_nvram( int nvram_id, int data_len, void *p_data, wiced_boo
 #else
         result = wiced_bt_dev_add_device_to_address_resolution_db( p_keys );
 #endif
+        WICED_BT_TRACE("Updated Addr Resolution DB:%d\n", result );
     }
 
-    WICED_BT_TRACE("Updated Addr Resolution DB:%d\n", result );
-
     /* If NVRAM chunk arrived from host, no need to send it back, otherwise send over transport */
     if (!from_host)
     {
-        *p++ = nvram_id & 0xff;
-        *p++ = (nvram_id >> 8) & 0xff;
-        memcpy(p, p_data, data_len);
-
-        wiced_transport_send_data( HCI_CONTROL_EVENT_NVRAM_DATA, tx_buf, ( int )( data_len + 2 ) );
+        hci_control_send_data( HCI_CONTROL_EVENT_NVRAM_DATA, ( uint8_t * )&p1->nvram_id, ( int )( data_len + sizeof( p1->nvram_id ) ) );
     }
     UNUSED_VARIABLE(result);
     return (data_len);
 }
 
+/*
+ * Store the records of an HCI_CONTROL_MISC_COMMAND_NVRAM_RESTORE, nvram_id(2) length(2)
+ * data each, as if each was pushed with HCI_CONTROL_COMMAND_PUSH_NVRAM_DATA. Restoring
+ * a device takes more than a transport buffer, the host sends the command in fragments.
+ * Stops at the first record that is not stored.
+ */
+void hci_control_nvram_restore( uint8_t *p_data, uint32_t data_len )
+{
+    uint8_t   tx_buf[2];
+    uint8_t   restored = 0;
+    uint8_t   status   = HCI_CONTROL_RESTORE_STATUS_SUCCESS;
+    uint16_t  nvram_id, len;
+
+    while ( data_len > 0 )
+    {
+        if ( data_len < 4 )
+        {
+            status = HCI_CONTROL_RESTORE_STATUS_MALFORMED;
+            break;
+        }
+        nvram_id = p_data[0] | ( p_data[1] << 8 );
+        len      = p_data[2] | ( p_data[3] << 8 );
+        if ( len > data_len - 4 )
+        {
+            status = HCI_CONTROL_RESTORE_STATUS_MALFORMED;
+            break;
+        }
+        if ( hci_control_write_nvram( nvram_id, len, &p_data[4], WICED_TRUE ) != len )
+        {
+            status = HCI_CONTROL_RESTORE_STATUS_NOT_STORED;
+            break;
+        }
+        restored++;
+        p_data   += 4 + len;
+        data_len -= 4 + len;
+    }
+    WICED_BT_TRACE( "NVRAM restore: %d records, status %d\n", restored, status );
+
+    tx_buf[0] = restored;
+    tx_buf[1] = status;
+    hci_control_send_data( HCI_CONTROL_MISC_EVENT_NVRAM_RESTORE, tx_buf, sizeof( tx_buf ) );
+}
+
 /*
  * Find nvram_id of the NVRAM chunk with first bytes matching specified byte array
  */
-int hci_control_find_nvram_id(uint8_t *p_data, int len)
+HANDSFREE_HOT int hci_control_find_nvram_id(uint8_t *p_data, int len)
 {
     hci_control_nvram_chunk_t *p1;
 
+    HANDSFREE_COUNT( NVRAM_LOOKUP );
+
     /* Go through the linked list of chunks */
     for (p1 = p_nvram_first; p1 != NULL; p1 = (hci_control_nvram_chunk_t *)p1->p_next)
     {
+        if ( HANDSFREE_RECORD_TYPE( p1->nvram_id ) != HANDSFREE_RECORD_TYPE_BOND )
+            continue;
+
         WICED_BT_TRACE( "find %B %B len:%d", p1->data, p_data, len );
         if ( memcmp( p1->data, p_data, len ) == 0 )
         {
@@ -185,11 +372,13 @@ int hci_control_find_nvram_id(uint8_t *p_data, int len)
 /*
  * Read NVRAM actually finds the memory chunk in the RAM
  */
-int hci_control_read_nvram( int nvram_id, void *p_data, int data_len )
+HANDSFREE_HOT int hci_control_read_nvram( int nvram_id, void *p_data, int data_len )
 {
     hci_control_nvram_chunk_t *p1;
     int                        data_read = 0;
 
+    HANDSFREE_COUNT( NVRAM_LOOKUP );
+
     /* Go through the linked list of chunks */
     for ( p1 = p_nvram_first; p1 != NULL; p1 = p1->p_next )
     {
@@ -220,6 +409,9 @@ int hci_control_alloc_nvram_id( )
 
         for ( p1 = p_nvram_first; p1 != NULL; p1 = (hci_control_nvram_chunk_t *)p1->p_next )
         {
+            if ( HANDSFREE_RECORD_TYPE( p1->nvram_id ) != HANDSFREE_RECORD_TYPE_BOND )
+                continue;
+
             /* If the key buffer pool is becoming full, we need to notify the mcu and disable Pairing.
              * The mcu will need to delete some nvram entries and enable pairing in order to
              * pair with more devices */
@@ -228,7 +420,7 @@ int hci_control_alloc_nvram_id( )
             if ( ( allocated_key_pool_count == KEY_INFO_POOL_BUFFER_COUNT ) && ( handsfree_app_states.pairing_allowed ) )
             {
                 // Send Max Number of Paired Devices Reached event message
-                wiced_transport_send_data( HCI_CONTROL_EVENT_MAX_NUM_OF_PAIRED_DEVICES_REACHED, NULL, 0 );
+                hci_control_send_data( HCI_CONTROL_EVENT_MAX_NUM_OF_PAIRED_DEVICES_REACHED, NULL, 0 );
 
                 handsfree_app_states.pairing_allowed = WICED_FALSE;
                 wiced_bt_set_pairable_mode( handsfree_app_states.pairing_allowed, 0 );
@@ -248,3 +440,77 @@ int hci_control_alloc_nvram_id( )
     WICED_BT_TRACE ( "hci_control_alloc_nvram_id:%d\n", nvram_id );
     return ( nvram_id );
 }
+
+/*
+ * Read the AG capability cache of a bonded device from its AG cache record
+ */
+wiced_bool_t hci_control_read_ag_cache( wiced_bt_device_address_t bd_addr, handsfree_ag_cache_t *p_cache )
+{
+    handsfree_ag_cache_record_t record;
+    int                         nvram_id, record_len;
+
+    if ( ( nvram_id = hci_control_find_nvram_id( bd_addr, BD_ADDR_LEN ) ) == HCI_CONTROL_INVALID_NVRAM_ID )
+        return WICED_FALSE;
+
+    /* Caches of an earlier layout are shorter, the appended fields read back zero */
+    memset( &record, 0, sizeof( record ) );
+    record_len = hci_control_record_read( HANDSFREE_RECORD_TYPE_AG_CACHE, nvram_id, &record, sizeof( record ) );
+    if ( ( record_len < offsetof( handsfree_ag_cache_record_t, ag_cache ) + HANDSFREE_AG_CACHE_V1_SIZE ) ||
+         ( memcmp( record.bd_addr, bd_addr, BD_ADDR_LEN ) != 0 ) )
+        return WICED_FALSE;
+
+    memcpy( p_cache, &record.ag_cache, sizeof( handsfree_ag_cache_t ) );
+    return ( p_cache->valid == HANDSFREE_AG_CACHE_VALID );
+}
+
+/*
+ * Update the AG capability cache of a bonded device. The record is rewritten and
+ * forwarded to the host only if the cache contents actually changed.
+ */
+wiced_bool_t hci_control_write_ag_cache( wiced_bt_device_address_t bd_addr, const handsfree_ag_cache_t *p_cache )
+{
+    handsfree_ag_cache_record_t record;
+    int                         nvram_id;
+
+    /* Not bonded, nothing to attach the cache to */
+    if ( ( nvram_id = hci_control_find_nvram_id( bd_addr, BD_ADDR_LEN ) ) == HCI_CONTROL_INVALID_NVRAM_ID )
+        return WICED_FALSE;
+
+    if ( ( hci_control_record_read( HANDSFREE_RECORD_TYPE_AG_CACHE, nvram_id, &record, sizeof( record ) ) == sizeof( record ) ) &&
+         ( memcmp( record.bd_addr, bd_addr, BD_ADDR_LEN ) == 0 ) &&
+         ( memcmp( &record.ag_cache, p_cache, sizeof( handsfree_ag_cache_t ) ) == 0 ) )
+    {
+        return WICED_TRUE;
+    }
+
+    memset( &record, 0, sizeof( record ) );
+    memcpy( record.bd_addr, bd_addr, BD_ADDR_LEN );
+    memcpy( &record.ag_cache, p_cache, sizeof( handsfree_ag_cache_t ) );
+
+    WICED_BT_TRACE( "AG cache update %B features:0x%x codec:%d\n", bd_addr, p_cache->ag_features, p_cache->last_codec );
+
+    return ( hci_control_record_write( HANDSFREE_RECORD_TYPE_AG_CACHE, nvram_id, &record, sizeof( record ) ) == sizeof( record ) );
+}
+
+/*
+ * Store a typed record. The record is kept in RAM and forwarded to the host like a bond
+ * record, the host pushes it back at startup with HCI_CONTROL_COMMAND_PUSH_NVRAM_DATA.
+ */
+int hci_control_record_write( uint8_t type, uint8_t index, const void *p_data, uint16_t data_len )
+{
+    if ( type == HANDSFREE_RECORD_TYPE_BOND )
+        return ( 0 );
+
+    return hci_control_write_nvram( HANDSFREE_RECORD_ID( type, index ), data_len, ( void * )p_data, WICED_FALSE );
+}
+
+int hci_control_record_read( uint8_t type, uint8_t index, void *p_data, uint16_t data_len )
+{
+    return hci_control_read_nvram( HANDSFREE_RECORD_ID( type, index ), p_data, data_len );
+}
+
+void hci_control_record_delete( uint8_t type, uint8_t index )
+{
+    if ( type != HANDSFREE_RECORD_TYPE_BOND )
+        hci_control_delete_nvram( HANDSFREE_RECORD_ID( type, index ), WICED_FALSE );
+}
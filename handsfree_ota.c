@@ -0,0 +1,472 @@
+/*
+ * Copyright 2016-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+/** @file
+ *
+ * Firmware update over the host transport.
+ *
+ * The host streams the new image into the upgrade area of the serial flash with
+ *
+ *     HCI_CONTROL_MISC_COMMAND_OTA_START   format(1) image_len(4) image_crc32(4)
+ *     HCI_CONTROL_MISC_COMMAND_OTA_DATA    offset(4) data
+ *     HCI_CONTROL_MISC_COMMAND_OTA_FINISH
+ *     HCI_CONTROL_MISC_COMMAND_OTA_ABORT
+ *
+ * offset counts bytes of the transferred stream, which is the image itself
+ * (HCI_CONTROL_OTA_FORMAT_RAW) or the image compressed with host/ota_pack.py
+ * (HCI_CONTROL_OTA_FORMAT_LZ). DATA packets fit in one transport buffer, the host
+ * sends the largest that do and does not fragment them.
+ *
+ * The device answers with HCI_CONTROL_MISC_EVENT_OTA_STATUS next_offset(4) status(1)
+ * after START, every HANDSFREE_OTA_ACK_INTERVAL DATA packets, on FINISH and on error.
+ * The host keeps up to HANDSFREE_OTA_WINDOW packets in flight and rewinds to
+ * next_offset when HCI_CONTROL_OTA_STATUS_OUT_OF_ORDER comes back. A START for the
+ * image already in progress does not restart it, the status tells the host where to
+ * continue, so a transfer survives a host side reconnect.
+ *
+ * The compressed stream is decoded as it arrives. Decoded bytes go through a ring
+ * which doubles as the match window and the flash write buffer. Every page is read
+ * back and compared right after it is written, and the CRC32 of the image is
+ * accumulated on the way, so FINISH only has to flush the last page.
+ *
+ * There is no delta format. A patch has to be applied against the running image, and
+ * the firmware upgrade library only gives access to the upgrade area; the running
+ * image is in whichever data section the last update switched to. Compression is what
+ * shortens the transfer until the library can read the active section.
+ */
+
+#if defined(OTA_FW_UPGRADE) && !defined(BTSTACK_VER)
+
+#include "wiced_bt_trace.h"
+#include "wiced_firmware_upgrade.h"
+#include "wiced_timer.h"
+#include "handsfree.h"
+#include "string.h"
+#ifdef CYW43012C0
+#include "wiced_hal_watchdog.h"
+#else
+#include "wiced_hal_wdog.h"
+#endif
+
+#define HANDSFREE_OTA_ACK_INTERVAL      8       // DATA packets per status event
+#define HANDSFREE_OTA_WINDOW            ( 2 * HANDSFREE_OTA_ACK_INTERVAL )
+#define HANDSFREE_OTA_PAGE_SIZE         256     // Flash write and verify unit
+#define HANDSFREE_OTA_VERIFY_CHUNK      32
+#define HANDSFREE_OTA_RESET_DELAY       100     // ms for the status event to reach the host
+
+/* LZ decoder states, see host/ota_pack.py for the stream format */
+enum
+{
+    HANDSFREE_OTA_LZ_TOKEN,
+    HANDSFREE_OTA_LZ_LITERAL_LEN,
+    HANDSFREE_OTA_LZ_LITERALS,
+    HANDSFREE_OTA_LZ_OFFSET_LO,
+    HANDSFREE_OTA_LZ_OFFSET_HI,
+    HANDSFREE_OTA_LZ_MATCH_LEN,
+};
+
+/* Per device, see handsfree_instance_t */
+#define handsfree_ota_cb                    ( p_handsfree_instance->handsfree_ota_cb )
+#define handsfree_ota_ring                  ( p_handsfree_instance->handsfree_ota_ring )
+#define handsfree_ota_reset_timer           ( p_handsfree_instance->handsfree_ota_reset_timer )
+#define handsfree_ota_timer_initialized     ( p_handsfree_instance->handsfree_ota_timer_initialized )
+
+static const uint32_t crc32_nibble_table[16] =
+{
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C
+};
+
+/*
+ * CRC-32 (IEEE 802.3, same as zlib), pass 0 to start. Processed a nibble at a time to keep
+ * the table small.
+ */
+static uint32_t handsfree_ota_crc32( uint32_t crc, const uint8_t *p_data, uint32_t length )
+{
+    crc = ~crc;
+    while ( length-- )
+    {
+        crc ^= *p_data++;
+        crc = ( crc >> 4 ) ^ crc32_nibble_table[crc & 0x0F];
+        crc = ( crc >> 4 ) ^ crc32_nibble_table[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+static void handsfree_ota_send_status( uint8_t status )
+{
+    uint8_t  tx_buf[5];
+
+    tx_buf[0] = handsfree_ota_cb.next_offset & 0xff;
+    tx_buf[1] = ( handsfree_ota_cb.next_offset >> 8 ) & 0xff;
+    tx_buf[2] = ( handsfree_ota_cb.next_offset >> 16 ) & 0xff;
+    tx_buf[3] = ( handsfree_ota_cb.next_offset >> 24 ) & 0xff;
+    tx_buf[4] = status;
+    hci_control_send_data( HCI_CONTROL_MISC_EVENT_OTA_STATUS, tx_buf, sizeof( tx_buf ) );
+
+    handsfree_ota_cb.unacked = 0;
+}
+
+/*
+ * Write the decoded bytes not yet in flash, read them back and fold them into the CRC
+ */
+static wiced_bool_t handsfree_ota_flush( void )
+{
+    uint8_t   verify_buf[HANDSFREE_OTA_VERIFY_CHUNK];
+    uint8_t  *p_page = &handsfree_ota_ring[handsfree_ota_cb.flushed & ( HANDSFREE_OTA_RING_SIZE - 1 )];
+    uint32_t  len = handsfree_ota_cb.out_len - handsfree_ota_cb.flushed;
+    uint32_t  done, chunk;
+
+    if ( len == 0 )
+        return WICED_TRUE;
+
+    if ( wiced_firmware_upgrade_store_to_nv( handsfree_ota_cb.flushed, p_page, len ) != len )
+    {
+        WICED_BT_TRACE( "ota: write failed at %d\n", handsfree_ota_cb.flushed );
+        return WICED_FALSE;
+    }
+
+    for ( done = 0; done < len; done += chunk )
+    {
+        chunk = ( len - done < sizeof( verify_buf ) ) ? len - done : sizeof( verify_buf );
+        if ( ( wiced_firmware_upgrade_retrieve_from_nv( handsfree_ota_cb.flushed + done, verify_buf, chunk ) != chunk ) ||
+             ( memcmp( verify_buf, &p_page[done], chunk ) != 0 ) )
+        {
+            WICED_BT_TRACE( "ota: verify failed at %d\n", handsfree_ota_cb.flushed + done );
+            return WICED_FALSE;
+        }
+    }
+
+    handsfree_ota_cb.crc = handsfree_ota_crc32( handsfree_ota_cb.crc, p_page, len );
+    handsfree_ota_cb.flushed += len;
+    return WICED_TRUE;
+}
+
+/*
+ * Append decoded bytes to the ring, writing every page as it fills
+ */
+static wiced_bool_t handsfree_ota_emit( const uint8_t *p_data, uint32_t len )
+{
+    uint32_t  pos, room;
+
+    if ( len > handsfree_ota_cb.image_len - handsfree_ota_cb.out_len )
+    {
+        WICED_BT_TRACE( "ota: image longer than %d\n", handsfree_ota_cb.image_len );
+        return WICED_FALSE;
+    }
+
+    while ( len )
+    {
+        pos  = handsfree_ota_cb.out_len & ( HANDSFREE_OTA_RING_SIZE - 1 );
+        room = HANDSFREE_OTA_PAGE_SIZE - ( pos & ( HANDSFREE_OTA_PAGE_SIZE - 1 ) );
+        if ( room > len )
+            room = len;
+
+        memcpy( &handsfree_ota_ring[pos], p_data, room );
+        handsfree_ota_cb.out_len += room;
+        p_data += room;
+        len    -= room;
+
+        if ( ( ( handsfree_ota_cb.out_len & ( HANDSFREE_OTA_PAGE_SIZE - 1 ) ) == 0 ) && !handsfree_ota_flush( ) )
+            return WICED_FALSE;
+    }
+    return WICED_TRUE;
+}
+
+/*
+ * Copy a back reference out of the ring. Source and destination may overlap, so the
+ * copy goes a byte at a time.
+ */
+static wiced_bool_t handsfree_ota_copy_match( void )
+{
+    uint8_t  byte;
+
+    if ( ( handsfree_ota_cb.lz_match_offset == 0 ) || ( handsfree_ota_cb.lz_match_offset > handsfree_ota_cb.out_len ) ||
+         ( handsfree_ota_cb.lz_match_offset > HANDSFREE_OTA_RING_SIZE ) )
+    {
+        WICED_BT_TRACE( "ota: bad match offset %d\n", handsfree_ota_cb.lz_match_offset );
+        return WICED_FALSE;
+    }
+
+    while ( handsfree_ota_cb.lz_match_len-- )
+    {
+        byte = handsfree_ota_ring[( handsfree_ota_cb.out_len - handsfree_ota_cb.lz_match_offset ) & ( HANDSFREE_OTA_RING_SIZE - 1 )];
+        if ( !handsfree_ota_emit( &byte, 1 ) )
+            return WICED_FALSE;
+    }
+    return WICED_TRUE;
+}
+
+/*
+ * Feed part of an LZ stream to the decoder, packet boundaries can fall anywhere
+ */
+static wiced_bool_t handsfree_ota_lz_decode( const uint8_t *p_data, uint32_t len )
+{
+    uint32_t  run;
+    uint8_t   byte;
+
+    while ( len )
+    {
+        if ( handsfree_ota_cb.lz_state == HANDSFREE_OTA_LZ_LITERALS )
+        {
+            run = ( handsfree_ota_cb.lz_literal_len < len ) ? handsfree_ota_cb.lz_literal_len : len;
+            if ( !handsfree_ota_emit( p_data, run ) )
+                return WICED_FALSE;
+            p_data += run;
+            len    -= run;
+            handsfree_ota_cb.lz_literal_len -= run;
+            if ( handsfree_ota_cb.lz_literal_len == 0 )
+                handsfree_ota_cb.lz_state = HANDSFREE_OTA_LZ_OFFSET_LO;
+            continue;
+        }
+
+        byte = *p_data++;
+        len--;
+
+        switch ( handsfree_ota_cb.lz_state )
+        {
+        case HANDSFREE_OTA_LZ_TOKEN:
+            handsfree_ota_cb.lz_literal_len = byte >> 4;
+            handsfree_ota_cb.lz_match_len   = ( byte & 0x0F ) + 4;
+            if ( handsfree_ota_cb.lz_literal_len == 15 )
+                handsfree_ota_cb.lz_state = HANDSFREE_OTA_LZ_LITERAL_LEN;
+            else if ( handsfree_ota_cb.lz_literal_len )
+                handsfree_ota_cb.lz_state = HANDSFREE_OTA_LZ_LITERALS;
+            else
+                handsfree_ota_cb.lz_state = HANDSFREE_OTA_LZ_OFFSET_LO;
+            break;
+
+        case HANDSFREE_OTA_LZ_LITERAL_LEN:
+            handsfree_ota_cb.lz_literal_len += byte;
+            if ( byte != 255 )
+                handsfree_ota_cb.lz_state = HANDSFREE_OTA_LZ_LITERALS;
+            break;
+
+        case HANDSFREE_OTA_LZ_OFFSET_LO:
+            handsfree_ota_cb.lz_match_offset = byte;
+            handsfree_ota_cb.lz_state = HANDSFREE_OTA_LZ_OFFSET_HI;
+            break;
+
+        case HANDSFREE_OTA_LZ_OFFSET_HI:
+            handsfree_ota_cb.lz_match_offset |= byte << 8;
+            if ( handsfree_ota_cb.lz_match_len == 15 + 4 )
+            {
+                handsfree_ota_cb.lz_state = HANDSFREE_OTA_LZ_MATCH_LEN;
+                break;
+            }
+            if ( !handsfree_ota_copy_match( ) )
+                return WICED_FALSE;
+            handsfree_ota_cb.lz_state = HANDSFREE_OTA_LZ_TOKEN;
+            break;
+
+        case HANDSFREE_OTA_LZ_MATCH_LEN:
+            handsfree_ota_cb.lz_match_len += byte;
+            if ( byte == 255 )
+                break;
+            if ( !handsfree_ota_copy_match( ) )
+                return WICED_FALSE;
+            handsfree_ota_cb.lz_state = HANDSFREE_OTA_LZ_TOKEN;
+            break;
+        }
+    }
+    return WICED_TRUE;
+}
+
+static void handsfree_ota_reset_timeout( TIMER_PARAM_TYPE param )
+{
+    wiced_hal_wdog_reset_system( );
+}
+
+static void handsfree_ota_abort( uint8_t status )
+{
+    handsfree_ota_send_status( status );
+    memset( &handsfree_ota_cb, 0, sizeof( handsfree_ota_cb ) );
+}
+
+static void handsfree_ota_handle_start( uint8_t *p_data, uint32_t data_len )
+{
+    uint8_t   format;
+    uint32_t  image_len, image_crc;
+
+    if ( data_len < 9 )
+    {
+        hci_control_send_command_status_evt( HCI_CONTROL_EVENT_COMMAND_STATUS, HCI_CONTROL_STATUS_INVALID_ARGS );
+        return;
+    }
+    STREAM_TO_UINT8( format, p_data );
+    STREAM_TO_UINT32( image_len, p_data );
+    STREAM_TO_UINT32( image_crc, p_data );
+
+    if ( handsfree_ota_cb.active && ( handsfree_ota_cb.format == format ) &&
+         ( handsfree_ota_cb.image_len == image_len ) && ( handsfree_ota_cb.image_crc == image_crc ) )
+    {
+        WICED_BT_TRACE( "ota: resume at %d\n", handsfree_ota_cb.next_offset );
+        handsfree_ota_cb.nak_sent = WICED_FALSE;
+        handsfree_ota_send_status( HCI_CONTROL_OTA_STATUS_SUCCESS );
+        return;
+    }
+
+    memset( &handsfree_ota_cb, 0, sizeof( handsfree_ota_cb ) );
+
+    if ( ( format > HCI_CONTROL_OTA_FORMAT_LZ ) || ( image_len == 0 ) )
+    {
+        handsfree_ota_send_status( HCI_CONTROL_OTA_STATUS_BAD_ARGS );
+        return;
+    }
+    if ( !wiced_firmware_upgrade_init_nv_locations( ) )
+    {
+        WICED_BT_TRACE( "ota: no upgrade area\n" );
+        handsfree_ota_send_status( HCI_CONTROL_OTA_STATUS_WRITE_FAILED );
+        return;
+    }
+    if ( !handsfree_ota_timer_initialized )
+    {
+        wiced_init_timer( &handsfree_ota_reset_timer, handsfree_ota_reset_timeout, 0, WICED_MILLI_SECONDS_TIMER );
+        handsfree_ota_timer_initialized = WICED_TRUE;
+    }
+
+    handsfree_ota_cb.active    = WICED_TRUE;
+    handsfree_ota_cb.format    = format;
+    handsfree_ota_cb.image_len = image_len;
+    handsfree_ota_cb.image_crc = image_crc;
+    handsfree_ota_cb.lz_state  = HANDSFREE_OTA_LZ_TOKEN;
+
+    WICED_BT_TRACE( "ota: start format:%d len:%d crc:%08x\n", format, image_len, image_crc );
+    handsfree_ota_send_status( HCI_CONTROL_OTA_STATUS_SUCCESS );
+}
+
+static void handsfree_ota_handle_data( uint8_t *p_data, uint32_t data_len )
+{
+    uint32_t      offset;
+    wiced_bool_t  ok;
+
+    if ( !handsfree_ota_cb.active )
+    {
+        handsfree_ota_send_status( HCI_CONTROL_OTA_STATUS_NOT_STARTED );
+        return;
+    }
+    if ( data_len < 4 )
+        return;
+
+    STREAM_TO_UINT32( offset, p_data );
+    data_len -= 4;
+
+    /* Packets must be contiguous, the host rewinds to next_offset on a nak */
+    if ( offset != handsfree_ota_cb.next_offset )
+    {
+        if ( !handsfree_ota_cb.nak_sent )
+        {
+            handsfree_ota_send_status( HCI_CONTROL_OTA_STATUS_OUT_OF_ORDER );
+            handsfree_ota_cb.nak_sent = WICED_TRUE;
+        }
+        return;
+    }
+    handsfree_ota_cb.nak_sent = WICED_FALSE;
+
+    if ( handsfree_ota_cb.format == HCI_CONTROL_OTA_FORMAT_LZ )
+        ok = handsfree_ota_lz_decode( p_data, data_len );
+    else
+        ok = handsfree_ota_emit( p_data, data_len );
+
+    if ( !ok )
+    {
+        handsfree_ota_abort( HCI_CONTROL_OTA_STATUS_BAD_IMAGE );
+        return;
+    }
+    handsfree_ota_cb.next_offset += data_len;
+
+    if ( ++handsfree_ota_cb.unacked >= HANDSFREE_OTA_ACK_INTERVAL )
+        handsfree_ota_send_status( HCI_CONTROL_OTA_STATUS_SUCCESS );
+}
+
+static void handsfree_ota_handle_finish( void )
+{
+    if ( !handsfree_ota_cb.active )
+    {
+        handsfree_ota_send_status( HCI_CONTROL_OTA_STATUS_NOT_STARTED );
+        return;
+    }
+
+    /* An LZ stream ends after the literals of its last sequence */
+    if ( ( handsfree_ota_cb.format == HCI_CONTROL_OTA_FORMAT_LZ ) &&
+         ( handsfree_ota_cb.lz_state != HANDSFREE_OTA_LZ_OFFSET_LO ) )
+    {
+        handsfree_ota_abort( HCI_CONTROL_OTA_STATUS_BAD_IMAGE );
+        return;
+    }
+    if ( !handsfree_ota_flush( ) )
+    {
+        handsfree_ota_abort( HCI_CONTROL_OTA_STATUS_WRITE_FAILED );
+        return;
+    }
+    if ( ( handsfree_ota_cb.flushed != handsfree_ota_cb.image_len ) || ( handsfree_ota_cb.crc != handsfree_ota_cb.image_crc ) )
+    {
+        WICED_BT_TRACE( "ota: image len:%d crc:%08x, expected len:%d crc:%08x\n", handsfree_ota_cb.flushed,
+                handsfree_ota_cb.crc, handsfree_ota_cb.image_len, handsfree_ota_cb.image_crc );
+        handsfree_ota_abort( HCI_CONTROL_OTA_STATUS_BAD_IMAGE );
+        return;
+    }
+
+    WICED_BT_TRACE( "ota: image verified, rebooting\n" );
+    wiced_firmware_upgrade_finish( );
+    handsfree_ota_abort( HCI_CONTROL_OTA_STATUS_COMPLETE );
+    wiced_start_timer( &handsfree_ota_reset_timer, HANDSFREE_OTA_RESET_DELAY );
+}
+
+/*
+ * Handle the HCI_CONTROL_MISC_COMMAND_OTA_* commands
+ */
+void hci_control_ota_handle_command( uint16_t opcode, uint8_t *p_data, uint32_t data_len )
+{
+    switch ( opcode )
+    {
+    case HCI_CONTROL_MISC_COMMAND_OTA_START:
+        handsfree_ota_handle_start( p_data, data_len );
+        break;
+
+    case HCI_CONTROL_MISC_COMMAND_OTA_DATA:
+        handsfree_ota_handle_data( p_data, data_len );
+        break;
+
+    case HCI_CONTROL_MISC_COMMAND_OTA_FINISH:
+        handsfree_ota_handle_finish( );
+        break;
+
+    case HCI_CONTROL_MISC_COMMAND_OTA_ABORT:
+        WICED_BT_TRACE( "ota: aborted by host at %d\n", handsfree_ota_cb.next_offset );
+        handsfree_ota_abort( HCI_CONTROL_OTA_STATUS_SUCCESS );
+        break;
+    }
+}
+
+#endif /* OTA_FW_UPGRADE && !BTSTACK_VER */
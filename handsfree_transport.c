@@ -0,0 +1,157 @@
+/*
+ * Copyright 2016-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+/** @file
+ *
+ * Host interface transport backends.
+ *
+ * The application sends and receives host packets through the handsfree_transport_t
+ * interface only. On the device the WICED UART transport is used. Host builds
+ * (HANDSFREE_HOST_BUILD) select the Linux PTY/Unix socket backend from
+ * handsfree_transport_host.c instead.
+ */
+
+#include "wiced_transport.h"
+#include "wiced_memory.h"
+#include "handsfree.h"
+#include "string.h"
+
+#ifndef HANDSFREE_HOST_BUILD
+
+/*
+ * The transport library allocates its receive buffers itself and silently drops a packet
+ * when none is free. So that it always has one, a packet that arrives while every other
+ * transport buffer is still held by the application (fragments and OTA data are handled
+ * in place) is copied into a buffer of our own and the transport buffer released at once.
+ * That copy is the receive allocation the application can see fail: the packet is then
+ * dropped and counted as RX_OVERFLOW.
+ */
+static wiced_transport_cfg_t            handsfree_transport_uart_cfg;
+static wiced_transport_data_handler_t   handsfree_transport_uart_data_handler;
+static uint8_t                          handsfree_transport_uart_rx_held;
+static uint8_t                         *handsfree_transport_uart_rx_copy[HANDSFREE_CAP_RX_BUFFERS];
+
+static uint32_t handsfree_transport_uart_rx( uint8_t *p_data, uint32_t length )
+{
+    uint8_t *p_copy;
+    int      i;
+
+    if ( ++handsfree_transport_uart_rx_held < HANDSFREE_CAP_RX_BUFFERS )
+        return handsfree_transport_uart_data_handler( p_data, length );
+
+    for ( i = 0; i < HANDSFREE_CAP_RX_BUFFERS; i++ )
+    {
+        if ( handsfree_transport_uart_rx_copy[i] == NULL )
+            break;
+    }
+    p_copy = ( i < HANDSFREE_CAP_RX_BUFFERS ) ? (uint8_t *)wiced_bt_get_buffer( length ) : NULL;
+
+    if ( p_copy != NULL )
+        memcpy( p_copy, p_data, length );
+    handsfree_transport_uart_rx_held--;
+    wiced_transport_free_buffer( p_data );
+
+    if ( p_copy == NULL )
+    {
+        HANDSFREE_COUNT( RX_OVERFLOW );
+        return 0;
+    }
+    handsfree_transport_uart_rx_copy[i] = p_copy;
+    return handsfree_transport_uart_data_handler( p_copy, length );
+}
+
+static wiced_result_t handsfree_transport_uart_init( const wiced_transport_cfg_t *p_cfg )
+{
+    handsfree_transport_uart_cfg          = *p_cfg;
+    handsfree_transport_uart_data_handler = p_cfg->p_data_handler;
+    if ( p_cfg->p_data_handler != NULL )
+        handsfree_transport_uart_cfg.p_data_handler = handsfree_transport_uart_rx;
+
+    return wiced_transport_init( &handsfree_transport_uart_cfg );
+}
+
+/*
+ * wiced_transport_send_data() takes one piece, a payload with a tail is put together in a
+ * buffer that lives only until the transport has copied it. Without that buffer nothing
+ * is sent: the tail is part of the event and the host would misread it without.
+ */
+static wiced_result_t handsfree_transport_uart_send( uint16_t code, uint8_t *p_data, uint16_t length,
+                                                     const uint8_t *p_tail, uint16_t tail_length )
+{
+    wiced_result_t  result;
+    uint8_t        *p_buf;
+
+    if ( tail_length == 0 )
+        return wiced_transport_send_data( code, p_data, length );
+
+    if ( ( p_buf = (uint8_t *)wiced_bt_get_buffer( length + tail_length ) ) == NULL )
+    {
+        HANDSFREE_COUNT( POOL_ALLOC_FAILED );
+        return WICED_BT_NO_RESOURCES;
+    }
+    if ( length )
+        memcpy( p_buf, p_data, length );
+    memcpy( p_buf + length, p_tail, tail_length );
+
+    result = wiced_transport_send_data( code, p_buf, length + tail_length );
+    wiced_bt_free_buffer( p_buf );
+    return result;
+}
+
+static void handsfree_transport_uart_free_rx_buffer( uint8_t *p_buf )
+{
+    int i;
+
+    for ( i = 0; i < HANDSFREE_CAP_RX_BUFFERS; i++ )
+    {
+        if ( handsfree_transport_uart_rx_copy[i] == p_buf )
+        {
+            handsfree_transport_uart_rx_copy[i] = NULL;
+            wiced_bt_free_buffer( p_buf );
+            return;
+        }
+    }
+    handsfree_transport_uart_rx_held--;
+    wiced_transport_free_buffer( p_buf );
+}
+
+const handsfree_transport_t handsfree_transport_uart =
+{
+    .init           = handsfree_transport_uart_init,
+    .send           = handsfree_transport_uart_send,
+    .free_rx_buffer = handsfree_transport_uart_free_rx_buffer,
+};
+
+const handsfree_transport_t *p_handsfree_transport = &handsfree_transport_uart;
+
+#endif /* !HANDSFREE_HOST_BUILD */
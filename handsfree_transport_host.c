@@ -0,0 +1,373 @@
+/*
+ * Copyright 2016-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+/** @file
+ *
+ * Linux host transport backend.
+ *
+ * Used when the application logic is built for a Linux host against a stub WICED layer
+ * (HANDSFREE_HOST_BUILD). Packets use the same framing as the WICED HCI UART:
+ *
+ *     0x19 opcode(2) length(2) payload(length)
+ *
+ * By default a pseudo terminal is opened and the name of its slave side is printed, so
+ * the host MCU stack can open it like the real UART. If the HANDSFREE_SOCKET environment
+ * variable is set, a Unix stream socket is created at that path instead and the first
+ * client to connect becomes the host.
+ *
+ * A reader thread collects packets and posts them to the application thread with
+ * wiced_app_event_serialize(), where the data handler of the transport configuration
+ * gets them in a malloc'd buffer starting at the opcode as on the device. As on the
+ * device, at most rx_buff_pool_cfg.buffer_count packets are held until the application
+ * releases them; packets arriving while all are held, and packets longer than a receive
+ * buffer, are read and dropped so the stream stays in sync. If HANDSFREE_BAUD is set,
+ * packets are taken no faster than a UART at that rate, 10 bits per byte, delivers them.
+ */
+
+#ifdef HANDSFREE_HOST_BUILD
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <termios.h>
+#include <time.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include "wiced_transport.h"
+#include "handsfree.h"
+
+#define HOST_TRANSPORT_PACKET_TYPE          0x19    // HCI_WICED_PKT
+#define HOST_TRANSPORT_HDR_LEN              4       // opcode(2) length(2)
+
+static int                          host_transport_fd = -1;
+static pthread_t                    host_transport_rx_thread;
+static pthread_mutex_t              host_transport_tx_lock = PTHREAD_MUTEX_INITIALIZER;
+static const wiced_transport_cfg_t *p_host_transport_cfg;
+static wiced_stub_t                *p_host_transport_stub;     // Device the packets go to
+static atomic_uint                  host_transport_rx_held;     // Buffers not yet released by the application
+
+typedef struct
+{
+    uint8_t    *p_packet;
+    uint32_t    length;
+} host_transport_rx_t;
+
+/* Hold a packet of len bytes until a UART at the given rate would have delivered it */
+static void host_transport_pace( uint32_t baud, struct timespec *p_next, size_t len )
+{
+    struct timespec now;
+    uint64_t        ns = (uint64_t)len * 10 * 1000000000ull / baud;
+
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    if ( ( p_next->tv_sec < now.tv_sec ) || ( ( p_next->tv_sec == now.tv_sec ) && ( p_next->tv_nsec < now.tv_nsec ) ) )
+        *p_next = now;
+
+    ns += p_next->tv_nsec;
+    p_next->tv_sec += ns / 1000000000ull;
+    p_next->tv_nsec = ns % 1000000000ull;
+    while ( clock_nanosleep( CLOCK_MONOTONIC, TIMER_ABSTIME, p_next, NULL ) == EINTR )
+        ;
+}
+
+static int host_transport_read_all( int fd, uint8_t *p_buf, size_t len )
+{
+    ssize_t n;
+
+    while ( len )
+    {
+        n = read( fd, p_buf, len );
+        if ( n < 0 && errno == EINTR )
+            continue;
+        if ( n <= 0 )
+            return -1;
+        p_buf += n;
+        len   -= n;
+    }
+    return 0;
+}
+
+static int host_transport_write_all( int fd, const uint8_t *p_buf, size_t len )
+{
+    ssize_t n;
+
+    while ( len )
+    {
+        n = write( fd, p_buf, len );
+        if ( n < 0 && errno == EINTR )
+            continue;
+        if ( n <= 0 )
+            return -1;
+        p_buf += n;
+        len   -= n;
+    }
+    return 0;
+}
+
+/* Read and drop a payload that does not fit the receive buffer */
+static int host_transport_discard( int fd, uint16_t length )
+{
+    uint8_t  scratch[64];
+    uint16_t n;
+
+    while ( length )
+    {
+        n = ( length < sizeof( scratch ) ) ? length : sizeof( scratch );
+        if ( host_transport_read_all( fd, scratch, n ) < 0 )
+            return -1;
+        length -= n;
+    }
+    return 0;
+}
+
+/* Runs on the application thread */
+static int host_transport_deliver( void *p_data )
+{
+    host_transport_rx_t *p_rx = p_data;
+
+    /* Handler owns the buffer and releases it through free_rx_buffer */
+    p_host_transport_cfg->p_data_handler( p_rx->p_packet, p_rx->length );
+    free( p_rx );
+    return 0;
+}
+
+/*
+ * Runs on the application thread. The reader thread has no application instance selected,
+ * so it hands the count over rather than incrementing the default instance's counter.
+ */
+static int host_transport_rx_overflow( void *p_data )
+{
+    HANDSFREE_COUNT( RX_OVERFLOW );
+    return 0;
+}
+
+static void *host_transport_rx_task( void *arg )
+{
+    uint8_t              type;
+    uint8_t              hdr[HOST_TRANSPORT_HDR_LEN];
+    uint16_t             length;
+    uint8_t             *p_packet;
+    host_transport_rx_t *p_rx;
+    const char          *p_baud = getenv( "HANDSFREE_BAUD" );
+    uint32_t             baud = p_baud ? strtoul( p_baud, NULL, 0 ) : 0;
+    struct timespec      next = { 0, 0 };
+
+    wiced_stub_select( p_host_transport_stub );
+
+    for ( ;; )
+    {
+        if ( host_transport_read_all( host_transport_fd, &type, 1 ) < 0 )
+            break;
+
+        /* Resynchronize on the packet type */
+        if ( type != HOST_TRANSPORT_PACKET_TYPE )
+            continue;
+
+        if ( host_transport_read_all( host_transport_fd, hdr, sizeof( hdr ) ) < 0 )
+            break;
+
+        length = hdr[2] | ( hdr[3] << 8 );
+        if ( baud )
+            host_transport_pace( baud, &next, 1 + HOST_TRANSPORT_HDR_LEN + length );
+        if ( length > HANDSFREE_CAP_RX_BUFFER_SIZE - HOST_TRANSPORT_HDR_LEN )
+        {
+            fprintf( stderr, "host transport: packet too long (%u)\n", length );
+            wiced_app_event_serialize( host_transport_rx_overflow, NULL );
+            if ( host_transport_discard( host_transport_fd, length ) < 0 )
+                break;
+            continue;
+        }
+        if ( atomic_load( &host_transport_rx_held ) >= p_host_transport_cfg->rx_buff_pool_cfg.buffer_count )
+        {
+            wiced_app_event_serialize( host_transport_rx_overflow, NULL );
+            if ( host_transport_discard( host_transport_fd, length ) < 0 )
+                break;
+            continue;
+        }
+
+        if ( ( p_packet = malloc( HOST_TRANSPORT_HDR_LEN + length ) ) == NULL )
+            break;
+        if ( ( p_rx = malloc( sizeof( host_transport_rx_t ) ) ) == NULL )
+        {
+            free( p_packet );
+            break;
+        }
+
+        memcpy( p_packet, hdr, sizeof( hdr ) );
+        if ( host_transport_read_all( host_transport_fd, p_packet + HOST_TRANSPORT_HDR_LEN, length ) < 0 )
+        {
+            free( p_packet );
+            free( p_rx );
+            break;
+        }
+
+        atomic_fetch_add( &host_transport_rx_held, 1 );
+        p_rx->p_packet = p_packet;
+        p_rx->length   = HOST_TRANSPORT_HDR_LEN + length;
+        wiced_app_event_serialize( host_transport_deliver, p_rx );
+    }
+
+    fprintf( stderr, "host transport: peer closed\n" );
+    return NULL;
+}
+
+static int host_transport_open_pty( void )
+{
+    struct termios tio;
+    int            fd;
+
+    if ( ( fd = posix_openpt( O_RDWR | O_NOCTTY ) ) < 0 )
+        return -1;
+
+    if ( ( grantpt( fd ) < 0 ) || ( unlockpt( fd ) < 0 ) )
+    {
+        close( fd );
+        return -1;
+    }
+
+    /* Binary protocol, no line discipline */
+    if ( tcgetattr( fd, &tio ) == 0 )
+    {
+        cfmakeraw( &tio );
+        tcsetattr( fd, TCSANOW, &tio );
+    }
+
+    printf( "host transport: pty %s\n", ptsname( fd ) );
+    fflush( stdout );
+    return fd;
+}
+
+static int host_transport_open_socket( const char *path )
+{
+    struct sockaddr_un addr;
+    int                listen_fd, fd;
+
+    if ( ( listen_fd = socket( AF_UNIX, SOCK_STREAM, 0 ) ) < 0 )
+        return -1;
+
+    memset( &addr, 0, sizeof( addr ) );
+    addr.sun_family = AF_UNIX;
+    strncpy( addr.sun_path, path, sizeof( addr.sun_path ) - 1 );
+    unlink( path );
+
+    if ( ( bind( listen_fd, (struct sockaddr *)&addr, sizeof( addr ) ) < 0 ) || ( listen( listen_fd, 1 ) < 0 ) )
+    {
+        close( listen_fd );
+        return -1;
+    }
+
+    printf( "host transport: waiting for host on %s\n", path );
+    fflush( stdout );
+
+    fd = accept( listen_fd, NULL, NULL );
+    close( listen_fd );
+    return fd;
+}
+
+static wiced_result_t host_transport_init( const wiced_transport_cfg_t *p_cfg )
+{
+    const char *socket_path = getenv( "HANDSFREE_SOCKET" );
+
+    p_host_transport_cfg  = p_cfg;
+    p_host_transport_stub = wiced_stub_current( );
+
+    host_transport_fd = socket_path ? host_transport_open_socket( socket_path ) : host_transport_open_pty( );
+    if ( host_transport_fd < 0 )
+    {
+        perror( "host transport" );
+        return WICED_ERROR;
+    }
+
+    if ( pthread_create( &host_transport_rx_thread, NULL, host_transport_rx_task, NULL ) != 0 )
+    {
+        close( host_transport_fd );
+        host_transport_fd = -1;
+        return WICED_ERROR;
+    }
+
+    if ( p_cfg->p_status_handler )
+    {
+        p_cfg->p_status_handler( p_cfg->type );
+    }
+    return WICED_SUCCESS;
+}
+
+static wiced_result_t host_transport_send( uint16_t code, uint8_t *p_data, uint16_t length,
+                                           const uint8_t *p_tail, uint16_t tail_length )
+{
+    uint8_t hdr[1 + HOST_TRANSPORT_HDR_LEN];
+    int     rc;
+
+    if ( host_transport_fd < 0 )
+        return WICED_ERROR;
+
+    hdr[0] = HOST_TRANSPORT_PACKET_TYPE;
+    hdr[1] = code & 0xff;
+    hdr[2] = code >> 8;
+    hdr[3] = ( length + tail_length ) & 0xff;
+    hdr[4] = ( length + tail_length ) >> 8;
+
+    /* Keep header and payload of concurrent senders together */
+    pthread_mutex_lock( &host_transport_tx_lock );
+    rc = host_transport_write_all( host_transport_fd, hdr, sizeof( hdr ) );
+    if ( ( rc == 0 ) && length )
+        rc = host_transport_write_all( host_transport_fd, p_data, length );
+    if ( ( rc == 0 ) && tail_length )
+        rc = host_transport_write_all( host_transport_fd, p_tail, tail_length );
+    pthread_mutex_unlock( &host_transport_tx_lock );
+
+    return ( rc == 0 ) ? WICED_SUCCESS : WICED_ERROR;
+}
+
+static void host_transport_free_rx_buffer( uint8_t *p_buf )
+{
+    atomic_fetch_sub( &host_transport_rx_held, 1 );
+    free( p_buf );
+}
+
+const handsfree_transport_t handsfree_transport_host =
+{
+    .init           = host_transport_init,
+    .send           = host_transport_send,
+    .free_rx_buffer = host_transport_free_rx_buffer,
+};
+
+const handsfree_transport_t *p_handsfree_transport = &handsfree_transport_host;
+
+#endif /* HANDSFREE_HOST_BUILD */
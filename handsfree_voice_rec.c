@@ -0,0 +1,340 @@
+/*
+ * Copyright 2016-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+/** @file
+ *
+ * Voice recognition sessions.
+ *
+ * A long button press or AT+BVRA from the host starts a session. Instead of sending
+ * AT+BVRA and waiting for the AG to bring up audio like for a call, the session starts
+ * everything the assistant needs at once:
+ *  - AT+BCC goes out as soon as the AG has answered AT+BVRA with OK, when both sides
+ *    support codec negotiation, so the codec is settled while the AG is still starting
+ *    the assistant. The AG answers one command at a time, so AT+BCC waits for that OK;
+ *    its own OK or ERROR is not passed to the host, which did not send it. An ERROR to
+ *    AT+BVRA ends the session.
+ *  - The audio path is claimed and configured ahead of SCO (music is paused).
+ *  - The HF opens SCO itself if the AG has not done so HANDSFREE_VR_SCO_WAIT_TIMEOUT after
+ *    the codec was set, instead of SCO_CONNECTION_WAIT_TIMEOUT.
+ *  - SCO uses the S1 / T1 parameter sets, the lowest latency ones of HFP, rather than the
+ *    S4 / T2 sets used for calls. Both allow EV3 packets only; S1 (CVSD) asks for power
+ *    optimised retransmissions and may fall back to HV3, T1 (mSBC) asks for quality.
+ *
+ * There is no separate jitter policy for sessions. The SCO audio path is buffered by the
+ * controller and the audio manager, sized once at start up by handsfree_audio_buf_config,
+ * and the application has no per stream setting to shorten it.
+ *
+ * The session ends with AT+BVRA=0 from the host, +BVRA: 0 from the AG, when its SCO link
+ * goes down or when the service level connection closes.
+ *
+ * HFP 1.8 textual representation updates
+ *
+ *     +BVRA: <vrect>,<vrectstate>,<textID>,<textType>,<textOperation>,<string>
+ *
+ * are parsed in place and passed to the host as HCI_CONTROL_HF_EVENT_VR_TEXT events. The
+ * string is cut into HCI_CONTROL_HF_VR_TEXT_CHUNK pieces, each event carries the total
+ * length and the offset of its piece so the host can assemble the text.
+ */
+
+#include "wiced_bt_trace.h"
+#include "wiced_timer.h"
+#include "handsfree.h"
+#include "string.h"
+
+#define HANDSFREE_VR_SCO_WAIT_TIMEOUT       150     // ms before the HF opens SCO itself
+
+#define HANDSFREE_VR_LATENCY_CVSD           0x0007  // S1
+#define HANDSFREE_VR_LATENCY_MSBC           0x0008  // T1
+
+/* EV3, none of the EDR packets */
+#define HANDSFREE_VR_EV3_PKT_TYPES          ( BTM_SCO_PKT_TYPES_MASK_EV3 | \
+                                              BTM_SCO_PKT_TYPES_MASK_NO_2_EV3 | BTM_SCO_PKT_TYPES_MASK_NO_3_EV3 | \
+                                              BTM_SCO_PKT_TYPES_MASK_NO_2_EV5 | BTM_SCO_PKT_TYPES_MASK_NO_3_EV5 )
+
+#define HANDSFREE_VR_TEXT_HDR_LEN           10
+
+/* S1, with the HV3 (D1) fallback for AGs without eSCO */
+static const wiced_bt_sco_params_t handsfree_vr_esco_params_cvsd =
+{
+        HANDSFREE_VR_LATENCY_CVSD,
+        HANDSFREE_VR_EV3_PKT_TYPES | BTM_SCO_PKT_TYPES_MASK_HV3,
+        BTM_ESCO_RETRANS_POWER,
+        WICED_FALSE
+};
+
+/* T1 */
+static const wiced_bt_sco_params_t handsfree_vr_esco_params_msbc =
+{
+        HANDSFREE_VR_LATENCY_MSBC,
+        HANDSFREE_VR_EV3_PKT_TYPES,
+        BTM_ESCO_RETRANS_QUALITY,
+        WICED_TRUE
+};
+
+/* Per device, see handsfree_instance_t */
+#define handsfree_next_sco_params       ( p_handsfree_instance->handsfree_next_sco_params )
+
+/*
+ * SCO parameters for the next SCO link of this device, adapted to the link quality
+ */
+wiced_bt_sco_params_t *handsfree_sco_params( void )
+{
+    if ( !handsfree_ctxt_data.vr_active )
+    {
+        handsfree_next_sco_params = handsfree_esco_params;
+    }
+    else
+    {
+        /* The codec was negotiated for the call parameters, follow it */
+        handsfree_next_sco_params = handsfree_esco_params.use_wbs ? handsfree_vr_esco_params_msbc : handsfree_vr_esco_params_cvsd;
+    }
+
+    handsfree_link_monitor_adjust( &handsfree_next_sco_params );
+    handsfree_call_stats_params( &handsfree_next_sco_params );
+    return &handsfree_next_sco_params;
+}
+
+/*
+ * SCO wait before the HF opens SCO after codec negotiation
+ */
+uint32_t handsfree_sco_wait_timeout( void )
+{
+    return handsfree_ctxt_data.vr_active ? HANDSFREE_VR_SCO_WAIT_TIMEOUT : SCO_CONNECTION_WAIT_TIMEOUT;
+}
+
+/*
+ * Send AT+BVRA=<value> and set up audio for the assistant in parallel
+ */
+void handsfree_vr_start( uint16_t handle, int value )
+{
+    wiced_bt_hfp_hf_scb_t *p_scb = wiced_bt_hfp_hf_get_scb_by_handle( handle );
+
+    hci_control_hf_send_at_cmd( handle, "+BVRA", WICED_BT_HFP_HF_AT_SET, WICED_BT_HFP_HF_AT_FMT_INT, NULL, value );
+
+    /* Already listening, or a call owns the audio */
+    if ( ( p_scb == NULL ) || handsfree_ctxt_data.vr_active || handsfree_ctxt_data.is_sco_connected ||
+         handsfree_ctxt_data.call_active )
+    {
+        return;
+    }
+
+    WICED_BT_TRACE( "vr: session start\n" );
+    handsfree_ctxt_data.vr_active = WICED_TRUE;
+
+#if defined(CYW20721B2) || defined(CYW43012C0) || defined(CYW55572A1)
+    handsfree_audio_arbiter_call_start( );
+#endif
+
+    if ( ( p_scb->peer_feature_mask & WICED_BT_HFP_AG_FEATURE_CODEC_NEGOTIATION ) &&
+         ( p_scb->feature_mask & WICED_BT_HFP_HF_FEATURE_CODEC_NEGOTIATION ) )
+    {
+        /* AT+BCC follows the OK, see handsfree_vr_at_result() */
+        handsfree_ctxt_data.vr_at_state = HANDSFREE_VR_AT_BVRA;
+    }
+    else
+    {
+        wiced_start_timer( &handsfree_app_states.hfp_timer, HANDSFREE_VR_SCO_WAIT_TIMEOUT );
+    }
+}
+
+/*
+ * OK (ok) or ERROR from the AG while a session is starting. Returns WICED_TRUE if it
+ * answers the AT+BCC of the session and is not for the host.
+ */
+wiced_bool_t handsfree_vr_at_result( uint16_t handle, wiced_bool_t ok )
+{
+    wiced_bt_hfp_hf_scb_t *p_scb;
+
+    switch ( handsfree_ctxt_data.vr_at_state )
+    {
+    case HANDSFREE_VR_AT_BVRA:
+        if ( !ok )
+        {
+            WICED_BT_TRACE( "vr: AT+BVRA refused\n" );
+            handsfree_vr_end( );
+            return WICED_FALSE;
+        }
+        if ( ( p_scb = wiced_bt_hfp_hf_get_scb_by_handle( handle ) ) == NULL )
+        {
+            handsfree_ctxt_data.vr_at_state = HANDSFREE_VR_AT_IDLE;
+            return WICED_FALSE;
+        }
+
+        /* SCO wait starts once the codec is set */
+        wiced_bt_hfp_hf_at_send_cmd( p_scb, WICED_BT_HFP_HF_CMD_BCC,
+                WICED_BT_HFP_HF_AT_NONE, WICED_BT_HFP_HF_AT_FMT_NONE, NULL, 0 );
+        handsfree_ctxt_data.vr_at_state   = HANDSFREE_VR_AT_BCC;
+        handsfree_ctxt_data.init_sco_conn = WICED_TRUE;
+        return WICED_FALSE;
+
+    case HANDSFREE_VR_AT_BCC:
+        handsfree_ctxt_data.vr_at_state = HANDSFREE_VR_AT_IDLE;
+        if ( !ok )
+        {
+            /* No codec negotiation to wait for, open SCO on the session timeout */
+            handsfree_ctxt_data.init_sco_conn = WICED_FALSE;
+            wiced_start_timer( &handsfree_app_states.hfp_timer, HANDSFREE_VR_SCO_WAIT_TIMEOUT );
+        }
+        return WICED_TRUE;
+
+    default:
+        return WICED_FALSE;
+    }
+}
+
+/*
+ * Send AT+BVRA=0, the session ends when the AG drops SCO
+ */
+void handsfree_vr_stop( uint16_t handle )
+{
+    hci_control_hf_send_at_cmd( handle, "+BVRA", WICED_BT_HFP_HF_AT_SET, WICED_BT_HFP_HF_AT_FMT_INT, NULL, 0 );
+
+    /* Nothing to wait for if audio never came up */
+    if ( handsfree_ctxt_data.vr_active && !handsfree_ctxt_data.is_sco_connected )
+        handsfree_vr_end( );
+}
+
+/*
+ * Forget the session, called when its audio or the connection goes away
+ */
+void handsfree_vr_end( void )
+{
+    if ( !handsfree_ctxt_data.vr_active )
+        return;
+
+    WICED_BT_TRACE( "vr: session end\n" );
+    handsfree_ctxt_data.vr_active     = WICED_FALSE;
+    handsfree_ctxt_data.vr_at_state   = HANDSFREE_VR_AT_IDLE;
+    handsfree_ctxt_data.init_sco_conn = WICED_FALSE;
+    if ( wiced_is_timer_in_use( &handsfree_app_states.hfp_timer ) )
+        wiced_stop_timer( &handsfree_app_states.hfp_timer );
+
+#if defined(CYW20721B2) || defined(CYW43012C0) || defined(CYW55572A1)
+    handsfree_call_audio_check_idle( );
+#endif
+}
+
+/*
+ * Parse a decimal or hexadecimal field followed by a comma, advances *pp_at past the comma
+ */
+static wiced_bool_t handsfree_vr_parse_field( const char **pp_at, int base, uint32_t *p_value )
+{
+    const char *p = *pp_at;
+    uint32_t    value = 0;
+    int         digit;
+
+    while ( *p == ' ' )
+        p++;
+
+    for ( ; ; p++ )
+    {
+        if ( ( *p >= '0' ) && ( *p <= '9' ) )
+            digit = *p - '0';
+        else if ( ( base == 16 ) && ( *p >= 'A' ) && ( *p <= 'F' ) )
+            digit = *p - 'A' + 10;
+        else if ( ( base == 16 ) && ( *p >= 'a' ) && ( *p <= 'f' ) )
+            digit = *p - 'a' + 10;
+        else
+            break;
+        value = value * base + digit;
+    }
+
+    if ( ( p == *pp_at ) || ( *p != ',' ) )
+        return WICED_FALSE;
+
+    *p_value = value;
+    *pp_at   = p + 1;
+    return WICED_TRUE;
+}
+
+/*
+ * Pass the text of a +BVRA textual representation update to the host. Returns WICED_FALSE
+ * if p_at is not one.
+ */
+wiced_bool_t handsfree_vr_text_handle( uint16_t handle, const char *p_at )
+{
+    uint8_t     tx_buf[HANDSFREE_VR_TEXT_HDR_LEN + HCI_CONTROL_HF_VR_TEXT_CHUNK];
+    uint8_t    *p;
+    uint32_t    vrect, vrect_state, text_id, text_type, text_op;
+    uint16_t    total_len, offset, chunk;
+    const char *p_text;
+
+    while ( ( *p_at == '\r' ) || ( *p_at == '\n' ) )
+        p_at++;
+    if ( strncmp( p_at, "+BVRA:", 6 ) != 0 )
+        return WICED_FALSE;
+    p_at += 6;
+
+    if ( !handsfree_vr_parse_field( &p_at, 10, &vrect ) ||
+         !handsfree_vr_parse_field( &p_at, 10, &vrect_state ) ||
+         !handsfree_vr_parse_field( &p_at, 16, &text_id ) ||
+         !handsfree_vr_parse_field( &p_at, 10, &text_type ) ||
+         !handsfree_vr_parse_field( &p_at, 10, &text_op ) )
+    {
+        return WICED_FALSE;
+    }
+
+    /* Text runs to the end of the line, without the optional quotes */
+    p_text = p_at;
+    for ( total_len = 0; ( p_text[total_len] != '\0' ) && ( p_text[total_len] != '\r' ) && ( p_text[total_len] != '\n' ); total_len++ )
+        ;
+    if ( ( total_len >= 2 ) && ( p_text[0] == '"' ) && ( p_text[total_len - 1] == '"' ) )
+    {
+        p_text++;
+        total_len -= 2;
+    }
+
+    if ( vrect == 0 )
+        handsfree_vr_end( );
+
+    offset = 0;
+    do
+    {
+        chunk = ( total_len - offset > HCI_CONTROL_HF_VR_TEXT_CHUNK ) ? HCI_CONTROL_HF_VR_TEXT_CHUNK : total_len - offset;
+
+        p = tx_buf;
+        UINT16_TO_STREAM( p, handle );
+        UINT16_TO_STREAM( p, text_id );
+        UINT8_TO_STREAM( p, text_type );
+        UINT8_TO_STREAM( p, text_op );
+        UINT16_TO_STREAM( p, total_len );
+        UINT16_TO_STREAM( p, offset );
+        memcpy( p, &p_text[offset], chunk );
+
+        hci_control_send_data( HCI_CONTROL_HF_EVENT_VR_TEXT, tx_buf, HANDSFREE_VR_TEXT_HDR_LEN + chunk );
+        offset += chunk;
+    } while ( offset < total_len );
+
+    UNUSED_VARIABLE( vrect_state );
+    return WICED_TRUE;
+}
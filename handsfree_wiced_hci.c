@@ -44,16 +44,12 @@
 #include "wiced_hal_wdog.h"
 #endif
 
-void hci_control_send_command_status_evt( uint16_t code, uint8_t status );
 void hci_control_device_handle_command( uint16_t cmd_opcode, uint8_t* p_data, uint32_t data_len );
 void hci_control_hf_handle_command(uint16_t opcode, uint8_t* p_data, uint32_t length);
 void hci_control_hf_at_command (uint16_t handle, uint8_t command, int num, uint8_t* p_data);
 void hci_control_misc_handle_command( uint16_t cmd_opcode, uint8_t* p_data, uint32_t data_len );
 void hci_control_misc_handle_get_version( void );
-void hci_control_hf_send_at_cmd (uint16_t handle,char *cmd, uint8_t arg_type, uint8_t arg_format, const char *p_arg, int16_t int_arg);
 
-extern wiced_bt_buffer_pool_t* p_key_info_pool;//Pool for storing the  key info
-extern wiced_bt_sco_params_t handsfree_esco_params;
 
 /*
  * handle reset command from UART
@@ -151,7 +147,7 @@ void hci_control_inquiry_result_cback( wiced_bt_dev_inquiry_scan_result_t *p_inq
                 *p++ = *p_eir_data++;
         }
     }
-    wiced_transport_send_data( code, tx_buf, ( int )( p - tx_buf ) );
+    hci_control_send_data( code, tx_buf, ( int )( p - tx_buf ) );
 }
 
 /*
@@ -246,7 +242,11 @@ void hci_control_handle_set_pairability ( uint8_t allowed )
  */
 void hci_control_send_device_started_evt( void )
 {
-    wiced_transport_send_data( HCI_CONTROL_EVENT_DEVICE_STARTED, NULL, 0 );
+    /* Host (re)started, it talks v1 until it asks for v2 again */
+    hci_control_v2_reset( );
+    hci_control_frag_reset( );
+    hci_control_time_reset( );
+    hci_control_send_data( HCI_CONTROL_EVENT_DEVICE_STARTED, NULL, 0 );
 
 #if BTSTACK_VER >= 0x03000001
     WICED_BT_TRACE( "maxLinks:%d maxChannels:%d maxpsm:%d rfcom max links:%d, rfcom max ports:%d\n",
@@ -265,12 +265,58 @@ void hci_control_send_device_started_evt( void )
 #endif
 }
 
+/*
+ * Send a packet over the transport as is
+ */
+wiced_result_t hci_control_transport_send( uint16_t code, uint8_t *p_data, uint16_t length )
+{
+    return p_handsfree_transport->send( code, p_data, length, NULL, 0 );
+}
+
+/*
+ * Send an event to the host, framed according to the protocol version in use
+ */
+HANDSFREE_HOT wiced_result_t hci_control_send_data( uint16_t code, uint8_t *p_data, uint16_t length )
+{
+    wiced_result_t result;
+    uint8_t        trailer[HCI_TIME_TRAILER_LEN];
+    uint16_t       trailer_len = 0;
+
+    /*
+     * The trailer is handed to the transport as a second piece, which puts the two
+     * together. Once stamping is on the host expects a trailer on every event, so one that
+     * can not carry it is dropped rather than sent without.
+     */
+    if ( hci_control_time_is_enabled( ) )
+    {
+        if ( ( trailer_len = hci_control_time_stamp( length, trailer ) ) == 0 )
+        {
+            HANDSFREE_COUNT( EVT_SEND_FAILED );
+            return WICED_BT_ERROR;
+        }
+    }
+    if ( hci_control_v2_is_enabled( ) )
+    {
+        result = hci_control_v2_send( code, p_data, length, trailer, trailer_len );
+    }
+    else
+    {
+        result = p_handsfree_transport->send( code, p_data, length, trailer, trailer_len );
+    }
+
+    if ( result == WICED_SUCCESS )
+        HANDSFREE_COUNT( EVT_SENT );
+    else
+        HANDSFREE_COUNT( EVT_SEND_FAILED );
+    return result;
+}
+
 /*
 * transfer command status event to UART
 */
 void hci_control_send_command_status_evt( uint16_t code, uint8_t status )
 {
-    wiced_transport_send_data( code, &status, 1 );
+    hci_control_send_data( code, &status, 1 );
 }
 
 /*
@@ -292,7 +338,7 @@ void hci_control_send_pairing_completed_evt( uint8_t status , wiced_bt_device_ad
 
     WICED_BT_TRACE(" sending the pairing complete evt: %B as %B status %d\n", bdaddr, &event_data[1], status);
 
-    wiced_transport_send_data(HCI_CONTROL_EVENT_PAIRING_COMPLETE, event_data, cmd_bytes );
+    hci_control_send_data(HCI_CONTROL_EVENT_PAIRING_COMPLETE, event_data, cmd_bytes );
 }
 
 /*
@@ -312,13 +358,21 @@ void hci_control_send_encryption_changed_evt( uint8_t encrypted ,  wiced_bt_devi
             event_data[cmd_bytes++] = bdaddr[BD_ADDR_LEN - 1 - i];
     }
 
-    wiced_transport_send_data( HCI_CONTROL_EVENT_ENCRYPTION_CHANGED, event_data, cmd_bytes );
+    hci_control_send_data( HCI_CONTROL_EVENT_ENCRYPTION_CHANGED, event_data, cmd_bytes );
 }
 
+#ifndef BTSTACK_VER
+/* Per device, see handsfree_instance_t */
+#define hci_control_rx_copy         ( p_handsfree_instance->hci_control_rx_copy )
+
+/* Bond pushes are copied too, plain or in a v2 frame */
+typedef char hci_control_rx_copy_bond_check[ ( HCI_V2_OVERHEAD + 2 + KEY_INFO_POOL_BUFFER_SIZE <= HCI_CONTROL_RX_COPY_MAX ) ? 1 : -1 ];
+#endif
+
 /*
  * Handle received command over UART.
  */
-uint32_t hci_control_proc_rx_cmd( uint8_t *p_data, uint32_t length )
+HANDSFREE_HOT uint32_t hci_control_proc_rx_cmd( uint8_t *p_data, uint32_t length )
 {
     uint16_t opcode;
     uint16_t payload_len;
@@ -331,12 +385,15 @@ uint32_t hci_control_proc_rx_cmd( uint8_t *p_data, uint32_t length )
     {
         return HCI_CONTROL_STATUS_INVALID_ARGS;
     }
+    HANDSFREE_COUNT( RX_PACKETS );
+
     //Expected minimum 4 byte as the wiced header
     if( length < 4 )
     {
         WICED_BT_TRACE("invalid params\n");
+        HANDSFREE_COUNT( RX_MALFORMED );
 #ifndef BTSTACK_VER
-        wiced_transport_free_buffer( p_rx_buf );
+        p_handsfree_transport->free_rx_buffer( p_rx_buf );
 #endif
         return HCI_CONTROL_STATUS_INVALID_ARGS;
     }
@@ -345,32 +402,68 @@ uint32_t hci_control_proc_rx_cmd( uint8_t *p_data, uint32_t length )
     STREAM_TO_UINT16(opcode, p_data);     // Get opcode
     STREAM_TO_UINT16(payload_len, p_data); // Get len
 
+    if ( payload_len > length - 4 )
+    {
+        WICED_BT_TRACE( "truncated command %04x len:%d/%d\n", opcode, payload_len, length - 4 );
+        HANDSFREE_COUNT( RX_MALFORMED );
+#ifndef BTSTACK_VER
+        p_handsfree_transport->free_rx_buffer( p_rx_buf );
+#endif
+        return HCI_CONTROL_STATUS_INVALID_ARGS;
+    }
+
+#ifndef BTSTACK_VER
+    if ( ( payload_len <= sizeof( hci_control_rx_copy ) ) && ( opcode != HCI_CONTROL_MISC_COMMAND_FRAGMENT ) &&
+         ( opcode != HCI_CONTROL_MISC_COMMAND_OTA_DATA ) )
+    {
+        memcpy( hci_control_rx_copy, p_data, payload_len );
+        p_handsfree_transport->free_rx_buffer( p_rx_buf );
+        HANDSFREE_COUNT( RX_EARLY_RELEASE );
+
+        hci_control_dispatch_cmd( opcode, hci_control_rx_copy, payload_len );
+        return status;
+    }
+#endif
+
+    HANDSFREE_COUNT( RX_IN_PLACE );
+    hci_control_dispatch_cmd( opcode, p_data, payload_len );
+
+#ifndef BTSTACK_VER
+    //Freeing the buffer in which data is received
+    p_handsfree_transport->free_rx_buffer( p_rx_buf );
+#endif
+    return status;
+}
+
+/*
+ * Route a command to the handler of its group
+ */
+HANDSFREE_HOT void hci_control_dispatch_cmd( uint16_t opcode, uint8_t *p_data, uint16_t payload_len )
+{
     WICED_BT_TRACE("cmd_opcode 0x%02x\n", opcode);
 
     switch((opcode >> 8) & 0xff)
     {
     case HCI_CONTROL_GROUP_DEVICE:
+        HANDSFREE_COUNT( CMD_DEVICE );
         hci_control_device_handle_command( opcode, p_data, payload_len );
         break;
 
     case HCI_CONTROL_GROUP_HF:
+        HANDSFREE_COUNT( CMD_HF );
         hci_control_hf_handle_command ( opcode, p_data, payload_len );
         break;
 
     case HCI_CONTROL_GROUP_MISC:
+        HANDSFREE_COUNT( CMD_MISC );
         hci_control_misc_handle_command(opcode, p_data, payload_len);
         break;
 
     default:
+        HANDSFREE_COUNT( CMD_UNKNOWN );
         WICED_BT_TRACE( "unknown class code\n");
         break;
     }
-
-#ifndef BTSTACK_VER
-    //Freeing the buffer in which data is received
-    wiced_transport_free_buffer( p_rx_buf );
-#endif
-    return status;
 }
 
 void hci_control_device_handle_command( uint16_t cmd_opcode, uint8_t* p_data, uint32_t data_len )
@@ -463,7 +556,7 @@ void hci_control_hf_handle_command(uint16_t opcode, uint8_t* p_data, uint32_t le
             else
             {
                 wiced_bt_sco_remove( handsfree_ctxt_data.sco_index );
-                wiced_bt_sco_create_as_initiator( p_scb->peer_addr, &handsfree_ctxt_data.sco_index, (wiced_bt_sco_params_t *) &handsfree_esco_params );
+                wiced_bt_sco_create_as_initiator( p_scb->peer_addr, &handsfree_ctxt_data.sco_index, handsfree_sco_params() );
             }
         }
         break;
@@ -489,13 +582,28 @@ void hci_control_hf_handle_command(uint16_t opcode, uint8_t* p_data, uint32_t le
     case HCI_CONTROL_HF_COMMAND_LONG_BUTTON_PRESS:
             /* send a corresponding AT command */
         WICED_BT_TRACE("Send AT+BVRA=2\n");
-            hci_control_hf_send_at_cmd(handsfree_ctxt_data.rfcomm_handle,"+BVRA",
-                    WICED_BT_HFP_HF_AT_SET, WICED_BT_HFP_HF_AT_FMT_INT, NULL, 2);
+        handsfree_vr_start( handsfree_ctxt_data.rfcomm_handle, 2 );
+        break;
+
+    case HCI_CONTROL_HF_COMMAND_SET_HF_INDICATOR:
+        if ( ( length < 5 ) || !handsfree_hf_ind_update( p[0] | ( p[1] << 8 ), p[2], p[3] | ( p[4] << 8 ) ) )
+        {
+            hci_control_send_command_status_evt( HCI_CONTROL_EVENT_COMMAND_STATUS, HCI_CONTROL_STATUS_INVALID_ARGS );
+        }
+        else
+        {
+            hci_control_send_command_status_evt( HCI_CONTROL_EVENT_COMMAND_STATUS, HCI_CONTROL_STATUS_SUCCESS );
+        }
         break;
 
     default:
         {
             uint8_t *data_ptr = (uint8_t *) wiced_bt_get_buffer(length+1);
+            if ( data_ptr == NULL )
+            {
+                HANDSFREE_COUNT( POOL_ALLOC_FAILED );
+                break;
+            }
             hs_cmd = opcode - HCI_CONTROL_HF_AT_COMMAND_BASE;
 
             memcpy (data_ptr, p, length);
@@ -561,11 +669,13 @@ void hci_control_hf_at_command (uint16_t handle, uint8_t command, int num, uint8
     switch ( command )
     {
         case HCI_CONTROL_HF_AT_COMMAND_SPK:
+            handsfree_set_volume( WICED_BT_HFP_HF_SPEAKER, num );
             wiced_bt_hfp_hf_notify_volume (handle,
                     WICED_BT_HFP_HF_SPEAKER, num);
             break;
 
         case HCI_CONTROL_HF_AT_COMMAND_MIC:
+            handsfree_set_volume( WICED_BT_HFP_HF_MIC, num );
             wiced_bt_hfp_hf_notify_volume (handle,
                     WICED_BT_HFP_HF_MIC, num);
             break;
@@ -581,8 +691,10 @@ void hci_control_hf_at_command (uint16_t handle, uint8_t command, int num, uint8
             break;
 
         case HCI_CONTROL_HF_AT_COMMAND_BVRA:
-            hci_control_hf_send_at_cmd( handle, "+BVRA",
-                    WICED_BT_HFP_HF_AT_SET, WICED_BT_HFP_HF_AT_FMT_INT, NULL, num );
+            if ( num )
+                handsfree_vr_start( handle, num );
+            else
+                handsfree_vr_stop( handle );
             break;
 
         case HCI_CONTROL_HF_AT_COMMAND_CMEE:
@@ -655,6 +767,49 @@ void hci_control_misc_handle_command( uint16_t cmd_opcode, uint8_t* p_data, uint
     case HCI_CONTROL_MISC_COMMAND_GET_VERSION:
         hci_control_misc_handle_get_version();
         break;
+
+    case HCI_CONTROL_MISC_COMMAND_SET_PROTOCOL:
+        hci_control_v2_handle_set_protocol( p_data, data_len );
+        break;
+
+    case HCI_CONTROL_MISC_COMMAND_V2_FRAME:
+        hci_control_v2_handle_frame( p_data, data_len );
+        break;
+
+    case HCI_CONTROL_MISC_COMMAND_FRAGMENT:
+        hci_control_frag_handle( p_data, data_len );
+        break;
+
+    case HCI_CONTROL_MISC_COMMAND_SET_TIMESTAMPS:
+        hci_control_time_handle_set( p_data, data_len );
+        break;
+
+    case HCI_CONTROL_MISC_COMMAND_TIME_SYNC:
+        hci_control_time_handle_sync( p_data, data_len );
+        break;
+
+    case HCI_CONTROL_MISC_COMMAND_GET_COUNTERS:
+        hci_control_counters_handle_get( p_data, data_len );
+        break;
+
+    case HCI_CONTROL_MISC_COMMAND_NVRAM_RESTORE:
+        hci_control_nvram_restore( p_data, data_len );
+        break;
+
+#ifdef HANDSFREE_LATENCY_PROBE
+    case HCI_CONTROL_MISC_COMMAND_LATENCY_PROBE:
+        hci_control_latency_probe_handle( p_data, data_len );
+        break;
+#endif
+
+#if defined(OTA_FW_UPGRADE) && !defined(BTSTACK_VER)
+    case HCI_CONTROL_MISC_COMMAND_OTA_START:
+    case HCI_CONTROL_MISC_COMMAND_OTA_DATA:
+    case HCI_CONTROL_MISC_COMMAND_OTA_FINISH:
+    case HCI_CONTROL_MISC_COMMAND_OTA_ABORT:
+        hci_control_ota_handle_command( cmd_opcode, p_data, data_len );
+        break;
+#endif
     }
 }
 
@@ -693,5 +848,5 @@ void hci_control_misc_handle_get_version( void )
     /* Send MCU app the supported features */
     tx_buf[cmd++] = HCI_CONTROL_GROUP_HF;
 
-    wiced_transport_send_data( HCI_CONTROL_MISC_EVENT_VERSION, tx_buf, cmd );
+    hci_control_send_data( HCI_CONTROL_MISC_EVENT_VERSION, tx_buf, cmd );
 }
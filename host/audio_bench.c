@@ -0,0 +1,332 @@
+/*
+ * Copyright 2016-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+
+/** @file
+ *
+ * Codec control bus cost of the call audio path.
+ *
+ * Runs calls against the application on the stub WICED layer with a virtual clock and
+ * reads the codec model of the stub: every audio manager call is charged the register
+ * writes a CS47L35 class codec needs over 400 kHz I2C. A call is: RING, incoming call
+ * setup, mSBC codec selection, SCO up, the call answered, the AG echoing the speaker
+ * level, a volume slider on the host sending a burst of speaker levels, a microphone
+ * change from the AG, hang up and SCO down.
+ *
+ * The program is linked twice, audio_bench with the parameter cache and write batching
+ * of handsfree_audio.c and audio_bench_direct with HANDSFREE_AUDIO_SHADOW 0, which
+ * applies every setting as it comes.
+ *
+ * With -s the calls interrupt music from the A2DP sink instead and the program reports
+ * the switch gaps: from RING and from the music stream stop to the call stream start,
+ * and from SCO down to the music stream start. The AG side is a fixed timeline of an
+ * in-band ringing phone (AUDIO_BENCH_AG_*), what the device adds is the codec bus time
+ * on the way, which the virtual clock of the stub charges.
+ *
+ * Usage: audio_bench [-s] [calls]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "wiced_stub.h"
+#include "handsfree.h"
+#include "loopback_transport.h"
+
+extern void application_start( void );
+
+#define AUDIO_BENCH_HANDLE          1
+#define AUDIO_BENCH_SLIDER_STEPS    8       // Host speaker levels sent back to back
+#define AUDIO_BENCH_A2DP_HANDLE     2
+
+/* AG timeline of an incoming call with in-band ringing, and of music restarting */
+#define AUDIO_BENCH_AG_BCS_US       40000   // RING to codec negotiation (+BCS, AT+BCS, OK)
+#define AUDIO_BENCH_AG_SCO_REQ_US   30000   // Codec negotiation to the SCO connection request
+#define AUDIO_BENCH_AG_SCO_UP_US    10000   // Accept to SCO connected
+#define AUDIO_BENCH_AG_AVDT_US      20000   // AVDTP start to start confirm
+
+static const wiced_bt_device_address_t audio_bench_ag = { 0x00, 0x1b, 0xdc, 0x0f, 0x10, 0x01 };
+
+/* Let the application run what the event queued, then drop what it sent the host */
+static void audio_bench_settle( uint64_t us )
+{
+    uint8_t drain[1024];
+
+    wiced_stub_advance_us( us );
+    while ( wiced_stub_run_pending( ) )
+        ;
+    while ( loopback_read( drain, sizeof( drain ) ) )
+        ;
+}
+
+static void audio_bench_a2dp( wiced_bt_a2dp_sink_event_t event, wiced_bt_a2dp_sink_event_data_t *p_data )
+{
+    wiced_stub_a2dp_event( event, p_data );
+    audio_bench_settle( 0 );
+}
+
+static void audio_bench_music_connect( void )
+{
+    wiced_bt_a2dp_sink_event_data_t data;
+
+    memset( &data, 0, sizeof( data ) );
+    data.connect.result = WICED_SUCCESS;
+    data.connect.handle = AUDIO_BENCH_A2DP_HANDLE;
+    memcpy( data.connect.bd_addr, audio_bench_ag, BD_ADDR_LEN );
+    audio_bench_a2dp( WICED_BT_A2DP_SINK_CONNECT_EVT, &data );
+
+    memset( &data, 0, sizeof( data ) );
+    data.codec_config.handle = AUDIO_BENCH_A2DP_HANDLE;
+    data.codec_config.codec.cie.sbc.samp_freq = A2D_SBC_IE_SAMP_FREQ_44;
+    audio_bench_a2dp( WICED_BT_A2DP_SINK_CODEC_CONFIG_EVT, &data );
+}
+
+static void audio_bench_music_start( void )
+{
+    wiced_bt_a2dp_sink_event_data_t data;
+
+    memset( &data, 0, sizeof( data ) );
+    data.start_ind.handle = AUDIO_BENCH_A2DP_HANDLE;
+    audio_bench_a2dp( WICED_BT_A2DP_SINK_START_IND_EVT, &data );
+}
+
+static void audio_bench_hfp( wiced_bt_hfp_hf_event_t event, wiced_bt_hfp_hf_event_data_t *p_data )
+{
+    p_data->handle = AUDIO_BENCH_HANDLE;
+    wiced_stub_hfp_event( event, p_data );
+    audio_bench_settle( 1000 );
+}
+
+static void audio_bench_call_state( int active, wiced_bt_hfp_hf_callsetup_state_t setup )
+{
+    wiced_bt_hfp_hf_event_data_t data;
+
+    memset( &data, 0, sizeof( data ) );
+    data.call_data.active_call_present = active;
+    data.call_data.setup_state         = setup;
+    audio_bench_hfp( WICED_BT_HFP_HF_CALL_SETUP_EVT, &data );
+}
+
+static void audio_bench_volume( int type, uint8_t level )
+{
+    wiced_bt_hfp_hf_event_data_t data;
+
+    memset( &data, 0, sizeof( data ) );
+    data.volume.type  = type;
+    data.volume.level = level;
+    audio_bench_hfp( WICED_BT_HFP_HF_VOLUME_CHANGE_EVT, &data );
+}
+
+static void audio_bench_sco( wiced_bt_management_evt_t event, uint16_t sco_index )
+{
+    wiced_bt_management_evt_data_t data;
+
+    memset( &data, 0, sizeof( data ) );
+    data.sco_connected.sco_index = sco_index;
+    wiced_stub_management_event( event, &data );
+    audio_bench_settle( 1000 );
+}
+
+/* HCI_CONTROL_HF_AT_COMMAND_SPK frames from the host, delivered before the app runs */
+static void audio_bench_host_slider( uint8_t first_level )
+{
+    uint8_t frame[1 + 4 + 4];
+    int     i;
+
+    for ( i = 0; i < AUDIO_BENCH_SLIDER_STEPS; i++ )
+    {
+        frame[0] = 0x19;
+        frame[1] = ( HCI_CONTROL_HF_AT_COMMAND_BASE + HCI_CONTROL_HF_AT_COMMAND_SPK ) & 0xff;
+        frame[2] = ( HCI_CONTROL_HF_AT_COMMAND_BASE + HCI_CONTROL_HF_AT_COMMAND_SPK ) >> 8;
+        frame[3] = 4;
+        frame[4] = 0;
+        frame[5] = AUDIO_BENCH_HANDLE & 0xff;
+        frame[6] = AUDIO_BENCH_HANDLE >> 8;
+        frame[7] = ( first_level + i ) % ( BT_AUDIO_HFP_VOLUME_MAX + 1 );
+        frame[8] = 0;
+        loopback_command( frame, sizeof( frame ) );
+    }
+    audio_bench_settle( 1000 );
+}
+
+static void audio_bench_connect( void )
+{
+    wiced_bt_hfp_hf_event_data_t data;
+
+    wiced_stub_hfp_add_scb( AUDIO_BENCH_HANDLE, audio_bench_ag, WICED_BT_HFP_AG_FEATURE_CODEC_NEGOTIATION );
+
+    memset( &data, 0, sizeof( data ) );
+    data.conn_data.conn_state        = WICED_BT_HFP_HF_STATE_CONNECTED;
+    data.conn_data.connected_profile = WICED_BT_HFP_PROFILE;
+    memcpy( data.conn_data.remote_address, audio_bench_ag, BD_ADDR_LEN );
+    audio_bench_hfp( WICED_BT_HFP_HF_CONNECTION_STATE_EVT, &data );
+
+    memset( &data, 0, sizeof( data ) );
+    data.ag_feature_flags = WICED_BT_HFP_AG_FEATURE_CODEC_NEGOTIATION;
+    audio_bench_hfp( WICED_BT_HFP_HF_AG_FEATURE_SUPPORT_EVT, &data );
+
+    memset( &data, 0, sizeof( data ) );
+    data.conn_data.conn_state = WICED_BT_HFP_HF_STATE_SLC_CONNECTED;
+    memcpy( data.conn_data.remote_address, audio_bench_ag, BD_ADDR_LEN );
+    audio_bench_hfp( WICED_BT_HFP_HF_CONNECTION_STATE_EVT, &data );
+}
+
+/* Calls with in-band ringing that interrupt music, see the file comment */
+static void audio_bench_switch( int calls )
+{
+    const wiced_stub_codec_stats_t *p_codec = wiced_stub_codec_stats( );
+    wiced_bt_hfp_hf_event_data_t    data;
+    wiced_bt_a2dp_sink_event_data_t a2dp;
+    wiced_bt_management_evt_data_t  sco;
+    uint64_t                        ring_us, sco_up_us, sco_down_us;
+    uint64_t                        ring_gap = 0, music_gap = 0, sco_gap = 0, resume_gap = 0, resume_max = 0;
+    int                             call;
+
+    memset( &sco, 0, sizeof( sco ) );
+    audio_bench_music_connect( );
+
+    for ( call = 0; call < calls; call++ )
+    {
+        audio_bench_music_start( );
+        audio_bench_settle( 100000 );
+
+        ring_us = clock_SystemTimeMicroseconds64( );
+        memset( &data, 0, sizeof( data ) );
+        data.handle = AUDIO_BENCH_HANDLE;
+        wiced_stub_hfp_event( WICED_BT_HFP_HF_RING_EVT, &data );
+        audio_bench_settle( 0 );
+        data.call_data.setup_state = WICED_BT_HFP_HF_CALLSETUP_STATE_INCOMING;
+        wiced_stub_hfp_event( WICED_BT_HFP_HF_CALL_SETUP_EVT, &data );
+        audio_bench_settle( AUDIO_BENCH_AG_BCS_US );
+
+        memset( &data, 0, sizeof( data ) );
+        data.handle         = AUDIO_BENCH_HANDLE;
+        data.selected_codec = WICED_BT_HFP_HF_MSBC_CODEC;
+        wiced_stub_hfp_event( WICED_BT_HFP_HFP_CODEC_SET_EVT, &data );
+        audio_bench_settle( AUDIO_BENCH_AG_SCO_REQ_US );
+
+        wiced_stub_management_event( BTM_SCO_CONNECTION_REQUEST_EVT, &sco );
+        audio_bench_settle( AUDIO_BENCH_AG_SCO_UP_US );
+        sco_up_us = clock_SystemTimeMicroseconds64( );
+        wiced_stub_management_event( BTM_SCO_CONNECTED_EVT, &sco );
+        audio_bench_settle( 0 );
+
+        ring_gap  += p_codec->started_us[HFP] - ring_us;
+        music_gap += p_codec->started_us[HFP] - p_codec->stopped_us[A2DP_SINK];
+        sco_gap   += p_codec->started_us[HFP] - sco_up_us;
+
+        audio_bench_call_state( 1, WICED_BT_HFP_HF_CALLSETUP_STATE_IDLE );
+        audio_bench_settle( 1000000 );
+        audio_bench_call_state( 0, WICED_BT_HFP_HF_CALLSETUP_STATE_IDLE );
+
+        /* Music is asked to restart on SCO down, the AG confirms */
+        sco_down_us = clock_SystemTimeMicroseconds64( );
+        wiced_stub_management_event( BTM_SCO_DISCONNECTED_EVT, &sco );
+        audio_bench_settle( AUDIO_BENCH_AG_AVDT_US );
+        memset( &a2dp, 0, sizeof( a2dp ) );
+        a2dp.start_cfm.handle = AUDIO_BENCH_A2DP_HANDLE;
+        a2dp.start_cfm.result = WICED_SUCCESS;
+        audio_bench_a2dp( WICED_BT_A2DP_SINK_START_CFM_EVT, &a2dp );
+
+        resume_gap += p_codec->started_us[A2DP_SINK] - sco_down_us;
+        if ( p_codec->started_us[A2DP_SINK] - sco_down_us > resume_max )
+            resume_max = p_codec->started_us[A2DP_SINK] - sco_down_us;
+        audio_bench_settle( 1000000 );
+    }
+
+    printf( "%-20s %6d calls  RING to call audio %6.2f ms, music stop to call audio %6.2f ms, "
+            "SCO up to call audio %5.2f ms, SCO down to music %6.2f ms (max %.2f)\n",
+            HANDSFREE_AUDIO_SHADOW ? "cached, batched" : "direct", calls,
+            ring_gap / 1000.0 / calls, music_gap / 1000.0 / calls, sco_gap / 1000.0 / calls,
+            resume_gap / 1000.0 / calls, resume_max / 1000.0 );
+}
+
+int main( int argc, char *argv[] )
+{
+    wiced_bool_t                    switch_gaps = ( argc > 1 ) && ( strcmp( argv[1], "-s" ) == 0 );
+    int                             calls = ( argc > 1 + switch_gaps ) ? atoi( argv[1 + switch_gaps] ) : 100;
+    wiced_stub_t                   *p_stub = wiced_stub_new( WICED_TRUE );
+    const wiced_stub_codec_stats_t *p_codec;
+    wiced_stub_codec_stats_t        start, before_sco;
+    wiced_bt_hfp_hf_event_data_t    data;
+    uint64_t                        sco_path_us = 0;
+    uint32_t                        sco_path_writes = 0;
+    int                             call;
+
+    wiced_stub_select( p_stub );
+    application_start( );
+    audio_bench_settle( 1000000 );
+    audio_bench_connect( );
+
+    if ( switch_gaps )
+    {
+        audio_bench_switch( calls );
+        return 0;
+    }
+
+    p_codec = wiced_stub_codec_stats( );
+    start   = *p_codec;
+
+    for ( call = 0; call < calls; call++ )
+    {
+        memset( &data, 0, sizeof( data ) );
+        audio_bench_hfp( WICED_BT_HFP_HF_RING_EVT, &data );
+        audio_bench_call_state( 0, WICED_BT_HFP_HF_CALLSETUP_STATE_INCOMING );
+
+        memset( &data, 0, sizeof( data ) );
+        data.selected_codec = WICED_BT_HFP_HF_MSBC_CODEC;
+        audio_bench_hfp( WICED_BT_HFP_HFP_CODEC_SET_EVT, &data );
+
+        audio_bench_sco( BTM_SCO_CONNECTION_REQUEST_EVT, 0 );
+        before_sco = *p_codec;
+        audio_bench_sco( BTM_SCO_CONNECTED_EVT, 0 );
+        sco_path_us     += p_codec->bus_us - before_sco.bus_us;
+        sco_path_writes += p_codec->reg_writes - before_sco.reg_writes;
+
+        audio_bench_call_state( 1, WICED_BT_HFP_HF_CALLSETUP_STATE_IDLE );
+        audio_bench_volume( WICED_BT_HFP_HF_SPEAKER, BT_AUDIO_HFP_VOLUME_DEFAULT );
+        audio_bench_host_slider( call % ( BT_AUDIO_HFP_VOLUME_MAX + 1 ) );
+        audio_bench_volume( WICED_BT_HFP_HF_MIC, ( call + 3 ) % ( BT_AUDIO_HFP_VOLUME_MAX + 1 ) );
+
+        audio_bench_call_state( 0, WICED_BT_HFP_HF_CALLSETUP_STATE_IDLE );
+        audio_bench_sco( BTM_SCO_DISCONNECTED_EVT, 0 );
+        audio_bench_settle( 100000 );
+    }
+
+    printf( "%-20s %6d calls  per call: %5.1f set_param %6.1f reg writes %7.2f ms bus, SCO connect path %5.1f writes %6.2f ms\n",
+            HANDSFREE_AUDIO_SHADOW ? "cached, batched" : "direct", calls,
+            (double)( p_codec->set_params - start.set_params ) / calls, (double)( p_codec->reg_writes - start.reg_writes ) / calls,
+            ( p_codec->bus_us - start.bus_us ) / 1000.0 / calls, (double)sco_path_writes / calls, sco_path_us / 1000.0 / calls );
+    return 0;
+}
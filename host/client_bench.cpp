@@ -0,0 +1,227 @@
+/*
+ * Copyright 2016-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+
+/** @file
+ *
+ * Sustained command rate of the WICED HCI, measured with handsfree_client.hpp against
+ * the application linked in through loopback_transport.c. No UART or pty is involved,
+ * so the figures are the cost of framing, dispatch and command handling on both ends:
+ *  - GET_VERSION round trips in protocol v1 and v2, one and eight commands in flight.
+ *  - NVRAM_RESTORE of the records of a device, 2112 bytes sent as fragments, completing
+ *    on the FRAGMENT_ACK COMPLETE of each transfer. Restores the device did not store
+ *    count as failed.
+ *
+ * Usage: client_bench [commands]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <vector>
+
+#include "handsfree_client.hpp"
+#include "loopback_transport.h"
+#include "wiced_stub.h"
+
+extern "C" void application_start( void );
+
+using namespace handsfree::host;
+
+namespace
+{
+
+/* Keeps the client's frames until the loop hands them over, the device never runs inside write() */
+struct loopback
+{
+    std::deque<std::vector<uint8_t>> frames;
+
+    void write( std::span<const uint8_t> f ) { frames.emplace_back( f.begin( ), f.end( ) ); }
+};
+
+loopback          transport;
+client<loopback>  host( transport );
+
+/* Runs device and client until neither has anything left to do */
+void pump( )
+{
+    uint8_t buf[4096];
+    bool    busy = true;
+
+    while ( busy )
+    {
+        busy = false;
+        while ( !transport.frames.empty( ) )
+        {
+            auto f = std::move( transport.frames.front( ) );
+            transport.frames.pop_front( );
+            loopback_command( f.data( ), f.size( ) );
+            busy = true;
+        }
+        if ( wiced_stub_run_pending( ) )
+            busy = true;
+        while ( size_t n = loopback_read( buf, sizeof( buf ) ) )
+        {
+            host.feed( std::span<const uint8_t>( buf, n ) );
+            busy = true;
+        }
+        host.poll( );
+    }
+}
+
+struct run
+{
+    int  left;
+    int  failed = 0;
+    int  active = 0;
+};
+
+detached_task get_versions( run &r )
+{
+    r.active++;
+    while ( r.left > 0 )
+    {
+        r.left--;
+        command_result result = co_await host.get_version( );
+        if ( !result.ok )
+            r.failed++;
+    }
+    r.active--;
+}
+
+int restores_not_stored;
+
+detached_task restore_records( run &r, const std::vector<uint8_t> &records )
+{
+    r.active++;
+    while ( r.left > 0 )
+    {
+        r.left--;
+        command_result result = co_await host.nvram_restore( records );
+        if ( !result.ok )
+            r.failed++;
+    }
+    r.active--;
+}
+
+detached_task set_protocol( uint8_t version, bool &ok )
+{
+    command_result result = co_await host.set_protocol( version, 8 );
+    ok = result.ok;
+}
+
+bool set_protocol( uint8_t version )
+{
+    bool ok = false;
+
+    set_protocol( version, ok );
+    pump( );
+    return ok && host.v2( ) == ( version == 2 );
+}
+
+template <typename Task>
+void measure( const char *name, int commands, int in_flight, completion kind, Task task )
+{
+    run  r{ commands };
+    auto start = std::chrono::steady_clock::now( );
+
+    host.reset_latency( );
+    for ( int i = 0; i < in_flight; i++ )
+        task( r );
+    pump( );
+
+    double secs = std::chrono::duration<double>( std::chrono::steady_clock::now( ) - start ).count( );
+    auto  &lat  = host.latency( kind );
+    auto   max  = std::chrono::duration_cast<std::chrono::microseconds>( lat.max( ) );
+
+    /* percentile() is a histogram bucket bound, it may lie above the largest sample */
+    printf( "%-28s %3d %10.0f %8.2f %8lld %8lld %6d%s\n", name, in_flight, commands / secs,
+            lat.mean( ).count( ) / 1000.0, (long long)std::min( lat.percentile( 99 ), max ).count( ),
+            (long long)max.count( ), r.failed, r.active ? "  stalled" : "" );
+}
+
+} // namespace
+
+int main( int argc, char *argv[] )
+{
+    int                  commands = ( argc > 1 ) ? atoi( argv[1] ) : 20000;
+    std::vector<uint8_t> records, data( 512 );
+
+    /* Typed records filling the record slabs of handsfree_nvram.c, 2112 bytes */
+    for ( size_t i = 0; i < data.size( ); i++ )
+        data[i] = uint8_t( i );
+    for ( uint16_t i = 0; i < 2; i++ )
+        host.add_nvram_record( records, 0x0300 + i, data );
+    for ( uint16_t i = 0; i < 6; i++ )
+        host.add_nvram_record( records, 0x0310 + i, std::span<const uint8_t>( data ).first( 128 ) );
+    for ( uint16_t i = 0; i < 8; i++ )
+        host.add_nvram_record( records, 0x0320 + i, std::span<const uint8_t>( data ).first( 32 ) );
+
+    host.on_event( []( const event_t &ev )
+    {
+        if ( auto *e = std::get_if<event::nvram_restore>( &ev ); e && e->status != HCI_CONTROL_RESTORE_STATUS_SUCCESS )
+            restores_not_stored++;
+    } );
+
+    application_start( );
+    pump( );
+
+    printf( "%-28s %3s %10s %8s %8s %8s %6s\n", "test", "n", "cmd/s", "mean us", "p99 us", "max us", "failed" );
+
+    for ( uint8_t version : { 1, 2 } )
+    {
+        if ( !set_protocol( version ) )
+        {
+            printf( "SET_PROTOCOL %u failed\n", version );
+            return 1;
+        }
+
+        host.set_max_payload( max_packet_payload );
+        for ( int in_flight : { 1, 8 } )
+            measure( version == 1 ? "v1 get_version" : "v2 get_version", commands, in_flight, completion::version,
+                     []( run &r ) { get_versions( r ); } );
+
+        restores_not_stored = 0;
+        measure( version == 1 ? "v1 nvram_restore 2112" : "v2 nvram_restore 2112", commands / 8, 1,
+                 completion::fragments, [&records]( run &r ) { restore_records( r, records ); } );
+        if ( restores_not_stored )
+            printf( "%d restores not stored\n", restores_not_stored );
+    }
+
+    if ( host.v2_retransmits( ) || host.v2_bad_frames( ) )
+        printf( "v2 retransmits %llu, bad frames %llu\n", (unsigned long long)host.v2_retransmits( ),
+                (unsigned long long)host.v2_bad_frames( ) );
+    return 0;
+}
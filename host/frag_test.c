@@ -0,0 +1,249 @@
+/*
+ * Copyright 2016-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+
+
+/** @file
+ *
+ * Test of the reassembly of fragmented host commands, handsfree_hci_frag.c.
+ *
+ * An NVRAM_RESTORE of 2112 bytes, twice TRANS_UART_BUFFER_SIZE, is sent in fragments
+ * and every record is read back and compared. A fragment out of order must be naked
+ * with the offset to resume from, a transfer above HCI_FRAG_MAX_LEN rejected, and no
+ * buffer may be left behind.
+ *
+ * Usage: frag_test
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "wiced_stub.h"
+#include "handsfree.h"
+#include "loopback_transport.h"
+
+extern void application_start( void );
+
+#define FRAG_TEST_CHUNK             512     /* Fragment data per packet */
+#define FRAG_TEST_RECORDS           16
+#define FRAG_TEST_RESTORE_LEN       ( 2 * ( 4 + 512 ) + 6 * ( 4 + 128 ) + 8 * ( 4 + 32 ) )
+
+typedef char frag_test_size_check[ ( FRAG_TEST_RESTORE_LEN > TRANS_UART_BUFFER_SIZE ) ? 1 : -1 ];
+
+static uint8_t  frag_test_restore[FRAG_TEST_RESTORE_LEN];
+static uint16_t frag_test_ids[FRAG_TEST_RECORDS];
+static uint16_t frag_test_lens[FRAG_TEST_RECORDS];
+static uint8_t  frag_test_events[4096];
+static size_t   frag_test_event_len;
+static int      frag_test_failed;
+
+#define FRAG_TEST_CHECK( cond ) \
+    do { if ( !( cond ) ) { printf( "line %d: %s\n", __LINE__, #cond ); frag_test_failed++; } } while ( 0 )
+
+/* Typed records filling the record slabs of handsfree_nvram.c */
+static void frag_test_build( void )
+{
+    static const uint16_t lens[] = { 512, 512, 128, 128, 128, 128, 128, 128, 32, 32, 32, 32, 32, 32, 32, 32 };
+    uint8_t *p = frag_test_restore;
+    int      i, j;
+
+    for ( i = 0; i < FRAG_TEST_RECORDS; i++ )
+    {
+        frag_test_ids[i]  = HANDSFREE_RECORD_ID( 0x03, i );
+        frag_test_lens[i] = lens[i];
+        *p++ = frag_test_ids[i] & 0xff;
+        *p++ = frag_test_ids[i] >> 8;
+        *p++ = lens[i] & 0xff;
+        *p++ = lens[i] >> 8;
+        for ( j = 0; j < lens[i]; j++ )
+            *p++ = (uint8_t)( i * 37 + j );
+    }
+}
+
+static void frag_test_send( uint8_t xfer_id, uint16_t opcode, uint16_t total_len, uint16_t offset,
+                            const uint8_t *p_data, uint16_t len )
+{
+    uint8_t  frame[5 + 7 + FRAG_TEST_CHUNK];
+    uint16_t payload_len = 7 + len;
+
+    frame[0]  = 0x19;
+    frame[1]  = HCI_CONTROL_MISC_COMMAND_FRAGMENT & 0xff;
+    frame[2]  = HCI_CONTROL_MISC_COMMAND_FRAGMENT >> 8;
+    frame[3]  = payload_len & 0xff;
+    frame[4]  = payload_len >> 8;
+    frame[5]  = xfer_id;
+    frame[6]  = opcode & 0xff;
+    frame[7]  = opcode >> 8;
+    frame[8]  = total_len & 0xff;
+    frame[9]  = total_len >> 8;
+    frame[10] = offset & 0xff;
+    frame[11] = offset >> 8;
+    memcpy( &frame[12], p_data, len );
+    loopback_command( frame, 5 + payload_len );
+
+    while ( wiced_stub_run_pending( ) )
+        ;
+    frag_test_event_len += loopback_read( frag_test_events + frag_test_event_len,
+                                          sizeof( frag_test_events ) - frag_test_event_len );
+}
+
+/* Takes the first event with opcode out of those received, its payload goes to p_payload */
+static wiced_bool_t frag_test_event( uint16_t opcode, uint8_t *p_payload, size_t len )
+{
+    size_t   pos = 0, frame_len;
+    uint16_t code, payload_len;
+
+    while ( pos + 5 <= frag_test_event_len )
+    {
+        code        = frag_test_events[pos + 1] | ( frag_test_events[pos + 2] << 8 );
+        payload_len = frag_test_events[pos + 3] | ( frag_test_events[pos + 4] << 8 );
+        frame_len   = 5 + payload_len;
+        if ( code == opcode )
+        {
+            memcpy( p_payload, &frag_test_events[pos + 5], ( payload_len < len ) ? payload_len : len );
+            memmove( &frag_test_events[pos], &frag_test_events[pos + frame_len], frag_test_event_len - pos - frame_len );
+            frag_test_event_len -= frame_len;
+            return WICED_TRUE;
+        }
+        pos += frame_len;
+    }
+    return WICED_FALSE;
+}
+
+static wiced_bool_t frag_test_ack( uint8_t xfer_id, uint16_t next_offset, uint8_t status )
+{
+    uint8_t ack[4];
+
+    return frag_test_event( HCI_CONTROL_MISC_EVENT_FRAGMENT_ACK, ack, sizeof( ack ) ) && ( ack[0] == xfer_id ) &&
+           ( ( ack[1] | ( ack[2] << 8 ) ) == next_offset ) && ( ack[3] == status );
+}
+
+/* The restore in order, window acks every four fragments */
+static void frag_test_restore_in_order( void )
+{
+    uint8_t  record[HANDSFREE_RECORD_MAX_LEN], result[2];
+    const uint8_t *p = frag_test_restore;
+    uint16_t offset, len;
+    int      i, fragments = 0;
+
+    for ( offset = 0; offset < FRAG_TEST_RESTORE_LEN; offset += len )
+    {
+        len = ( FRAG_TEST_RESTORE_LEN - offset < FRAG_TEST_CHUNK ) ? FRAG_TEST_RESTORE_LEN - offset : FRAG_TEST_CHUNK;
+        frag_test_send( 1, HCI_CONTROL_MISC_COMMAND_NVRAM_RESTORE, FRAG_TEST_RESTORE_LEN, offset, &frag_test_restore[offset], len );
+        if ( ( ++fragments % 4 == 0 ) && ( offset + len < FRAG_TEST_RESTORE_LEN ) )
+            FRAG_TEST_CHECK( frag_test_ack( 1, offset + len, HCI_CONTROL_FRAG_STATUS_SUCCESS ) );
+    }
+    FRAG_TEST_CHECK( frag_test_ack( 1, FRAG_TEST_RESTORE_LEN, HCI_CONTROL_FRAG_STATUS_COMPLETE ) );
+    FRAG_TEST_CHECK( frag_test_event( HCI_CONTROL_MISC_EVENT_NVRAM_RESTORE, result, sizeof( result ) ) );
+    FRAG_TEST_CHECK( ( result[0] == FRAG_TEST_RECORDS ) && ( result[1] == HCI_CONTROL_RESTORE_STATUS_SUCCESS ) );
+
+    for ( i = 0; i < FRAG_TEST_RECORDS; i++ )
+    {
+        p += 4;
+        FRAG_TEST_CHECK( hci_control_read_nvram( frag_test_ids[i], record, sizeof( record ) ) == frag_test_lens[i] );
+        FRAG_TEST_CHECK( memcmp( record, p, frag_test_lens[i] ) == 0 );
+        p += frag_test_lens[i];
+    }
+}
+
+/* A lost fragment is naked once, the host resumes from next_offset */
+static void frag_test_out_of_order( void )
+{
+    uint8_t  result[2];
+    uint16_t offset;
+
+    frag_test_send( 2, HCI_CONTROL_MISC_COMMAND_NVRAM_RESTORE, FRAG_TEST_RESTORE_LEN, 0, frag_test_restore, FRAG_TEST_CHUNK );
+    for ( offset = 2 * FRAG_TEST_CHUNK; offset <= 3 * FRAG_TEST_CHUNK; offset += FRAG_TEST_CHUNK )
+        frag_test_send( 2, HCI_CONTROL_MISC_COMMAND_NVRAM_RESTORE, FRAG_TEST_RESTORE_LEN, offset,
+                        &frag_test_restore[offset], FRAG_TEST_CHUNK );
+    FRAG_TEST_CHECK( frag_test_ack( 2, FRAG_TEST_CHUNK, HCI_CONTROL_FRAG_STATUS_OUT_OF_ORDER ) );
+    FRAG_TEST_CHECK( frag_test_event_len == 0 );
+
+    for ( offset = FRAG_TEST_CHUNK; offset < 4 * FRAG_TEST_CHUNK; offset += FRAG_TEST_CHUNK )
+        frag_test_send( 2, HCI_CONTROL_MISC_COMMAND_NVRAM_RESTORE, FRAG_TEST_RESTORE_LEN, offset,
+                        &frag_test_restore[offset], FRAG_TEST_CHUNK );
+    frag_test_send( 2, HCI_CONTROL_MISC_COMMAND_NVRAM_RESTORE, FRAG_TEST_RESTORE_LEN, offset,
+                    &frag_test_restore[offset], FRAG_TEST_RESTORE_LEN - offset );
+    FRAG_TEST_CHECK( frag_test_ack( 2, FRAG_TEST_RESTORE_LEN, HCI_CONTROL_FRAG_STATUS_COMPLETE ) );
+    FRAG_TEST_CHECK( frag_test_event( HCI_CONTROL_MISC_EVENT_NVRAM_RESTORE, result, sizeof( result ) ) );
+    FRAG_TEST_CHECK( ( result[0] == FRAG_TEST_RECORDS ) && ( result[1] == HCI_CONTROL_RESTORE_STATUS_SUCCESS ) );
+}
+
+/* The first record and 100 bytes of the 512 the second declares, only the first is stored */
+static void frag_test_truncated( void )
+{
+    uint8_t  result[2];
+    uint16_t total_len = 4 + 512 + 4 + 100;
+
+    frag_test_send( 3, HCI_CONTROL_MISC_COMMAND_NVRAM_RESTORE, total_len, 0, frag_test_restore, FRAG_TEST_CHUNK );
+    frag_test_send( 3, HCI_CONTROL_MISC_COMMAND_NVRAM_RESTORE, total_len, FRAG_TEST_CHUNK,
+                    &frag_test_restore[FRAG_TEST_CHUNK], total_len - FRAG_TEST_CHUNK );
+    FRAG_TEST_CHECK( frag_test_ack( 3, total_len, HCI_CONTROL_FRAG_STATUS_COMPLETE ) );
+    FRAG_TEST_CHECK( frag_test_event( HCI_CONTROL_MISC_EVENT_NVRAM_RESTORE, result, sizeof( result ) ) );
+    FRAG_TEST_CHECK( ( result[0] == 1 ) && ( result[1] == HCI_CONTROL_RESTORE_STATUS_MALFORMED ) );
+}
+
+static void frag_test_too_large( void )
+{
+    frag_test_send( 4, HCI_CONTROL_MISC_COMMAND_NVRAM_RESTORE, HCI_FRAG_MAX_LEN + 1, 0, frag_test_restore, FRAG_TEST_CHUNK );
+    FRAG_TEST_CHECK( frag_test_ack( 4, 0, HCI_CONTROL_FRAG_STATUS_TOO_LARGE ) );
+    frag_test_send( 4, HCI_CONTROL_MISC_COMMAND_NVRAM_RESTORE, HCI_FRAG_MAX_LEN + 1, FRAG_TEST_CHUNK,
+                    frag_test_restore, FRAG_TEST_CHUNK );
+    FRAG_TEST_CHECK( frag_test_ack( 4, 0, HCI_CONTROL_FRAG_STATUS_UNKNOWN_XFER ) );
+}
+
+int main( int argc, char *argv[] )
+{
+    uint32_t buffers;
+
+    application_start( );
+    while ( wiced_stub_run_pending( ) )
+        ;
+    while ( loopback_read( frag_test_events, sizeof( frag_test_events ) ) )
+        ;
+
+    frag_test_build( );
+    frag_test_restore_in_order( );
+
+    /* The records now hold their buffers, anything else must have been released */
+    buffers = wiced_stub_buffers_in_use( );
+    frag_test_out_of_order( );
+    frag_test_truncated( );
+    frag_test_too_large( );
+    FRAG_TEST_CHECK( wiced_stub_buffers_in_use( ) == buffers );
+    FRAG_TEST_CHECK( frag_test_event_len == 0 );
+
+    if ( frag_test_failed )
+        printf( "%d fragment checks failed\n", frag_test_failed );
+    return frag_test_failed ? 1 : 0;
+}
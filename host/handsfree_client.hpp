@@ -0,0 +1,1095 @@
+/*
+ * Copyright 2016-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+/** @file
+ *
+ * Header-only C++20 host client for the handsfree application.
+ *
+ * Covers the DEVICE, HF and MISC groups of the WICED HCI protocol as implemented in
+ * handsfree_wiced_hci.c and hci_control_send_hf_event():
+ *  - frame_parser splits the 0x19/opcode/length byte stream into frames, without
+ *    copying when a frame is contiguous in the input.
+ *  - decode_event() turns a frame into a typed event whose variable length fields are
+ *    views into the frame.
+ *  - client sends commands as co_await-able operations that complete on the matching
+ *    COMMAND_STATUS, AT response (OK/ERROR/+CME ERROR), HF OPEN or VERSION event, and
+ *    keeps latency statistics per completion kind.
+ *  - After set_protocol( 2 ) the client speaks protocol v2 (handsfree_hci_v2.c): commands
+ *    go out in V2 frames within the window, events are checked, acked and delivered in
+ *    order. Call poll() periodically so that unacked frames are resent.
+ *  - Commands longer than set_max_payload() are sent as MISC FRAGMENT packets
+ *    (handsfree_hci_frag.c), in v1 or inside V2 frames.
+ *
+ * The client is not thread safe: feed(), poll() and the command calls must run on one
+ * thread, typically the I/O loop reading the transport. Completions are matched in FIFO
+ * order per kind (per handle for AT commands), as the firmware answers in order.
+ *
+ * Build the host with the SDK include directory on the include path for
+ * hci_control_api.h, and the application directory for handsfree_hci_api.h.
+ */
+
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <coroutine>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <exception>
+#include <variant>
+#include <vector>
+
+#include "handsfree_hci_api.h"
+
+namespace handsfree::host
+{
+
+constexpr uint8_t  packet_type_wiced = 0x19;
+constexpr size_t   frame_header_len  = 5;          // type(1) opcode(2) length(2)
+constexpr size_t   max_packet_payload = 1020;      // TRANS_UART_BUFFER_SIZE less opcode(2) length(2)
+
+using bd_addr = std::array<uint8_t, 6>;             // Most significant byte first, as displayed
+
+/*****************************************************************************
+ * Framing
+ ****************************************************************************/
+
+struct frame_view
+{
+    uint16_t                    opcode;
+    std::span<const uint8_t>    payload;
+};
+
+/* Serialize a command into out, returns the number of bytes used */
+inline size_t encode_frame( uint16_t opcode, std::span<const uint8_t> payload, std::span<uint8_t> out )
+{
+    if ( out.size( ) < frame_header_len + payload.size( ) || payload.size( ) > 0xFFFF )
+        return 0;
+
+    out[0] = packet_type_wiced;
+    out[1] = opcode & 0xff;
+    out[2] = opcode >> 8;
+    out[3] = payload.size( ) & 0xff;
+    out[4] = payload.size( ) >> 8;
+    if ( !payload.empty( ) )
+        std::memcpy( out.data( ) + frame_header_len, payload.data( ), payload.size( ) );
+    return frame_header_len + payload.size( );
+}
+
+/* Protocol v2 frame inside HCI_CONTROL_MISC_COMMAND/EVENT_V2_FRAME, see handsfree_hci_v2.c */
+constexpr size_t v2_header_len = 6;                 // seq(1) ack(1) opcode(2) length(2)
+constexpr size_t v2_overhead   = v2_header_len + 2; // crc16(2) at the end
+
+/* HCI_CONTROL_MISC_COMMAND_FRAGMENT header, see handsfree_hci_frag.c */
+constexpr size_t fragment_header_len = 7;           // xfer_id(1) opcode(2) total_len(2) offset(2)
+
+/* CRC-16/CCITT-FALSE, as hci_control_crc16() */
+inline uint16_t crc16( std::span<const uint8_t> data )
+{
+    uint16_t crc = 0xFFFF;
+
+    for ( uint8_t b : data )
+    {
+        crc ^= uint16_t( b << 8 );
+        for ( int i = 0; i < 8; i++ )
+            crc = ( crc & 0x8000 ) ? uint16_t( ( crc << 1 ) ^ 0x1021 ) : uint16_t( crc << 1 );
+    }
+    return crc;
+}
+
+/* Trailer of events sent while HCI_CONTROL_MISC_COMMAND_SET_TIMESTAMPS is on */
+constexpr size_t event_timestamp_len = 6;       // timestamp_us(4) seq(2)
+
+struct event_timestamp
+{
+    uint32_t    device_us;                      // Low 32 bits of the device microsecond clock
+    uint16_t    seq;
+};
+
+/* Remove the trailer from the payload of f, false if the payload is too short to have one */
+inline bool strip_timestamp( frame_view &f, event_timestamp &ts )
+{
+    if ( f.payload.size( ) < event_timestamp_len )
+        return false;
+
+    const uint8_t *p = f.payload.data( ) + f.payload.size( ) - event_timestamp_len;
+    ts.device_us = uint32_t( p[0] ) | ( uint32_t( p[1] ) << 8 ) | ( uint32_t( p[2] ) << 16 ) | ( uint32_t( p[3] ) << 24 );
+    ts.seq       = uint16_t( p[4] | ( p[5] << 8 ) );
+    f.payload    = f.payload.first( f.payload.size( ) - event_timestamp_len );
+    return true;
+}
+
+/*
+ * Incremental parser of the byte stream coming from the device. Frames that are
+ * complete inside one feed() chunk are reported as views into that chunk, only frames
+ * split across chunks are assembled in an internal buffer.
+ */
+class frame_parser
+{
+public:
+    template <typename OnFrame>
+    void feed( std::span<const uint8_t> data, OnFrame &&on_frame )
+    {
+        while ( !data.empty( ) )
+        {
+            if ( m_partial.empty( ) )
+            {
+                /* Resynchronize on the packet type */
+                if ( data[0] != packet_type_wiced )
+                {
+                    data = data.subspan( 1 );
+                    continue;
+                }
+                if ( data.size( ) >= frame_header_len )
+                {
+                    size_t len = data[3] | ( data[4] << 8 );
+                    if ( data.size( ) >= frame_header_len + len )
+                    {
+                        on_frame( frame_view{ uint16_t( data[1] | ( data[2] << 8 ) ),
+                                              data.subspan( frame_header_len, len ) } );
+                        data = data.subspan( frame_header_len + len );
+                        continue;
+                    }
+                }
+            }
+
+            /* Frame continues beyond this chunk */
+            size_t need = frame_header_len;
+            if ( m_partial.size( ) >= frame_header_len )
+                need += m_partial[3] | ( m_partial[4] << 8 );
+            else if ( m_partial.size( ) + data.size( ) >= frame_header_len )
+            {
+                std::array<uint8_t, frame_header_len> hdr{};
+                size_t have = m_partial.size( );
+                std::memcpy( hdr.data( ), m_partial.data( ), have );
+                std::memcpy( hdr.data( ) + have, data.data( ), frame_header_len - have );
+                need += hdr[3] | ( hdr[4] << 8 );
+            }
+
+            size_t take = std::min( data.size( ), need - m_partial.size( ) );
+            m_partial.insert( m_partial.end( ), data.begin( ), data.begin( ) + take );
+            data = data.subspan( take );
+
+            if ( m_partial.size( ) == need && need >= frame_header_len &&
+                 need == frame_header_len + ( m_partial[3] | ( m_partial[4] << 8 ) ) )
+            {
+                on_frame( frame_view{ uint16_t( m_partial[1] | ( m_partial[2] << 8 ) ),
+                                      std::span<const uint8_t>( m_partial ).subspan( frame_header_len ) } );
+                m_partial.clear( );
+            }
+        }
+    }
+
+    void reset( ) { m_partial.clear( ); }
+
+private:
+    std::vector<uint8_t> m_partial;
+};
+
+/*****************************************************************************
+ * Typed events
+ ****************************************************************************/
+
+namespace event
+{
+    struct command_status       { uint8_t status; };
+    struct device_started       { };
+    struct nvram_data           { uint16_t nvram_id; std::span<const uint8_t> data; };
+    struct inquiry_result       { bd_addr addr; uint32_t device_class; int8_t rssi; std::span<const uint8_t> eir; };
+    struct inquiry_complete     { };
+    struct pairing_complete     { uint8_t status; bd_addr addr; };
+    struct encryption_changed   { uint8_t encrypted; bd_addr addr; };
+    struct max_paired_reached   { };
+    struct hf_open              { uint16_t handle; bd_addr addr; uint8_t status; };
+    struct hf_close             { uint16_t handle; };
+    struct hf_connected         { uint16_t handle; uint32_t peer_features; };
+    struct hf_audio_open        { uint16_t handle; };
+    struct hf_audio_close       { uint16_t handle; };
+    struct hf_profile_type      { uint16_t handle; uint8_t profile; };
+    struct hf_at                { uint16_t at_event; uint16_t handle; uint16_t num; std::string_view str; };
+    struct hf_vr_text           { uint16_t handle; uint16_t text_id; uint8_t text_type; uint8_t text_op;
+                                  uint16_t total_len; uint16_t offset; std::string_view text; };   // One piece of the text
+    struct hf_call_stats        { uint16_t handle; uint8_t codec; uint16_t packet_types; uint16_t max_latency; uint8_t retrans_effort;
+                                  uint16_t setup_ms; uint32_t duration_ms; int8_t rssi_min; int8_t rssi_avg; uint8_t rssi_samples;
+                                  uint8_t volume_changes; uint8_t reason; };
+    struct version              { uint8_t major; uint8_t minor; uint8_t rev; uint16_t build; uint32_t chip; std::span<const uint8_t> groups; };
+    struct time_sync            { uint64_t host_time; uint64_t device_time_us; };
+    struct fragment_ack         { uint8_t xfer_id; uint16_t next_offset; uint8_t status; };
+    struct nvram_restore        { uint8_t restored; uint8_t status; };
+    struct counters             { std::span<const uint8_t> values;     // value(4) each, see counter_names
+                                  size_t   size( ) const               { return values.size( ) / 4; }
+                                  uint32_t operator[]( size_t i ) const
+                                  { return uint32_t( values[4 * i] ) | ( uint32_t( values[4 * i + 1] ) << 8 ) |
+                                           ( uint32_t( values[4 * i + 2] ) << 16 ) | ( uint32_t( values[4 * i + 3] ) << 24 ); } };
+    struct unknown              { uint16_t opcode; std::span<const uint8_t> payload; };
+}
+
+using event_t = std::variant<event::command_status, event::device_started, event::nvram_data,
+                             event::inquiry_result, event::inquiry_complete, event::pairing_complete,
+                             event::encryption_changed, event::max_paired_reached,
+                             event::hf_open, event::hf_close, event::hf_connected,
+                             event::hf_audio_open, event::hf_audio_close, event::hf_profile_type,
+                             event::hf_at, event::hf_vr_text, event::hf_call_stats, event::version, event::time_sync,
+                             event::fragment_ack, event::nvram_restore, event::counters, event::unknown>;
+
+/* Names of the event::counters values, a device may report fewer or more */
+#define HANDSFREE_COUNTER_NAME( name )  #name,
+inline constexpr std::string_view counter_names[] = { HANDSFREE_COUNTER_LIST( HANDSFREE_COUNTER_NAME ) };
+#undef HANDSFREE_COUNTER_NAME
+
+namespace detail
+{
+    inline uint16_t le16( const uint8_t *p ) { return uint16_t( p[0] | ( p[1] << 8 ) ); }
+    inline uint32_t le32( const uint8_t *p ) { return uint32_t( p[0] ) | ( uint32_t( p[1] ) << 8 ) | ( uint32_t( p[2] ) << 16 ) | ( uint32_t( p[3] ) << 24 ); }
+    inline uint64_t le64( const uint8_t *p ) { return uint64_t( le32( p ) ) | ( uint64_t( le32( p + 4 ) ) << 32 ); }
+
+    /* Addresses go on the wire least significant byte first */
+    inline bd_addr wire_bdaddr( const uint8_t *p )
+    {
+        bd_addr a;
+        for ( size_t i = 0; i < a.size( ); i++ )
+            a[i] = p[a.size( ) - 1 - i];
+        return a;
+    }
+}
+
+/* Decode a frame into a typed event. Views in the event point into the frame. */
+inline event_t decode_event( const frame_view &f )
+{
+    using namespace detail;
+    const uint8_t *p   = f.payload.data( );
+    const size_t   len = f.payload.size( );
+
+    switch ( f.opcode )
+    {
+    case HCI_CONTROL_EVENT_COMMAND_STATUS:
+        if ( len >= 1 ) return event::command_status{ p[0] };
+        break;
+    case HCI_CONTROL_EVENT_DEVICE_STARTED:
+        return event::device_started{ };
+    case HCI_CONTROL_EVENT_NVRAM_DATA:
+        if ( len >= 2 ) return event::nvram_data{ le16( p ), f.payload.subspan( 2 ) };
+        break;
+    case HCI_CONTROL_EVENT_INQUIRY_RESULT:
+        if ( len >= 10 ) return event::inquiry_result{ wire_bdaddr( p ), uint32_t( p[6] | ( p[7] << 8 ) | ( p[8] << 16 ) ),
+                                                        int8_t( p[9] ), f.payload.subspan( 10 ) };
+        break;
+    case HCI_CONTROL_EVENT_INQUIRY_COMPLETE:
+        return event::inquiry_complete{ };
+    case HCI_CONTROL_EVENT_PAIRING_COMPLETE:
+        if ( len >= 7 ) return event::pairing_complete{ p[0], wire_bdaddr( p + 1 ) };
+        break;
+    case HCI_CONTROL_EVENT_ENCRYPTION_CHANGED:
+        if ( len >= 7 ) return event::encryption_changed{ p[0], wire_bdaddr( p + 1 ) };
+        break;
+    case HCI_CONTROL_EVENT_MAX_NUM_OF_PAIRED_DEVICES_REACHED:
+        return event::max_paired_reached{ };
+    case HCI_CONTROL_HF_EVENT_OPEN:
+        if ( len >= 9 ) return event::hf_open{ le16( p ), wire_bdaddr( p + 2 ), p[8] };
+        break;
+    case HCI_CONTROL_HF_EVENT_CLOSE:
+        if ( len >= 2 ) return event::hf_close{ le16( p ) };
+        break;
+    case HCI_CONTROL_HF_EVENT_CONNECTED:
+        if ( len >= 6 ) return event::hf_connected{ le16( p ), le32( p + 2 ) };
+        break;
+    case HCI_CONTROL_HF_EVENT_AUDIO_OPEN:
+        if ( len >= 2 ) return event::hf_audio_open{ le16( p ) };
+        break;
+    case HCI_CONTROL_HF_EVENT_AUDIO_CLOSE:
+        if ( len >= 2 ) return event::hf_audio_close{ le16( p ) };
+        break;
+    case HCI_CONTROL_HF_EVENT_PROFILE_TYPE:
+        if ( len >= 3 ) return event::hf_profile_type{ le16( p ), p[2] };
+        break;
+    case HCI_CONTROL_HF_EVENT_VR_TEXT:
+        if ( len >= 10 ) return event::hf_vr_text{ le16( p ), le16( p + 2 ), p[4], p[5], le16( p + 6 ), le16( p + 8 ),
+                                                    std::string_view( reinterpret_cast<const char *>( p + 10 ), len - 10 ) };
+        break;
+    case HCI_CONTROL_HF_EVENT_CALL_STATS:
+        if ( len >= 19 ) return event::hf_call_stats{ le16( p ), p[2], le16( p + 3 ), le16( p + 5 ), p[7], le16( p + 8 ), le32( p + 10 ),
+                                                       int8_t( p[14] ), int8_t( p[15] ), p[16], p[17], p[18] };
+        break;
+    case HCI_CONTROL_MISC_EVENT_VERSION:
+        if ( len >= 9 ) return event::version{ p[0], p[1], p[2], le16( p + 3 ),
+                                               uint32_t( p[5] | ( p[6] << 8 ) | ( uint32_t( p[7] ) << 24 ) ),
+                                               f.payload.subspan( 9 ) };
+        break;
+    case HCI_CONTROL_MISC_EVENT_TIME_SYNC:
+        if ( len >= 16 ) return event::time_sync{ le64( p ), le64( p + 8 ) };
+        break;
+    case HCI_CONTROL_MISC_EVENT_FRAGMENT_ACK:
+        if ( len >= 4 ) return event::fragment_ack{ p[0], le16( p + 1 ), p[3] };
+        break;
+    case HCI_CONTROL_MISC_EVENT_NVRAM_RESTORE:
+        if ( len >= 2 ) return event::nvram_restore{ p[0], p[1] };
+        break;
+    case HCI_CONTROL_MISC_EVENT_COUNTERS:
+        if ( len >= 1 && len >= 1 + 4 * size_t( p[0] ) ) return event::counters{ f.payload.subspan( 1, 4 * size_t( p[0] ) ) };
+        break;
+    default:
+        if ( f.opcode >= HCI_CONTROL_HF_AT_EVENT_BASE &&
+             f.opcode <= HCI_CONTROL_HF_AT_EVENT_BASE + HCI_CONTROL_HF_AT_EVENT_MAX && len >= 4 )
+        {
+            /* AT string is NUL terminated inside the payload */
+            const char *s   = reinterpret_cast<const char *>( p + 4 );
+            size_t      max = len - 4;
+            return event::hf_at{ uint16_t( f.opcode - HCI_CONTROL_HF_AT_EVENT_BASE ), le16( p ), le16( p + 2 ),
+                                 std::string_view( s, strnlen( s, max ) ) };
+        }
+        break;
+    }
+    return event::unknown{ f.opcode, f.payload };
+}
+
+/*****************************************************************************
+ * Latency metrics
+ ****************************************************************************/
+
+class latency_stats
+{
+public:
+    static constexpr size_t buckets = 32;           // Bucket n counts latencies in [2^n, 2^(n+1)) usec
+
+    void record( std::chrono::nanoseconds d )
+    {
+        uint64_t us = uint64_t( std::max<int64_t>( 0, std::chrono::duration_cast<std::chrono::microseconds>( d ).count( ) ) );
+        size_t   b  = 0;
+        while ( ( us >> ( b + 1 ) ) && b < buckets - 1 )
+            b++;
+
+        m_histogram[b]++;
+        m_count++;
+        m_sum += d;
+        if ( m_count == 1 || d < m_min ) m_min = d;
+        if ( d > m_max ) m_max = d;
+    }
+
+    uint64_t                 count( ) const { return m_count; }
+    std::chrono::nanoseconds min( ) const   { return m_min; }
+    std::chrono::nanoseconds max( ) const   { return m_max; }
+    std::chrono::nanoseconds mean( ) const  { return m_count ? m_sum / int64_t( m_count ) : std::chrono::nanoseconds{ 0 }; }
+
+    /* Upper bound of the histogram bucket holding the given percentile (0..100) */
+    std::chrono::microseconds percentile( double pct ) const
+    {
+        uint64_t target = uint64_t( ( pct / 100.0 ) * double( m_count ) + 0.5 );
+        uint64_t seen   = 0;
+        for ( size_t b = 0; b < buckets; b++ )
+        {
+            seen += m_histogram[b];
+            if ( seen >= target && seen )
+                return std::chrono::microseconds( uint64_t( 2 ) << b );
+        }
+        return std::chrono::microseconds( 0 );
+    }
+
+    void reset( ) { *this = latency_stats{ }; }
+
+private:
+    std::array<uint64_t, buckets> m_histogram{ };
+    uint64_t                      m_count = 0;
+    std::chrono::nanoseconds      m_sum{ 0 };
+    std::chrono::nanoseconds      m_min{ 0 };
+    std::chrono::nanoseconds      m_max{ 0 };
+};
+
+/*****************************************************************************
+ * Client
+ ****************************************************************************/
+
+/* What completes a command */
+enum class completion
+{
+    sent,           // Nothing to wait for, completes once written
+    status,         // HCI_CONTROL_EVENT_COMMAND_STATUS
+    at_response,    // AT OK, ERROR or +CME ERROR for the same handle
+    hf_open,        // HCI_CONTROL_HF_EVENT_OPEN
+    version,        // HCI_CONTROL_MISC_EVENT_VERSION
+    fragments,      // FRAGMENT_ACK COMPLETE, for fragmented commands that are otherwise only sent
+    count_
+};
+
+struct command_result
+{
+    bool                        ok = false;
+    uint8_t                     status = 0;         // COMMAND_STATUS code or HF OPEN status
+    uint16_t                    at_event = 0;       // HCI_CONTROL_HF_AT_EVENT_* for AT responses
+    uint16_t                    num = 0;            // CME error code, or handle for HF OPEN
+    std::chrono::nanoseconds    latency{ 0 };
+    std::vector<uint8_t>        payload;            // Raw completion payload
+};
+
+/* Fire and forget coroutine type for callers without their own task type */
+struct detached_task
+{
+    struct promise_type
+    {
+        detached_task       get_return_object( ) { return { }; }
+        std::suspend_never  initial_suspend( ) noexcept { return { }; }
+        std::suspend_never  final_suspend( ) noexcept { return { }; }
+        void                return_void( ) { }
+        void                unhandled_exception( ) { std::terminate( ); }
+    };
+};
+
+/*
+ * Transport is any object with  void write( std::span<const uint8_t> )  writing a whole
+ * frame to the device.
+ */
+template <typename Transport>
+class client
+{
+    using clock = std::chrono::steady_clock;
+
+    struct pending
+    {
+        uint16_t                 handle;
+        clock::time_point        sent_at;
+        std::coroutine_handle<>  waiter;
+        command_result          *p_result;
+        uint8_t                  protocol;          // SET_PROTOCOL version, switches framing on success
+        uint8_t                  window;
+    };
+
+    /* Fragmented command, kept until the device reports it complete */
+    struct transfer
+    {
+        uint8_t                  xfer_id;
+        uint16_t                 opcode;
+        std::vector<uint8_t>     data;
+        command_result          *p_result;
+        bool                     waits;             // Completes on FRAGMENT_ACK COMPLETE
+    };
+
+public:
+    class operation
+    {
+    public:
+        operation( client &c, uint16_t opcode, std::vector<uint8_t> payload, completion kind, uint16_t handle,
+                   uint8_t protocol = 0, uint8_t window = 0 )
+            : m_client( c ), m_opcode( opcode ), m_payload( std::move( payload ) ), m_kind( kind ), m_handle( handle ),
+              m_protocol( protocol ), m_window( window ) { }
+
+        bool await_ready( ) const noexcept { return false; }
+
+        bool await_suspend( std::coroutine_handle<> h )
+        {
+            auto now = clock::now( );
+
+            /* A fragmented command is only done once the device put it back together */
+            if ( m_kind == completion::sent && m_client.fragmented( m_opcode, m_payload.size( ) ) )
+                m_kind = completion::fragments;
+
+            /* Register before writing, the answer may arrive from within write() */
+            if ( m_kind != completion::sent )
+                m_client.m_pending[size_t( m_kind )].push_back( pending{ m_handle, now, h, &m_result, m_protocol, m_window } );
+
+            m_client.send_command( m_opcode, m_payload, &m_result, m_kind == completion::fragments );
+
+            if ( m_kind == completion::sent )
+            {
+                m_result.ok      = true;
+                m_result.latency = clock::now( ) - now;
+            }
+
+            /* Answered synchronously: carry on without suspending */
+            return !m_client.resume_deferred( h ) && m_kind != completion::sent;
+        }
+
+        command_result await_resume( ) { return std::move( m_result ); }
+
+    private:
+        client                 &m_client;
+        uint16_t                m_opcode;
+        std::vector<uint8_t>    m_payload;
+        completion              m_kind;
+        uint16_t                m_handle;
+        uint8_t                 m_protocol;
+        uint8_t                 m_window;
+        command_result          m_result;
+    };
+
+    explicit client( Transport &transport ) : m_transport( transport ) { }
+
+    /* Handler for events that do not complete a command, or all events if wanted */
+    void on_event( std::function<void( const event_t & )> handler ) { m_on_event = std::move( handler ); }
+
+    /* Feed bytes read from the transport */
+    void feed( std::span<const uint8_t> data )
+    {
+        m_parser.feed( data, [this]( const frame_view &f ) { dispatch( f ); } );
+        service( );
+    }
+
+    /* Resend unacked v2 frames once the retransmit timeout passed, call periodically */
+    void poll( )
+    {
+        if ( !m_v2 || m_v2_unacked.empty( ) || m_servicing || clock::now( ) - m_v2_sent_at < m_v2_timeout )
+            return;
+
+        /* Go-Back-N, an ack arriving meanwhile must not shrink the list under us */
+        m_servicing = true;
+        for ( size_t i = 0; i < m_v2_unacked.size( ); i++ )
+        {
+            v2_transmit( m_v2_unacked[i] );
+            m_v2_retransmits++;
+        }
+        m_servicing = false;
+        service( );
+    }
+
+    /* Largest command payload the device takes in one packet, longer ones are fragmented */
+    void set_max_payload( size_t len )                      { m_max_payload = std::max( len, v2_overhead + fragment_header_len + 1 ); }
+    void set_v2_timeout( std::chrono::milliseconds t )      { m_v2_timeout = t; }
+
+    /* Generic command */
+    operation command( uint16_t opcode, std::vector<uint8_t> payload, completion kind, uint16_t handle = 0 )
+    {
+        return operation( *this, opcode, std::move( payload ), kind, handle );
+    }
+
+    /* DEVICE group */
+    operation reset( )                                      { return command( HCI_CONTROL_COMMAND_RESET, { }, completion::sent ); }
+    operation inquiry( bool enable )                        { return command( HCI_CONTROL_COMMAND_INQUIRY, { uint8_t( enable ) }, completion::status ); }
+    operation set_visibility( bool discoverable, bool connectable )
+                                                            { return command( HCI_CONTROL_COMMAND_SET_VISIBILITY, { uint8_t( discoverable ), uint8_t( connectable ) }, completion::status ); }
+    operation set_pairing_mode( bool allowed )              { return command( HCI_CONTROL_COMMAND_SET_PAIRING_MODE, { uint8_t( allowed ) }, completion::status ); }
+    operation set_local_bda( const bd_addr &a )             { return command( HCI_CONTROL_COMMAND_SET_LOCAL_BDA, bdaddr_payload( a ), completion::status ); }
+
+    operation push_nvram( uint16_t nvram_id, std::span<const uint8_t> data )
+    {
+        std::vector<uint8_t> p{ uint8_t( nvram_id ), uint8_t( nvram_id >> 8 ) };
+        p.insert( p.end( ), data.begin( ), data.end( ) );
+        return command( HCI_CONTROL_COMMAND_PUSH_NVRAM_DATA, std::move( p ), completion::sent );
+    }
+
+    operation delete_nvram( uint16_t nvram_id )             { return command( HCI_CONTROL_COMMAND_DELETE_NVRAM_DATA, { uint8_t( nvram_id ), uint8_t( nvram_id >> 8 ) }, completion::sent ); }
+
+    /* HF group */
+    operation hf_connect( const bd_addr &a )                { return command( HCI_CONTROL_HF_COMMAND_CONNECT, bdaddr_payload( a ), completion::hf_open ); }
+    operation hf_disconnect( uint16_t handle )              { return command( HCI_CONTROL_HF_COMMAND_DISCONNECT, le16( handle ), completion::sent ); }
+    operation hf_open_audio( uint16_t handle )              { return command( HCI_CONTROL_HF_COMMAND_OPEN_AUDIO, le16( handle ), completion::sent ); }
+    operation hf_close_audio( uint16_t handle )             { return command( HCI_CONTROL_HF_COMMAND_CLOSE_AUDIO, le16( handle ), completion::sent ); }
+
+    operation hf_set_indicator( uint16_t handle, uint8_t ind_id, uint16_t value )
+    {
+        return command( HCI_CONTROL_HF_COMMAND_SET_HF_INDICATOR,
+                        { uint8_t( handle ), uint8_t( handle >> 8 ), ind_id, uint8_t( value ), uint8_t( value >> 8 ) }, completion::status );
+    }
+
+    /* AT commands, see hci_control_hf_at_command(). Complete on OK/ERROR/+CME ERROR. */
+    operation hf_at( uint16_t handle, uint8_t at_command, uint16_t num = 0, std::string_view str = { } )
+    {
+        std::vector<uint8_t> p{ uint8_t( handle ), uint8_t( handle >> 8 ), uint8_t( num ), uint8_t( num >> 8 ) };
+        p.insert( p.end( ), str.begin( ), str.end( ) );
+        return command( HCI_CONTROL_HF_AT_COMMAND_BASE + at_command, std::move( p ), completion::at_response, handle );
+    }
+
+    operation hf_dial( uint16_t handle, std::string_view number )   { return hf_at( handle, HCI_CONTROL_HF_AT_COMMAND_D, 0, number ); }
+    operation hf_answer( uint16_t handle )                          { return hf_at( handle, HCI_CONTROL_HF_AT_COMMAND_A ); }
+    operation hf_hangup( uint16_t handle )                          { return hf_at( handle, HCI_CONTROL_HF_AT_COMMAND_CHUP ); }
+    operation hf_speaker_volume( uint16_t handle, uint8_t level )   { return hf_at( handle, HCI_CONTROL_HF_AT_COMMAND_SPK, level ); }
+    operation hf_mic_volume( uint16_t handle, uint8_t level )       { return hf_at( handle, HCI_CONTROL_HF_AT_COMMAND_MIC, level ); }
+
+    /* MISC group */
+    operation get_version( )                                { return command( HCI_CONTROL_MISC_COMMAND_GET_VERSION, { }, completion::version ); }
+
+    /*
+     * Protocol 1 or 2, window is the number of unacked v2 frames in each direction. Always
+     * sent and answered in v1, the client switches framing when it succeeds.
+     */
+    operation set_protocol( uint8_t version, uint8_t window = 8 )
+    {
+        return operation( *this, HCI_CONTROL_MISC_COMMAND_SET_PROTOCOL, { version, window }, completion::status, 0, version, window );
+    }
+
+    /*
+     * Event timestamps. The status of set_timestamps() still comes without a trailer, call
+     * expect_timestamps() with the same value once it has completed. time_sync() is answered
+     * with an event::time_sync, host_time is echoed back.
+     */
+    operation set_timestamps( bool enable )                 { return command( HCI_CONTROL_MISC_COMMAND_SET_TIMESTAMPS, { uint8_t( enable ) }, completion::status ); }
+    operation time_sync( uint64_t host_time )
+    {
+        std::vector<uint8_t> p( 8 );
+        for ( size_t i = 0; i < p.size( ); i++ )
+            p[i] = uint8_t( host_time >> ( 8 * i ) );
+        return command( HCI_CONTROL_MISC_COMMAND_TIME_SYNC, std::move( p ), completion::sent );
+    }
+    void                   expect_timestamps( bool enable ) { m_timestamps = enable; }
+
+    /*
+     * Stores the records of a device, built with add_nvram_record(), answered with an
+     * event::nvram_restore. Longer than a packet it goes in fragments, up to
+     * HCI_FRAG_MAX_LEN (handsfree.h) bytes.
+     */
+    operation nvram_restore( std::vector<uint8_t> records ) { return command( HCI_CONTROL_MISC_COMMAND_NVRAM_RESTORE, std::move( records ), completion::sent ); }
+    static void add_nvram_record( std::vector<uint8_t> &records, uint16_t nvram_id, std::span<const uint8_t> data )
+    {
+        records.insert( records.end( ), { uint8_t( nvram_id ), uint8_t( nvram_id >> 8 ), uint8_t( data.size( ) ), uint8_t( data.size( ) >> 8 ) } );
+        records.insert( records.end( ), data.begin( ), data.end( ) );
+    }
+
+    /* Answered with an event::counters */
+    operation get_counters( bool clear = false )            { return command( HCI_CONTROL_MISC_COMMAND_GET_COUNTERS, { uint8_t( clear ) }, completion::sent ); }
+
+    /* Trailer of the event being dispatched, valid inside the event handler */
+    const event_timestamp &last_timestamp( ) const          { return m_last_timestamp; }
+
+    /* Fail every outstanding command, e.g. after the device restarted */
+    void cancel_all( )
+    {
+        m_transfers.clear( );
+        for ( auto &q : m_pending )
+        {
+            while ( !q.empty( ) )
+            {
+                auto p = q.front( );
+                q.pop_front( );
+                p.p_result->ok = false;
+                resume( p.waiter );
+            }
+        }
+    }
+
+    size_t               in_flight( ) const
+    {
+        size_t n = 0;
+        for ( auto &q : m_pending )
+            n += q.size( );
+        return n;
+    }
+
+    const latency_stats &latency( completion kind ) const   { return m_latency[size_t( kind )]; }
+    void                 reset_latency( ) { for ( auto &l : m_latency ) l.reset( ); }
+    uint64_t             frames_received( ) const           { return m_frames_rx; }
+    uint64_t             frames_sent( ) const               { return m_frames_tx; }
+    bool                 v2( ) const                        { return m_v2; }
+    uint64_t             v2_retransmits( ) const            { return m_v2_retransmits; }
+    uint64_t             v2_bad_frames( ) const             { return m_v2_bad_frames; }
+
+private:
+    static std::vector<uint8_t> le16( uint16_t v ) { return { uint8_t( v ), uint8_t( v >> 8 ) }; }
+
+    static std::vector<uint8_t> bdaddr_payload( const bd_addr &a )
+    {
+        return std::vector<uint8_t>( a.rbegin( ), a.rend( ) );
+    }
+
+    /* SET_PROTOCOL always travels as a v1 packet */
+    bool uses_v2( uint16_t opcode ) const
+    {
+        return m_v2 && opcode != HCI_CONTROL_MISC_COMMAND_SET_PROTOCOL;
+    }
+
+    size_t packet_payload_limit( uint16_t opcode ) const
+    {
+        return m_max_payload - ( uses_v2( opcode ) ? v2_overhead : 0 );
+    }
+
+    bool fragmented( uint16_t opcode, size_t len ) const
+    {
+        return opcode != HCI_CONTROL_MISC_COMMAND_FRAGMENT && len > packet_payload_limit( opcode );
+    }
+
+    void send_command( uint16_t opcode, std::span<const uint8_t> payload, command_result *p_result, bool waits )
+    {
+        if ( !fragmented( opcode, payload.size( ) ) )
+        {
+            send_packet( opcode, payload );
+            return;
+        }
+
+        m_transfers.push_back( transfer{ m_next_xfer_id++, opcode, std::vector<uint8_t>( payload.begin( ), payload.end( ) ),
+                                         p_result, waits } );
+        send_fragments( m_transfers.back( ), 0 );
+    }
+
+    void send_fragments( const transfer &t, size_t offset )
+    {
+        size_t               chunk = packet_payload_limit( HCI_CONTROL_MISC_COMMAND_FRAGMENT ) - fragment_header_len;
+        std::vector<uint8_t> p;
+
+        do
+        {
+            size_t n = std::min( chunk, t.data.size( ) - offset );
+
+            p = { t.xfer_id, uint8_t( t.opcode ), uint8_t( t.opcode >> 8 ), uint8_t( t.data.size( ) ),
+                  uint8_t( t.data.size( ) >> 8 ), uint8_t( offset ), uint8_t( offset >> 8 ) };
+            p.insert( p.end( ), t.data.begin( ) + offset, t.data.begin( ) + offset + n );
+            send_packet( HCI_CONTROL_MISC_COMMAND_FRAGMENT, p );
+            offset += n;
+        } while ( offset < t.data.size( ) );
+    }
+
+    /* One packet, in a V2 frame when v2 is on */
+    void send_packet( uint16_t opcode, std::span<const uint8_t> payload )
+    {
+        if ( !uses_v2( opcode ) )
+        {
+            write_frame( opcode, payload );
+            return;
+        }
+
+        std::vector<uint8_t> f( v2_overhead + payload.size( ) );
+        f[0] = m_v2_tx_seq++;
+        f[2] = uint8_t( opcode );
+        f[3] = uint8_t( opcode >> 8 );
+        f[4] = uint8_t( payload.size( ) );
+        f[5] = uint8_t( payload.size( ) >> 8 );
+        if ( !payload.empty( ) )
+            std::memcpy( f.data( ) + v2_header_len, payload.data( ), payload.size( ) );
+
+        m_v2_backlog.push_back( std::move( f ) );
+        service( );
+    }
+
+    /* Fill in the current ack and the CRC, then write */
+    void v2_transmit( std::vector<uint8_t> &f )
+    {
+        f[1] = m_v2_rx_expected;
+        uint16_t crc = crc16( std::span<const uint8_t>( f ).first( f.size( ) - 2 ) );
+        f[f.size( ) - 2] = uint8_t( crc );
+        f[f.size( ) - 1] = uint8_t( crc >> 8 );
+
+        m_v2_ack_pending = false;
+        m_v2_sent_at     = clock::now( );
+        write_frame( HCI_CONTROL_MISC_COMMAND_V2_FRAME, f );
+    }
+
+    void v2_reset( bool enable, uint8_t window )
+    {
+        m_v2             = enable;
+        m_v2_window      = std::max<uint8_t>( window, 1 );
+        m_v2_tx_seq      = 0;
+        m_v2_tx_base     = 0;
+        m_v2_rx_expected = 0;
+        m_v2_ack_pending = false;
+        m_v2_unacked.clear( );
+        m_v2_backlog.clear( );
+    }
+
+    /* A V2 frame from the device, delivers the event it carries if it is the next one */
+    void v2_receive( const frame_view &f )
+    {
+        auto d = f.payload;
+
+        if ( d.size( ) < v2_overhead || size_t( detail::le16( &d[4] ) ) + v2_overhead != d.size( ) ||
+             crc16( d.first( d.size( ) - 2 ) ) != detail::le16( &d[d.size( ) - 2] ) )
+        {
+            /* Duplicate ack, the device resends without waiting for its timer */
+            m_v2_bad_frames++;
+            m_v2_ack_pending = true;
+            return;
+        }
+
+        uint8_t  seq    = d[0];
+        uint8_t  acked  = uint8_t( d[1] - m_v2_tx_base );
+        uint16_t opcode = detail::le16( &d[2] );
+
+        if ( acked && acked <= m_v2_unacked.size( ) )
+        {
+            m_v2_unacked.erase( m_v2_unacked.begin( ), m_v2_unacked.begin( ) + acked );
+            m_v2_tx_base = d[1];
+            m_v2_sent_at = clock::now( );
+        }
+
+        /* Ack only */
+        if ( opcode == 0 )
+            return;
+
+        m_v2_ack_pending = true;
+        if ( seq != m_v2_rx_expected )
+            return;
+
+        m_v2_rx_expected++;
+        dispatch( frame_view{ opcode, d.subspan( v2_header_len, d.size( ) - v2_overhead ) } );
+    }
+
+    bool fragment_ack( const frame_view &f, const event::fragment_ack &a )
+    {
+        auto it = std::find_if( m_transfers.begin( ), m_transfers.end( ),
+                                [&a]( const transfer &t ) { return t.xfer_id == a.xfer_id; } );
+        if ( it == m_transfers.end( ) || a.status == HCI_CONTROL_FRAG_STATUS_SUCCESS )
+            return it != m_transfers.end( );
+
+        /* The device only keeps the latest transfer */
+        if ( a.status == HCI_CONTROL_FRAG_STATUS_OUT_OF_ORDER && it + 1 == m_transfers.end( ) && a.next_offset < it->data.size( ) )
+        {
+            m_rewind        = true;
+            m_rewind_offset = a.next_offset;
+            return true;
+        }
+
+        /* Done with it before the waiter resumes and maybe starts the next one */
+        command_result *p_result = it->p_result;
+        bool            waits    = it->waits;
+        m_transfers.erase( it );
+
+        if ( a.status != HCI_CONTROL_FRAG_STATUS_COMPLETE )
+            fail_command( p_result, a.status );
+        else if ( waits )
+            complete( completion::fragments, f, true, a.status, 0, 0, 0, false );
+        return true;
+    }
+
+    void fail_command( command_result *p_result, uint8_t status )
+    {
+        for ( auto &q : m_pending )
+        {
+            for ( auto it = q.begin( ); it != q.end( ); ++it )
+            {
+                if ( it->p_result != p_result )
+                    continue;
+
+                pending p = *it;
+                q.erase( it );
+                p.p_result->ok      = false;
+                p.p_result->status  = status;
+                p.p_result->latency = clock::now( ) - p.sent_at;
+                resume( p.waiter );
+                return;
+            }
+        }
+    }
+
+    /*
+     * Sends what the last events asked for: v2 frames the window has room for, an ack
+     * that no command carried, a fragment rewind. Never runs inside write(), so a
+     * transport answering synchronously does not see a nested command.
+     */
+    void service( )
+    {
+        if ( m_writing || m_servicing )
+            return;
+
+        m_servicing = true;
+        for ( bool again = true; again; )
+        {
+            again = false;
+
+            if ( m_rewind && !m_transfers.empty( ) )
+            {
+                m_rewind = false;
+                send_fragments( m_transfers.back( ), m_rewind_offset );
+                again = true;
+            }
+
+            while ( m_v2 && !m_v2_backlog.empty( ) && m_v2_unacked.size( ) < m_v2_window )
+            {
+                m_v2_unacked.push_back( std::move( m_v2_backlog.front( ) ) );
+                m_v2_backlog.pop_front( );
+                v2_transmit( m_v2_unacked.back( ) );
+                again = true;
+            }
+
+            if ( m_v2 && m_v2_ack_pending )
+            {
+                std::vector<uint8_t> ack( v2_overhead, 0 );
+                ack[0] = m_v2_tx_seq;
+                v2_transmit( ack );
+                again = true;
+            }
+        }
+        m_servicing = false;
+    }
+
+    void write_frame( uint16_t opcode, std::span<const uint8_t> payload )
+    {
+        m_tx.resize( frame_header_len + payload.size( ) );
+        encode_frame( opcode, payload, m_tx );
+        m_frames_tx++;
+        m_writing = true;
+        m_transport.write( std::span<const uint8_t>( m_tx ) );
+        m_writing = false;
+        service( );
+    }
+
+    /*
+     * Resume the commands completed while writing, other than self. Returns true if
+     * self was one of them. Resuming only after write() returns keeps the stack flat
+     * with loopback transports that answer synchronously.
+     */
+    bool resume_deferred( std::coroutine_handle<> self )
+    {
+        bool self_done = false;
+        auto ready     = std::move( m_deferred );
+
+        m_deferred.clear( );
+        for ( auto h : ready )
+        {
+            if ( h == self )
+                self_done = true;
+            else
+                h.resume( );
+        }
+        return self_done;
+    }
+
+    void resume( std::coroutine_handle<> h )
+    {
+        if ( m_writing )
+            m_deferred.push_back( h );
+        else
+            h.resume( );
+    }
+
+    bool complete( completion kind, const frame_view &f, bool ok, uint8_t status, uint16_t at_event, uint16_t num, uint16_t handle, bool match_handle )
+    {
+        auto &q  = m_pending[size_t( kind )];
+        auto  it = q.begin( );
+
+        if ( match_handle )
+            while ( it != q.end( ) && it->handle != handle )
+                ++it;
+        if ( it == q.end( ) )
+            return false;
+
+        pending p = *it;
+        q.erase( it );
+
+        p.p_result->ok       = ok;
+        p.p_result->status   = status;
+        p.p_result->at_event = at_event;
+        p.p_result->num      = num;
+        p.p_result->latency  = clock::now( ) - p.sent_at;
+        p.p_result->payload.assign( f.payload.begin( ), f.payload.end( ) );
+        m_latency[size_t( kind )].record( p.p_result->latency );
+
+        /* Status of SET_PROTOCOL, the device starts over with sequence number 0 */
+        if ( ok && p.protocol )
+            v2_reset( p.protocol == 2, p.window );
+
+        resume( p.waiter );
+        return true;
+    }
+
+    void dispatch( frame_view f )
+    {
+        if ( m_v2 && f.opcode == HCI_CONTROL_MISC_EVENT_V2_FRAME )
+        {
+            v2_receive( f );
+            return;
+        }
+
+        if ( m_timestamps )
+            strip_timestamp( f, m_last_timestamp );
+
+        event_t ev = decode_event( f );
+        bool    consumed = false;
+
+        m_frames_rx++;
+
+        if ( auto *s = std::get_if<event::command_status>( &ev ) )
+        {
+            consumed = complete( completion::status, f, s->status == HCI_CONTROL_STATUS_SUCCESS, s->status, 0, 0, 0, false );
+        }
+        else if ( auto *at = std::get_if<event::hf_at>( &ev ) )
+        {
+            switch ( at->at_event )
+            {
+            case HCI_CONTROL_HF_AT_EVENT_OK:
+            case HCI_CONTROL_HF_AT_EVENT_ERROR:
+            case HCI_CONTROL_HF_AT_EVENT_CMEE:
+                consumed = complete( completion::at_response, f, at->at_event == HCI_CONTROL_HF_AT_EVENT_OK, 0,
+                                     at->at_event, at->num, at->handle, true );
+                break;
+            }
+        }
+        else if ( auto *o = std::get_if<event::hf_open>( &ev ) )
+        {
+            /* Connection state is still reported to the event handler */
+            complete( completion::hf_open, f, o->status == 0, o->status, 0, o->handle, 0, false );
+        }
+        else if ( std::holds_alternative<event::version>( ev ) )
+        {
+            consumed = complete( completion::version, f, true, 0, 0, 0, 0, false );
+        }
+        else if ( auto *a = std::get_if<event::fragment_ack>( &ev ) )
+        {
+            consumed = fragment_ack( f, *a );
+        }
+        else if ( std::holds_alternative<event::device_started>( ev ) )
+        {
+            /* Device restarted, nothing in flight will be answered, v1 without timestamps */
+            m_timestamps = false;
+            v2_reset( false, 0 );
+            cancel_all( );
+        }
+
+        if ( !consumed && m_on_event )
+            m_on_event( ev );
+    }
+
+    Transport                                                       &m_transport;
+    frame_parser                                                     m_parser;
+    std::vector<uint8_t>                                             m_tx;
+    std::array<std::deque<pending>, size_t( completion::count_ )>   m_pending;
+    std::array<latency_stats, size_t( completion::count_ )>         m_latency;
+    std::function<void( const event_t & )>                          m_on_event;
+    bool                                                             m_timestamps = false;
+    event_timestamp                                                  m_last_timestamp{ };
+    std::vector<std::coroutine_handle<>>                            m_deferred;
+    bool                                                             m_writing = false;
+    bool                                                             m_servicing = false;
+    uint64_t                                                         m_frames_rx = 0;
+    uint64_t                                                         m_frames_tx = 0;
+
+    size_t                                                           m_max_payload = max_packet_payload;
+    std::deque<transfer>                                             m_transfers;
+    uint8_t                                                          m_next_xfer_id = 1;
+    bool                                                             m_rewind = false;
+    size_t                                                           m_rewind_offset = 0;
+
+    bool                                                             m_v2 = false;
+    uint8_t                                                          m_v2_window = 1;
+    uint8_t                                                          m_v2_tx_seq = 0;          // Seq of the next new frame
+    uint8_t                                                          m_v2_tx_base = 0;         // Seq of the oldest unacked frame
+    uint8_t                                                          m_v2_rx_expected = 0;
+    bool                                                             m_v2_ack_pending = false;
+    std::deque<std::vector<uint8_t>>                                 m_v2_unacked;
+    std::deque<std::vector<uint8_t>>                                 m_v2_backlog;              // Waiting for the window
+    clock::time_point                                                m_v2_sent_at{ };
+    std::chrono::milliseconds                                        m_v2_timeout{ 200 };
+    uint64_t                                                         m_v2_retransmits = 0;
+    uint64_t                                                         m_v2_bad_frames = 0;
+};
+
+} // namespace handsfree::host
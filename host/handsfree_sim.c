@@ -0,0 +1,866 @@
+/*
+ * Copyright 2016-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+
+/** @file
+ *
+ * Runs many hands-free devices in one process for load testing host software.
+ *
+ * Every device is the application linked against the stub WICED layer with its own
+ * wiced_stub_t (controller, timers, NVRAM) and handsfree_instance_t (application state),
+ * and its own WICED HCI: a pseudo terminal, or a Unix socket in the directory given with
+ * -s. The device names are printed at start, one line per device:
+ *
+ *     device <n> pty <path>      or      device <n> socket <path>
+ *
+ * Devices are run by a pool of worker threads. A device with work (a host command, an
+ * expired timer, an event it posted itself) is queued on the deque of its home worker;
+ * a worker takes devices from the back of its own deque and steals from the front of the
+ * others when it runs dry. A device runs on one worker at a time, work arriving while it
+ * runs makes the worker run it again. One thread reads all transports and another wakes
+ * devices whose timers expire.
+ *
+ * Usage: handsfree_sim [-n devices] [-t threads] [-s socket_dir] [-r report_seconds]
+ *
+ * The report line gives host commands and events per second over the interval, device
+ * runs and the share of them taken by stealing. A device that resets itself (wdog) is
+ * stopped.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <termios.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+#include "wiced_stub.h"
+#include "wiced_transport.h"
+#include "handsfree.h"
+
+extern void application_start( void );
+
+#define SIM_PACKET_TYPE             0x19    // HCI_WICED_PKT
+#define SIM_HDR_LEN                 4       // opcode(2) length(2)
+#define SIM_WRITE_TIMEOUT           100     // ms a device waits for a host that does not read
+#define SIM_READ_CHUNK              4096
+
+enum
+{
+    SIM_IDLE,                       // Nothing to do, or waiting for a timer
+    SIM_QUEUED,                     // On a worker deque
+    SIM_RUNNING,
+    SIM_RERUN,                      // Work arrived while running
+};
+
+typedef struct
+{
+    int                          index;
+    wiced_stub_t                *p_stub;
+    handsfree_instance_t         instance;
+    const wiced_transport_cfg_t *p_cfg;
+    int                          home;              // Worker the device is queued on
+    atomic_int                   state;
+    wiced_bool_t                 stopped;
+
+    pthread_mutex_t              tx_lock;           // Against the reader replacing fd
+    int                          fd;                // Host side, -1 if no host connected
+    int                          listen_fd;         // Socket mode
+    int                          slave_fd;          // Pty mode, keeps the master from hanging up
+
+    uint64_t                     timer_armed_us;    // Earliest wake up queued for the device
+
+    /* Reader thread */
+    uint8_t                      rx_hdr[1 + SIM_HDR_LEN];
+    uint32_t                     rx_hdr_len;
+    uint8_t                     *p_rx_packet;
+    uint32_t                     rx_len;            // Payload length of the packet being read
+    uint32_t                     rx_have;
+    wiced_bool_t                 rx_discard;
+} sim_device_t;
+
+typedef struct
+{
+    pthread_t                    thread;
+    pthread_mutex_t              lock;
+    sim_device_t               **pp_deque;          // Ring, every device is queued at most once
+    uint32_t                     head;
+    uint32_t                     count;
+    atomic_uint_fast64_t         runs;
+    atomic_uint_fast64_t         steals;
+    atomic_uint_fast64_t         commands;
+    atomic_uint_fast64_t         events;
+} sim_worker_t;
+
+typedef struct
+{
+    uint64_t                     deadline_us;
+    sim_device_t                *p_device;
+} sim_timer_t;
+
+typedef struct
+{
+    uint8_t                     *p_packet;
+    uint32_t                     length;
+} sim_rx_t;
+
+static sim_device_t            **sim_devices;
+static int                       sim_device_count = 4;
+static sim_worker_t             *sim_workers;
+static int                       sim_worker_count;
+
+static pthread_mutex_t           sim_idle_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t            sim_idle_cond = PTHREAD_COND_INITIALIZER;
+static atomic_int                sim_queued;
+
+static pthread_mutex_t           sim_timer_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t            sim_timer_cond;
+static sim_timer_t              *sim_timers;        // Binary heap by deadline
+static uint32_t                  sim_timer_count;
+static uint32_t                  sim_timer_size;
+
+static int                       sim_stop_pipe[2];
+
+static _Thread_local sim_device_t *p_sim_device;     // Device the calling worker runs
+static _Thread_local sim_worker_t *p_sim_worker;
+
+static uint64_t sim_monotonic_us( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/******************************************************************************
+ *  Scheduler
+ ******************************************************************************/
+static void sim_push( sim_worker_t *p_worker, sim_device_t *p_device )
+{
+    pthread_mutex_lock( &p_worker->lock );
+    p_worker->pp_deque[( p_worker->head + p_worker->count ) % sim_device_count] = p_device;
+    p_worker->count++;
+    pthread_mutex_unlock( &p_worker->lock );
+
+    atomic_fetch_add( &sim_queued, 1 );
+    pthread_mutex_lock( &sim_idle_lock );
+    pthread_cond_signal( &sim_idle_cond );
+    pthread_mutex_unlock( &sim_idle_lock );
+}
+
+/* Owner end, the most recently queued device is the most likely to be in cache */
+static sim_device_t *sim_pop( sim_worker_t *p_worker )
+{
+    sim_device_t *p_device = NULL;
+
+    pthread_mutex_lock( &p_worker->lock );
+    if ( p_worker->count )
+    {
+        p_worker->count--;
+        p_device = p_worker->pp_deque[( p_worker->head + p_worker->count ) % sim_device_count];
+    }
+    pthread_mutex_unlock( &p_worker->lock );
+    return p_device;
+}
+
+/* Thief end, the device that waited longest */
+static sim_device_t *sim_steal( sim_worker_t *p_victim )
+{
+    sim_device_t *p_device = NULL;
+
+    pthread_mutex_lock( &p_victim->lock );
+    if ( p_victim->count )
+    {
+        p_device         = p_victim->pp_deque[p_victim->head];
+        p_victim->head   = ( p_victim->head + 1 ) % sim_device_count;
+        p_victim->count--;
+    }
+    pthread_mutex_unlock( &p_victim->lock );
+    return p_device;
+}
+
+/* Make sure the device runs soon, from any thread */
+static void sim_schedule( sim_device_t *p_device )
+{
+    int state = atomic_load( &p_device->state );
+
+    for ( ;; )
+    {
+        if ( state == SIM_IDLE )
+        {
+            if ( atomic_compare_exchange_weak( &p_device->state, &state, SIM_QUEUED ) )
+            {
+                sim_push( &sim_workers[p_device->home], p_device );
+                return;
+            }
+        }
+        else if ( state == SIM_RUNNING )
+        {
+            if ( atomic_compare_exchange_weak( &p_device->state, &state, SIM_RERUN ) )
+                return;
+        }
+        else
+        {
+            return;
+        }
+    }
+}
+
+static void sim_notify( void *p_context )
+{
+    sim_schedule( p_context );
+}
+
+/******************************************************************************
+ *  Timers
+ ******************************************************************************/
+static void sim_timer_swap( uint32_t a, uint32_t b )
+{
+    sim_timer_t t = sim_timers[a];
+
+    sim_timers[a] = sim_timers[b];
+    sim_timers[b] = t;
+}
+
+/* Wake the device at deadline_us, called by the worker running it */
+static void sim_timer_arm( sim_device_t *p_device, uint64_t deadline_us )
+{
+    uint32_t i;
+
+    pthread_mutex_lock( &sim_timer_lock );
+
+    /* An earlier wake up runs the device, which arms again */
+    if ( deadline_us >= p_device->timer_armed_us )
+    {
+        pthread_mutex_unlock( &sim_timer_lock );
+        return;
+    }
+    p_device->timer_armed_us = deadline_us;
+
+    if ( sim_timer_count == sim_timer_size )
+    {
+        sim_timer_size = sim_timer_size ? 2 * sim_timer_size : 64;
+        if ( ( sim_timers = realloc( sim_timers, sim_timer_size * sizeof( sim_timer_t ) ) ) == NULL )
+            abort( );
+    }
+
+    i = sim_timer_count++;
+    sim_timers[i].deadline_us = deadline_us;
+    sim_timers[i].p_device    = p_device;
+    while ( i && ( sim_timers[( i - 1 ) / 2].deadline_us > sim_timers[i].deadline_us ) )
+    {
+        sim_timer_swap( i, ( i - 1 ) / 2 );
+        i = ( i - 1 ) / 2;
+    }
+
+    if ( i == 0 )
+        pthread_cond_signal( &sim_timer_cond );
+    pthread_mutex_unlock( &sim_timer_lock );
+}
+
+static sim_timer_t sim_timer_pop( void )
+{
+    sim_timer_t top = sim_timers[0];
+    uint32_t    i = 0, c;
+
+    sim_timers[0] = sim_timers[--sim_timer_count];
+    while ( ( c = 2 * i + 1 ) < sim_timer_count )
+    {
+        if ( ( c + 1 < sim_timer_count ) && ( sim_timers[c + 1].deadline_us < sim_timers[c].deadline_us ) )
+            c++;
+        if ( sim_timers[i].deadline_us <= sim_timers[c].deadline_us )
+            break;
+        sim_timer_swap( i, c );
+        i = c;
+    }
+    return top;
+}
+
+static void *sim_timer_task( void *arg )
+{
+    struct timespec ts;
+    sim_timer_t     t;
+    uint64_t        now_us;
+
+    pthread_mutex_lock( &sim_timer_lock );
+    for ( ;; )
+    {
+        if ( sim_timer_count == 0 )
+        {
+            pthread_cond_wait( &sim_timer_cond, &sim_timer_lock );
+            continue;
+        }
+
+        now_us = sim_monotonic_us( );
+        if ( sim_timers[0].deadline_us > now_us )
+        {
+            ts.tv_sec  = sim_timers[0].deadline_us / 1000000;
+            ts.tv_nsec = ( sim_timers[0].deadline_us % 1000000 ) * 1000;
+            pthread_cond_timedwait( &sim_timer_cond, &sim_timer_lock, &ts );
+            continue;
+        }
+
+        t = sim_timer_pop( );
+        if ( t.deadline_us == t.p_device->timer_armed_us )
+            t.p_device->timer_armed_us = UINT64_MAX;
+
+        pthread_mutex_unlock( &sim_timer_lock );
+        sim_schedule( t.p_device );
+        pthread_mutex_lock( &sim_timer_lock );
+    }
+    return NULL;
+}
+
+/******************************************************************************
+ *  Workers
+ ******************************************************************************/
+static void sim_run( sim_device_t *p_device )
+{
+    uint64_t next_us, now_us;
+    int      state = SIM_RUNNING;
+
+    atomic_store( &p_device->state, SIM_RUNNING );
+    atomic_fetch_add_explicit( &p_sim_worker->runs, 1, memory_order_relaxed );
+
+    if ( !p_device->stopped )
+    {
+        p_sim_device = p_device;
+        wiced_stub_select( p_device->p_stub );
+        handsfree_instance_select( &p_device->instance );
+
+        wiced_stub_run_pending( );
+        next_us = wiced_stub_next_timer_us( );
+        now_us  = clock_SystemTimeMicroseconds64( );
+
+        if ( wiced_stub_resets( ) )
+        {
+            fprintf( stderr, "device %d reset, stopped\n", p_device->index );
+            p_device->stopped = WICED_TRUE;
+        }
+        else if ( next_us != UINT64_MAX )
+        {
+            sim_timer_arm( p_device, sim_monotonic_us( ) + ( ( next_us > now_us ) ? next_us - now_us : 0 ) );
+        }
+
+        handsfree_instance_select( NULL );
+        wiced_stub_select( NULL );
+        p_sim_device = NULL;
+    }
+
+    /* Work that arrived meanwhile runs on this worker, the device is warm here */
+    if ( !atomic_compare_exchange_strong( &p_device->state, &state, SIM_IDLE ) )
+    {
+        atomic_store( &p_device->state, SIM_QUEUED );
+        sim_push( p_sim_worker, p_device );
+    }
+}
+
+static void *sim_worker_task( void *arg )
+{
+    sim_device_t *p_device;
+    int           i, victim;
+
+    p_sim_worker = arg;
+
+    for ( ;; )
+    {
+        p_device = sim_pop( p_sim_worker );
+
+        for ( i = 1; ( p_device == NULL ) && ( i < sim_worker_count ); i++ )
+        {
+            victim = ( ( p_sim_worker - sim_workers ) + i ) % sim_worker_count;
+            if ( ( p_device = sim_steal( &sim_workers[victim] ) ) != NULL )
+                atomic_fetch_add_explicit( &p_sim_worker->steals, 1, memory_order_relaxed );
+        }
+
+        if ( p_device == NULL )
+        {
+            pthread_mutex_lock( &sim_idle_lock );
+            while ( atomic_load( &sim_queued ) == 0 )
+                pthread_cond_wait( &sim_idle_cond, &sim_idle_lock );
+            pthread_mutex_unlock( &sim_idle_lock );
+            continue;
+        }
+
+        atomic_fetch_sub( &sim_queued, 1 );
+        sim_run( p_device );
+    }
+    return NULL;
+}
+
+/******************************************************************************
+ *  Transport
+ ******************************************************************************/
+static int sim_start( void *p_data )
+{
+    application_start( );
+    return 0;
+}
+
+/* Runs on the worker with the device selected */
+static int sim_deliver( void *p_data )
+{
+    sim_rx_t *p_rx = p_data;
+
+    atomic_fetch_add_explicit( &p_sim_worker->commands, 1, memory_order_relaxed );
+
+    /* Handler owns the buffer and releases it through free_rx_buffer */
+    p_sim_device->p_cfg->p_data_handler( p_rx->p_packet, p_rx->length );
+    free( p_rx );
+    return 0;
+}
+
+/* Posted by the reader so the count lands on the device's instance, not the reader's */
+static int sim_rx_overflow( void *p_data )
+{
+    HANDSFREE_COUNT( RX_OVERFLOW );
+    return 0;
+}
+
+static wiced_result_t sim_transport_init( const wiced_transport_cfg_t *p_cfg )
+{
+    p_sim_device->p_cfg = p_cfg;
+
+    if ( p_cfg->p_status_handler )
+    {
+        p_cfg->p_status_handler( p_cfg->type );
+    }
+    return WICED_SUCCESS;
+}
+
+/* Write all of it, waiting at most SIM_WRITE_TIMEOUT for a host that does not read */
+static int sim_write_all( int fd, struct iovec *p_iov, int iov_count )
+{
+    struct pollfd pfd = { .fd = fd, .events = POLLOUT };
+    ssize_t       n;
+
+    while ( iov_count )
+    {
+        n = writev( fd, p_iov, iov_count );
+        if ( n < 0 )
+        {
+            if ( errno == EINTR )
+                continue;
+            if ( ( errno != EAGAIN ) || ( poll( &pfd, 1, SIM_WRITE_TIMEOUT ) <= 0 ) )
+                return -1;
+            continue;
+        }
+
+        while ( iov_count && ( (size_t)n >= p_iov->iov_len ) )
+        {
+            n -= p_iov->iov_len;
+            p_iov++;
+            iov_count--;
+        }
+        if ( iov_count )
+        {
+            p_iov->iov_base = (uint8_t *)p_iov->iov_base + n;
+            p_iov->iov_len -= n;
+        }
+    }
+    return 0;
+}
+
+static wiced_result_t sim_transport_send( uint16_t code, uint8_t *p_data, uint16_t length,
+                                          const uint8_t *p_tail, uint16_t tail_length )
+{
+    sim_device_t *p_device = p_sim_device;
+    uint8_t       hdr[1 + SIM_HDR_LEN];
+    struct iovec  iov[3];
+    int           iovcnt = 1;
+    int           rc = -1;
+
+    hdr[0] = SIM_PACKET_TYPE;
+    hdr[1] = code & 0xff;
+    hdr[2] = code >> 8;
+    hdr[3] = ( length + tail_length ) & 0xff;
+    hdr[4] = ( length + tail_length ) >> 8;
+
+    iov[0].iov_base = hdr;
+    iov[0].iov_len  = sizeof( hdr );
+    if ( length )
+    {
+        iov[iovcnt].iov_base = p_data;
+        iov[iovcnt++].iov_len = length;
+    }
+    if ( tail_length )
+    {
+        iov[iovcnt].iov_base = (void *)p_tail;
+        iov[iovcnt++].iov_len = tail_length;
+    }
+
+    pthread_mutex_lock( &p_device->tx_lock );
+    if ( p_device->fd >= 0 )
+        rc = sim_write_all( p_device->fd, iov, iovcnt );
+    pthread_mutex_unlock( &p_device->tx_lock );
+
+    if ( rc < 0 )
+        return WICED_ERROR;
+
+    atomic_fetch_add_explicit( &p_sim_worker->events, 1, memory_order_relaxed );
+    return WICED_SUCCESS;
+}
+
+static void sim_transport_free_rx_buffer( uint8_t *p_buf )
+{
+    free( p_buf );
+}
+
+static const handsfree_transport_t handsfree_transport_sim =
+{
+    .init           = sim_transport_init,
+    .send           = sim_transport_send,
+    .free_rx_buffer = sim_transport_free_rx_buffer,
+};
+
+const handsfree_transport_t *p_handsfree_transport = &handsfree_transport_sim;
+
+/******************************************************************************
+ *  Reader
+ ******************************************************************************/
+static void sim_rx_reset( sim_device_t *p_device )
+{
+    free( p_device->p_rx_packet );
+    p_device->p_rx_packet = NULL;
+    p_device->rx_hdr_len  = 0;
+    p_device->rx_discard  = WICED_FALSE;
+}
+
+/* Split the bytes read from the host into packets and queue them on the device */
+static void sim_rx_bytes( sim_device_t *p_device, const uint8_t *p, size_t len )
+{
+    sim_rx_t *p_rx;
+    size_t    n;
+
+    while ( len )
+    {
+        if ( p_device->rx_hdr_len < sizeof( p_device->rx_hdr ) )
+        {
+            /* Resynchronize on the packet type */
+            if ( ( p_device->rx_hdr_len == 0 ) && ( *p != SIM_PACKET_TYPE ) )
+            {
+                p++;
+                len--;
+                continue;
+            }
+
+            p_device->rx_hdr[p_device->rx_hdr_len++] = *p++;
+            len--;
+            if ( p_device->rx_hdr_len < sizeof( p_device->rx_hdr ) )
+                continue;
+
+            p_device->rx_len  = p_device->rx_hdr[3] | ( p_device->rx_hdr[4] << 8 );
+            p_device->rx_have = 0;
+            if ( p_device->rx_len > HANDSFREE_CAP_RX_BUFFER_SIZE - SIM_HDR_LEN )
+            {
+                p_device->rx_discard = WICED_TRUE;
+                wiced_stub_post( p_device->p_stub, sim_rx_overflow, NULL );
+            }
+            else if ( ( p_device->p_rx_packet = malloc( SIM_HDR_LEN + p_device->rx_len ) ) != NULL )
+            {
+                memcpy( p_device->p_rx_packet, p_device->rx_hdr + 1, SIM_HDR_LEN );
+            }
+            else
+            {
+                abort( );
+            }
+        }
+
+        n = p_device->rx_len - p_device->rx_have;
+        if ( n > len )
+            n = len;
+        if ( !p_device->rx_discard )
+            memcpy( p_device->p_rx_packet + SIM_HDR_LEN + p_device->rx_have, p, n );
+        p_device->rx_have += n;
+        p   += n;
+        len -= n;
+
+        if ( p_device->rx_have < p_device->rx_len )
+            continue;
+
+        if ( !p_device->rx_discard )
+        {
+            if ( ( p_rx = malloc( sizeof( sim_rx_t ) ) ) == NULL )
+                abort( );
+            p_rx->p_packet = p_device->p_rx_packet;
+            p_rx->length   = SIM_HDR_LEN + p_device->rx_len;
+            p_device->p_rx_packet = NULL;
+            wiced_stub_post( p_device->p_stub, sim_deliver, p_rx );
+        }
+        sim_rx_reset( p_device );
+    }
+}
+
+static void sim_set_fd( sim_device_t *p_device, int fd )
+{
+    pthread_mutex_lock( &p_device->tx_lock );
+    if ( p_device->fd >= 0 )
+        close( p_device->fd );
+    p_device->fd = fd;
+    pthread_mutex_unlock( &p_device->tx_lock );
+    sim_rx_reset( p_device );
+}
+
+static int sim_open_pty( sim_device_t *p_device )
+{
+    struct termios tio;
+    int            fd;
+
+    if ( ( fd = posix_openpt( O_RDWR | O_NOCTTY | O_NONBLOCK ) ) < 0 )
+        return -1;
+    if ( ( grantpt( fd ) < 0 ) || ( unlockpt( fd ) < 0 ) ||
+         ( ( p_device->slave_fd = open( ptsname( fd ), O_RDWR | O_NOCTTY ) ) < 0 ) )
+    {
+        close( fd );
+        return -1;
+    }
+
+    /* Binary protocol, no line discipline */
+    if ( tcgetattr( p_device->slave_fd, &tio ) == 0 )
+    {
+        cfmakeraw( &tio );
+        tcsetattr( p_device->slave_fd, TCSANOW, &tio );
+    }
+
+    p_device->fd = fd;
+    printf( "device %d pty %s\n", p_device->index, ptsname( fd ) );
+    return 0;
+}
+
+static int sim_open_socket( sim_device_t *p_device, const char *p_dir )
+{
+    struct sockaddr_un addr;
+    int                fd;
+
+    if ( ( fd = socket( AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0 ) ) < 0 )
+        return -1;
+
+    memset( &addr, 0, sizeof( addr ) );
+    addr.sun_family = AF_UNIX;
+    snprintf( addr.sun_path, sizeof( addr.sun_path ), "%s/hf%d.sock", p_dir, p_device->index );
+    unlink( addr.sun_path );
+
+    if ( ( bind( fd, (struct sockaddr *)&addr, sizeof( addr ) ) < 0 ) || ( listen( fd, 1 ) < 0 ) )
+    {
+        close( fd );
+        return -1;
+    }
+
+    p_device->listen_fd = fd;
+    printf( "device %d socket %s\n", p_device->index, addr.sun_path );
+    return 0;
+}
+
+/* epoll data: device index * 2, plus 1 for the listening socket; the stop pipe is ~0 */
+static void sim_reader( int epoll_fd, int report_s )
+{
+    struct epoll_event events[64];
+    uint8_t            buf[SIM_READ_CHUNK];
+    uint64_t           last_us = sim_monotonic_us( ), now_us;
+    uint64_t           last_commands = 0, last_events = 0, last_runs = 0, last_steals = 0;
+    uint64_t           commands, events_sent, runs, steals;
+    sim_device_t      *p_device;
+    struct epoll_event ev;
+    ssize_t            n;
+    int                count, i, w, fd;
+
+    for ( ;; )
+    {
+        count = epoll_wait( epoll_fd, events, 64, report_s ? 1000 * report_s : -1 );
+        if ( ( count < 0 ) && ( errno != EINTR ) )
+            break;
+
+        for ( i = 0; i < count; i++ )
+        {
+            if ( events[i].data.u64 == ~(uint64_t)0 )
+                return;
+
+            p_device = sim_devices[events[i].data.u64 / 2];
+
+            if ( events[i].data.u64 & 1 )
+            {
+                /* A new host replaces the previous one */
+                if ( ( fd = accept4( p_device->listen_fd, NULL, NULL, SOCK_NONBLOCK ) ) < 0 )
+                    continue;
+                if ( p_device->fd >= 0 )
+                    epoll_ctl( epoll_fd, EPOLL_CTL_DEL, p_device->fd, NULL );
+                sim_set_fd( p_device, fd );
+                ev.events   = EPOLLIN;
+                ev.data.u64 = 2 * (uint64_t)p_device->index;
+                epoll_ctl( epoll_fd, EPOLL_CTL_ADD, fd, &ev );
+                continue;
+            }
+
+            while ( ( n = read( p_device->fd, buf, sizeof( buf ) ) ) > 0 )
+                sim_rx_bytes( p_device, buf, n );
+
+            if ( ( n == 0 ) || ( ( n < 0 ) && ( errno != EAGAIN ) && ( errno != EINTR ) ) )
+            {
+                /* Socket host went away, wait for the next one */
+                epoll_ctl( epoll_fd, EPOLL_CTL_DEL, p_device->fd, NULL );
+                sim_set_fd( p_device, -1 );
+            }
+        }
+
+        now_us = sim_monotonic_us( );
+        if ( !report_s || ( now_us - last_us < 1000000ull * report_s ) )
+            continue;
+
+        commands = events_sent = runs = steals = 0;
+        for ( w = 0; w < sim_worker_count; w++ )
+        {
+            commands    += atomic_load( &sim_workers[w].commands );
+            events_sent += atomic_load( &sim_workers[w].events );
+            runs        += atomic_load( &sim_workers[w].runs );
+            steals      += atomic_load( &sim_workers[w].steals );
+        }
+        fprintf( stderr, "commands/s %.0f  events/s %.0f  runs %llu  stolen %.1f%%\n",
+                 ( commands - last_commands ) * 1e6 / ( now_us - last_us ),
+                 ( events_sent - last_events ) * 1e6 / ( now_us - last_us ),
+                 (unsigned long long)( runs - last_runs ),
+                 ( runs - last_runs ) ? 100.0 * ( steals - last_steals ) / ( runs - last_runs ) : 0.0 );
+        last_us       = now_us;
+        last_commands = commands;
+        last_events   = events_sent;
+        last_runs     = runs;
+        last_steals   = steals;
+    }
+}
+
+static void sim_stop( int sig )
+{
+    ssize_t rc = write( sim_stop_pipe[1], "", 1 );
+
+    (void)rc;
+}
+
+int main( int argc, char *argv[] )
+{
+    const char         *p_socket_dir = NULL;
+    int                 report_s = 0;
+    int                 epoll_fd, opt, i;
+    pthread_condattr_t  attr;
+    pthread_t           timer_thread;
+    struct epoll_event  ev;
+    sim_device_t       *p_device;
+
+    sim_worker_count = sysconf( _SC_NPROCESSORS_ONLN );
+
+    while ( ( opt = getopt( argc, argv, "n:t:s:r:" ) ) != -1 )
+    {
+        switch ( opt )
+        {
+        case 'n': sim_device_count = atoi( optarg ); break;
+        case 't': sim_worker_count = atoi( optarg ); break;
+        case 's': p_socket_dir     = optarg;         break;
+        case 'r': report_s         = atoi( optarg ); break;
+        default:
+            fprintf( stderr, "usage: %s [-n devices] [-t threads] [-s socket_dir] [-r report_seconds]\n", argv[0] );
+            return 2;
+        }
+    }
+    if ( ( sim_device_count < 1 ) || ( sim_worker_count < 1 ) )
+        return 2;
+
+    signal( SIGPIPE, SIG_IGN );
+    if ( ( pipe( sim_stop_pipe ) < 0 ) || ( ( epoll_fd = epoll_create1( 0 ) ) < 0 ) )
+        return 1;
+    signal( SIGINT, sim_stop );
+    signal( SIGTERM, sim_stop );
+    ev.events   = EPOLLIN;
+    ev.data.u64 = ~(uint64_t)0;
+    epoll_ctl( epoll_fd, EPOLL_CTL_ADD, sim_stop_pipe[0], &ev );
+
+    /* Devices and their transports */
+    sim_devices = calloc( sim_device_count, sizeof( sim_device_t * ) );
+    for ( i = 0; i < sim_device_count; i++ )
+    {
+        if ( ( p_device = calloc( 1, sizeof( sim_device_t ) ) ) == NULL )
+            return 1;
+        sim_devices[i] = p_device;
+
+        p_device->index          = i;
+        p_device->p_stub         = wiced_stub_new( WICED_FALSE );
+        p_device->fd             = -1;
+        p_device->listen_fd      = -1;
+        p_device->slave_fd       = -1;
+        p_device->timer_armed_us = UINT64_MAX;
+        pthread_mutex_init( &p_device->tx_lock, NULL );
+        wiced_stub_set_notify( p_device->p_stub, sim_notify, p_device );
+
+        if ( ( p_socket_dir ? sim_open_socket( p_device, p_socket_dir ) : sim_open_pty( p_device ) ) < 0 )
+        {
+            perror( "handsfree_sim" );
+            return 1;
+        }
+
+        ev.events   = EPOLLIN;
+        ev.data.u64 = 2 * (uint64_t)i + ( p_socket_dir ? 1 : 0 );
+        epoll_ctl( epoll_fd, EPOLL_CTL_ADD, p_socket_dir ? p_device->listen_fd : p_device->fd, &ev );
+    }
+    fflush( stdout );
+
+    /* Workers, the devices are spread over them and stolen back as load requires */
+    sim_workers = calloc( sim_worker_count, sizeof( sim_worker_t ) );
+    for ( i = 0; i < sim_worker_count; i++ )
+    {
+        pthread_mutex_init( &sim_workers[i].lock, NULL );
+        sim_workers[i].pp_deque = calloc( sim_device_count, sizeof( sim_device_t * ) );
+    }
+    for ( i = 0; i < sim_device_count; i++ )
+        sim_devices[i]->home = i % sim_worker_count;
+    for ( i = 0; i < sim_worker_count; i++ )
+        pthread_create( &sim_workers[i].thread, NULL, sim_worker_task, &sim_workers[i] );
+
+    pthread_condattr_init( &attr );
+    pthread_condattr_setclock( &attr, CLOCK_MONOTONIC );
+    pthread_cond_init( &sim_timer_cond, &attr );
+    pthread_condattr_destroy( &attr );
+    pthread_create( &timer_thread, NULL, sim_timer_task, NULL );
+
+    for ( i = 0; i < sim_device_count; i++ )
+        wiced_stub_post( sim_devices[i]->p_stub, sim_start, NULL );
+
+    sim_reader( epoll_fd, report_s );
+    return 0;
+}
@@ -0,0 +1,426 @@
+#!/usr/bin/env python3
+#
+# Copyright 2016-2024, Cypress Semiconductor Corporation (an Infineon company) or
+# an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+#
+# This software, including source code, documentation and related
+# materials ("Software") is owned by Cypress Semiconductor Corporation
+# or one of its affiliates ("Cypress") and is protected by and subject to
+# worldwide patent protection (United States and foreign),
+# United States copyright laws and international treaty provisions.
+# Therefore, you may use this Software only as provided in the license
+# agreement accompanying the software package from which you
+# obtained this Software ("EULA").
+# If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+# non-transferable license to copy, modify, and compile the Software
+# source code solely for use in connection with Cypress's
+# integrated circuit products.  Any reproduction, modification, translation,
+# compilation, or representation of this Software except as specified
+# above is prohibited without the express written permission of Cypress.
+#
+# Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+# EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+# reserves the right to make changes to the Software without notice. Cypress
+# does not assume any liability arising out of the application or use of the
+# Software or any product or circuit described in the Software. Cypress does
+# not authorize its products for use in any products where a malfunction or
+# failure of the Cypress product may reasonably be expected to result in
+# significant property damage, injury or death ("High Risk Product"). By
+# including Cypress's product in a High Risk Product, the manufacturer
+# of such system or application assumes all risk of such use and in doing
+# so agrees to indemnify Cypress against all liability.
+"""
+Benchmarks of the WICED HCI host interface against handsfree_host (make -C host).
+
+    hci_bench.py protocol [--loss 0,0.01,0.05] [--corrupt 0.01] [--commands 500] [--window 8]
+    hci_bench.py burst [--bursts 1,2,4,8,16,32]
+
+protocol compares plain v1 packets with the reliable v2 framing over a lossy pseudo
+terminal. The host side of the link drops a packet with probability --loss and flips a
+bit in the payload of one with probability --corrupt, in both directions. Headers are
+left alone: a damaged length makes the device skip up to 64 KB of the stream, which
+stalls both versions alike and says nothing about the framing above. Every round sends
+GET_VERSION and checks the answer against the one read on a clean link:
+  v1    one command at a time, resent after --v1-timeout ms without a good answer. A
+        corrupted answer that still parses is counted as bad, v1 cannot detect it.
+  v2    up to --window commands in flight, Go-Back-N with the device, the host resends
+        after --v2-timeout ms. Answers are matched in order.
+Goodput counts payload bytes of good answers per second, latency is from the first send
+of a command to its good answer.
+
+burst writes bursts of PUSH_NVRAM_DATA commands back to back and reads the RX counters
+to see how many the device accepted. handsfree_host runs with HANDSFREE_BUSY, so a bond
+push blocks the application for the controller command that adds the bond to the
+address resolution list, holds as many receive buffers as the device has and takes
+packets at the rate of a --baud UART. Bursts are sent as plain bond pushes, 512 byte
+typed records, and both again in v2 frames of up to one window.
+"""
+
+import argparse
+import os
+import random
+import re
+import select
+import struct
+import subprocess
+import sys
+import time
+
+PACKET_TYPE = 0x19
+HCI_CONTROL_EVENT_COMMAND_STATUS = 0x0001
+HCI_CONTROL_COMMAND_PUSH_NVRAM_DATA = 0x0005
+HCI_CONTROL_MISC_COMMAND_GET_VERSION = 0xFF02
+HCI_CONTROL_MISC_EVENT_VERSION = 0xFF02
+HCI_CONTROL_MISC_COMMAND_SET_PROTOCOL = 0xFF40
+HCI_CONTROL_MISC_COMMAND_V2_FRAME = 0xFF41
+HCI_CONTROL_MISC_EVENT_V2_FRAME = 0xFF41
+HCI_CONTROL_MISC_COMMAND_GET_COUNTERS = 0xFF49
+HCI_CONTROL_MISC_EVENT_COUNTERS = 0xFF49
+V2_OVERHEAD = 8
+HCI_API_H = os.path.join(os.path.dirname(os.path.abspath(__file__)), '..', 'handsfree_hci_api.h')
+
+
+def crc16(data):
+    """CRC-16/CCITT-FALSE, as hci_control_crc16()"""
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def packet(opcode, payload=b''):
+    return bytes([PACKET_TYPE]) + struct.pack('<HH', opcode, len(payload)) + payload
+
+
+def v2_frame(seq, ack, opcode, payload=b''):
+    body = struct.pack('<BBHH', seq, ack, opcode, len(payload)) + payload
+    return body + struct.pack('<H', crc16(body))
+
+
+def counter_names():
+    """Counter order of HANDSFREE_COUNTER_LIST"""
+    with open(HCI_API_H) as f:
+        text = f.read()
+    block = text[text.index('#define HANDSFREE_COUNTER_LIST'):]
+    block = block[:block.index('\n\n')]
+    return re.findall(r'X\( (\w+) \)', block)
+
+
+class Device:
+    """handsfree_host on a pseudo terminal, with loss injected on the host side"""
+
+    def __init__(self, binary, seed=1, env_extra=None):
+        env = dict(os.environ)
+        env.pop('HANDSFREE_SOCKET', None)
+        env.update(env_extra or {})
+        self.proc = subprocess.Popen([binary], stdout=subprocess.PIPE, env=env)
+        line = self.proc.stdout.readline().decode()
+        m = re.search(r'pty (\S+)', line)
+        if not m:
+            self.close()
+            sys.exit('%s: no pty in "%s"' % (binary, line.strip()))
+        self.fd = os.open(m.group(1), os.O_RDWR | os.O_NOCTTY)
+        self.loss = 0.0
+        self.corrupt = 0.0
+        self.rng = random.Random(seed)
+        self.rx = bytearray()
+        self.dropped = 0
+        self.corrupted = 0
+
+    def close(self):
+        self.proc.kill()
+        self.proc.wait()
+
+    def _impair(self, pkt):
+        """The packet as it comes out of the link, None if lost"""
+        if self.loss and self.rng.random() < self.loss:
+            self.dropped += 1
+            return None
+        if self.corrupt and len(pkt) > 5 and self.rng.random() < self.corrupt:
+            pkt = bytearray(pkt)
+            pkt[self.rng.randrange(5, len(pkt))] ^= 1 << self.rng.randrange(8)
+            self.corrupted += 1
+        return bytes(pkt)
+
+    def send(self, opcode, payload=b''):
+        pkt = self._impair(packet(opcode, payload))
+        if pkt:
+            os.write(self.fd, pkt)
+
+    def receive(self, timeout):
+        """Next packet as (opcode, payload), None on timeout"""
+        deadline = time.monotonic() + timeout
+        while True:
+            while self.rx and self.rx[0] != PACKET_TYPE:
+                del self.rx[0]
+            if len(self.rx) >= 5:
+                opcode, length = struct.unpack_from('<HH', self.rx, 1)
+                if len(self.rx) >= 5 + length:
+                    pkt = bytes(self.rx[:5 + length])
+                    del self.rx[:5 + length]
+                    pkt = self._impair(pkt)
+                    if pkt:
+                        return opcode, pkt[5:]
+                    continue
+            left = deadline - time.monotonic()
+            if left <= 0 or not select.select([self.fd], [], [], left)[0]:
+                return None
+            self.rx += os.read(self.fd, 4096)
+
+    def drain(self, timeout=0.05):
+        while self.receive(timeout) is not None:
+            pass
+
+
+class Result:
+    def __init__(self, name):
+        self.name = name
+        self.good = 0
+        self.bad = 0
+        self.resends = 0
+        self.bytes = 0
+        self.latency = []
+        self.elapsed = 0.0
+
+    def report(self, loss, corrupt, dropped, corrupted):
+        lat = sorted(self.latency) or [0.0]
+        pct = lambda p: lat[min(len(lat) - 1, int(p * len(lat)))] * 1000
+        print('%-3s loss %4.1f%% corrupt %4.1f%%  goodput %7.0f B/s  good %5d  bad %3d  resent %5d  '
+              'dropped %4d  corrupted %4d  latency p50 %6.2f p99 %7.2f max %7.2f ms'
+              % (self.name, loss * 100, corrupt * 100, self.bytes / self.elapsed if self.elapsed else 0,
+                 self.good, self.bad, self.resends, dropped, corrupted, pct(0.5), pct(0.99), lat[-1] * 1000))
+
+
+def run_v1(dev, expected, count, timeout):
+    res = Result('v1')
+    start = time.monotonic()
+    for _ in range(count):
+        first = time.monotonic()
+        while True:
+            dev.send(HCI_CONTROL_MISC_COMMAND_GET_VERSION)
+            answer = dev.receive(timeout)
+            while answer is not None and answer[0] != HCI_CONTROL_MISC_EVENT_VERSION:
+                answer = dev.receive(timeout)
+            if answer is not None:
+                break
+            res.resends += 1
+        res.latency.append(time.monotonic() - first)
+        if answer[1] == expected:
+            res.good += 1
+            res.bytes += len(expected)
+        else:
+            res.bad += 1
+    res.elapsed = time.monotonic() - start
+    return res
+
+
+class V2Link:
+    """Host side of protocol v2, see handsfree_hci_v2.c"""
+
+    def __init__(self, dev, window, timeout):
+        self.dev = dev
+        self.window = window
+        self.timeout = timeout
+        self.tx_seq = 0             # Seq of the next new frame
+        self.tx_base = 0            # Oldest unacked
+        self.rx_expected = 0
+        self.unacked = []           # (seq, opcode, payload)
+        self.sent_at = 0.0
+        self.resends = 0
+
+    def _frame(self, seq, opcode, payload):
+        body = struct.pack('<BBHH', seq, self.rx_expected, opcode, len(payload)) + payload
+        return body + struct.pack('<H', crc16(body))
+
+    def _transmit(self, seq, opcode, payload):
+        self.dev.send(HCI_CONTROL_MISC_COMMAND_V2_FRAME, self._frame(seq, opcode, payload))
+        self.sent_at = time.monotonic()
+
+    def can_send(self):
+        return len(self.unacked) < self.window
+
+    def send(self, opcode, payload=b''):
+        self.unacked.append((self.tx_seq, opcode, payload))
+        self._transmit(self.tx_seq, opcode, payload)
+        self.tx_seq = (self.tx_seq + 1) & 0xFF
+
+    def _ack(self):
+        self.dev.send(HCI_CONTROL_MISC_COMMAND_V2_FRAME, self._frame(self.tx_seq, 0, b''))
+
+    def poll(self, timeout):
+        """Deliver the next in order event as (opcode, payload), None if there was none"""
+        deadline = time.monotonic() + timeout
+        while True:
+            if self.unacked and time.monotonic() - self.sent_at > self.timeout:
+                for frame in self.unacked:
+                    self._transmit(*frame)
+                    self.resends += 1
+            left = min(deadline - time.monotonic(), self.timeout)
+            if left <= 0:
+                return None
+            pkt = self.dev.receive(left)
+            if pkt is None or pkt[0] != HCI_CONTROL_MISC_EVENT_V2_FRAME:
+                continue
+            data = pkt[1]
+            if len(data) < V2_OVERHEAD or crc16(data[:-2]) != struct.unpack_from('<H', data, len(data) - 2)[0]:
+                self._ack()
+                continue
+            seq, ack, opcode, length = struct.unpack_from('<BBHH', data)
+            if length + V2_OVERHEAD != len(data):
+                continue
+            acked = (ack - self.tx_base) & 0xFF
+            if 0 < acked <= len(self.unacked):
+                del self.unacked[:acked]
+                self.tx_base = ack
+                self.sent_at = time.monotonic()
+            if opcode == 0:
+                continue
+            if seq != self.rx_expected:
+                self._ack()
+                continue
+            self.rx_expected = (self.rx_expected + 1) & 0xFF
+            self._ack()
+            return opcode, data[6:6 + length]
+
+
+def run_v2(dev, expected, count, window, timeout):
+    res = Result('v2')
+    link = V2Link(dev, window, timeout)
+    sent = []
+    start = time.monotonic()
+    while res.good + res.bad < count:
+        while link.can_send() and len(sent) < count:
+            sent.append(time.monotonic())
+            link.send(HCI_CONTROL_MISC_COMMAND_GET_VERSION)
+        answer = link.poll(timeout)
+        if answer is None or answer[0] != HCI_CONTROL_MISC_EVENT_VERSION:
+            continue
+        res.latency.append(time.monotonic() - sent[res.good + res.bad])
+        if answer[1] == expected:
+            res.good += 1
+            res.bytes += len(expected)
+        else:
+            res.bad += 1
+    res.elapsed = time.monotonic() - start
+    res.resends = link.resends
+    return res
+
+
+def set_protocol(dev, version, window):
+    dev.send(HCI_CONTROL_MISC_COMMAND_SET_PROTOCOL, bytes([version, window]))
+    while True:
+        answer = dev.receive(1.0)
+        if answer is None:
+            sys.exit('no answer to SET_PROTOCOL')
+        if answer[0] == HCI_CONTROL_EVENT_COMMAND_STATUS:
+            return
+
+
+def protocol(args):
+    for loss in [float(v) for v in args.loss.split(',')]:
+        for version in (1, 2):
+            dev = Device(args.binary, seed=args.seed)
+            try:
+                dev.drain()
+                dev.send(HCI_CONTROL_MISC_COMMAND_GET_VERSION)
+                expected = dev.receive(1.0)
+                if expected is None:
+                    sys.exit('no answer to GET_VERSION')
+                if version == 2:
+                    set_protocol(dev, 2, args.window)
+                dev.loss = loss
+                dev.corrupt = args.corrupt
+                if version == 1:
+                    res = run_v1(dev, expected[1], args.commands, args.v1_timeout / 1000)
+                else:
+                    res = run_v2(dev, expected[1], args.commands, args.window, args.v2_timeout / 1000)
+                res.report(loss, args.corrupt, dev.dropped, dev.corrupted)
+            finally:
+                dev.close()
+
+
+def get_counters(dev, names):
+    """Counters as a dict, cleared on the device. Also returns how many requests it took,
+    a request is dropped like any other command while the receive buffers are held."""
+    for attempt in range(1, 50):
+        dev.send(HCI_CONTROL_MISC_COMMAND_GET_COUNTERS, b'\x01')
+        while True:
+            answer = dev.receive(0.1)
+            if answer is None:
+                break
+            if answer[0] == HCI_CONTROL_MISC_EVENT_COUNTERS:
+                count = answer[1][0]
+                values = struct.unpack_from('<%dI' % count, answer[1], 1)
+                return dict(zip(names, values)), attempt
+    sys.exit('no answer to GET_COUNTERS')
+
+
+def burst(args):
+    names = counter_names()
+    bond = struct.pack('<H', 0x0010) + bytes(range(128))
+    record = struct.pack('<H', 0x0100) + bytes(i & 0xff for i in range(512))
+    cases = [('bond', bond, 1), ('record 512', record, 1), ('v2 bond', bond, 2), ('v2 record 512', record, 2)]
+
+    print('%-14s %6s %9s %8s %9s %8s %9s' % ('command', 'burst', 'accepted', 'dropped', 'accept %', 'copied', 'in place'))
+    for name, payload, version in cases:
+        for n in [int(v) for v in args.bursts.split(',')]:
+            if version == 2 and n > 8:
+                continue
+            dev = Device(args.binary, seed=args.seed, env_extra={'HANDSFREE_BUSY': '1', 'HANDSFREE_BAUD': str(args.baud)})
+            try:
+                dev.drain()
+                get_counters(dev, names)
+                extra = 0
+                if version == 2:
+                    set_protocol(dev, 2, 8)
+                    burst_bytes = b''.join(packet(HCI_CONTROL_MISC_COMMAND_V2_FRAME,
+                                                  v2_frame(seq, 0, HCI_CONTROL_COMMAND_PUSH_NVRAM_DATA, payload))
+                                           for seq in range(n))
+                    extra = 2
+                else:
+                    burst_bytes = packet(HCI_CONTROL_COMMAND_PUSH_NVRAM_DATA, payload) * n
+                os.write(dev.fd, burst_bytes)
+                time.sleep(n * 0.0015 + 0.1)
+                if version == 2:
+                    set_protocol(dev, 1, 0)
+                counters, attempts = get_counters(dev, names)
+                accepted = counters['RX_PACKETS'] - 1 - extra
+                dropped = counters['RX_OVERFLOW'] - (attempts - 1)
+                print('%-14s %6d %9d %8d %8.1f%% %8d %9d'
+                      % (name, n, accepted, dropped, 100.0 * accepted / n, counters['RX_EARLY_RELEASE'] - 1 - extra,
+                         counters['RX_IN_PLACE']))
+            finally:
+                dev.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('--binary', default=os.path.join(os.path.dirname(os.path.abspath(__file__)), 'out', 'handsfree_host'))
+    parser.add_argument('--seed', type=int, default=1)
+    sub = parser.add_subparsers(dest='command', required=True)
+
+    p = sub.add_parser('protocol', help='v1 and v2 goodput and latency with loss')
+    p.add_argument('--loss', default='0,0.01,0.05', help='comma separated packet loss rates')
+    p.add_argument('--corrupt', type=float, default=0.01, help='payload corruption rate')
+    p.add_argument('--commands', type=int, default=500)
+    p.add_argument('--window', type=int, default=8)
+    p.add_argument('--v1-timeout', type=float, default=50.0, help='ms')
+    p.add_argument('--v2-timeout', type=float, default=50.0, help='ms')
+
+    p = sub.add_parser('burst', help='commands accepted from back to back bursts')
+    p.add_argument('--bursts', default='1,2,4,8,16,32', help='comma separated burst sizes')
+    p.add_argument('--baud', type=int, default=3000000)
+    args = parser.parse_args()
+
+    if args.command == 'protocol':
+        protocol(args)
+    elif args.command == 'burst':
+        burst(args)
+
+
+if __name__ == '__main__':
+    main()
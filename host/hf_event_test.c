@@ -0,0 +1,357 @@
+/*
+ * Copyright 2016-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+
+/** @file
+ *
+ * Golden file test of the HF event serializer.
+ *
+ * Every HF event and every AT response event is passed through
+ * hci_control_send_hf_event() and the frame the application sends, 0x19 opcode(2)
+ * length(2) payload, is compared with golden/hf_events/<name>.bin. The golden files
+ * are the wire contract of the layout table above hci_control_send_hf_event(); a
+ * serializer change that moves a byte fails here.
+ *
+ * The CIEV, CLCC and BIND cases go through the HFP event callback instead, which
+ * formats the indicator and call fields into the string, and end up in the same
+ * serializer buffer.
+ *
+ * Usage: hf_event_test [-u] [-b iterations] [golden directory]
+ *   -u  write the golden files from the current serializer instead of comparing
+ *   -b  also report the serializer cost in ns per event, measured per case
+ */
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "wiced_stub.h"
+#include "handsfree.h"
+#include "loopback_transport.h"
+
+extern void application_start( void );
+extern void hci_control_send_hf_event( uint16_t evt, uint16_t handle, hci_control_hf_event_t *p_data );
+
+#define HF_EVENT_TEST_HANDLE        0x0102
+#define HF_EVENT_TEST_FRAME_MAX     ( 1 + 4 + 2 + 2 + WICED_BT_HFP_HF_MAX_AT_CMD_LEN )
+
+static const wiced_bt_device_address_t hf_event_test_ag = { 0x20, 0x81, 0x9a, 0x10, 0xff, 0xee };
+
+typedef struct
+{
+    const char *name;
+    uint16_t    evt;
+    wiced_bool_t no_data;               /* Sent with p_data NULL as the application does */
+    void      (*p_fill)( hci_control_hf_event_t *p_data );
+} hf_event_case_t;
+
+typedef struct
+{
+    const char                 *name;
+    wiced_bt_hfp_hf_event_t     event;
+    void                      (*p_fill)( wiced_bt_hfp_hf_event_data_t *p_data );
+} hf_callback_case_t;
+
+static void fill_open( hci_control_hf_event_t *p_data )
+{
+    static const BD_ADDR bd_addr = { 0x20, 0x81, 0x9a, 0x10, 0xff, 0xee };
+
+    memcpy( p_data->open.bd_addr, bd_addr, BD_ADDR_LEN );
+    p_data->open.status = 0x05;
+}
+
+static void fill_connected( hci_control_hf_event_t *p_data )
+{
+    p_data->conn.peer_features    = 0x000016ef;
+    p_data->conn.profile_selected = 0x01;
+}
+
+static void fill_num( hci_control_hf_event_t *p_data )
+{
+    p_data->val.num = 0x0a0b;
+}
+
+static void fill_string( hci_control_hf_event_t *p_data )
+{
+    p_data->val.num = 1;
+    strcpy( p_data->val.str, "\"+15551234567\",145" );
+}
+
+/* The longest string the profile hands over, the serializer buffer must hold it */
+static void fill_max( hci_control_hf_event_t *p_data )
+{
+    p_data->val.num = 0xffff;
+    memset( p_data->val.str, 'x', WICED_BT_HFP_HF_MAX_AT_CMD_LEN - 1 );
+    p_data->val.str[WICED_BT_HFP_HF_MAX_AT_CMD_LEN - 1] = '\0';
+}
+
+#define HF_AT( n )  ( HCI_CONTROL_HF_AT_EVENT_BASE + HCI_CONTROL_HF_AT_EVENT_##n )
+
+static const hf_event_case_t hf_event_cases[] =
+{
+    { "open",               HCI_CONTROL_HF_EVENT_OPEN,          WICED_FALSE, fill_open },
+    { "close",              HCI_CONTROL_HF_EVENT_CLOSE,         WICED_TRUE,  NULL },
+    { "audio_open",         HCI_CONTROL_HF_EVENT_AUDIO_OPEN,    WICED_TRUE,  NULL },
+    { "audio_close",        HCI_CONTROL_HF_EVENT_AUDIO_CLOSE,   WICED_TRUE,  NULL },
+    { "connected",          HCI_CONTROL_HF_EVENT_CONNECTED,     WICED_FALSE, fill_connected },
+    { "profile_type",       HCI_CONTROL_HF_EVENT_PROFILE_TYPE,  WICED_FALSE, fill_connected },
+    { "at_ok",              HF_AT( OK ),                        WICED_FALSE, NULL },
+    { "at_ok_no_data",      HF_AT( OK ),                        WICED_TRUE,  NULL },
+    { "at_error",           HF_AT( ERROR ),                     WICED_FALSE, NULL },
+    { "at_cmee",            HF_AT( CMEE ),                      WICED_FALSE, fill_num },
+    { "at_ring",            HF_AT( RING ),                      WICED_FALSE, NULL },
+    { "at_vgs",             HF_AT( VGS ),                       WICED_FALSE, fill_num },
+    { "at_vgm",             HF_AT( VGM ),                       WICED_FALSE, fill_num },
+    { "at_ccwa",            HF_AT( CCWA ),                      WICED_FALSE, fill_string },
+    { "at_chld",            HF_AT( CHLD ),                      WICED_FALSE, fill_string },
+    { "at_cind",            HF_AT( CIND ),                      WICED_FALSE, fill_string },
+    { "at_clip",            HF_AT( CLIP ),                      WICED_FALSE, fill_string },
+    { "at_ciev",            HF_AT( CIEV ),                      WICED_FALSE, fill_num },
+    { "at_binp",            HF_AT( BINP ),                      WICED_FALSE, fill_string },
+    { "at_bvra",            HF_AT( BVRA ),                      WICED_FALSE, fill_num },
+    { "at_bsir",            HF_AT( BSIR ),                      WICED_FALSE, fill_num },
+    { "at_cnum",            HF_AT( CNUM ),                      WICED_FALSE, fill_string },
+    { "at_btrh",            HF_AT( BTRH ),                      WICED_FALSE, fill_num },
+    { "at_cops",            HF_AT( COPS ),                      WICED_FALSE, fill_string },
+    { "at_clcc",            HF_AT( CLCC ),                      WICED_FALSE, fill_string },
+    { "at_bind",            HF_AT( BIND ),                      WICED_FALSE, fill_string },
+    { "at_bcs",             HF_AT( BCS ),                       WICED_FALSE, fill_num },
+    { "at_unat",            HF_AT( UNAT ),                      WICED_FALSE, fill_string },
+    { "at_unat_max",        HF_AT( UNAT ),                      WICED_FALSE, fill_max },
+};
+
+static void fill_cb_battery( wiced_bt_hfp_hf_event_data_t *p_data )
+{
+    p_data->battery_level = 4;
+}
+
+static void fill_cb_signal( wiced_bt_hfp_hf_event_data_t *p_data )
+{
+    p_data->rssi = 5;
+}
+
+static void fill_cb_call( wiced_bt_hfp_hf_event_data_t *p_data )
+{
+    p_data->active_call.idx    = 1;
+    p_data->active_call.status = 4;
+    strcpy( p_data->active_call.num, "\"+15551234567\"" );
+    p_data->active_call.type   = 145;
+}
+
+static void fill_cb_call_no_number( wiced_bt_hfp_hf_event_data_t *p_data )
+{
+    p_data->active_call.idx           = 2;
+    p_data->active_call.dir           = 1;
+    p_data->active_call.status        = 1;
+    p_data->active_call.is_conference = 1;
+}
+
+/* The longest number the profile hands over */
+static void fill_cb_call_max( wiced_bt_hfp_hf_event_data_t *p_data )
+{
+    p_data->active_call.idx  = 7;
+    memset( p_data->active_call.num, '9', sizeof( p_data->active_call.num ) - 1 );
+    p_data->active_call.type = 129;
+}
+
+static void fill_cb_bind( wiced_bt_hfp_hf_event_data_t *p_data )
+{
+    p_data->bind_data.ind_id    = 2;
+    p_data->bind_data.ind_value = 1;
+}
+
+static const hf_callback_case_t hf_callback_cases[] =
+{
+    { "cb_ciev_battery",    WICED_BT_HFP_HF_BATTERY_STATUS_IND_EVT, fill_cb_battery },
+    { "cb_ciev_signal",     WICED_BT_HFP_HF_RSSI_IND_EVT,           fill_cb_signal },
+    { "cb_clcc",            WICED_BT_HFP_HFP_ACTIVE_CALL_EVT,       fill_cb_call },
+    { "cb_clcc_no_number",  WICED_BT_HFP_HFP_ACTIVE_CALL_EVT,       fill_cb_call_no_number },
+    { "cb_clcc_max",        WICED_BT_HFP_HFP_ACTIVE_CALL_EVT,       fill_cb_call_max },
+    { "cb_bind",            WICED_BT_HFP_HF_BIND_EVT,               fill_cb_bind },
+};
+
+static void hf_event_send( const hf_event_case_t *p_case, hci_control_hf_event_t *p_data )
+{
+    hci_control_send_hf_event( p_case->evt, HF_EVENT_TEST_HANDLE, p_case->no_data ? NULL : p_data );
+}
+
+static size_t hf_event_read_file( const char *p_path, uint8_t *p_buf, size_t max )
+{
+    FILE   *fp = fopen( p_path, "rb" );
+    size_t  n;
+
+    if ( fp == NULL )
+        return 0;
+    n = fread( p_buf, 1, max, fp );
+    fclose( fp );
+    return n;
+}
+
+static int hf_event_compare( const char *p_dir, const char *p_name, const uint8_t *p_frame, size_t len,
+                             wiced_bool_t update )
+{
+    uint8_t                golden[HF_EVENT_TEST_FRAME_MAX + 1];
+    char                   path[256];
+    size_t                 golden_len, i;
+    FILE                  *fp;
+
+    snprintf( path, sizeof( path ), "%s/%s.bin", p_dir, p_name );
+
+    if ( update )
+    {
+        if ( ( fp = fopen( path, "wb" ) ) == NULL || fwrite( p_frame, 1, len, fp ) != len )
+        {
+            printf( "%s: %s\n", path, strerror( errno ) );
+            return 1;
+        }
+        fclose( fp );
+        return 0;
+    }
+
+    if ( ( golden_len = hf_event_read_file( path, golden, sizeof( golden ) ) ) == 0 )
+    {
+        printf( "%-16s missing %s\n", p_name, path );
+        return 1;
+    }
+    if ( ( len != golden_len ) || memcmp( p_frame, golden, len ) )
+    {
+        for ( i = 0; ( i < len ) && ( i < golden_len ) && ( p_frame[i] == golden[i] ); i++ )
+            ;
+        printf( "%-16s differs at byte %zu: %zu bytes sent, %zu in %s\n", p_name, i, len, golden_len, path );
+        return 1;
+    }
+    return 0;
+}
+
+static int hf_event_check( const char *p_dir, const hf_event_case_t *p_case, wiced_bool_t update )
+{
+    hci_control_hf_event_t data;
+    uint8_t                frame[HF_EVENT_TEST_FRAME_MAX + 1];
+    size_t                 len;
+
+    memset( &data, 0, sizeof( data ) );
+    if ( p_case->p_fill )
+        p_case->p_fill( &data );
+
+    hf_event_send( p_case, &data );
+    len = loopback_read( frame, sizeof( frame ) );
+    return hf_event_compare( p_dir, p_case->name, frame, len, update );
+}
+
+static int hf_callback_check( const char *p_dir, const hf_callback_case_t *p_case, wiced_bool_t update )
+{
+    wiced_bt_hfp_hf_event_data_t data;
+    uint8_t                      frame[HF_EVENT_TEST_FRAME_MAX + 1];
+    size_t                       len;
+
+    memset( &data, 0, sizeof( data ) );
+    data.handle = HF_EVENT_TEST_HANDLE;
+    p_case->p_fill( &data );
+
+    wiced_stub_hfp_event( p_case->event, &data );
+    while ( wiced_stub_run_pending( ) )
+        ;
+    len = loopback_read( frame, sizeof( frame ) );
+    return hf_event_compare( p_dir, p_case->name, frame, len, update );
+}
+
+static void hf_event_bench( const hf_event_case_t *p_case, int iterations )
+{
+    hci_control_hf_event_t data;
+    uint8_t                frame[HF_EVENT_TEST_FRAME_MAX];
+    struct timespec        start, end;
+    int                    i;
+
+    memset( &data, 0, sizeof( data ) );
+    if ( p_case->p_fill )
+        p_case->p_fill( &data );
+
+    clock_gettime( CLOCK_MONOTONIC, &start );
+    for ( i = 0; i < iterations; i++ )
+    {
+        hf_event_send( p_case, &data );
+        loopback_read( frame, sizeof( frame ) );
+    }
+    clock_gettime( CLOCK_MONOTONIC, &end );
+
+    printf( "%-16s %8.1f ns/event\n", p_case->name,
+            ( ( end.tv_sec - start.tv_sec ) * 1e9 + ( end.tv_nsec - start.tv_nsec ) ) / iterations );
+}
+
+int main( int argc, char *argv[] )
+{
+    const char   *p_dir = "golden/hf_events";
+    wiced_bool_t  update = WICED_FALSE;
+    int           iterations = 0, failed = 0, opt;
+    uint8_t       drain[256];
+    size_t        i;
+
+    while ( ( opt = getopt( argc, argv, "ub:" ) ) != -1 )
+    {
+        switch ( opt )
+        {
+        case 'u': update = WICED_TRUE;      break;
+        case 'b': iterations = atoi( optarg ); break;
+        default:
+            fprintf( stderr, "usage: %s [-u] [-b iterations] [golden directory]\n", argv[0] );
+            return 2;
+        }
+    }
+    if ( optind < argc )
+        p_dir = argv[optind];
+
+    application_start( );
+    while ( wiced_stub_run_pending( ) )
+        ;
+    while ( loopback_read( drain, sizeof( drain ) ) )
+        ;
+
+    for ( i = 0; i < sizeof( hf_event_cases ) / sizeof( hf_event_cases[0] ); i++ )
+        failed += hf_event_check( p_dir, &hf_event_cases[i], update );
+
+    wiced_stub_hfp_add_scb( HF_EVENT_TEST_HANDLE, hf_event_test_ag, WICED_BT_HFP_AG_FEATURE_HF_INDICATORS );
+    for ( i = 0; i < sizeof( hf_callback_cases ) / sizeof( hf_callback_cases[0] ); i++ )
+        failed += hf_callback_check( p_dir, &hf_callback_cases[i], update );
+
+    if ( iterations > 0 )
+        for ( i = 0; i < sizeof( hf_event_cases ) / sizeof( hf_event_cases[0] ); i++ )
+            hf_event_bench( &hf_event_cases[i], iterations );
+
+    if ( failed )
+        printf( "%d of %zu HF events differ from the golden files\n", failed,
+                sizeof( hf_event_cases ) / sizeof( hf_event_cases[0] ) + sizeof( hf_callback_cases ) / sizeof( hf_callback_cases[0] ) );
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,112 @@
+#!/usr/bin/env python3
+#
+# Copyright 2016-2024, Cypress Semiconductor Corporation (an Infineon company) or
+# an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+#
+# This software, including source code, documentation and related
+# materials ("Software") is owned by Cypress Semiconductor Corporation
+# or one of its affiliates ("Cypress") and is protected by and subject to
+# worldwide patent protection (United States and foreign),
+# United States copyright laws and international treaty provisions.
+# Therefore, you may use this Software only as provided in the license
+# agreement accompanying the software package from which you
+# obtained this Software ("EULA").
+# If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+# non-transferable license to copy, modify, and compile the Software
+# source code solely for use in connection with Cypress's
+# integrated circuit products.  Any reproduction, modification, translation,
+# compilation, or representation of this Software except as specified
+# above is prohibited without the express written permission of Cypress.
+#
+# Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+# EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+# reserves the right to make changes to the Software without notice. Cypress
+# does not assume any liability arising out of the application or use of the
+# Software or any product or circuit described in the Software. Cypress does
+# not authorize its products for use in any products where a malfunction or
+# failure of the Cypress product may reasonably be expected to result in
+# significant property damage, injury or death ("High Risk Product"). By
+# including Cypress's product in a High Risk Product, the manufacturer
+# of such system or application assumes all risk of such use and in doing
+# so agrees to indemnify Cypress against all liability.
+#
+"""
+Choose the functions to place in RAM for an XIP build from a call count profile.
+
+Inputs:
+  counts   text file with one "<function> <calls>" pair per line, e.g. collected with
+           -finstrument-functions or a debugger counting breakpoint hits
+  symbols  output of "arm-none-eabi-nm --print-size --size-sort <app>.elf"
+
+Functions are picked by calls per byte until the RAM budget is used. The result is
+printed either as the list of functions to tag HANDSFREE_HOT, or as an input section
+list for the linker script of a build compiled with -ffunction-sections.
+
+    hot_placement.py counts.txt symbols.txt --budget 2048 [--ld]
+"""
+
+import argparse
+import sys
+
+
+def read_counts(path):
+    counts = {}
+    with open(path) as f:
+        for line in f:
+            fields = line.split()
+            if len(fields) >= 2 and not fields[0].startswith('#'):
+                counts[fields[0]] = counts.get(fields[0], 0) + int(fields[1], 0)
+    return counts
+
+
+def read_sizes(path):
+    sizes = {}
+    with open(path) as f:
+        for line in f:
+            # address size type name
+            fields = line.split()
+            if len(fields) == 4 and fields[2] in ('T', 't'):
+                sizes[fields[3]] = int(fields[1], 16)
+    return sizes
+
+
+def select(counts, sizes, budget):
+    candidates = [(calls / sizes[name], name, sizes[name], calls)
+                  for name, calls in counts.items() if name in sizes and sizes[name] > 0 and calls > 0]
+    candidates.sort(reverse=True)
+
+    chosen, used = [], 0
+    for _, name, size, calls in candidates:
+        if used + size <= budget:
+            chosen.append((name, size, calls))
+            used += size
+    return chosen, used
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument('counts')
+    parser.add_argument('symbols')
+    parser.add_argument('--budget', type=lambda v: int(v, 0), required=True, help='RAM bytes available for code')
+    parser.add_argument('--ld', action='store_true', help='print linker script input sections')
+    args = parser.parse_args()
+
+    counts = read_counts(args.counts)
+    sizes = read_sizes(args.symbols)
+    missing = sorted(set(counts) - set(sizes))
+    chosen, used = select(counts, sizes, args.budget)
+
+    for name, size, calls in chosen:
+        if args.ld:
+            print('        *(.text.%s)' % name)
+        else:
+            print('%-48s %6d bytes %10d calls' % (name, size, calls))
+
+    print('%d functions, %d of %d bytes' % (len(chosen), used, args.budget), file=sys.stderr)
+    if missing:
+        print('no size for: %s' % ' '.join(missing), file=sys.stderr)
+
+
+if __name__ == '__main__':
+    main()
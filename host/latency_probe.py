@@ -0,0 +1,224 @@
+#!/usr/bin/env python3
+#
+# Copyright 2016-2024, Cypress Semiconductor Corporation (an Infineon company) or
+# an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+#
+# This software, including source code, documentation and related
+# materials ("Software") is owned by Cypress Semiconductor Corporation
+# or one of its affiliates ("Cypress") and is protected by and subject to
+# worldwide patent protection (United States and foreign),
+# United States copyright laws and international treaty provisions.
+# Therefore, you may use this Software only as provided in the license
+# agreement accompanying the software package from which you
+# obtained this Software ("EULA").
+# If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+# non-transferable license to copy, modify, and compile the Software
+# source code solely for use in connection with Cypress's
+# integrated circuit products.  Any reproduction, modification, translation,
+# compilation, or representation of this Software except as specified
+# above is prohibited without the express written permission of Cypress.
+#
+# Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+# EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+# reserves the right to make changes to the Software without notice. Cypress
+# does not assume any liability arising out of the application or use of the
+# Software or any product or circuit described in the Software. Cypress does
+# not authorize its products for use in any products where a malfunction or
+# failure of the Cypress product may reasonably be expected to result in
+# significant property damage, injury or death ("High Risk Product"). By
+# including Cypress's product in a High Risk Product, the manufacturer
+# of such system or application assumes all risk of such use and in doing
+# so agrees to indemnify Cypress against all liability.
+"""
+Mouth-to-ear latency measurement with a maximum length sequence (MLS).
+
+The test signal is one period of an MLS. It is played into the mic path at one end of
+the loop and recorded at every tap along the way: the uplink at the AG, the downlink the
+AG sends back, and the speaker output of the device. The delay of each tap is the peak
+of its cross-correlation with the test signal, the difference between two taps is the
+latency of the stages between them.
+
+    latency_probe.py mls test.wav [--order 13] [--rate 16000]
+    latency_probe.py measure test.wav ag_rx.wav speaker.wav
+    latency_probe.py simulate [--codec msbc|cvsd] [--ag-ms 20] [--cfg ../handsfree_bt_cfg.c]
+
+simulate runs the test without hardware. The device pipeline is modelled as a chain of
+stages with a stand-in AG that loops the uplink back to the downlink, each stage is
+taken as a pure delay:
+  codec_in, codec_out   half of the audio codec buffer per direction, double buffered,
+                        audio_codec_buffer_size is read from handsfree_audio_buf_config
+  sco_tx, sco_rx        one SCO packet interval, 7.5 ms for mSBC and 3.75 ms for CVSD
+  ag                    the stand-in AG, --ag-ms
+Seeded noise is added at every stage so the number is reproducible. The model shows the
+effect of a buffering change, it does not predict the hardware; measure gives those.
+"""
+
+import argparse
+import cmath
+import random
+import re
+import struct
+import sys
+import wave
+
+SCO_INTERVAL_MS = {'msbc': 7.5, 'cvsd': 3.75}
+CODEC_RATE = {'msbc': 16000, 'cvsd': 8000}
+MLS_TAPS = {10: (10, 7), 11: (11, 9), 12: (12, 11, 10, 4), 13: (13, 12, 11, 8), 14: (14, 13, 12, 2), 15: (15, 14)}
+AMPLITUDE = 8000
+
+
+def mls(order):
+    """One period of an MLS as +1/-1, from a Fibonacci LFSR"""
+    taps = MLS_TAPS[order]
+    state = (1 << order) - 1
+    out = []
+    for _ in range((1 << order) - 1):
+        out.append(1 if state & 1 else -1)
+        bit = 0
+        for t in taps:
+            bit ^= (state >> (order - t)) & 1
+        state = (state >> 1) | (bit << (order - 1))
+    return out
+
+
+def read_wav(path):
+    with wave.open(path, 'rb') as w:
+        if w.getsampwidth() != 2:
+            sys.exit('%s: 16-bit samples expected' % path)
+        rate, channels = w.getframerate(), w.getnchannels()
+        frames = w.readframes(w.getnframes())
+    samples = struct.unpack('<%dh' % (len(frames) // 2), frames)
+    return rate, list(samples[::channels])
+
+
+def write_wav(path, rate, samples):
+    with wave.open(path, 'wb') as w:
+        w.setnchannels(1)
+        w.setsampwidth(2)
+        w.setframerate(rate)
+        w.writeframes(struct.pack('<%dh' % len(samples), *[max(-32768, min(32767, int(s))) for s in samples]))
+
+
+def _fft(a, invert=False):
+    n = len(a)
+    j = 0
+    for i in range(1, n):
+        bit = n >> 1
+        while j & bit:
+            j ^= bit
+            bit >>= 1
+        j |= bit
+        if i < j:
+            a[i], a[j] = a[j], a[i]
+    size = 2
+    while size <= n:
+        w_step = cmath.exp((2j if invert else -2j) * cmath.pi / size)
+        half = size // 2
+        for start in range(0, n, size):
+            w = 1
+            for k in range(start, start + half):
+                u, v = a[k], a[k + half] * w
+                a[k], a[k + half] = u + v, u - v
+                w *= w_step
+        size *= 2
+    return a
+
+
+def delay_of(reference, capture):
+    """Lag in samples, fractional, at which reference best matches capture"""
+    n = 1
+    while n < len(reference) + len(capture):
+        n *= 2
+    ref = _fft([complex(s) for s in reference] + [0j] * (n - len(reference)))
+    cap = _fft([complex(s) for s in capture] + [0j] * (n - len(capture)))
+    xc = _fft([c * r.conjugate() for c, r in zip(cap, ref)], invert=True)
+    corr = [v.real for v in xc[:len(capture)]]
+    peak = max(range(len(corr)), key=lambda i: corr[i])
+    if 0 < peak < len(corr) - 1:
+        # Parabolic interpolation between the neighbours of the peak
+        y0, y1, y2 = corr[peak - 1], corr[peak], corr[peak + 1]
+        denom = y0 - 2 * y1 + y2
+        if denom:
+            return peak + 0.5 * (y0 - y2) / denom
+    return float(peak)
+
+
+def report(names, delays, rate):
+    previous = 0.0
+    for name, d in zip(names, delays):
+        print('%-16s %8.2f ms  (+%.2f ms)' % (name, 1000.0 * d / rate, 1000.0 * (d - previous) / rate))
+        previous = d
+    print('%-16s %8.2f ms' % ('end to end', 1000.0 * delays[-1] / rate))
+
+
+def codec_buffer_size(path):
+    with open(path) as f:
+        m = re.search(r'\.audio_codec_buffer_size\s*=\s*(0x[0-9a-fA-F]+|\d+)', f.read())
+    if not m:
+        sys.exit('%s: audio_codec_buffer_size not found' % path)
+    return int(m.group(1), 0)
+
+
+def simulate(args):
+    rate = CODEC_RATE[args.codec]
+    buffer_size = args.codec_buffer if args.codec_buffer is not None else codec_buffer_size(args.cfg)
+    codec_ms = 1000.0 * (buffer_size / 2 / 2 / 2) / rate       # per direction, double buffered, 16-bit
+    stages = [('codec_in', codec_ms), ('sco_tx', SCO_INTERVAL_MS[args.codec]), ('ag', args.ag_ms),
+              ('sco_rx', SCO_INTERVAL_MS[args.codec]), ('codec_out', codec_ms)]
+
+    rng = random.Random(args.seed)
+    reference = [AMPLITUDE * s for s in mls(args.order)]
+    signal = reference + [0] * int(rate * sum(ms for _, ms in stages) / 1000 + rate // 10)
+    delays, total = [], 0
+    for name, ms in stages:
+        shift = int(round(rate * ms / 1000))
+        signal = [0] * shift + signal[:len(signal) - shift]
+        signal = [0.7 * s + rng.gauss(0, AMPLITUDE * args.noise) for s in signal]
+        total += shift
+        delays.append(delay_of(reference, signal))
+
+    print('%s, %d Hz, codec buffer %d bytes, expected %.2f ms' % (args.codec, rate, buffer_size, 1000.0 * total / rate))
+    report([name for name, _ in stages], delays, rate)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    sub = parser.add_subparsers(dest='command', required=True)
+
+    p = sub.add_parser('mls', help='write the test signal')
+    p.add_argument('out')
+    p.add_argument('--order', type=int, default=13, choices=sorted(MLS_TAPS))
+    p.add_argument('--rate', type=int, default=16000)
+
+    p = sub.add_parser('measure', help='latency of recorded taps, in loop order')
+    p.add_argument('reference')
+    p.add_argument('taps', nargs='+')
+
+    p = sub.add_parser('simulate', help='run the test through the pipeline model')
+    p.add_argument('--codec', choices=sorted(SCO_INTERVAL_MS), default='msbc')
+    p.add_argument('--ag-ms', type=float, default=20.0, help='loop delay of the stand-in AG')
+    p.add_argument('--cfg', default='handsfree_bt_cfg.c', help='source of handsfree_audio_buf_config')
+    p.add_argument('--codec-buffer', type=lambda v: int(v, 0), help='audio_codec_buffer_size, instead of --cfg')
+    p.add_argument('--order', type=int, default=12, choices=sorted(MLS_TAPS))
+    p.add_argument('--noise', type=float, default=0.05, help='noise added per stage, relative to the signal')
+    p.add_argument('--seed', type=int, default=1)
+    args = parser.parse_args()
+
+    if args.command == 'mls':
+        write_wav(args.out, args.rate, [AMPLITUDE * s for s in mls(args.order)])
+    elif args.command == 'measure':
+        rate, reference = read_wav(args.reference)
+        delays = []
+        for path in args.taps:
+            tap_rate, capture = read_wav(path)
+            if tap_rate != rate:
+                sys.exit('%s: %d Hz, the test signal is %d Hz' % (path, tap_rate, rate))
+            delays.append(delay_of(reference, capture))
+        report(args.taps, delays, rate)
+    else:
+        simulate(args)
+
+
+if __name__ == '__main__':
+    main()
@@ -0,0 +1,132 @@
+/*
+ * Copyright 2016-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+
+/** @file
+ *
+ * Loopback host transport for benchmarks and tests.
+ *
+ * Takes the place of handsfree_transport_host.c when the application is linked into a
+ * host program: commands are handed to the data handler on the calling thread and the
+ * events the application sends are kept in a buffer, framed as on the WICED HCI UART,
+ * until the program reads them.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "wiced_transport.h"
+#include "handsfree.h"
+#include "loopback_transport.h"
+
+#define LOOPBACK_PACKET_TYPE                0x19    // HCI_WICED_PKT
+#define LOOPBACK_HDR_LEN                    4       // opcode(2) length(2)
+#define LOOPBACK_EVENT_BUFFER_SIZE          65536
+
+static const wiced_transport_cfg_t *p_loopback_cfg;
+static uint8_t                      loopback_events[LOOPBACK_EVENT_BUFFER_SIZE];
+static size_t                       loopback_event_len;
+
+int loopback_command( const uint8_t *p_frame, size_t length )
+{
+    uint8_t *p_packet;
+
+    if ( ( p_loopback_cfg == NULL ) || ( length < 1 + LOOPBACK_HDR_LEN ) || ( p_frame[0] != LOOPBACK_PACKET_TYPE ) ||
+         ( length - 1 > HANDSFREE_CAP_RX_BUFFER_SIZE ) )
+        return -1;
+
+    /* Handler owns the buffer and releases it through free_rx_buffer */
+    if ( ( p_packet = malloc( length - 1 ) ) == NULL )
+        return -1;
+    memcpy( p_packet, p_frame + 1, length - 1 );
+    p_loopback_cfg->p_data_handler( p_packet, length - 1 );
+    return 0;
+}
+
+size_t loopback_read( uint8_t *p_buf, size_t max )
+{
+    size_t n = ( loopback_event_len < max ) ? loopback_event_len : max;
+
+    memcpy( p_buf, loopback_events, n );
+    memmove( loopback_events, loopback_events + n, loopback_event_len - n );
+    loopback_event_len -= n;
+    return n;
+}
+
+static wiced_result_t loopback_init( const wiced_transport_cfg_t *p_cfg )
+{
+    p_loopback_cfg     = p_cfg;
+    loopback_event_len = 0;
+
+    if ( p_cfg->p_status_handler )
+    {
+        p_cfg->p_status_handler( p_cfg->type );
+    }
+    return WICED_SUCCESS;
+}
+
+static wiced_result_t loopback_send( uint16_t code, uint8_t *p_data, uint16_t length, const uint8_t *p_tail, uint16_t tail_length )
+{
+    uint8_t *p;
+
+    /* Full like a UART whose host stopped reading */
+    if ( loopback_event_len + 1 + LOOPBACK_HDR_LEN + length + tail_length > sizeof( loopback_events ) )
+        return WICED_ERROR;
+
+    p    = loopback_events + loopback_event_len;
+    p[0] = LOOPBACK_PACKET_TYPE;
+    p[1] = code & 0xff;
+    p[2] = code >> 8;
+    p[3] = ( length + tail_length ) & 0xff;
+    p[4] = ( length + tail_length ) >> 8;
+    if ( length )
+        memcpy( p + 1 + LOOPBACK_HDR_LEN, p_data, length );
+    if ( tail_length )
+        memcpy( p + 1 + LOOPBACK_HDR_LEN + length, p_tail, tail_length );
+    loopback_event_len += 1 + LOOPBACK_HDR_LEN + length + tail_length;
+    return WICED_SUCCESS;
+}
+
+static void loopback_free_rx_buffer( uint8_t *p_buf )
+{
+    free( p_buf );
+}
+
+static const handsfree_transport_t handsfree_transport_loopback =
+{
+    .init           = loopback_init,
+    .send           = loopback_send,
+    .free_rx_buffer = loopback_free_rx_buffer,
+};
+
+const handsfree_transport_t *p_handsfree_transport = &handsfree_transport_loopback;
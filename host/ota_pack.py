@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+#
+# Copyright 2016-2024, Cypress Semiconductor Corporation (an Infineon company) or
+# an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+#
+# This software, including source code, documentation and related
+# materials ("Software") is owned by Cypress Semiconductor Corporation
+# or one of its affiliates ("Cypress") and is protected by and subject to
+# worldwide patent protection (United States and foreign),
+# United States copyright laws and international treaty provisions.
+# Therefore, you may use this Software only as provided in the license
+# agreement accompanying the software package from which you
+# obtained this Software ("EULA").
+# If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+# non-transferable license to copy, modify, and compile the Software
+# source code solely for use in connection with Cypress's
+# integrated circuit products.  Any reproduction, modification, translation,
+# compilation, or representation of this Software except as specified
+# above is prohibited without the express written permission of Cypress.
+#
+# Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+# EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+# WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+# reserves the right to make changes to the Software without notice. Cypress
+# does not assume any liability arising out of the application or use of the
+# Software or any product or circuit described in the Software. Cypress does
+# not authorize its products for use in any products where a malfunction or
+# failure of the Cypress product may reasonably be expected to result in
+# significant property damage, injury or death ("High Risk Product"). By
+# including Cypress's product in a High Risk Product, the manufacturer
+# of such system or application assumes all risk of such use and in doing
+# so agrees to indemnify Cypress against all liability.
+"""
+Compress a firmware image for HCI_CONTROL_OTA_FORMAT_LZ updates, see handsfree_ota.c.
+
+The stream is a series of sequences, as in the LZ4 block format:
+
+  token(1)          literal count in the high nibble, match length - 4 in the low nibble
+  [literal count]   when the nibble is 15, extra bytes are added until one is not 255
+  literals
+  offset(2)         little endian distance back into the decoded image, 1..WINDOW
+  [match length]    extended like the literal count
+
+The last sequence has literals only and ends the stream. Offsets never reach further
+back than the device ring (WINDOW bytes), which is what sets this apart from plain LZ4.
+
+Binary deltas against the running image are not supported, the device has no way to
+read the image it runs from (see handsfree_ota.c).
+
+Usage: ota_pack.py <image.bin> <image.lz>
+Prints the OTA_START parameters: image length and CRC32.
+"""
+
+import sys
+import zlib
+
+WINDOW = 2048
+MIN_MATCH = 4
+HASH_CHAIN = 32     # Candidates tried per position
+
+
+def _put_len(out, n):
+    while n >= 255:
+        out.append(255)
+        n -= 255
+    out.append(n)
+
+
+def _sequence(out, literals, match_len=None, offset=0):
+    lit = min(len(literals), 15)
+    ml = 0 if match_len is None else min(match_len - MIN_MATCH, 15)
+    out.append((lit << 4) | ml)
+    if lit == 15:
+        _put_len(out, len(literals) - 15)
+    out += literals
+    if match_len is None:
+        return
+    out += offset.to_bytes(2, "little")
+    if ml == 15:
+        _put_len(out, match_len - MIN_MATCH - 15)
+
+
+def compress(data):
+    out = bytearray()
+    chains = {}
+    start = 0
+    i = 0
+    while i + MIN_MATCH <= len(data):
+        key = data[i:i + MIN_MATCH]
+        best_len, best_off = 0, 0
+        for j in reversed(chains.get(key, [])[-HASH_CHAIN:]):
+            if i - j > WINDOW:
+                break
+            n = MIN_MATCH
+            while i + n < len(data) and data[j + n] == data[i + n]:
+                n += 1
+            if n > best_len:
+                best_len, best_off = n, i - j
+        if best_len:
+            _sequence(out, data[start:i], best_len, best_off)
+            for k in range(i, i + best_len):
+                chains.setdefault(data[k:k + MIN_MATCH], []).append(k)
+            i += best_len
+            start = i
+        else:
+            chains.setdefault(key, []).append(i)
+            i += 1
+    _sequence(out, data[start:])
+    return bytes(out)
+
+
+def decompress(stream):
+    out = bytearray()
+    i = 0
+    while True:
+        token = stream[i]
+        i += 1
+        n = token >> 4
+        if n == 15:
+            while True:
+                n += stream[i]
+                i += 1
+                if stream[i - 1] != 255:
+                    break
+        out += stream[i:i + n]
+        i += n
+        if i == len(stream):
+            return bytes(out)
+        offset = int.from_bytes(stream[i:i + 2], "little")
+        i += 2
+        m = (token & 0x0F) + MIN_MATCH
+        if m == 15 + MIN_MATCH:
+            while True:
+                m += stream[i]
+                i += 1
+                if stream[i - 1] != 255:
+                    break
+        for _ in range(m):
+            out.append(out[-offset])
+
+
+def main():
+    if len(sys.argv) != 3:
+        sys.exit(__doc__)
+    with open(sys.argv[1], "rb") as f:
+        image = f.read()
+    packed = compress(image)
+    if decompress(packed) != image:
+        sys.exit("round trip failed")
+    with open(sys.argv[2], "wb") as f:
+        f.write(packed)
+    print("image_len %d image_crc32 0x%08x packed %d (%.0f%%)"
+          % (len(image), zlib.crc32(image), len(packed), 100.0 * len(packed) / max(len(image), 1)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,248 @@
+/*
+ * Copyright 2016-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+
+
+/** @file
+ *
+ * End-to-end latency measured by the device's own latency probe.
+ *
+ * Runs the application built with HANDSFREE_LATENCY_PROBE on the stub SCO layer, with a
+ * stand-in AG that loops the uplink back into the downlink after a fixed delay. Each SCO
+ * interval of 7.5 ms the AG delivers one downlink packet through the app voice path
+ * callback and takes the uplink packet the device answered with. With mSBC and with
+ * CVSD and for a set of AG delays the program sends HCI_CONTROL_MISC_COMMAND_LATENCY_PROBE
+ * over the loopback transport and reads the delay the device reports. The AG accounts
+ * for its own delay; what is left is the SCO packet clocking and the buffering of the
+ * device.
+ *
+ * Usage: probe_bench [order]
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "wiced_stub.h"
+#include "handsfree.h"
+#include "loopback_transport.h"
+
+extern void application_start( void );
+
+#define PROBE_BENCH_HANDLE          1
+#define PROBE_BENCH_INTERVAL_US     7500    // SCO packet interval
+#define PROBE_BENCH_MAX_TICKS       400
+#define PROBE_BENCH_RING            8192    // AG delay line, samples, power of 2
+
+static const wiced_bt_device_address_t probe_bench_ag = { 0x00, 0x1b, 0xdc, 0x0f, 0x10, 0x02 };
+static const uint32_t probe_bench_ag_delay_ms[] = { 0, 20, 50, 100 };
+
+static int16_t  probe_bench_ring[PROBE_BENCH_RING];
+static uint32_t probe_bench_ring_wr, probe_bench_ring_rd;
+
+static uint8_t  probe_bench_events[4096];
+static size_t   probe_bench_event_len;
+
+/* Let the application run what the event queued, keep what it sent the host */
+static void probe_bench_settle( uint64_t us )
+{
+    wiced_stub_advance_us( us );
+    while ( wiced_stub_run_pending( ) )
+        ;
+    probe_bench_event_len += loopback_read( probe_bench_events + probe_bench_event_len,
+                                            sizeof( probe_bench_events ) - probe_bench_event_len );
+}
+
+/* Payload of the first event with this opcode, the events before it are dropped */
+static uint8_t *probe_bench_find_event( uint16_t opcode, uint16_t *p_len )
+{
+    static uint8_t payload[256];
+    size_t         pos = 0;
+    uint16_t       code, len;
+
+    while ( pos + 5 <= probe_bench_event_len )
+    {
+        code = probe_bench_events[pos + 1] | ( probe_bench_events[pos + 2] << 8 );
+        len  = probe_bench_events[pos + 3] | ( probe_bench_events[pos + 4] << 8 );
+        if ( pos + 5 + len > probe_bench_event_len )
+            break;
+        pos += 5 + len;
+        if ( code == opcode )
+        {
+            *p_len = ( len < sizeof( payload ) ) ? len : sizeof( payload );
+            memcpy( payload, probe_bench_events + pos - len, *p_len );
+            memmove( probe_bench_events, probe_bench_events + pos, probe_bench_event_len - pos );
+            probe_bench_event_len -= pos;
+            return payload;
+        }
+    }
+    return NULL;
+}
+
+static void probe_bench_hfp( wiced_bt_hfp_hf_event_t event, wiced_bt_hfp_hf_event_data_t *p_data )
+{
+    p_data->handle = PROBE_BENCH_HANDLE;
+    wiced_stub_hfp_event( event, p_data );
+    probe_bench_settle( 1000 );
+}
+
+static void probe_bench_sco( wiced_bt_management_evt_t event )
+{
+    wiced_bt_management_evt_data_t data;
+
+    memset( &data, 0, sizeof( data ) );
+    wiced_stub_management_event( event, &data );
+    probe_bench_settle( 1000 );
+}
+
+static void probe_bench_connect( void )
+{
+    wiced_bt_hfp_hf_event_data_t data;
+
+    wiced_stub_hfp_add_scb( PROBE_BENCH_HANDLE, probe_bench_ag, WICED_BT_HFP_AG_FEATURE_CODEC_NEGOTIATION );
+
+    memset( &data, 0, sizeof( data ) );
+    data.conn_data.conn_state        = WICED_BT_HFP_HF_STATE_CONNECTED;
+    data.conn_data.connected_profile = WICED_BT_HFP_PROFILE;
+    memcpy( data.conn_data.remote_address, probe_bench_ag, BD_ADDR_LEN );
+    probe_bench_hfp( WICED_BT_HFP_HF_CONNECTION_STATE_EVT, &data );
+
+    memset( &data, 0, sizeof( data ) );
+    data.ag_feature_flags = WICED_BT_HFP_AG_FEATURE_CODEC_NEGOTIATION;
+    probe_bench_hfp( WICED_BT_HFP_HF_AG_FEATURE_SUPPORT_EVT, &data );
+
+    memset( &data, 0, sizeof( data ) );
+    data.conn_data.conn_state = WICED_BT_HFP_HF_STATE_SLC_CONNECTED;
+    memcpy( data.conn_data.remote_address, probe_bench_ag, BD_ADDR_LEN );
+    probe_bench_hfp( WICED_BT_HFP_HF_CONNECTION_STATE_EVT, &data );
+}
+
+/* One SCO interval: the AG sends a downlink packet and takes the uplink packet sent back */
+static void probe_bench_tick( uint32_t samples )
+{
+    int16_t  packet[PROBE_BENCH_RING];
+    uint32_t i, n;
+
+    for ( i = 0; i < samples; i++ )
+        packet[i] = probe_bench_ring[probe_bench_ring_rd++ & ( PROBE_BENCH_RING - 1 )];
+    wiced_stub_sco_data_cb( )( 0, (uint16_t)( samples * sizeof( int16_t ) ), (uint8_t *)packet );
+
+    n = wiced_stub_sco_output( packet, PROBE_BENCH_RING );
+    for ( i = 0; i < n; i++ )
+        probe_bench_ring[probe_bench_ring_wr++ & ( PROBE_BENCH_RING - 1 )] = packet[i];
+    probe_bench_settle( PROBE_BENCH_INTERVAL_US );
+}
+
+static void probe_bench_run( uint8_t codec, uint32_t ag_delay_ms, uint8_t order )
+{
+    uint32_t        rate     = ( codec == WICED_BT_HFP_HF_MSBC_CODEC ) ? 16000 : 8000;
+    uint32_t        samples  = rate / 1000 * PROBE_BENCH_INTERVAL_US / 1000;
+    uint32_t        ag_delay = rate / 1000 * ag_delay_ms;
+    uint8_t         frame[1 + 4 + 1];
+    wiced_bt_hfp_hf_event_data_t data;
+    uint8_t        *p;
+    uint16_t        len;
+    uint32_t        tick, delay_samples, delay_us;
+    int16_t         stale;
+
+    memset( &data, 0, sizeof( data ) );
+    data.selected_codec = codec;
+    probe_bench_hfp( WICED_BT_HFP_HFP_CODEC_SET_EVT, &data );
+    probe_bench_sco( BTM_SCO_CONNECTION_REQUEST_EVT );
+    probe_bench_sco( BTM_SCO_CONNECTED_EVT );
+
+    /* The AG delay plus the downlink packet on its way */
+    memset( probe_bench_ring, 0, sizeof( probe_bench_ring ) );
+    probe_bench_ring_rd = 0;
+    probe_bench_ring_wr = ag_delay + samples;
+    while ( wiced_stub_sco_output( &stale, 1 ) )
+        ;
+    for ( tick = 0; tick < 4; tick++ )
+        probe_bench_tick( samples );
+
+    frame[0] = 0x19;
+    frame[1] = HCI_CONTROL_MISC_COMMAND_LATENCY_PROBE & 0xff;
+    frame[2] = HCI_CONTROL_MISC_COMMAND_LATENCY_PROBE >> 8;
+    frame[3] = 1;
+    frame[4] = 0;
+    frame[5] = order;
+    probe_bench_event_len = 0;
+    loopback_command( frame, sizeof( frame ) );
+    probe_bench_settle( 0 );
+
+    p = NULL;
+    for ( tick = 0; ( tick < PROBE_BENCH_MAX_TICKS ) && !p; tick++ )
+    {
+        probe_bench_tick( samples );
+        p = probe_bench_find_event( HCI_CONTROL_MISC_EVENT_LATENCY_PROBE, &len );
+    }
+
+    if ( !p || ( len < 10 ) )
+    {
+        printf( "%-5s AG %3u ms  no result\n", codec == WICED_BT_HFP_HF_MSBC_CODEC ? "mSBC" : "CVSD", ag_delay_ms );
+    }
+    else if ( p[0] != HCI_CONTROL_PROBE_STATUS_SUCCESS )
+    {
+        printf( "%-5s AG %3u ms  status %u\n", codec == WICED_BT_HFP_HF_MSBC_CODEC ? "mSBC" : "CVSD", ag_delay_ms, p[0] );
+    }
+    else
+    {
+        delay_samples = p[3] | ( p[4] << 8 );
+        delay_us      = p[5] | ( p[6] << 8 ) | ( p[7] << 16 ) | ( (uint32_t)p[8] << 24 );
+        printf( "%-5s AG %3u ms  end to end %4u samples %7.2f ms, without the AG %6.2f ms "
+                "(SCO packet %.2f ms), level %u%%\n",
+                codec == WICED_BT_HFP_HF_MSBC_CODEC ? "mSBC" : "CVSD", ag_delay_ms, delay_samples, delay_us / 1000.0,
+                ( delay_samples - ag_delay ) * 1000.0 / rate, PROBE_BENCH_INTERVAL_US / 1000.0, p[9] );
+    }
+
+    probe_bench_sco( BTM_SCO_DISCONNECTED_EVT );
+    probe_bench_settle( 100000 );
+}
+
+int main( int argc, char *argv[] )
+{
+    uint8_t       order  = ( argc > 1 ) ? (uint8_t)atoi( argv[1] ) : HANDSFREE_PROBE_ORDER_MAX;
+    wiced_stub_t *p_stub = wiced_stub_new( WICED_TRUE );
+    size_t        i;
+
+    wiced_stub_select( p_stub );
+    application_start( );
+    probe_bench_settle( 1000000 );
+    probe_bench_connect( );
+
+    for ( i = 0; i < sizeof( probe_bench_ag_delay_ms ) / sizeof( probe_bench_ag_delay_ms[0] ); i++ )
+        probe_bench_run( WICED_BT_HFP_HF_CVSD_CODEC, probe_bench_ag_delay_ms[i], order );
+    for ( i = 0; i < sizeof( probe_bench_ag_delay_ms ) / sizeof( probe_bench_ag_delay_ms[0] ); i++ )
+        probe_bench_run( WICED_BT_HFP_HF_MSBC_CODEC, probe_bench_ag_delay_ms[i], order );
+    return 0;
+}
@@ -0,0 +1,283 @@
+/*
+ * Copyright 2016-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+
+/** @file
+ *
+ * Scaling of handsfree_sim with its worker thread count.
+ *
+ * For each thread count handsfree_sim is started with Unix sockets, a
+ * handsfree_client.hpp client connects to every device and keeps a window of GET_VERSION
+ * commands in flight on each, and the completed commands per second are reported. The
+ * driver is a single thread, watch its CPU use: once it saturates a core the figures
+ * are the driver's limit rather than the simulator's.
+ *
+ * Usage: sim_bench [-n devices] [-w window] [-d seconds] [-t threads,...] [-b handsfree_sim]
+ */
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+
+#include "handsfree_client.hpp"
+
+using namespace handsfree::host;
+
+extern char **environ;
+
+namespace
+{
+
+/* Frames are collected and written once per loop iteration */
+struct socket_transport
+{
+    int                   fd = -1;
+    std::vector<uint8_t>  out;
+
+    void write( std::span<const uint8_t> f ) { out.insert( out.end( ), f.begin( ), f.end( ) ); }
+
+    bool flush( )
+    {
+        size_t done = 0;
+
+        while ( done < out.size( ) )
+        {
+            ssize_t n = ::write( fd, out.data( ) + done, out.size( ) - done );
+            if ( n < 0 && errno == EINTR )
+                continue;
+            if ( n <= 0 )
+                return false;
+            done += size_t( n );
+        }
+        out.clear( );
+        return true;
+    }
+};
+
+struct device
+{
+    socket_transport          transport;
+    client<socket_transport>  host{ transport };
+};
+
+bool running;
+
+detached_task get_versions( device &d, uint64_t &failed )
+{
+    while ( running )
+    {
+        command_result result = co_await d.host.get_version( );
+        if ( !result.ok )
+            failed++;
+    }
+}
+
+int connect_device( const std::string &path )
+{
+    sockaddr_un addr{ };
+    int         fd = socket( AF_UNIX, SOCK_STREAM, 0 );
+
+    addr.sun_family = AF_UNIX;
+    snprintf( addr.sun_path, sizeof( addr.sun_path ), "%s", path.c_str( ) );
+
+    /* The simulator creates the sockets after it started */
+    for ( int tries = 0; tries < 500; tries++ )
+    {
+        if ( connect( fd, reinterpret_cast<sockaddr *>( &addr ), sizeof( addr ) ) == 0 )
+            return fd;
+        std::this_thread::sleep_for( std::chrono::milliseconds( 10 ) );
+    }
+    close( fd );
+    return -1;
+}
+
+bool run( const char *binary, int devices, int threads, int window, double seconds )
+{
+    char        dir_template[] = "/tmp/sim_bench.XXXXXX";
+    std::string dir = mkdtemp( dir_template );
+    std::string n = std::to_string( devices ), t = std::to_string( threads );
+    const char *argv[] = { binary, "-n", n.c_str( ), "-t", t.c_str( ), "-s", dir.c_str( ), nullptr };
+    pid_t       pid;
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init( &actions );
+    posix_spawn_file_actions_addopen( &actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0 );
+    if ( posix_spawn( &pid, binary, &actions, nullptr, const_cast<char **>( argv ), environ ) != 0 )
+    {
+        perror( binary );
+        return false;
+    }
+    posix_spawn_file_actions_destroy( &actions );
+
+    std::vector<std::unique_ptr<device>> devs;
+    int                                  epoll_fd = epoll_create1( 0 );
+    uint64_t                             failed = 0;
+    bool                                 ok = true;
+
+    for ( int i = 0; i < devices && ok; i++ )
+    {
+        auto d = std::make_unique<device>( );
+        if ( ( d->transport.fd = connect_device( dir + "/hf" + std::to_string( i ) + ".sock" ) ) < 0 )
+        {
+            fprintf( stderr, "device %d: no socket\n", i );
+            ok = false;
+            break;
+        }
+        epoll_event ev{ };
+        ev.events   = EPOLLIN;
+        ev.data.ptr = d.get( );
+        epoll_ctl( epoll_fd, EPOLL_CTL_ADD, d->transport.fd, &ev );
+        devs.push_back( std::move( d ) );
+    }
+
+    running = ok;
+    for ( auto &d : devs )
+        for ( int w = 0; w < window; w++ )
+            get_versions( *d, failed );
+
+    using clock = std::chrono::steady_clock;
+    auto     start = clock::now( ), measure_from = start + std::chrono::milliseconds( 500 );
+    auto     stop = measure_from + std::chrono::duration_cast<clock::duration>( std::chrono::duration<double>( seconds ) );
+    bool     measuring = false;
+    uint8_t  buf[16384];
+    epoll_event events[64];
+
+    while ( ok )
+    {
+        for ( auto &d : devs )
+            if ( !d->transport.flush( ) )
+                ok = false;
+
+        auto now = clock::now( );
+        if ( !measuring && now >= measure_from )
+        {
+            measuring = true;
+            for ( auto &d : devs )
+                d->host.reset_latency( );
+        }
+        if ( now >= stop )
+            break;
+
+        int count = epoll_wait( epoll_fd, events, 64, 100 );
+        for ( int i = 0; i < count; i++ )
+        {
+            auto   *d = static_cast<device *>( events[i].data.ptr );
+            ssize_t len = recv( d->transport.fd, buf, sizeof( buf ), MSG_DONTWAIT );
+            if ( len > 0 )
+                d->host.feed( std::span<const uint8_t>( buf, size_t( len ) ) );
+            else if ( len == 0 || ( errno != EAGAIN && errno != EINTR ) )
+                ok = false;
+        }
+    }
+
+    running = false;
+
+    uint64_t done = 0, mean_ns = 0, p99_us = 0;
+    for ( auto &d : devs )
+    {
+        auto &lat = d->host.latency( completion::version );
+        done    += lat.count( );
+        mean_ns += uint64_t( lat.mean( ).count( ) ) * lat.count( );
+        p99_us   = std::max<uint64_t>( p99_us, lat.percentile( 99 ).count( ) );
+    }
+
+    if ( ok )
+        printf( "%7d %7d %7d %12.0f %10.1f %10llu %7llu\n", threads, devices, window, done / seconds,
+                done ? mean_ns / 1000.0 / done : 0.0, (unsigned long long)p99_us, (unsigned long long)failed );
+
+    /* Parked coroutines are abandoned with their clients */
+    for ( auto &d : devs )
+        close( d->transport.fd );
+    close( epoll_fd );
+    kill( pid, SIGTERM );
+    waitpid( pid, nullptr, 0 );
+    for ( int i = 0; i < devices; i++ )
+        unlink( ( dir + "/hf" + std::to_string( i ) + ".sock" ).c_str( ) );
+    rmdir( dir.c_str( ) );
+    return ok;
+}
+
+} // namespace
+
+int main( int argc, char *argv[] )
+{
+    const char      *binary = "out/handsfree_sim";
+    int              devices = 64, window = 4;
+    double           seconds = 2;
+    std::vector<int> threads;
+    int              opt;
+
+    while ( ( opt = getopt( argc, argv, "n:w:d:t:b:" ) ) != -1 )
+    {
+        switch ( opt )
+        {
+        case 'n': devices = atoi( optarg ); break;
+        case 'w': window  = atoi( optarg ); break;
+        case 'd': seconds = atof( optarg ); break;
+        case 'b': binary  = optarg;         break;
+        case 't':
+            for ( char *p = strtok( optarg, "," ); p; p = strtok( nullptr, "," ) )
+                threads.push_back( atoi( p ) );
+            break;
+        default:
+            fprintf( stderr, "usage: %s [-n devices] [-w window] [-d seconds] [-t threads,...] [-b handsfree_sim]\n", argv[0] );
+            return 2;
+        }
+    }
+    if ( threads.empty( ) )
+        for ( int t = 1; t <= int( std::thread::hardware_concurrency( ) ); t *= 2 )
+            threads.push_back( t );
+
+    signal( SIGPIPE, SIG_IGN );
+    printf( "%7s %7s %7s %12s %10s %10s %7s\n", "threads", "devices", "window", "cmd/s", "mean us", "p99 us", "failed" );
+    for ( int t : threads )
+        if ( !run( binary, devices, t, window, seconds ) )
+            return 1;
+    return 0;
+}
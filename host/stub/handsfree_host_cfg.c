@@ -0,0 +1,89 @@
+/*
+ * Copyright 2016-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+/** @file
+ *
+ * Stack configuration for host builds. handsfree_bt_cfg.c needs the full SDK headers,
+ * this carries the values the application reads back from it.
+ */
+
+#include "wiced_bt_cfg.h"
+#include "wiced_bt_audio.h"
+#include "handsfree.h"
+
+const wiced_bt_cfg_settings_t handsfree_cfg_settings =
+{
+    .device_name        = (uint8_t *)HANDS_FREE_DEVICE_NAME,
+    .rfcomm_cfg         =
+    {
+        .max_links      = HANDSFREE_CAP_HF_CONNECTIONS,
+        .max_ports      = HANDSFREE_CAP_HF_CONNECTIONS,
+    },
+    .l2cap_application  =
+    {
+        .max_links      = HANDSFREE_CAP_HF_CONNECTIONS,
+        .max_channels   = 7,
+        .max_psm        = 7,
+    },
+};
+
+const wiced_bt_cfg_buf_pool_t handsfree_cfg_buf_pools[] =
+{
+/*  { buf_size, buf_count } */
+    { 64,      12  },
+    { 272,      6  },
+    { 1056,     6  },
+    { 1056,     HANDSFREE_CAP_A2DP_LINKS },
+};
+
+const wiced_bt_audio_config_buffer_t handsfree_audio_buf_config = {
+#if HANDSFREE_CAP_A2DP
+    .role                       =   WICED_AUDIO_SINK_ROLE | WICED_HF_ROLE,
+#else
+    .role                       =   WICED_HF_ROLE,
+#endif
+    .audio_tx_buffer_size       =   0,
+    .audio_codec_buffer_size    =   0x4000,
+    .audio_tx_buffer_watermark_level = 50
+};
+
+/* The stub does not parse SDP records, an empty data element sequence will do */
+const uint8_t handsfree_sdp_db[] =
+{
+    0x35, 0x00
+};
+
+uint16_t wiced_app_cfg_sdp_record_get_size(void)
+{
+    return (uint16_t)sizeof(handsfree_sdp_db);
+}
@@ -0,0 +1,2 @@
+/* SDK header stand-in for host builds, see wiced_stub.h */
+#include "wiced_stub.h"
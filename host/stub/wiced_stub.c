@@ -0,0 +1,1297 @@
+/*
+ * Copyright 2016-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+/** @file
+ *
+ * Host implementation of the WICED SDK stand-in declared in wiced_stub.h.
+ *
+ * Everything a device owns lives in its wiced_stub_t, so several devices can run in one
+ * process as long as each thread selects the device it works on. Events posted from
+ * other threads (transport reader, simulator) are queued under a lock and run by
+ * wiced_stub_run() on the thread driving the device, like the application thread of the
+ * firmware.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#include "wiced_stub.h"
+
+#define STUB_MAX_SCB                4
+#define STUB_MAX_STREAMS            4
+#define STUB_SCO_OUT_SAMPLES        4096        // Power of 2
+#define STUB_MEMORY_SIZE            ( 64 * 1024 )
+
+/*
+ * Codec control bus model: an I2C write of register address(2) and value(2) to a
+ * CS47L35 class codec at 400 kHz, and the number of writes each audio manager call
+ * causes. Used to compare how much bus time the application spends on audio setup.
+ */
+#define STUB_CODEC_WRITE_US         113         // 5 bytes, 9 bits each, 400 kHz
+#define STUB_CODEC_WRITES_OPEN      16          // Power up, clocks, routing
+#define STUB_CODEC_WRITES_CLOSE     4
+#define STUB_CODEC_WRITES_START     4
+#define STUB_CODEC_WRITES_STOP      2
+#define STUB_CODEC_WRITES_CONFIG    24          // Sample rate, PLL, ASRC, DSP rate
+#define STUB_CODEC_WRITES_GAIN      2           // Left and right volume
+
+/* Controller HCI command round trip, e.g. adding a bond to the address resolution list */
+#define STUB_HCI_COMMAND_US         1000
+
+typedef struct stub_event
+{
+    struct stub_event  *p_next;
+    int               (*p_fn)( void *p_data );
+    void               *p_data;
+} stub_event_t;
+
+typedef struct stub_nvram
+{
+    struct stub_nvram  *p_next;
+    uint16_t            id;
+    uint16_t            length;
+    uint8_t             data[];
+} stub_nvram_t;
+
+struct wiced_bt_buffer_pool_s
+{
+    uint32_t            buffer_size;
+    uint32_t            buffer_count;
+    uint32_t            in_use;
+};
+
+/* In front of every buffer handed out */
+typedef struct
+{
+    wiced_stub_t           *p_stub;
+    wiced_bt_buffer_pool_t *p_pool;
+    uint32_t                size;
+    uint32_t                reserved;
+} stub_buffer_hdr_t;
+
+struct wiced_stub_s
+{
+    wiced_bool_t                    virtual_time;
+    uint64_t                        now_us;             // Virtual clock
+    uint64_t                        origin_us;          // Real clock at creation
+
+    wiced_timer_t                  *p_timers;           // Running, by deadline
+
+    pthread_mutex_t                 lock;               // Event queue
+    pthread_cond_t                  cond;
+    stub_event_t                   *p_event_first;
+    stub_event_t                   *p_event_last;
+    void                          (*p_notify)( void *p_context );
+    void                           *p_notify_context;
+
+    wiced_bt_management_cback_t     p_management_cback;
+    wiced_bt_hfp_hf_event_cb_t      p_hfp_cback;
+    wiced_bt_a2dp_sink_control_cb_t p_a2dp_cback;
+    wiced_bt_hfp_hf_scb_t           scb[STUB_MAX_SCB];
+    wiced_bool_t                    scb_used[STUB_MAX_SCB];
+
+    char                            at_last[WICED_BT_HFP_HF_AT_MAX_LEN + 16];
+    uint32_t                        at_count;
+
+    uint16_t                        sco_next_index;
+    wiced_bt_sco_params_t           sco_params;
+    wiced_bool_t                    sco_params_valid;
+    wiced_bt_sco_data_cb_t          p_sco_data_cb;
+    int16_t                         sco_out[STUB_SCO_OUT_SAMPLES];
+    uint32_t                        sco_out_wr;
+    uint32_t                        sco_out_rd;
+
+    int                             stream_type[STUB_MAX_STREAMS];   // 0 if free
+    wiced_stub_codec_stats_t        codec;
+
+    uint32_t                        buffers_in_use;
+    uint32_t                        bytes_in_use;
+    uint32_t                        resets;
+    int8_t                          rssi;
+
+    stub_nvram_t                   *p_nvram;
+    uint8_t                        *p_ota;
+    wiced_bool_t                    ota_finished;
+};
+
+static _Thread_local wiced_stub_t  *p_wiced_stub;
+static wiced_stub_t                *p_wiced_stub_default;
+static pthread_mutex_t              wiced_stub_default_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static uint64_t stub_monotonic_us( void )
+{
+    struct timespec ts;
+
+    clock_gettime( CLOCK_MONOTONIC, &ts );
+    return (uint64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/******************************************************************************
+ *  Devices
+ ******************************************************************************/
+wiced_stub_t *wiced_stub_new( wiced_bool_t virtual_time )
+{
+    wiced_stub_t       *p_stub = calloc( 1, sizeof( wiced_stub_t ) );
+    pthread_condattr_t  attr;
+
+    if ( p_stub == NULL )
+    {
+        abort( );
+    }
+    p_stub->virtual_time = virtual_time;
+    p_stub->origin_us    = stub_monotonic_us( );
+    p_stub->rssi         = -60;
+
+    pthread_mutex_init( &p_stub->lock, NULL );
+    pthread_condattr_init( &attr );
+    pthread_condattr_setclock( &attr, CLOCK_MONOTONIC );
+    pthread_cond_init( &p_stub->cond, &attr );
+    pthread_condattr_destroy( &attr );
+    return p_stub;
+}
+
+void wiced_stub_delete( wiced_stub_t *p_stub )
+{
+    stub_event_t *p_event;
+    stub_nvram_t *p_nvram;
+
+    while ( ( p_event = p_stub->p_event_first ) != NULL )
+    {
+        p_stub->p_event_first = p_event->p_next;
+        free( p_event );
+    }
+    while ( ( p_nvram = p_stub->p_nvram ) != NULL )
+    {
+        p_stub->p_nvram = p_nvram->p_next;
+        free( p_nvram );
+    }
+    free( p_stub->p_ota );
+    pthread_mutex_destroy( &p_stub->lock );
+    pthread_cond_destroy( &p_stub->cond );
+    if ( p_wiced_stub == p_stub )
+        p_wiced_stub = NULL;
+    free( p_stub );
+}
+
+wiced_stub_t *wiced_stub_select( wiced_stub_t *p_stub )
+{
+    wiced_stub_t *p_prev = p_wiced_stub;
+
+    p_wiced_stub = p_stub;
+    return p_prev;
+}
+
+wiced_stub_t *wiced_stub_current( void )
+{
+    if ( p_wiced_stub == NULL )
+    {
+        pthread_mutex_lock( &wiced_stub_default_lock );
+        if ( p_wiced_stub_default == NULL )
+            p_wiced_stub_default = wiced_stub_new( WICED_FALSE );
+        pthread_mutex_unlock( &wiced_stub_default_lock );
+        p_wiced_stub = p_wiced_stub_default;
+    }
+    return p_wiced_stub;
+}
+
+/******************************************************************************
+ *  Settings from the environment
+ *    HANDSFREE_TRACE   print WICED_BT_TRACE output
+ *    HANDSFREE_BUSY    in real time, block the application thread for the time the
+ *                      modelled hardware takes (codec bus, controller commands)
+ ******************************************************************************/
+static wiced_bool_t     stub_trace_enabled;
+static wiced_bool_t     stub_busy_enabled;
+static pthread_once_t   stub_env_once = PTHREAD_ONCE_INIT;
+
+static void stub_env_init( void )
+{
+    stub_trace_enabled = getenv( "HANDSFREE_TRACE" ) != NULL;
+    stub_busy_enabled  = getenv( "HANDSFREE_BUSY" ) != NULL;
+}
+
+/* Blocking work on the application thread, e.g. codec bus transfers */
+static void stub_busy( wiced_stub_t *p_stub, uint64_t us )
+{
+    struct timespec ts;
+
+    if ( p_stub->virtual_time )
+    {
+        p_stub->now_us += us;
+        return;
+    }
+
+    pthread_once( &stub_env_once, stub_env_init );
+    if ( stub_busy_enabled )
+    {
+        ts.tv_sec  = us / 1000000;
+        ts.tv_nsec = ( us % 1000000 ) * 1000;
+        while ( nanosleep( &ts, &ts ) != 0 )
+            ;
+    }
+}
+
+/******************************************************************************
+ *  Trace
+ ******************************************************************************/
+
+void WICED_BT_TRACE( const char *p_fmt, ... )
+{
+    char        spec[16];
+    const char *p;
+    va_list     ap;
+    size_t      n;
+
+    pthread_once( &stub_env_once, stub_env_init );
+    if ( !stub_trace_enabled )
+        return;
+
+    va_start( ap, p_fmt );
+    for ( p = p_fmt; *p; p++ )
+    {
+        if ( *p != '%' )
+        {
+            fputc( *p, stderr );
+            continue;
+        }
+
+        /* Copy one conversion specification */
+        n = 0;
+        spec[n++] = *p++;
+        while ( *p && strchr( "-+ #0123456789.", *p ) && ( n < sizeof( spec ) - 4 ) )
+            spec[n++] = *p++;
+        while ( *p && strchr( "hlzjt", *p ) && ( n < sizeof( spec ) - 3 ) )
+            spec[n++] = *p++;
+        if ( *p == 0 )
+            break;
+        spec[n++] = *p;
+        spec[n]   = 0;
+
+        switch ( *p )
+        {
+        case 'B':
+            {
+                const uint8_t *a = va_arg( ap, const uint8_t * );
+                fprintf( stderr, "%02x:%02x:%02x:%02x:%02x:%02x", a[0], a[1], a[2], a[3], a[4], a[5] );
+            }
+            break;
+        case 's':
+            fprintf( stderr, spec, va_arg( ap, const char * ) );
+            break;
+        case 'p':
+            fprintf( stderr, spec, va_arg( ap, void * ) );
+            break;
+        case 'f':
+        case 'g':
+        case 'e':
+            fprintf( stderr, spec, va_arg( ap, double ) );
+            break;
+        case '%':
+            fputc( '%', stderr );
+            break;
+        default:
+            if ( strstr( spec, "ll" ) )
+                fprintf( stderr, spec, va_arg( ap, long long ) );
+            else if ( strchr( spec, 'l' ) || strchr( spec, 'z' ) )
+                fprintf( stderr, spec, va_arg( ap, long ) );
+            else
+                fprintf( stderr, spec, va_arg( ap, int ) );
+            break;
+        }
+    }
+    va_end( ap );
+}
+
+void wiced_set_debug_uart( wiced_debug_uart_types_t route )
+{
+}
+
+void wiced_transport_send_hci_trace( void *p_trans_pool, wiced_bt_hci_trace_type_t type, uint16_t length, uint8_t *p_data )
+{
+}
+
+/******************************************************************************
+ *  Memory
+ ******************************************************************************/
+static void *stub_alloc( wiced_bt_buffer_pool_t *p_pool, uint32_t size )
+{
+    wiced_stub_t      *p_stub = wiced_stub_current( );
+    stub_buffer_hdr_t *p_hdr;
+
+    if ( ( p_hdr = malloc( sizeof( stub_buffer_hdr_t ) + size ) ) == NULL )
+        return NULL;
+
+    p_hdr->p_stub = p_stub;
+    p_hdr->p_pool = p_pool;
+    p_hdr->size   = size;
+    p_stub->buffers_in_use++;
+    p_stub->bytes_in_use += size;
+    if ( p_pool )
+        p_pool->in_use++;
+    return p_hdr + 1;
+}
+
+void *wiced_bt_get_buffer( uint32_t size )
+{
+    return stub_alloc( NULL, size );
+}
+
+void *wiced_bt_get_buffer_from_pool( wiced_bt_buffer_pool_t *p_pool )
+{
+    if ( ( p_pool == NULL ) || ( p_pool->in_use >= p_pool->buffer_count ) )
+        return NULL;
+    return stub_alloc( p_pool, p_pool->buffer_size );
+}
+
+void wiced_bt_free_buffer( void *p_buf )
+{
+    stub_buffer_hdr_t *p_hdr;
+
+    if ( p_buf == NULL )
+        return;
+
+    p_hdr = (stub_buffer_hdr_t *)p_buf - 1;
+    p_hdr->p_stub->buffers_in_use--;
+    p_hdr->p_stub->bytes_in_use -= p_hdr->size;
+    if ( p_hdr->p_pool )
+        p_hdr->p_pool->in_use--;
+    free( p_hdr );
+}
+
+uint16_t wiced_bt_get_buffer_size( void *p_buf )
+{
+    return (uint16_t)( (stub_buffer_hdr_t *)p_buf - 1 )->size;
+}
+
+wiced_bt_buffer_pool_t *wiced_bt_create_pool( uint32_t buffer_size, uint32_t buffer_cnt )
+{
+    wiced_bt_buffer_pool_t *p_pool = calloc( 1, sizeof( wiced_bt_buffer_pool_t ) );
+
+    if ( p_pool )
+    {
+        p_pool->buffer_size  = buffer_size;
+        p_pool->buffer_count = buffer_cnt;
+    }
+    return p_pool;
+}
+
+int wiced_memory_get_free_bytes( void )
+{
+    uint32_t used = wiced_stub_current( )->bytes_in_use;
+
+    return ( used < STUB_MEMORY_SIZE ) ? (int)( STUB_MEMORY_SIZE - used ) : 0;
+}
+
+uint32_t wiced_stub_buffers_in_use( void )
+{
+    return wiced_stub_current( )->buffers_in_use;
+}
+
+/******************************************************************************
+ *  Clock and timers
+ ******************************************************************************/
+uint64_t clock_SystemTimeMicroseconds64( void )
+{
+    wiced_stub_t *p_stub = wiced_stub_current( );
+
+    if ( p_stub->virtual_time )
+        return p_stub->now_us;
+    return stub_monotonic_us( ) - p_stub->origin_us;
+}
+
+static void stub_timer_unlink( wiced_timer_t *p_timer )
+{
+    wiced_stub_t   *p_stub = p_timer->p_owner;
+    wiced_timer_t **pp;
+
+    for ( pp = &p_stub->p_timers; *pp; pp = &( *pp )->p_next )
+    {
+        if ( *pp == p_timer )
+        {
+            *pp = p_timer->p_next;
+            break;
+        }
+    }
+    p_timer->p_next = NULL;
+    p_timer->in_use = WICED_FALSE;
+}
+
+static void stub_timer_link( wiced_timer_t *p_timer )
+{
+    wiced_stub_t   *p_stub = p_timer->p_owner;
+    wiced_timer_t **pp;
+
+    /* Equal deadlines expire in start order */
+    for ( pp = &p_stub->p_timers; *pp && ( ( *pp )->deadline_us <= p_timer->deadline_us ); pp = &( *pp )->p_next )
+        ;
+    p_timer->p_next = *pp;
+    *pp             = p_timer;
+    p_timer->in_use = WICED_TRUE;
+}
+
+wiced_result_t wiced_init_timer( wiced_timer_t *p_timer, wiced_timer_callback_t cback, TIMER_PARAM_TYPE param, int type )
+{
+    memset( p_timer, 0, sizeof( wiced_timer_t ) );
+    p_timer->cback   = cback;
+    p_timer->param   = param;
+    p_timer->type    = type;
+    p_timer->p_owner = wiced_stub_current( );
+    return WICED_SUCCESS;
+}
+
+wiced_result_t wiced_start_timer( wiced_timer_t *p_timer, uint32_t timeout )
+{
+    uint64_t us = ( ( p_timer->type == WICED_SECONDS_TIMER ) || ( p_timer->type == WICED_SECONDS_PERIODIC_TIMER ) ) ?
+                      (uint64_t)timeout * 1000000 : (uint64_t)timeout * 1000;
+
+    if ( p_timer->p_owner == NULL )
+        return WICED_ERROR;
+
+    if ( p_timer->in_use )
+        stub_timer_unlink( p_timer );
+
+    p_timer->period_us   = ( ( p_timer->type == WICED_MILLI_SECONDS_PERIODIC_TIMER ) ||
+                             ( p_timer->type == WICED_SECONDS_PERIODIC_TIMER ) ) ? us : 0;
+    p_timer->deadline_us = clock_SystemTimeMicroseconds64( ) + us;
+    stub_timer_link( p_timer );
+    return WICED_SUCCESS;
+}
+
+wiced_result_t wiced_stop_timer( wiced_timer_t *p_timer )
+{
+    if ( p_timer->in_use )
+        stub_timer_unlink( p_timer );
+    return WICED_SUCCESS;
+}
+
+wiced_bool_t wiced_is_timer_in_use( wiced_timer_t *p_timer )
+{
+    return p_timer->in_use;
+}
+
+uint64_t wiced_stub_next_timer_us( void )
+{
+    wiced_stub_t *p_stub = wiced_stub_current( );
+
+    return p_stub->p_timers ? p_stub->p_timers->deadline_us : UINT64_MAX;
+}
+
+/* Fire the first timer if it expired */
+static wiced_bool_t stub_timer_fire( wiced_stub_t *p_stub, uint64_t now_us )
+{
+    wiced_timer_t *p_timer = p_stub->p_timers;
+
+    if ( ( p_timer == NULL ) || ( p_timer->deadline_us > now_us ) )
+        return WICED_FALSE;
+
+    stub_timer_unlink( p_timer );
+    if ( p_timer->period_us )
+    {
+        p_timer->deadline_us += p_timer->period_us;
+        stub_timer_link( p_timer );
+    }
+    p_timer->cback( p_timer->param );
+    return WICED_TRUE;
+}
+
+/******************************************************************************
+ *  Application loop
+ ******************************************************************************/
+void wiced_stub_post( wiced_stub_t *p_stub, int (*p_fn)( void *p_data ), void *p_data )
+{
+    stub_event_t *p_event = malloc( sizeof( stub_event_t ) );
+
+    if ( p_event == NULL )
+        abort( );
+
+    p_event->p_next = NULL;
+    p_event->p_fn   = p_fn;
+    p_event->p_data = p_data;
+
+    pthread_mutex_lock( &p_stub->lock );
+    if ( p_stub->p_event_last )
+        p_stub->p_event_last->p_next = p_event;
+    else
+        p_stub->p_event_first = p_event;
+    p_stub->p_event_last = p_event;
+    pthread_cond_signal( &p_stub->cond );
+    pthread_mutex_unlock( &p_stub->lock );
+
+    if ( p_stub->p_notify )
+        p_stub->p_notify( p_stub->p_notify_context );
+}
+
+void wiced_stub_set_notify( wiced_stub_t *p_stub, void (*p_notify)( void *p_context ), void *p_context )
+{
+    p_stub->p_notify         = p_notify;
+    p_stub->p_notify_context = p_context;
+}
+
+wiced_result_t wiced_app_event_serialize( int (*p_fn)( void *p_data ), void *p_data )
+{
+    wiced_stub_post( wiced_stub_current( ), p_fn, p_data );
+    return WICED_SUCCESS;
+}
+
+static stub_event_t *stub_event_get( wiced_stub_t *p_stub )
+{
+    stub_event_t *p_event;
+
+    pthread_mutex_lock( &p_stub->lock );
+    if ( ( p_event = p_stub->p_event_first ) != NULL )
+    {
+        if ( ( p_stub->p_event_first = p_event->p_next ) == NULL )
+            p_stub->p_event_last = NULL;
+    }
+    pthread_mutex_unlock( &p_stub->lock );
+    return p_event;
+}
+
+int wiced_stub_run_pending( void )
+{
+    wiced_stub_t *p_stub = wiced_stub_current( );
+    stub_event_t *p_event;
+    int           count = 0;
+    wiced_bool_t  busy  = WICED_TRUE;
+
+    while ( busy )
+    {
+        busy = WICED_FALSE;
+        while ( ( p_event = stub_event_get( p_stub ) ) != NULL )
+        {
+            p_event->p_fn( p_event->p_data );
+            free( p_event );
+            count++;
+            busy = WICED_TRUE;
+        }
+        if ( stub_timer_fire( p_stub, clock_SystemTimeMicroseconds64( ) ) )
+        {
+            count++;
+            busy = WICED_TRUE;
+        }
+    }
+    return count;
+}
+
+void wiced_stub_advance_us( uint64_t us )
+{
+    wiced_stub_t *p_stub = wiced_stub_current( );
+    uint64_t      target = p_stub->now_us + us;
+
+    wiced_stub_run_pending( );
+    while ( p_stub->p_timers && ( p_stub->p_timers->deadline_us <= target ) )
+    {
+        if ( p_stub->p_timers->deadline_us > p_stub->now_us )
+            p_stub->now_us = p_stub->p_timers->deadline_us;
+        wiced_stub_run_pending( );
+    }
+    if ( target > p_stub->now_us )
+        p_stub->now_us = target;
+    wiced_stub_run_pending( );
+}
+
+int wiced_stub_run( uint32_t timeout_ms )
+{
+    wiced_stub_t   *p_stub = wiced_stub_current( );
+    uint64_t        now_us, wake_us;
+    struct timespec ts;
+    int             count;
+
+    if ( ( count = wiced_stub_run_pending( ) ) != 0 )
+        return count;
+
+    now_us  = clock_SystemTimeMicroseconds64( );
+    wake_us = now_us + (uint64_t)timeout_ms * 1000;
+    if ( p_stub->p_timers && ( p_stub->p_timers->deadline_us < wake_us ) )
+        wake_us = p_stub->p_timers->deadline_us;
+
+    if ( p_stub->virtual_time )
+    {
+        wiced_stub_advance_us( wake_us - now_us );
+        return wiced_stub_run_pending( );
+    }
+
+    wake_us += p_stub->origin_us;
+    ts.tv_sec  = wake_us / 1000000;
+    ts.tv_nsec = ( wake_us % 1000000 ) * 1000;
+
+    pthread_mutex_lock( &p_stub->lock );
+    if ( p_stub->p_event_first == NULL )
+        pthread_cond_timedwait( &p_stub->cond, &p_stub->lock, &ts );
+    pthread_mutex_unlock( &p_stub->lock );
+
+    return wiced_stub_run_pending( );
+}
+
+/******************************************************************************
+ *  Stack and device management
+ ******************************************************************************/
+static int stub_stack_enabled( void *p_data )
+{
+    wiced_bt_management_evt_data_t evt;
+
+    memset( &evt, 0, sizeof( evt ) );
+    evt.enabled.status = WICED_BT_SUCCESS;
+    wiced_stub_management_event( BTM_ENABLED_EVT, &evt );
+    return 0;
+}
+
+wiced_result_t wiced_bt_stack_init( wiced_bt_management_cback_t p_bt_management_cback,
+                                    const wiced_bt_cfg_settings_t *p_bt_cfg_settings,
+                                    const wiced_bt_cfg_buf_pool_t *p_bt_cfg_buf_pools )
+{
+    wiced_stub_t *p_stub = wiced_stub_current( );
+
+    p_stub->p_management_cback = p_bt_management_cback;
+
+    /* The controller comes up asynchronously */
+    wiced_stub_post( p_stub, stub_stack_enabled, NULL );
+    return WICED_BT_SUCCESS;
+}
+
+void wiced_stub_management_event( wiced_bt_management_evt_t event, wiced_bt_management_evt_data_t *p_data )
+{
+    wiced_stub_t *p_stub = wiced_stub_current( );
+
+    if ( p_stub->p_management_cback )
+        p_stub->p_management_cback( event, p_data );
+}
+
+wiced_result_t wiced_bt_start_inquiry( wiced_bt_dev_inq_parms_t *p_inqparms, wiced_bt_inquiry_result_cback_t p_inquiry_cb )
+{
+    return WICED_BT_SUCCESS;
+}
+
+wiced_result_t wiced_bt_cancel_inquiry( void )
+{
+    return WICED_BT_SUCCESS;
+}
+
+wiced_result_t wiced_bt_dev_set_discoverability( uint8_t inq_mode, uint16_t window, uint16_t interval )
+{
+    return WICED_BT_SUCCESS;
+}
+
+wiced_result_t wiced_bt_dev_set_connectability( uint8_t page_mode, uint16_t window, uint16_t interval )
+{
+    return WICED_BT_SUCCESS;
+}
+
+void wiced_bt_set_pairable_mode( uint8_t allow_pairing, uint8_t connect_only_paired )
+{
+}
+
+wiced_result_t wiced_bt_dev_delete_bonded_device( wiced_bt_device_address_t bd_addr )
+{
+    return WICED_BT_SUCCESS;
+}
+
+wiced_result_t wiced_bt_dev_add_device_to_address_resolution_db( wiced_bt_device_link_keys_t *p_link_keys )
+{
+    stub_busy( wiced_stub_current( ), STUB_HCI_COMMAND_US );
+    return WICED_BT_SUCCESS;
+}
+
+wiced_result_t wiced_bt_set_local_bdaddr( wiced_bt_device_address_t bd_addr, int addr_type )
+{
+    return WICED_BT_SUCCESS;
+}
+
+void wiced_bt_dev_register_hci_trace( wiced_bt_hci_trace_cback_t p_cback )
+{
+}
+
+wiced_result_t wiced_bt_dev_write_eir( uint8_t *p_buff, uint16_t len )
+{
+    /* The stack takes ownership of the buffer */
+    wiced_bt_free_buffer( p_buff );
+    return WICED_BT_SUCCESS;
+}
+
+void wiced_bt_ble_security_grant( wiced_bt_device_address_t bd_addr, uint8_t res )
+{
+}
+
+void wiced_bt_dev_confirm_req_reply( wiced_result_t res, wiced_bt_device_address_t bd_addr )
+{
+}
+
+typedef struct
+{
+    wiced_bt_dev_cmpl_cback_t  *p_cback;
+    wiced_bt_dev_rssi_result_t  result;
+} stub_rssi_req_t;
+
+static int stub_rssi_complete( void *p_data )
+{
+    stub_rssi_req_t *p_req = p_data;
+
+    p_req->p_cback( &p_req->result );
+    free( p_req );
+    return 0;
+}
+
+void wiced_stub_set_rssi( int8_t rssi )
+{
+    wiced_stub_current( )->rssi = rssi;
+}
+
+wiced_result_t wiced_bt_dev_read_rssi( wiced_bt_device_address_t remote_bda, int transport, wiced_bt_dev_cmpl_cback_t *p_cback )
+{
+    wiced_stub_t    *p_stub = wiced_stub_current( );
+    stub_rssi_req_t *p_req  = calloc( 1, sizeof( stub_rssi_req_t ) );
+
+    if ( p_req == NULL )
+        return WICED_BT_NO_RESOURCES;
+
+    p_req->p_cback       = p_cback;
+    p_req->result.status = WICED_BT_SUCCESS;
+    p_req->result.rssi   = p_stub->rssi;
+    memcpy( p_req->result.rem_bda, remote_bda, BD_ADDR_LEN );
+    wiced_stub_post( p_stub, stub_rssi_complete, p_req );
+    return WICED_BT_SUCCESS;
+}
+
+wiced_bool_t wiced_bt_sdp_db_init( uint8_t *p_sdp_db, uint16_t size )
+{
+    return WICED_TRUE;
+}
+
+wiced_bt_rfcomm_result_t wiced_bt_rfcomm_init( uint32_t buffer_size, uint32_t buffer_cnt )
+{
+    return WICED_BT_RFCOMM_SUCCESS;
+}
+
+/******************************************************************************
+ *  HFP HF profile. Events are injected with wiced_stub_hfp_event(), AT commands the
+ *  application sends are recorded.
+ ******************************************************************************/
+wiced_result_t wiced_bt_hfp_hf_init( wiced_bt_hfp_hf_config_data_t *p_config_data, wiced_bt_hfp_hf_event_cb_t event_cb )
+{
+    wiced_stub_current( )->p_hfp_cback = event_cb;
+    return WICED_BT_SUCCESS;
+}
+
+void wiced_stub_hfp_event( wiced_bt_hfp_hf_event_t event, wiced_bt_hfp_hf_event_data_t *p_data )
+{
+    wiced_stub_t *p_stub = wiced_stub_current( );
+
+    if ( p_stub->p_hfp_cback )
+        p_stub->p_hfp_cback( event, p_data );
+}
+
+wiced_bt_hfp_hf_scb_t *wiced_stub_hfp_add_scb( uint16_t handle, const wiced_bt_device_address_t bd_addr, uint32_t peer_features )
+{
+    wiced_stub_t          *p_stub = wiced_stub_current( );
+    wiced_bt_hfp_hf_scb_t *p_scb  = wiced_bt_hfp_hf_get_scb_by_handle( handle );
+    int                    i;
+
+    for ( i = 0; ( p_scb == NULL ) && ( i < STUB_MAX_SCB ); i++ )
+    {
+        if ( !p_stub->scb_used[i] )
+        {
+            p_stub->scb_used[i] = WICED_TRUE;
+            p_scb               = &p_stub->scb[i];
+        }
+    }
+    if ( p_scb == NULL )
+        return NULL;
+
+    p_scb->rfcomm_handle     = handle;
+    p_scb->peer_feature_mask = peer_features;
+    p_scb->feature_mask      = WICED_BT_HFP_HF_FEATURE_CODEC_NEGOTIATION | WICED_BT_HFP_HF_FEATURE_HF_INDICATORS |
+                               WICED_BT_HFP_HF_FEATURE_VOICE_RECOGNITION_ACTIVATION | WICED_BT_HFP_HF_FEATURE_ENHANCED_VOICE_RECOGNITION;
+    memcpy( p_scb->peer_addr, bd_addr, BD_ADDR_LEN );
+    return p_scb;
+}
+
+wiced_bt_hfp_hf_scb_t *wiced_bt_hfp_hf_get_scb_by_handle( uint16_t handle )
+{
+    wiced_stub_t *p_stub = wiced_stub_current( );
+    int           i;
+
+    for ( i = 0; i < STUB_MAX_SCB; i++ )
+    {
+        if ( p_stub->scb_used[i] && ( p_stub->scb[i].rfcomm_handle == handle ) )
+            return &p_stub->scb[i];
+    }
+    return NULL;
+}
+
+wiced_bt_hfp_hf_scb_t *wiced_bt_hfp_hf_get_scb_by_bd_addr( wiced_bt_device_address_t bd_addr )
+{
+    wiced_stub_t *p_stub = wiced_stub_current( );
+    int           i;
+
+    for ( i = 0; i < STUB_MAX_SCB; i++ )
+    {
+        if ( p_stub->scb_used[i] && ( memcmp( p_stub->scb[i].peer_addr, bd_addr, BD_ADDR_LEN ) == 0 ) )
+            return &p_stub->scb[i];
+    }
+    return NULL;
+}
+
+wiced_result_t wiced_bt_hfp_hf_connect( wiced_bt_device_address_t bd_address )
+{
+    return WICED_BT_SUCCESS;
+}
+
+wiced_result_t wiced_bt_hfp_hf_disconnect( uint16_t handle )
+{
+    return WICED_BT_SUCCESS;
+}
+
+static void stub_at_record( const char *p_fmt, ... )
+{
+    wiced_stub_t *p_stub = wiced_stub_current( );
+    va_list       ap;
+
+    va_start( ap, p_fmt );
+    vsnprintf( p_stub->at_last, sizeof( p_stub->at_last ), p_fmt, ap );
+    va_end( ap );
+    p_stub->at_count++;
+}
+
+void wiced_bt_hfp_hf_at_send_cmd( wiced_bt_hfp_hf_scb_t *p_scb, uint8_t cmd, uint8_t arg_type, uint8_t arg_format, const char *p_arg, int16_t int_arg )
+{
+    stub_at_record( "%s\r", ( cmd == WICED_BT_HFP_HF_CMD_BCC ) ? "AT+BCC" : "AT+?" );
+}
+
+wiced_bool_t wiced_bt_hfp_hf_send_at_cmd( uint16_t handle, char *p_at_cmd )
+{
+    stub_at_record( "%s", p_at_cmd );
+    return WICED_TRUE;
+}
+
+wiced_result_t wiced_bt_hfp_hf_notify_volume( uint16_t handle, uint8_t volume_type, uint8_t volume_level )
+{
+    stub_at_record( "AT+%s=%u\r", ( volume_type == WICED_BT_HFP_HF_SPEAKER ) ? "VGS" : "VGM", volume_level );
+    return WICED_BT_SUCCESS;
+}
+
+wiced_result_t wiced_bt_hfp_hf_perform_call_action( uint16_t handle, uint8_t action, char *p_num )
+{
+    switch ( action )
+    {
+    case WICED_BT_HFP_HF_CALL_ACTION_ANSWER:
+        stub_at_record( "ATA\r" );
+        break;
+    case WICED_BT_HFP_HF_CALL_ACTION_HANGUP:
+        stub_at_record( "AT+CHUP\r" );
+        break;
+    case WICED_BT_HFP_HF_CALL_ACTION_DIAL:
+        if ( p_num && p_num[0] )
+            stub_at_record( "ATD%s;\r", p_num );
+        else
+            stub_at_record( "AT+BLDN\r" );
+        break;
+    default:
+        stub_at_record( "AT+CHLD=%u\r", action - WICED_BT_HFP_HF_CALL_ACTION_HOLD_0 );
+        break;
+    }
+    return WICED_BT_SUCCESS;
+}
+
+uint32_t wiced_stub_at_count( void )
+{
+    return wiced_stub_current( )->at_count;
+}
+
+const char *wiced_stub_at_last( void )
+{
+    return wiced_stub_current( )->at_last;
+}
+
+/******************************************************************************
+ *  SCO
+ ******************************************************************************/
+wiced_result_t wiced_bt_sco_create_as_acceptor( uint16_t *p_sco_index )
+{
+    *p_sco_index = wiced_stub_current( )->sco_next_index++;
+    return WICED_BT_SUCCESS;
+}
+
+static void stub_sco_params_record( wiced_bt_sco_params_t *p_params )
+{
+    wiced_stub_t *p_stub = wiced_stub_current( );
+
+    if ( p_params )
+    {
+        p_stub->sco_params       = *p_params;
+        p_stub->sco_params_valid = WICED_TRUE;
+    }
+}
+
+wiced_result_t wiced_bt_sco_create_as_initiator( wiced_bt_device_address_t bd_addr, uint16_t *p_sco_index, wiced_bt_sco_params_t *p_params )
+{
+    stub_sco_params_record( p_params );
+    *p_sco_index = wiced_stub_current( )->sco_next_index++;
+    return WICED_BT_SUCCESS;
+}
+
+wiced_result_t wiced_bt_sco_remove( uint16_t sco_index )
+{
+    return WICED_BT_SUCCESS;
+}
+
+wiced_result_t wiced_bt_sco_accept_connection( uint16_t sco_index, uint8_t hci_status, wiced_bt_sco_params_t *p_params )
+{
+    stub_sco_params_record( p_params );
+    return WICED_BT_SUCCESS;
+}
+
+void wiced_bt_sco_turn_off_pcm_clock( void )
+{
+}
+
+wiced_result_t wiced_bt_sco_setup_voice_path( wiced_bt_voice_path_setup_t *p_voice_path )
+{
+    wiced_stub_current( )->p_sco_data_cb = p_voice_path->p_sco_data_cb;
+    return WICED_BT_SUCCESS;
+}
+
+uint16_t wiced_bt_sco_output_stream( uint16_t sco_index, uint8_t *p_pcm_data, uint16_t len )
+{
+    wiced_stub_t  *p_stub    = wiced_stub_current( );
+    const int16_t *p_samples = (const int16_t *)p_pcm_data;
+    uint32_t       i;
+
+    for ( i = 0; i < len / 2u; i++ )
+    {
+        if ( p_stub->sco_out_wr - p_stub->sco_out_rd >= STUB_SCO_OUT_SAMPLES )
+            break;
+        p_stub->sco_out[p_stub->sco_out_wr++ & ( STUB_SCO_OUT_SAMPLES - 1 )] = p_samples[i];
+    }
+    return (uint16_t)( i * 2 );
+}
+
+const wiced_bt_sco_params_t *wiced_stub_sco_params( void )
+{
+    wiced_stub_t *p_stub = wiced_stub_current( );
+
+    return p_stub->sco_params_valid ? &p_stub->sco_params : NULL;
+}
+
+wiced_bt_sco_data_cb_t wiced_stub_sco_data_cb( void )
+{
+    return wiced_stub_current( )->p_sco_data_cb;
+}
+
+uint32_t wiced_stub_sco_output( int16_t *p_samples, uint32_t max_samples )
+{
+    wiced_stub_t *p_stub = wiced_stub_current( );
+    uint32_t      n      = 0;
+
+    while ( ( n < max_samples ) && ( p_stub->sco_out_rd != p_stub->sco_out_wr ) )
+        p_samples[n++] = p_stub->sco_out[p_stub->sco_out_rd++ & ( STUB_SCO_OUT_SAMPLES - 1 )];
+    return n;
+}
+
+/******************************************************************************
+ *  Audio manager and codec
+ ******************************************************************************/
+wiced_result_t wiced_audio_buffer_initialize( wiced_bt_audio_config_buffer_t audio_config_buffer )
+{
+    return WICED_SUCCESS;
+}
+
+void wiced_am_init( void )
+{
+}
+
+static void stub_codec_write( wiced_stub_t *p_stub, uint32_t writes )
+{
+    p_stub->codec.reg_writes += writes;
+    p_stub->codec.bus_us     += (uint64_t)writes * STUB_CODEC_WRITE_US;
+    stub_busy( p_stub, (uint64_t)writes * STUB_CODEC_WRITE_US );
+}
+
+static wiced_bool_t stub_stream_valid( wiced_stub_t *p_stub, int32_t stream_id )
+{
+    return ( stream_id >= 0 ) && ( stream_id < STUB_MAX_STREAMS ) && p_stub->stream_type[stream_id];
+}
+
+int32_t wiced_am_stream_open( int stream_type )
+{
+    wiced_stub_t *p_stub = wiced_stub_current( );
+    int32_t       i;
+
+    for ( i = 0; i < STUB_MAX_STREAMS; i++ )
+    {
+        if ( p_stub->stream_type[i] == 0 )
+        {
+            p_stub->stream_type[i] = stream_type;
+            p_stub->codec.opens++;
+            stub_codec_write( p_stub, STUB_CODEC_WRITES_OPEN );
+            return i;
+        }
+    }
+    return WICED_AUDIO_MANAGER_STREAM_ID_INVALID;
+}
+
+wiced_result_t wiced_am_stream_close( int32_t stream_id )
+{
+    wiced_stub_t *p_stub = wiced_stub_current( );
+
+    if ( !stub_stream_valid( p_stub, stream_id ) )
+        return WICED_ERROR;
+
+    p_stub->stream_type[stream_id] = 0;
+    p_stub->codec.closes++;
+    stub_codec_write( p_stub, STUB_CODEC_WRITES_CLOSE );
+    return WICED_SUCCESS;
+}
+
+wiced_result_t wiced_am_stream_start( int32_t stream_id )
+{
+    wiced_stub_t *p_stub = wiced_stub_current( );
+
+    if ( !stub_stream_valid( p_stub, stream_id ) )
+        return WICED_ERROR;
+
+    p_stub->codec.starts++;
+    stub_codec_write( p_stub, STUB_CODEC_WRITES_START );
+    p_stub->codec.started_us[p_stub->stream_type[stream_id]] = clock_SystemTimeMicroseconds64( );
+    return WICED_SUCCESS;
+}
+
+wiced_result_t wiced_am_stream_stop( int32_t stream_id )
+{
+    wiced_stub_t *p_stub = wiced_stub_current( );
+
+    if ( !stub_stream_valid( p_stub, stream_id ) )
+        return WICED_ERROR;
+
+    p_stub->codec.stops++;
+    p_stub->codec.stopped_us[p_stub->stream_type[stream_id]] = clock_SystemTimeMicroseconds64( );
+    stub_codec_write( p_stub, STUB_CODEC_WRITES_STOP );
+    return WICED_SUCCESS;
+}
+
+wiced_result_t wiced_am_stream_set_param( int32_t stream_id, int param, void *p_value )
+{
+    wiced_stub_t *p_stub = wiced_stub_current( );
+
+    if ( !stub_stream_valid( p_stub, stream_id ) )
+        return WICED_ERROR;
+
+    p_stub->codec.set_params++;
+    stub_codec_write( p_stub, ( param == AM_AUDIO_CONFIG ) ? STUB_CODEC_WRITES_CONFIG : STUB_CODEC_WRITES_GAIN );
+    return WICED_SUCCESS;
+}
+
+const wiced_stub_codec_stats_t *wiced_stub_codec_stats( void )
+{
+    return &wiced_stub_current( )->codec;
+}
+
+int32_t wiced_stub_am_open_stream( int stream_type )
+{
+    wiced_stub_t *p_stub = wiced_stub_current( );
+    int32_t       i;
+
+    for ( i = 0; i < STUB_MAX_STREAMS; i++ )
+    {
+        if ( p_stub->stream_type[i] == stream_type )
+            return i;
+    }
+    return WICED_AUDIO_MANAGER_STREAM_ID_INVALID;
+}
+
+/******************************************************************************
+ *  A2DP sink profile
+ ******************************************************************************/
+wiced_result_t wiced_bt_a2dp_sink_init( wiced_bt_a2dp_config_data_t *p_config_data, wiced_bt_a2dp_sink_control_cb_t control_cb )
+{
+    wiced_stub_current( )->p_a2dp_cback = control_cb;
+    return WICED_SUCCESS;
+}
+
+void wiced_stub_a2dp_event( wiced_bt_a2dp_sink_event_t event, wiced_bt_a2dp_sink_event_data_t *p_data )
+{
+    wiced_stub_t *p_stub = wiced_stub_current( );
+
+    if ( p_stub->p_a2dp_cback )
+        p_stub->p_a2dp_cback( event, p_data );
+}
+
+wiced_result_t wiced_bt_a2dp_sink_send_start_response( uint16_t handle, uint8_t label, uint8_t status )
+{
+    return WICED_SUCCESS;
+}
+
+wiced_result_t wiced_bt_a2dp_sink_suspend( uint16_t handle )
+{
+    return WICED_SUCCESS;
+}
+
+wiced_result_t wiced_bt_a2dp_sink_start( uint16_t handle )
+{
+    return WICED_SUCCESS;
+}
+
+/******************************************************************************
+ *  HAL
+ ******************************************************************************/
+void wiced_hal_wdog_reset_system( void )
+{
+    wiced_stub_current( )->resets++;
+    WICED_BT_TRACE( "watchdog reset\n" );
+}
+
+uint32_t wiced_stub_resets( void )
+{
+    return wiced_stub_current( )->resets;
+}
+
+void wiced_hal_puart_select_uart_pads( uint8_t rxdPin, uint8_t txdPin, uint8_t ctsPin, uint8_t rtsPin )
+{
+}
+
+uint16_t wiced_hal_write_nvram( uint16_t vs_id, uint16_t data_length, uint8_t *p_data, wiced_result_t *p_status )
+{
+    wiced_stub_t  *p_stub = wiced_stub_current( );
+    stub_nvram_t **pp, *p_new;
+
+    if ( ( p_new = malloc( sizeof( stub_nvram_t ) + data_length ) ) == NULL )
+    {
+        *p_status = WICED_ERROR;
+        return 0;
+    }
+    p_new->id     = vs_id;
+    p_new->length = data_length;
+    memcpy( p_new->data, p_data, data_length );
+
+    for ( pp = &p_stub->p_nvram; *pp; pp = &( *pp )->p_next )
+    {
+        if ( ( *pp )->id == vs_id )
+        {
+            p_new->p_next = ( *pp )->p_next;
+            free( *pp );
+            break;
+        }
+    }
+    if ( *pp == NULL )
+        p_new->p_next = NULL;
+    *pp = p_new;
+
+    *p_status = WICED_SUCCESS;
+    return data_length;
+}
+
+uint16_t wiced_hal_read_nvram( uint16_t vs_id, uint16_t data_length, uint8_t *p_data, wiced_result_t *p_status )
+{
+    stub_nvram_t *p;
+
+    for ( p = wiced_stub_current( )->p_nvram; p; p = p->p_next )
+    {
+        if ( p->id == vs_id )
+        {
+            if ( data_length > p->length )
+                data_length = p->length;
+            memcpy( p_data, p->data, data_length );
+            *p_status = WICED_SUCCESS;
+            return data_length;
+        }
+    }
+    *p_status = WICED_ERROR;
+    return 0;
+}
+
+/******************************************************************************
+ *  Firmware upgrade library
+ ******************************************************************************/
+wiced_bool_t wiced_firmware_upgrade_init_nv_locations( void )
+{
+    wiced_stub_t *p_stub = wiced_stub_current( );
+
+    if ( ( p_stub->p_ota == NULL ) && ( ( p_stub->p_ota = malloc( HANDSFREE_STUB_OTA_SIZE ) ) == NULL ) )
+        return WICED_FALSE;
+
+    /* Erased flash */
+    memset( p_stub->p_ota, 0xff, HANDSFREE_STUB_OTA_SIZE );
+    p_stub->ota_finished = WICED_FALSE;
+    return WICED_TRUE;
+}
+
+uint32_t wiced_firmware_upgrade_store_to_nv( uint32_t offset, uint8_t *p_data, uint32_t len )
+{
+    wiced_stub_t *p_stub = wiced_stub_current( );
+
+    if ( ( p_stub->p_ota == NULL ) || ( offset > HANDSFREE_STUB_OTA_SIZE ) || ( len > HANDSFREE_STUB_OTA_SIZE - offset ) )
+        return 0;
+    memcpy( p_stub->p_ota + offset, p_data, len );
+    return len;
+}
+
+uint32_t wiced_firmware_upgrade_retrieve_from_nv( uint32_t offset, uint8_t *p_data, uint32_t len )
+{
+    wiced_stub_t *p_stub = wiced_stub_current( );
+
+    if ( ( p_stub->p_ota == NULL ) || ( offset > HANDSFREE_STUB_OTA_SIZE ) || ( len > HANDSFREE_STUB_OTA_SIZE - offset ) )
+        return 0;
+    memcpy( p_data, p_stub->p_ota + offset, len );
+    return len;
+}
+
+void wiced_firmware_upgrade_finish( void )
+{
+    wiced_stub_current( )->ota_finished = WICED_TRUE;
+}
+
+const uint8_t *wiced_stub_ota_image( wiced_bool_t *p_finished )
+{
+    wiced_stub_t *p_stub = wiced_stub_current( );
+
+    if ( p_finished )
+        *p_finished = p_stub->ota_finished;
+    return p_stub->p_ota;
+}
+
+/******************************************************************************
+ *  Utilities
+ ******************************************************************************/
+int utl_itoa( uint16_t i, char *p_s )
+{
+    return sprintf( p_s, "%u", i );
+}
+
+char *utl_strcpy( char *p_dst, const char *p_src )
+{
+    return strcpy( p_dst, p_src );
+}
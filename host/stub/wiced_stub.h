@@ -0,0 +1,959 @@
+/*
+ * Copyright 2016-2024, Cypress Semiconductor Corporation (an Infineon company) or
+ * an affiliate of Cypress Semiconductor Corporation.  All rights reserved.
+ *
+ * This software, including source code, documentation and related
+ * materials ("Software") is owned by Cypress Semiconductor Corporation
+ * or one of its affiliates ("Cypress") and is protected by and subject to
+ * worldwide patent protection (United States and foreign),
+ * United States copyright laws and international treaty provisions.
+ * Therefore, you may use this Software only as provided in the license
+ * agreement accompanying the software package from which you
+ * obtained this Software ("EULA").
+ * If no EULA applies, Cypress hereby grants you a personal, non-exclusive,
+ * non-transferable license to copy, modify, and compile the Software
+ * source code solely for use in connection with Cypress's
+ * integrated circuit products.  Any reproduction, modification, translation,
+ * compilation, or representation of this Software except as specified
+ * above is prohibited without the express written permission of Cypress.
+ *
+ * Disclaimer: THIS SOFTWARE IS PROVIDED AS-IS, WITH NO WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING, BUT NOT LIMITED TO, NONINFRINGEMENT, IMPLIED
+ * WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE. Cypress
+ * reserves the right to make changes to the Software without notice. Cypress
+ * does not assume any liability arising out of the application or use of the
+ * Software or any product or circuit described in the Software. Cypress does
+ * not authorize its products for use in any products where a malfunction or
+ * failure of the Cypress product may reasonably be expected to result in
+ * significant property damage, injury or death ("High Risk Product"). By
+ * including Cypress's product in a High Risk Product, the manufacturer
+ * of such system or application assumes all risk of such use and in doing
+ * so agrees to indemnify Cypress against all liability.
+ */
+
+/** @file
+ *
+ * Stand-in for the parts of the WICED BTSDK used by the handsfree application, for host
+ * builds (HANDSFREE_HOST_BUILD). The SDK header names in this directory all include this
+ * file, so the application sources build unchanged.
+ *
+ * Types and constants follow the SDK where the application depends on them. Behaviour
+ * is implemented in wiced_stub.c: buffers and pools on the heap, timers on a real or
+ * virtual clock, an application event loop, NVRAM and OTA flash in memory, and a
+ * scripted HFP profile and audio manager. The host harness at the end of this file lets
+ * tests, benchmarks and the simulator drive the application and observe what it did.
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/******************************************************************************
+ *  Base types
+ ******************************************************************************/
+typedef int                 wiced_bool_t;
+typedef int                 wiced_result_t;
+typedef uint8_t             UINT8;
+typedef uint16_t            UINT16;
+typedef uint32_t            UINT32;
+typedef uint8_t             BOOLEAN;
+
+#define WICED_TRUE          1
+#define WICED_FALSE         0
+#ifndef TRUE
+#define TRUE                1
+#define FALSE               0
+#endif
+#define WICED_SUCCESS       0
+#define WICED_ERROR         1
+#define WICED_BT_SUCCESS    0
+#define WICED_BT_ERROR      1
+#define WICED_BT_NO_RESOURCES   3
+#define HCI_SUCCESS         0
+#define HCI_ERR_CONNECTION_TOUT 0x08
+
+#define BD_ADDR_LEN         6
+typedef uint8_t             BD_ADDR[BD_ADDR_LEN];
+typedef uint8_t             wiced_bt_device_address_t[BD_ADDR_LEN];
+typedef uint8_t             wiced_bt_dev_class_t[3];
+
+#define UNUSED_VARIABLE( x )    ( void )( x )
+#ifndef MIN
+#define MIN( a, b )         ( ( a ) < ( b ) ? ( a ) : ( b ) )
+#endif
+
+#define STREAM_TO_UINT8( u8, p )    { u8 = (uint8_t)( *( p ) ); ( p ) += 1; }
+#define STREAM_TO_UINT16( u16, p )  { u16 = ( (uint16_t)( *( p ) ) + ( ( (uint16_t)( *( ( p ) + 1 ) ) ) << 8 ) ); ( p ) += 2; }
+#define STREAM_TO_UINT32( u32, p )  { u32 = ( ( (uint32_t)( *( p ) ) ) + ( ( ( (uint32_t)( *( ( p ) + 1 ) ) ) ) << 8 ) + \
+                                            ( ( ( (uint32_t)( *( ( p ) + 2 ) ) ) ) << 16 ) + ( ( ( (uint32_t)( *( ( p ) + 3 ) ) ) ) << 24 ) ); ( p ) += 4; }
+#define UINT8_TO_STREAM( p, u8 )    { *( p )++ = (uint8_t)( u8 ); }
+#define UINT16_TO_STREAM( p, u16 )  { *( p )++ = (uint8_t)( u16 ); *( p )++ = (uint8_t)( ( u16 ) >> 8 ); }
+#define UINT32_TO_STREAM( p, u32 )  { *( p )++ = (uint8_t)( u32 ); *( p )++ = (uint8_t)( ( u32 ) >> 8 ); \
+                                      *( p )++ = (uint8_t)( ( u32 ) >> 16 ); *( p )++ = (uint8_t)( ( u32 ) >> 24 ); }
+#define STREAM_TO_BDADDR( a, p )    { int ijk; for ( ijk = 0; ijk < BD_ADDR_LEN; ijk++ ) ( a )[BD_ADDR_LEN - 1 - ijk] = *( p )++; }
+#define BDADDR_TO_STREAM( p, a )    { int ijk; for ( ijk = 0; ijk < BD_ADDR_LEN; ijk++ ) *( p )++ = (uint8_t)( a )[BD_ADDR_LEN - 1 - ijk]; }
+#define ARRAY_TO_STREAM( p, a, len ) { int ijk; for ( ijk = 0; ijk < ( len ); ijk++ ) *( p )++ = (uint8_t)( a )[ijk]; }
+#define STREAM_TO_ARRAY( a, p, len ) { int ijk; for ( ijk = 0; ijk < ( len ); ijk++ ) ( (uint8_t *)( a ) )[ijk] = *( p )++; }
+
+/* SDK identification reported by HCI_CONTROL_MISC_COMMAND_GET_VERSION */
+#define WICED_SDK_MAJOR_VER     4
+#define WICED_SDK_MINOR_VER     7
+#define WICED_SDK_REV_NUMBER    0
+#define WICED_SDK_BUILD_NUMBER  1
+#define CHIP                    20721
+
+#define APPLICATION_START()     void application_start( void )
+
+/******************************************************************************
+ *  Trace, wiced_bt_trace.h. %B prints a wiced_bt_device_address_t.
+ *  Output goes to stderr when the HANDSFREE_TRACE environment variable is set.
+ ******************************************************************************/
+extern void WICED_BT_TRACE( const char *p_fmt, ... );
+#define WICED_BT_TRACE_ARRAY( p_array, len, p_str )
+
+/******************************************************************************
+ *  Memory, wiced_memory.h
+ ******************************************************************************/
+typedef struct wiced_bt_buffer_pool_s wiced_bt_buffer_pool_t;
+
+extern void *wiced_bt_get_buffer( uint32_t size );
+extern void *wiced_bt_get_buffer_from_pool( wiced_bt_buffer_pool_t *p_pool );
+extern void wiced_bt_free_buffer( void *p_buf );
+extern uint16_t wiced_bt_get_buffer_size( void *p_buf );
+extern wiced_bt_buffer_pool_t *wiced_bt_create_pool( uint32_t buffer_size, uint32_t buffer_cnt );
+extern int wiced_memory_get_free_bytes( void );
+
+/******************************************************************************
+ *  Timers, wiced_timer.h
+ ******************************************************************************/
+typedef uint32_t TIMER_PARAM_TYPE;
+typedef void (*wiced_timer_callback_t)( TIMER_PARAM_TYPE param );
+
+#define WICED_MILLI_SECONDS_TIMER           0
+#define WICED_SECONDS_TIMER                 1
+#define WICED_MILLI_SECONDS_PERIODIC_TIMER  2
+#define WICED_SECONDS_PERIODIC_TIMER        3
+
+typedef struct wiced_timer_s
+{
+    wiced_timer_callback_t  cback;
+    TIMER_PARAM_TYPE        param;
+    int                     type;
+    wiced_bool_t            in_use;
+    uint64_t                deadline_us;
+    uint64_t                period_us;
+    struct wiced_timer_s   *p_next;     /* Running timers of the device, by deadline */
+    void                   *p_owner;    /* wiced_stub_t the timer runs on */
+} wiced_timer_t;
+
+extern wiced_result_t wiced_init_timer( wiced_timer_t *p_timer, wiced_timer_callback_t cback, TIMER_PARAM_TYPE param, int type );
+extern wiced_result_t wiced_start_timer( wiced_timer_t *p_timer, uint32_t timeout );
+extern wiced_result_t wiced_stop_timer( wiced_timer_t *p_timer );
+extern wiced_bool_t wiced_is_timer_in_use( wiced_timer_t *p_timer );
+extern uint64_t clock_SystemTimeMicroseconds64( void );
+
+/* Run a function on the application thread, wiced_rtos.h */
+extern wiced_result_t wiced_app_event_serialize( int (*p_fn)( void *p_data ), void *p_data );
+
+/******************************************************************************
+ *  Transport, wiced_transport.h
+ ******************************************************************************/
+typedef int wiced_transport_type_t;
+typedef uint32_t (*wiced_transport_data_handler_t)( uint8_t *p_data, uint32_t length );
+typedef void (*wiced_transport_status_handler_t)( wiced_transport_type_t type );
+typedef void (*wiced_transport_tx_complete_t)( void *p_pool );
+
+#define WICED_TRANSPORT_UART                1
+#define WICED_TRANSPORT_UART_HCI_MODE       0
+#define HCI_UART_DEFAULT_BAUD               3000000
+
+typedef struct
+{
+    uint32_t    buffer_size;
+    uint32_t    buffer_count;
+} wiced_transport_buffer_pool_cfg_t;
+
+typedef struct
+{
+    wiced_transport_type_t              type;
+    struct
+    {
+        struct
+        {
+            int         mode;
+            uint32_t    baud_rate;
+        } uart_cfg;
+    } cfg;
+    wiced_transport_buffer_pool_cfg_t   rx_buff_pool_cfg;
+    wiced_transport_status_handler_t    p_status_handler;
+    wiced_transport_data_handler_t      p_data_handler;
+    wiced_transport_tx_complete_t       p_tx_complete_cback;
+} wiced_transport_cfg_t;
+
+typedef int wiced_bt_hci_trace_type_t;
+typedef int wiced_debug_uart_types_t;
+
+#define WICED_ROUTE_DEBUG_NONE              0
+#define WICED_ROUTE_DEBUG_TO_PUART          1
+#define WICED_ROUTE_DEBUG_TO_WICED_UART     2
+#define WICED_ROUTE_DEBUG_TO_HCI_UART       3
+
+extern void wiced_transport_send_hci_trace( void *p_trans_pool, wiced_bt_hci_trace_type_t type, uint16_t length, uint8_t *p_data );
+extern void wiced_set_debug_uart( wiced_debug_uart_types_t route );
+
+/******************************************************************************
+ *  Device management, wiced_bt_dev.h
+ ******************************************************************************/
+typedef int wiced_bt_dev_status_t;
+typedef int wiced_bt_management_evt_t;
+
+typedef struct
+{
+    wiced_bt_device_address_t   bd_addr;
+    struct
+    {
+        uint8_t                 br_edr_key[16];
+        uint8_t                 le_keys[100];
+        int                     ble_addr_type;
+    } key_data;
+} wiced_bt_device_link_keys_t;
+
+typedef struct
+{
+    int8_t                      rssi;
+    wiced_bt_device_address_t   remote_bd_addr;
+    wiced_bt_dev_class_t        dev_class;
+} wiced_bt_dev_inquiry_scan_result_t;
+
+typedef struct
+{
+    int     mode;
+    int     duration;
+    int     filter_cond_type;
+} wiced_bt_dev_inq_parms_t;
+
+typedef struct { uint16_t sco_index; } wiced_bt_sco_connected_t;
+typedef struct { uint16_t sco_index; uint8_t reason; } wiced_bt_sco_disconnected_t;
+typedef struct { uint16_t sco_index; wiced_bt_device_address_t bd_addr; } wiced_bt_sco_connection_request_t;
+typedef struct { wiced_bt_device_address_t bd_addr; int result; } wiced_bt_dev_encryption_status_t;
+
+typedef struct
+{
+    wiced_bt_device_address_t   bd_addr;
+    int                         transport;
+    struct
+    {
+        struct { int status; } br_edr;
+        struct { int reason; } ble;
+    } pairing_complete_info;
+} wiced_bt_dev_pairing_cplt_t;
+
+typedef struct
+{
+    wiced_bt_device_address_t   bd_addr;
+    int                         local_io_cap, oob_data, auth_req, max_key_size, init_keys, resp_keys;
+} wiced_bt_dev_ble_io_caps_req_t;
+
+typedef struct
+{
+    wiced_bt_device_address_t   bd_addr;
+    int                         local_io_cap, oob_data, auth_req;
+} wiced_bt_dev_bredr_io_caps_req_t;
+
+typedef union
+{
+    struct { int status; }                  enabled;
+    wiced_bt_sco_connected_t                sco_connected;
+    wiced_bt_sco_disconnected_t             sco_disconnected;
+    wiced_bt_sco_connection_request_t       sco_connection_request;
+    struct { wiced_bt_device_address_t bd_addr; } security_request;
+    wiced_bt_dev_pairing_cplt_t             pairing_complete;
+    wiced_bt_device_link_keys_t             paired_device_link_keys_update;
+    wiced_bt_device_link_keys_t             paired_device_link_keys_request;
+    wiced_bt_dev_ble_io_caps_req_t          pairing_io_capabilities_ble_request;
+    wiced_bt_dev_bredr_io_caps_req_t        pairing_io_capabilities_br_edr_request;
+    struct { wiced_bt_device_address_t bd_addr; } user_confirmation_request;
+    wiced_bt_dev_encryption_status_t        encryption_status;
+} wiced_bt_management_evt_data_t;
+
+enum
+{
+    BTM_ENABLED_EVT,
+    BTM_DISABLED_EVT,
+    BTM_SCO_CONNECTED_EVT,
+    BTM_SCO_DISCONNECTED_EVT,
+    BTM_SCO_CONNECTION_REQUEST_EVT,
+    BTM_SCO_CONNECTION_CHANGE_EVT,
+    BTM_SECURITY_REQUEST_EVT,
+    BTM_PAIRING_COMPLETE_EVT,
+    BTM_LOCAL_IDENTITY_KEYS_UPDATE_EVT,
+    BTM_LOCAL_IDENTITY_KEYS_REQUEST_EVT,
+    BTM_PAIRED_DEVICE_LINK_KEYS_UPDATE_EVT,
+    BTM_PAIRED_DEVICE_LINK_KEYS_REQUEST_EVT,
+    BTM_PAIRING_IO_CAPABILITIES_BLE_REQUEST_EVT,
+    BTM_PAIRING_IO_CAPABILITIES_BR_EDR_REQUEST_EVT,
+    BTM_USER_CONFIRMATION_REQUEST_EVT,
+    BTM_ENCRYPTION_STATUS_EVT,
+    BTM_POWER_MANAGEMENT_STATUS_EVT,
+};
+
+#define BT_TRANSPORT_BR_EDR                             1
+#define BTM_IO_CAPABILITIES_NONE                        3
+#define BTM_OOB_NONE                                    0
+#define BTM_LE_AUTH_REQ_SC_MITM_BOND                    0x2D
+#define BTM_LE_KEY_PENC                                 0x01
+#define BTM_LE_KEY_PID                                  0x02
+#define BTM_LE_KEY_PCSRK                                0x04
+#define BTM_LE_KEY_LENC                                 0x08
+#define BTM_AUTH_SINGLE_PROFILE_GENERAL_BONDING_NO      4
+#define BTM_GENERAL_INQUIRY                             0
+#define BTM_CLR_INQUIRY_FILTER                          0
+#define BTM_NON_DISCOVERABLE                            0
+#define BTM_GENERAL_DISCOVERABLE                        2
+#define BTM_DEFAULT_DISC_WINDOW                         0x0012
+#define BTM_DEFAULT_DISC_INTERVAL                       0x0800
+#define BTM_DEFAULT_CONN_WINDOW                         0x0012
+#define BTM_DEFAULT_CONN_INTERVAL                       0x0800
+#define BLE_ADDR_PUBLIC                                 0
+
+typedef wiced_result_t (*wiced_bt_management_cback_t)( wiced_bt_management_evt_t event, wiced_bt_management_evt_data_t *p_event_data );
+typedef void (*wiced_bt_inquiry_result_cback_t)( wiced_bt_dev_inquiry_scan_result_t *p_inquiry_result, uint8_t *p_eir_data );
+typedef void (*wiced_bt_hci_trace_cback_t)( wiced_bt_hci_trace_type_t type, uint16_t length, uint8_t *p_data );
+typedef void (wiced_bt_dev_cmpl_cback_t)( void *p_result );
+
+typedef struct
+{
+    wiced_result_t              status;
+    uint8_t                     hci_status;
+    int8_t                      rssi;
+    wiced_bt_device_address_t   rem_bda;
+} wiced_bt_dev_rssi_result_t;
+
+extern wiced_result_t wiced_bt_start_inquiry( wiced_bt_dev_inq_parms_t *p_inqparms, wiced_bt_inquiry_result_cback_t p_inquiry_cb );
+extern wiced_result_t wiced_bt_cancel_inquiry( void );
+extern wiced_result_t wiced_bt_dev_set_discoverability( uint8_t inq_mode, uint16_t window, uint16_t interval );
+extern wiced_result_t wiced_bt_dev_set_connectability( uint8_t page_mode, uint16_t window, uint16_t interval );
+extern void wiced_bt_set_pairable_mode( uint8_t allow_pairing, uint8_t connect_only_paired );
+extern wiced_result_t wiced_bt_dev_delete_bonded_device( wiced_bt_device_address_t bd_addr );
+extern wiced_result_t wiced_bt_dev_add_device_to_address_resolution_db( wiced_bt_device_link_keys_t *p_link_keys );
+extern wiced_result_t wiced_bt_set_local_bdaddr( wiced_bt_device_address_t bd_addr, int addr_type );
+extern void wiced_bt_dev_register_hci_trace( wiced_bt_hci_trace_cback_t p_cback );
+extern wiced_result_t wiced_bt_dev_write_eir( uint8_t *p_buff, uint16_t len );
+extern void wiced_bt_ble_security_grant( wiced_bt_device_address_t bd_addr, uint8_t res );
+extern void wiced_bt_dev_confirm_req_reply( wiced_result_t res, wiced_bt_device_address_t bd_addr );
+extern wiced_result_t wiced_bt_dev_read_rssi( wiced_bt_device_address_t remote_bda, int transport, wiced_bt_dev_cmpl_cback_t *p_cback );
+
+/******************************************************************************
+ *  Stack configuration, wiced_bt_cfg.h
+ ******************************************************************************/
+typedef struct
+{
+    uint8_t    *device_name;
+    struct
+    {
+        int     max_links;
+        int     max_ports;
+    } rfcomm_cfg;
+    struct
+    {
+        int     max_links;
+        int     max_channels;
+        int     max_psm;
+    } l2cap_application;
+} wiced_bt_cfg_settings_t;
+
+typedef struct
+{
+    uint16_t    buf_size;
+    uint16_t    buf_count;
+} wiced_bt_cfg_buf_pool_t;
+
+extern wiced_result_t wiced_bt_stack_init( wiced_bt_management_cback_t p_bt_management_cback,
+                                           const wiced_bt_cfg_settings_t *p_bt_cfg_settings,
+                                           const wiced_bt_cfg_buf_pool_t *p_bt_cfg_buf_pools );
+
+/******************************************************************************
+ *  SDP, wiced_bt_sdp.h
+ ******************************************************************************/
+#define UUID_SERVCLASS_HEADSET              0x1108
+#define UUID_SERVCLASS_HF_HANDSFREE         0x111E
+#define UUID_SERVCLASS_GENERIC_AUDIO        0x1203
+
+extern wiced_bool_t wiced_bt_sdp_db_init( uint8_t *p_sdp_db, uint16_t size );
+
+/******************************************************************************
+ *  SCO, wiced_bt_sco.h
+ ******************************************************************************/
+typedef struct
+{
+    uint16_t        max_latency;
+    uint16_t        packet_types;
+    uint8_t         retrans_effort;
+    wiced_bool_t    use_wbs;
+} wiced_bt_sco_params_t;
+
+/* SCO_OVER_APP_CB: one packet of received SCO data */
+typedef void (*wiced_bt_sco_data_cb_t)( uint16_t sco_channel, uint16_t length, uint8_t *p_data );
+
+typedef struct
+{
+    int                     path;
+    wiced_bt_sco_data_cb_t  p_sco_data_cb;
+} wiced_bt_voice_path_setup_t;
+
+#define WICED_BT_SCO_OVER_HCI               0
+#define WICED_BT_SCO_OVER_PCM               1
+#define WICED_BT_SCO_OVER_I2SPCM            2
+#define WICED_BT_SCO_OVER_APP_CB            3
+
+extern wiced_result_t wiced_bt_sco_create_as_acceptor( uint16_t *p_sco_index );
+extern wiced_result_t wiced_bt_sco_create_as_initiator( wiced_bt_device_address_t bd_addr, uint16_t *p_sco_index, wiced_bt_sco_params_t *p_params );
+extern wiced_result_t wiced_bt_sco_remove( uint16_t sco_index );
+extern wiced_result_t wiced_bt_sco_accept_connection( uint16_t sco_index, uint8_t hci_status, wiced_bt_sco_params_t *p_params );
+extern void wiced_bt_sco_turn_off_pcm_clock( void );
+extern wiced_result_t wiced_bt_sco_setup_voice_path( wiced_bt_voice_path_setup_t *p_voice_path );
+extern uint16_t wiced_bt_sco_output_stream( uint16_t sco_index, uint8_t *p_pcm_data, uint16_t len );
+
+/******************************************************************************
+ *  Audio buffers and audio manager, wiced_bt_audio.h, wiced_audio_manager.h
+ ******************************************************************************/
+#define WICED_HF_ROLE                       0x02
+#define WICED_AUDIO_SINK_ROLE               0x04
+
+typedef struct
+{
+    int         role;
+    uint32_t    audio_tx_buffer_size;
+    uint32_t    audio_codec_buffer_size;
+    uint32_t    audio_tx_buffer_watermark_level;
+} wiced_bt_audio_config_buffer_t;
+
+extern wiced_result_t wiced_audio_buffer_initialize( wiced_bt_audio_config_buffer_t audio_config_buffer );
+
+#define WICED_AUDIO_MANAGER_STREAM_ID_INVALID   -1
+#define AM_PLAYBACK_SR_8K                   8000
+#define AM_PLAYBACK_SR_16K                  16000
+#define AM_PLAYBACK_SR_44K                  44100
+#define AM_PLAYBACK_SR_48K                  48000
+#define DEFAULT_BITSPSAM                    16
+#define AM_VOL_LEVEL_LOW                    0
+#define AM_VOL_LEVEL_HIGH                   10
+#define AM_HEADPHONES                       1
+
+typedef struct
+{
+    uint32_t    sr;
+    uint8_t     channels;
+    uint8_t     bits_per_sample;
+    int32_t     volume;
+    int32_t     mic_gain;
+    int         sink;
+} audio_config_t;
+
+/* Stream types */
+#define A2DP_PLAYBACK                       1
+#define A2DP_SINK                           A2DP_PLAYBACK
+#define HFP                                 2
+
+/* Stream parameters */
+enum
+{
+    AM_AUDIO_CONFIG,
+    AM_SPEAKER_VOL_LEVEL,
+    AM_MIC_GAIN_LEVEL,
+};
+
+extern void wiced_am_init( void );
+extern int32_t wiced_am_stream_open( int stream_type );
+extern wiced_result_t wiced_am_stream_close( int32_t stream_id );
+extern wiced_result_t wiced_am_stream_start( int32_t stream_id );
+extern wiced_result_t wiced_am_stream_stop( int32_t stream_id );
+extern wiced_result_t wiced_am_stream_set_param( int32_t stream_id, int param, void *p_value );
+
+/******************************************************************************
+ *  HAL, wiced_hal_*.h
+ ******************************************************************************/
+extern void wiced_hal_wdog_reset_system( void );
+extern uint16_t wiced_hal_write_nvram( uint16_t vs_id, uint16_t data_length, uint8_t *p_data, wiced_result_t *p_status );
+extern uint16_t wiced_hal_read_nvram( uint16_t vs_id, uint16_t data_length, uint8_t *p_data, wiced_result_t *p_status );
+extern void wiced_hal_puart_select_uart_pads( uint8_t rxdPin, uint8_t txdPin, uint8_t ctsPin, uint8_t rtsPin );
+
+/******************************************************************************
+ *  Utilities, wiced_bt_utils.h
+ ******************************************************************************/
+extern int utl_itoa( uint16_t i, char *p_s );
+extern char *utl_strcpy( char *p_dst, const char *p_src );
+
+/******************************************************************************
+ *  RFCOMM and HFP HF profile, wiced_bt_hfp_hf_int.h
+ ******************************************************************************/
+typedef int wiced_bt_rfcomm_result_t;
+#define WICED_BT_RFCOMM_SUCCESS             0
+
+extern wiced_bt_rfcomm_result_t wiced_bt_rfcomm_init( uint32_t buffer_size, uint32_t buffer_cnt );
+
+#define WICED_BT_HFP_HF_MAX_AT_CMD_LEN      256
+#define WICED_BT_HFP_HF_AT_MAX_LEN          256
+
+typedef int wiced_bt_hfp_hf_connection_state_t;
+typedef int wiced_bt_hfp_hf_callsetup_state_t;
+typedef int wiced_bt_hfp_hf_inband_ring_state_t;
+typedef int wiced_bt_hfp_hf_event_t;
+
+enum
+{
+    WICED_BT_HFP_HF_STATE_DISCONNECTED,
+    WICED_BT_HFP_HF_STATE_CONNECTED,
+    WICED_BT_HFP_HF_STATE_SLC_CONNECTED,
+};
+
+enum
+{
+    WICED_BT_HFP_HF_CALLSETUP_STATE_IDLE,
+    WICED_BT_HFP_HF_CALLSETUP_STATE_INCOMING,
+    WICED_BT_HFP_HF_CALLSETUP_STATE_DIALING,
+    WICED_BT_HFP_HF_CALLSETUP_STATE_ALERTING,
+};
+
+enum
+{
+    WICED_BT_HFP_HF_INBAND_RING_DISABLED,
+    WICED_BT_HFP_HF_INBAND_RING_ENABLED,
+};
+
+enum
+{
+    WICED_BT_HFP_HF_CONNECTION_STATE_EVT,
+    WICED_BT_HFP_HF_AG_FEATURE_SUPPORT_EVT,
+    WICED_BT_HFP_HF_SERVICE_STATE_EVT,
+    WICED_BT_HFP_HF_CALL_SETUP_EVT,
+    WICED_BT_HFP_HF_RSSI_IND_EVT,
+    WICED_BT_HFP_HF_SERVICE_TYPE_EVT,
+    WICED_BT_HFP_HF_BATTERY_STATUS_IND_EVT,
+    WICED_BT_HFP_HF_RING_EVT,
+    WICED_BT_HFP_HF_INBAND_RING_STATE_EVT,
+    WICED_BT_HFP_HF_OK_EVT,
+    WICED_BT_HFP_HF_ERROR_EVT,
+    WICED_BT_HFP_HF_CME_ERROR_EVT,
+    WICED_BT_HFP_HF_CLIP_IND_EVT,
+    WICED_BT_HFP_HF_BINP_EVT,
+    WICED_BT_HFP_HF_VOLUME_CHANGE_EVT,
+    WICED_BT_HFP_HFP_CODEC_SET_EVT,
+    WICED_BT_HFP_HFP_ACTIVE_CALL_EVT,
+    WICED_BT_HFP_HF_CNUM_EVT,
+    WICED_BT_HFP_HF_BIND_EVT,
+    WICED_BT_HFP_HF_BVRA_EVT,
+    WICED_BT_HFP_HF_UNKNOWN_AT_CMD_EVT,
+};
+
+enum
+{
+    WICED_BT_HFP_PROFILE = 1,
+    WICED_BT_HSP_PROFILE = 2,
+};
+
+enum
+{
+    WICED_BT_HFP_HF_SPEAKER,
+    WICED_BT_HFP_HF_MIC,
+};
+
+#define WICED_BT_HFP_HF_CVSD_CODEC                              1
+#define WICED_BT_HFP_HF_MSBC_CODEC                              2
+
+#define WICED_BT_HFP_AG_FEATURE_VOICE_RECOGNITION_ACTIVATION    0x00000004
+#define WICED_BT_HFP_AG_FEATURE_INBAND_RING_TONE_CAPABILITY     0x00000008
+#define WICED_BT_HFP_AG_FEATURE_CODEC_NEGOTIATION               0x00000200
+#define WICED_BT_HFP_AG_FEATURE_HF_INDICATORS                   0x00000400
+#define WICED_BT_HFP_AG_FEATURE_ENHANCED_VOICE_RECOGNITION      0x00001000
+
+#define WICED_BT_HFP_HF_FEATURE_ECNR                            0x00000001
+#define WICED_BT_HFP_HF_FEATURE_3WAY_CALLING                    0x00000002
+#define WICED_BT_HFP_HF_FEATURE_CLIP_CAPABILITY                 0x00000004
+#define WICED_BT_HFP_HF_FEATURE_VOICE_RECOGNITION_ACTIVATION    0x00000008
+#define WICED_BT_HFP_HF_FEATURE_REMOTE_VOLUME_CONTROL           0x00000010
+#define WICED_BT_HFP_HF_FEATURE_ENHANCED_CALL_STATUS            0x00000020
+#define WICED_BT_HFP_HF_FEATURE_ENHANCED_CALL_CONTROL           0x00000040
+#define WICED_BT_HFP_HF_FEATURE_CODEC_NEGOTIATION               0x00000080
+#define WICED_BT_HFP_HF_FEATURE_HF_INDICATORS                   0x00000100
+#define WICED_BT_HFP_HF_FEATURE_ENHANCED_VOICE_RECOGNITION      0x00000400
+
+enum
+{
+    WICED_BT_HFP_HF_AT_NONE,
+    WICED_BT_HFP_HF_AT_SET,
+    WICED_BT_HFP_HF_AT_READ,
+    WICED_BT_HFP_HF_AT_TEST,
+};
+
+enum
+{
+    WICED_BT_HFP_HF_AT_FMT_NONE,
+    WICED_BT_HFP_HF_AT_FMT_INT,
+    WICED_BT_HFP_HF_AT_FMT_STR,
+};
+
+#define WICED_BT_HFP_HF_CMD_BCC             1
+
+enum
+{
+    WICED_BT_HFP_HF_CALL_ACTION_HOLD_0,
+    WICED_BT_HFP_HF_CALL_ACTION_ANSWER = 10,
+    WICED_BT_HFP_HF_CALL_ACTION_HANGUP,
+    WICED_BT_HFP_HF_CALL_ACTION_DIAL,
+};
+
+typedef struct
+{
+    int                                 active_call_present;
+    int                                 held_call_present;
+    wiced_bt_hfp_hf_callsetup_state_t   setup_state;
+} wiced_bt_hfp_hf_call_data_t;
+
+typedef struct
+{
+    uint8_t     idx;
+    uint8_t     dir;
+    uint8_t     status;
+    uint8_t     mode;
+    uint8_t     is_conference;
+    char        num[32];
+    uint8_t     type;
+} wiced_bt_hfp_hf_active_call_t;
+
+typedef struct
+{
+    uint16_t    handle;
+    union
+    {
+        struct
+        {
+            wiced_bt_hfp_hf_connection_state_t  conn_state;
+            wiced_bt_device_address_t           remote_address;
+            int                                 connected_profile;
+        } conn_data;
+        uint32_t                                ag_feature_flags;
+        int                                     service_state;
+        wiced_bt_hfp_hf_call_data_t             call_data;
+        int                                     rssi;
+        int                                     service_type;
+        int                                     battery_level;
+        wiced_bt_hfp_hf_inband_ring_state_t     inband_ring;
+        int                                     error_code;
+        struct { char caller_num[32]; uint8_t type; } clip;
+        struct { char caller_num[32]; uint8_t type; } binp_data;
+        struct { int type; uint8_t level; }     volume;
+        uint8_t                                 selected_codec;
+        wiced_bt_hfp_hf_active_call_t           active_call;
+        char                                    cnum_data[64];
+        struct { uint8_t ind_id; uint8_t ind_value; } bind_data;
+        uint8_t                                 voice_recognition;
+        char                                   *unknown_at_data;
+    };
+} wiced_bt_hfp_hf_event_data_t;
+
+typedef struct
+{
+    uint32_t                    peer_feature_mask;
+    uint32_t                    feature_mask;
+    uint16_t                    rfcomm_handle;
+    wiced_bt_device_address_t   peer_addr;
+} wiced_bt_hfp_hf_scb_t;
+
+typedef struct
+{
+    uint32_t    feature_mask;
+    uint8_t     speaker_volume;
+    uint8_t     mic_volume;
+    uint8_t     num_server;
+    uint8_t     scn[2];
+    uint16_t    uuid[2];
+} wiced_bt_hfp_hf_config_data_t;
+
+typedef void (*wiced_bt_hfp_hf_event_cb_t)( wiced_bt_hfp_hf_event_t event, wiced_bt_hfp_hf_event_data_t *p_data );
+
+extern wiced_result_t wiced_bt_hfp_hf_init( wiced_bt_hfp_hf_config_data_t *p_config_data, wiced_bt_hfp_hf_event_cb_t event_cb );
+extern wiced_bt_hfp_hf_scb_t *wiced_bt_hfp_hf_get_scb_by_handle( uint16_t handle );
+extern wiced_bt_hfp_hf_scb_t *wiced_bt_hfp_hf_get_scb_by_bd_addr( wiced_bt_device_address_t bd_addr );
+extern wiced_result_t wiced_bt_hfp_hf_connect( wiced_bt_device_address_t bd_address );
+extern wiced_result_t wiced_bt_hfp_hf_disconnect( uint16_t handle );
+extern void wiced_bt_hfp_hf_at_send_cmd( wiced_bt_hfp_hf_scb_t *p_scb, uint8_t cmd, uint8_t arg_type, uint8_t arg_format, const char *p_arg, int16_t int_arg );
+extern wiced_bool_t wiced_bt_hfp_hf_send_at_cmd( uint16_t handle, char *p_at_cmd );
+extern wiced_result_t wiced_bt_hfp_hf_notify_volume( uint16_t handle, uint8_t volume_type, uint8_t volume_level );
+extern wiced_result_t wiced_bt_hfp_hf_perform_call_action( uint16_t handle, uint8_t action, char *p_num );
+
+/******************************************************************************
+ *  WICED HCI control protocol, hci_control_api.h
+ ******************************************************************************/
+#define HCI_CONTROL_GROUP_DEVICE                    0x00
+#define HCI_CONTROL_GROUP_HF                        0x03
+#define HCI_CONTROL_GROUP_MISC                      0xFF
+
+#define HCI_CONTROL_COMMAND_RESET                   ( ( HCI_CONTROL_GROUP_DEVICE << 8 ) | 0x01 )
+#define HCI_CONTROL_COMMAND_TRACE_ENABLE            ( ( HCI_CONTROL_GROUP_DEVICE << 8 ) | 0x02 )
+#define HCI_CONTROL_COMMAND_SET_LOCAL_BDA           ( ( HCI_CONTROL_GROUP_DEVICE << 8 ) | 0x03 )
+#define HCI_CONTROL_COMMAND_PUSH_NVRAM_DATA         ( ( HCI_CONTROL_GROUP_DEVICE << 8 ) | 0x05 )
+#define HCI_CONTROL_COMMAND_DELETE_NVRAM_DATA       ( ( HCI_CONTROL_GROUP_DEVICE << 8 ) | 0x06 )
+#define HCI_CONTROL_COMMAND_INQUIRY                 ( ( HCI_CONTROL_GROUP_DEVICE << 8 ) | 0x07 )
+#define HCI_CONTROL_COMMAND_SET_VISIBILITY          ( ( HCI_CONTROL_GROUP_DEVICE << 8 ) | 0x08 )
+#define HCI_CONTROL_COMMAND_SET_PAIRING_MODE        ( ( HCI_CONTROL_GROUP_DEVICE << 8 ) | 0x09 )
+
+#define HCI_CONTROL_EVENT_COMMAND_STATUS            ( ( HCI_CONTROL_GROUP_DEVICE << 8 ) | 0x01 )
+#define HCI_CONTROL_EVENT_NVRAM_DATA                ( ( HCI_CONTROL_GROUP_DEVICE << 8 ) | 0x04 )
+#define HCI_CONTROL_EVENT_DEVICE_STARTED            ( ( HCI_CONTROL_GROUP_DEVICE << 8 ) | 0x05 )
+#define HCI_CONTROL_EVENT_INQUIRY_RESULT            ( ( HCI_CONTROL_GROUP_DEVICE << 8 ) | 0x06 )
+#define HCI_CONTROL_EVENT_INQUIRY_COMPLETE          ( ( HCI_CONTROL_GROUP_DEVICE << 8 ) | 0x07 )
+#define HCI_CONTROL_EVENT_PAIRING_COMPLETE          ( ( HCI_CONTROL_GROUP_DEVICE << 8 ) | 0x08 )
+#define HCI_CONTROL_EVENT_ENCRYPTION_CHANGED        ( ( HCI_CONTROL_GROUP_DEVICE << 8 ) | 0x09 )
+#define HCI_CONTROL_EVENT_MAX_NUM_OF_PAIRED_DEVICES_REACHED ( ( HCI_CONTROL_GROUP_DEVICE << 8 ) | 0x0F )
+
+#define HCI_CONTROL_STATUS_SUCCESS                  0
+#define HCI_CONTROL_STATUS_IN_PROGRESS              1
+#define HCI_CONTROL_STATUS_UNKNOWN_GROUP            3
+#define HCI_CONTROL_STATUS_INVALID_ARGS             4
+#define HCI_CONTROL_STATUS_UNKNOWN_COMMAND          5
+#define HCI_CONTROL_STATUS_FAILED                   6
+#define HCI_CONTROL_STATUS_OUT_OF_MEMORY            8
+
+#define HCI_CONTROL_HF_COMMAND_CONNECT              ( ( HCI_CONTROL_GROUP_HF << 8 ) | 0x01 )
+#define HCI_CONTROL_HF_COMMAND_DISCONNECT           ( ( HCI_CONTROL_GROUP_HF << 8 ) | 0x02 )
+#define HCI_CONTROL_HF_COMMAND_OPEN_AUDIO           ( ( HCI_CONTROL_GROUP_HF << 8 ) | 0x03 )
+#define HCI_CONTROL_HF_COMMAND_CLOSE_AUDIO          ( ( HCI_CONTROL_GROUP_HF << 8 ) | 0x04 )
+#define HCI_CONTROL_HF_COMMAND_TURN_OFF_PCM_CLK     ( ( HCI_CONTROL_GROUP_HF << 8 ) | 0x06 )
+#define HCI_CONTROL_HF_COMMAND_BUTTON_PRESS         ( ( HCI_CONTROL_GROUP_HF << 8 ) | 0x07 )
+#define HCI_CONTROL_HF_COMMAND_LONG_BUTTON_PRESS    ( ( HCI_CONTROL_GROUP_HF << 8 ) | 0x08 )
+#define HCI_CONTROL_HF_AT_COMMAND_BASE              ( ( HCI_CONTROL_GROUP_HF << 8 ) | 0x20 )
+
+enum
+{
+    HCI_CONTROL_HF_AT_COMMAND_SPK,
+    HCI_CONTROL_HF_AT_COMMAND_MIC,
+    HCI_CONTROL_HF_AT_COMMAND_A,
+    HCI_CONTROL_HF_AT_COMMAND_BINP,
+    HCI_CONTROL_HF_AT_COMMAND_BVRA,
+    HCI_CONTROL_HF_AT_COMMAND_BLDN,
+    HCI_CONTROL_HF_AT_COMMAND_CHLD,
+    HCI_CONTROL_HF_AT_COMMAND_CHUP,
+    HCI_CONTROL_HF_AT_COMMAND_CIND,
+    HCI_CONTROL_HF_AT_COMMAND_CNUM,
+    HCI_CONTROL_HF_AT_COMMAND_D,
+    HCI_CONTROL_HF_AT_COMMAND_NREC,
+    HCI_CONTROL_HF_AT_COMMAND_VTS,
+    HCI_CONTROL_HF_AT_COMMAND_BTRH,
+    HCI_CONTROL_HF_AT_COMMAND_COPS,
+    HCI_CONTROL_HF_AT_COMMAND_CMEE,
+    HCI_CONTROL_HF_AT_COMMAND_CLCC,
+    HCI_CONTROL_HF_AT_COMMAND_BIA,
+    HCI_CONTROL_HF_AT_COMMAND_BIEV,
+};
+
+#define HCI_CONTROL_HF_EVENT_OPEN                   ( ( HCI_CONTROL_GROUP_HF << 8 ) | 0x01 )
+#define HCI_CONTROL_HF_EVENT_CLOSE                  ( ( HCI_CONTROL_GROUP_HF << 8 ) | 0x02 )
+#define HCI_CONTROL_HF_EVENT_CONNECTED              ( ( HCI_CONTROL_GROUP_HF << 8 ) | 0x03 )
+#define HCI_CONTROL_HF_EVENT_AUDIO_OPEN             ( ( HCI_CONTROL_GROUP_HF << 8 ) | 0x04 )
+#define HCI_CONTROL_HF_EVENT_AUDIO_CLOSE            ( ( HCI_CONTROL_GROUP_HF << 8 ) | 0x05 )
+#define HCI_CONTROL_HF_EVENT_AUDIO_CONN_REQ         ( ( HCI_CONTROL_GROUP_HF << 8 ) | 0x06 )
+#define HCI_CONTROL_HF_EVENT_PROFILE_TYPE           ( ( HCI_CONTROL_GROUP_HF << 8 ) | 0x07 )
+#define HCI_CONTROL_HF_AT_EVENT_BASE                ( ( HCI_CONTROL_GROUP_HF << 8 ) | 0x20 )
+
+enum
+{
+    HCI_CONTROL_HF_AT_EVENT_OK,
+    HCI_CONTROL_HF_AT_EVENT_ERROR,
+    HCI_CONTROL_HF_AT_EVENT_CMEE,
+    HCI_CONTROL_HF_AT_EVENT_RING,
+    HCI_CONTROL_HF_AT_EVENT_VGS,
+    HCI_CONTROL_HF_AT_EVENT_VGM,
+    HCI_CONTROL_HF_AT_EVENT_CCWA,
+    HCI_CONTROL_HF_AT_EVENT_CHLD,
+    HCI_CONTROL_HF_AT_EVENT_CIND,
+    HCI_CONTROL_HF_AT_EVENT_CLIP,
+    HCI_CONTROL_HF_AT_EVENT_CIEV,
+    HCI_CONTROL_HF_AT_EVENT_BINP,
+    HCI_CONTROL_HF_AT_EVENT_BVRA,
+    HCI_CONTROL_HF_AT_EVENT_BSIR,
+    HCI_CONTROL_HF_AT_EVENT_CNUM,
+    HCI_CONTROL_HF_AT_EVENT_BTRH,
+    HCI_CONTROL_HF_AT_EVENT_COPS,
+    HCI_CONTROL_HF_AT_EVENT_CLCC,
+    HCI_CONTROL_HF_AT_EVENT_BIND,
+    HCI_CONTROL_HF_AT_EVENT_BCS,
+    HCI_CONTROL_HF_AT_EVENT_UNAT,
+    HCI_CONTROL_HF_AT_EVENT_MAX,
+};
+
+#define HCI_CONTROL_MISC_COMMAND_PING               ( ( HCI_CONTROL_GROUP_MISC << 8 ) | 0x01 )
+#define HCI_CONTROL_MISC_COMMAND_GET_VERSION        ( ( HCI_CONTROL_GROUP_MISC << 8 ) | 0x02 )
+#define HCI_CONTROL_MISC_EVENT_PING_REPLY           ( ( HCI_CONTROL_GROUP_MISC << 8 ) | 0x01 )
+#define HCI_CONTROL_MISC_EVENT_VERSION              ( ( HCI_CONTROL_GROUP_MISC << 8 ) | 0x02 )
+
+/******************************************************************************
+ *  A2DP sink profile, wiced_bt_a2dp_sink.h
+ ******************************************************************************/
+#define WICED_BT_A2DP_CODEC_SBC             0x00
+
+#define A2D_SUCCESS                         0x00
+#define A2D_BUSY                            0x1B
+
+#define A2D_SBC_IE_SAMP_FREQ_48             0x10
+#define A2D_SBC_IE_SAMP_FREQ_44             0x20
+#define A2D_SBC_IE_CH_MD_JOINT              0x01
+#define A2D_SBC_IE_CH_MD_STEREO             0x02
+#define A2D_SBC_IE_CH_MD_DUAL               0x04
+#define A2D_SBC_IE_CH_MD_MONO               0x08
+#define A2D_SBC_IE_BLOCKS_16                0x10
+#define A2D_SBC_IE_BLOCKS_12                0x20
+#define A2D_SBC_IE_BLOCKS_8                 0x40
+#define A2D_SBC_IE_BLOCKS_4                 0x80
+#define A2D_SBC_IE_SUBBAND_8                0x04
+#define A2D_SBC_IE_SUBBAND_4                0x08
+#define A2D_SBC_IE_ALLOC_MD_L               0x01
+#define A2D_SBC_IE_ALLOC_MD_S               0x02
+#define A2D_SBC_IE_MIN_BITPOOL              2
+#define A2D_SBC_IE_MAX_BITPOOL              250
+
+#define WICED_BT_A2DP_SINK_OVERRUN_CONTROL_FLUSH_DATA   0
+
+typedef struct
+{
+    uint8_t     samp_freq, ch_mode, block_len, num_subbands, alloc_mthd, min_bitpool, max_bitpool;
+} wiced_bt_a2d_sbc_cie_t;
+
+typedef struct
+{
+    uint8_t     codec_id;
+    union
+    {
+        wiced_bt_a2d_sbc_cie_t  sbc;
+    } cie;
+} wiced_bt_a2dp_codec_info_t;
+
+typedef struct
+{
+    uint8_t                     count;
+    wiced_bt_a2dp_codec_info_t *info;
+} wiced_bt_a2dp_codec_info_list_t;
+
+typedef struct
+{
+    int     buf_depth_ms, start_buf_depth, target_buf_depth, overrun_control, adj_ppm_max, adj_ppm_min;
+    int     adj_ppb_per_msec, lvl_correction_threshold_high, lvl_correction_threshold_low;
+    int     adj_proportional_gain, adj_integral_gain;
+} wiced_bt_a2dp_sink_param_t;
+
+typedef struct
+{
+    uint32_t                        feature_mask;
+    wiced_bt_a2dp_codec_info_list_t codec_capabilities;
+    wiced_bt_a2dp_sink_param_t      p_param;
+} wiced_bt_a2dp_config_data_t;
+
+typedef enum
+{
+    WICED_BT_A2DP_SINK_CONNECT_EVT,
+    WICED_BT_A2DP_SINK_DISCONNECT_EVT,
+    WICED_BT_A2DP_SINK_START_IND_EVT,
+    WICED_BT_A2DP_SINK_START_CFM_EVT,
+    WICED_BT_A2DP_SINK_SUSPEND_EVT,
+    WICED_BT_A2DP_SINK_CODEC_CONFIG_EVT,
+} wiced_bt_a2dp_sink_event_t;
+
+typedef union
+{
+    struct { wiced_result_t result; wiced_bt_device_address_t bd_addr; uint16_t handle; } connect;
+    struct { uint16_t handle; }                                 disconnect;
+    struct { uint16_t handle; uint8_t label; }                  start_ind;
+    struct { uint16_t handle; wiced_result_t result; }          start_cfm;
+    struct { uint16_t handle; }                                 suspend;
+    struct { uint16_t handle; wiced_bt_a2dp_codec_info_t codec; } codec_config;
+} wiced_bt_a2dp_sink_event_data_t;
+
+typedef void (*wiced_bt_a2dp_sink_control_cb_t)( wiced_bt_a2dp_sink_event_t event, wiced_bt_a2dp_sink_event_data_t *p_data );
+
+extern wiced_result_t wiced_bt_a2dp_sink_init( wiced_bt_a2dp_config_data_t *p_config_data, wiced_bt_a2dp_sink_control_cb_t control_cb );
+extern wiced_result_t wiced_bt_a2dp_sink_send_start_response( uint16_t handle, uint8_t label, uint8_t status );
+extern wiced_result_t wiced_bt_a2dp_sink_suspend( uint16_t handle );
+extern wiced_result_t wiced_bt_a2dp_sink_start( uint16_t handle );
+
+/******************************************************************************
+ *  Firmware upgrade library, wiced_firmware_upgrade.h. The inactive image is a
+ *  HANDSFREE_STUB_OTA_SIZE byte array.
+ ******************************************************************************/
+#define HANDSFREE_STUB_OTA_SIZE             ( 512 * 1024 )
+
+extern wiced_bool_t wiced_firmware_upgrade_init_nv_locations( void );
+extern uint32_t wiced_firmware_upgrade_store_to_nv( uint32_t offset, uint8_t *p_data, uint32_t len );
+extern uint32_t wiced_firmware_upgrade_retrieve_from_nv( uint32_t offset, uint8_t *p_data, uint32_t len );
+extern void wiced_firmware_upgrade_finish( void );
+
+/******************************************************************************
+ *  Host harness
+ *
+ *  A wiced_stub_t is the simulated controller and SDK of one device: its clock,
+ *  timers, event queue, NVRAM, OTA flash, HFP profile and audio manager. The calling
+ *  thread works on the device selected with wiced_stub_select(), the first call to any
+ *  stub function creates a default device running on the real clock.
+ ******************************************************************************/
+typedef struct wiced_stub_s wiced_stub_t;
+
+#define WICED_STUB_STREAM_TYPES         ( HFP + 1 )
+
+/* Audio manager and codec bus activity, see wiced_am_stream_set_param() */
+typedef struct
+{
+    uint32_t    opens;
+    uint32_t    closes;
+    uint32_t    starts;
+    uint32_t    stops;
+    uint32_t    set_params;         /* wiced_am_stream_set_param() calls */
+    uint32_t    reg_writes;         /* Codec register writes they caused */
+    uint64_t    bus_us;             /* Time the codec control bus was busy */
+    uint64_t    started_us[WICED_STUB_STREAM_TYPES];    /* By stream type: last start done */
+    uint64_t    stopped_us[WICED_STUB_STREAM_TYPES];    /* and last stop begun */
+} wiced_stub_codec_stats_t;
+
+extern wiced_stub_t *wiced_stub_new( wiced_bool_t virtual_time );
+extern void wiced_stub_delete( wiced_stub_t *p_stub );
+extern wiced_stub_t *wiced_stub_select( wiced_stub_t *p_stub );
+extern wiced_stub_t *wiced_stub_current( void );
+
+/* Application loop. Both run posted events and expired timers on the calling thread. */
+extern int wiced_stub_run( uint32_t timeout_ms );      /* Wait up to timeout_ms for work */
+extern int wiced_stub_run_pending( void );             /* Only what is ready now */
+extern void wiced_stub_post( wiced_stub_t *p_stub, int (*p_fn)( void *p_data ), void *p_data );
+/* Called by wiced_stub_post() on the posting thread once the event is queued */
+extern void wiced_stub_set_notify( wiced_stub_t *p_stub, void (*p_notify)( void *p_context ), void *p_context );
+extern void wiced_stub_advance_us( uint64_t us );      /* Virtual clock, fires timers on the way */
+extern uint64_t wiced_stub_next_timer_us( void );      /* Deadline of the next timer, UINT64_MAX if none */
+
+/* Stack and profile events */
+extern void wiced_stub_management_event( wiced_bt_management_evt_t event, wiced_bt_management_evt_data_t *p_data );
+extern void wiced_stub_hfp_event( wiced_bt_hfp_hf_event_t event, wiced_bt_hfp_hf_event_data_t *p_data );
+extern void wiced_stub_a2dp_event( wiced_bt_a2dp_sink_event_t event, wiced_bt_a2dp_sink_event_data_t *p_data );
+extern wiced_bt_hfp_hf_scb_t *wiced_stub_hfp_add_scb( uint16_t handle, const wiced_bt_device_address_t bd_addr,
+                                                      uint32_t peer_features );
+
+/* What the application did */
+extern uint32_t wiced_stub_at_count( void );                       /* AT commands sent to the AG */
+extern const char *wiced_stub_at_last( void );
+extern const wiced_bt_sco_params_t *wiced_stub_sco_params( void ); /* Last accept or initiate, NULL if none */
+extern wiced_bt_sco_data_cb_t wiced_stub_sco_data_cb( void );
+extern uint32_t wiced_stub_sco_output( int16_t *p_samples, uint32_t max_samples );  /* Drain wiced_bt_sco_output_stream() */
+extern const wiced_stub_codec_stats_t *wiced_stub_codec_stats( void );
+extern int32_t wiced_stub_am_open_stream( int stream_type );       /* Open stream id or WICED_AUDIO_MANAGER_STREAM_ID_INVALID */
+extern uint32_t wiced_stub_buffers_in_use( void );
+extern uint32_t wiced_stub_resets( void );
+extern const uint8_t *wiced_stub_ota_image( wiced_bool_t *p_finished );
+
+/* Radio conditions reported to the application */
+extern void wiced_stub_set_rssi( int8_t rssi );
+
+#ifdef __cplusplus
+}
+#endif